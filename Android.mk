@@ -2,7 +2,7 @@ ifeq ($(call my-dir),$(call project-path-for,qcom-display))
 
 ifneq ($(TARGET_DISABLE_DISPLAY),true)
 sdm-libs := sdm/libs
-display-hals := include libdebug $(sdm-libs)/utils $(sdm-libs)/core
+display-hals := include libdebug $(sdm-libs)/utils $(sdm-libs)/core sdm/tools
 
 ifneq ($(TARGET_IS_HEADLESS), true)
     display-hals += libmemtrack hdmi_cec \
@@ -62,6 +62,8 @@
 #define PREFER_SOURCE_SPLIT_PROP             DISPLAY_PROP("prefer_source_split")
 #define MIXER_RESOLUTION_PROP                DISPLAY_PROP("mixer_resolution")
 #define SIMULATED_CONFIG_PROP                DISPLAY_PROP("simulated_config")
+#define SIM_CAPS_FILE_PROP                   DISPLAY_PROP("sim_caps_file")
+#define ENABLE_SIM_BACKEND_PROP              DISPLAY_PROP("enable_sim_backend")
 #define MAX_EXTERNAL_LAYERS_PROP             DISPLAY_PROP("max_external_layers")
 #define PERF_HINT_WINDOW_PROP                DISPLAY_PROP("perf_hint_window")
 #define ENABLE_EXTERNAL_DOWNSCALE_PROP       DISPLAY_PROP("enable_external_downscale")
@@ -88,6 +90,22 @@
 #define PRIORITIZE_CACHE_COMPOSITION_PROP    DISPLAY_PROP("prioritize_cache_comp")
 #define DROP_SKEWED_VSYNC_PROP               DISPLAY_PROP("drop_skewed_vsync")
 #define DISABLE_FBID_CACHE                   DISPLAY_PROP("disable_fbid_cache")
+#define FBID_CACHE_SIZE_PROP                 DISPLAY_PROP("fbid_cache_size")
+#define FBID_CACHE_MAX_MB_PROP               DISPLAY_PROP("fbid_cache_max_mb")
+#define DISABLE_ATOMIC_DELTA_PROP            DISPLAY_PROP("disable_atomic_delta")
+#define DISABLE_VALIDATE_CACHE_PROP          DISPLAY_PROP("disable_validate_cache")
+#define DISABLE_PP_FEATURE_CACHE_PROP        DISPLAY_PROP("disable_pp_feature_cache")
+#define DISABLE_COMP_CACHE_PROP              DISPLAY_PROP("disable_comp_cache")
+#define TRACE_LAYER_STACK_PROP               DISPLAY_PROP("trace_layer_stack")
+#define DISABLE_COST_MODEL_PROP              DISPLAY_PROP("disable_cost_model")
+#define ENABLE_FRAME_STATS_PROP              DISPLAY_PROP("enable_frame_stats")
+#define FRAME_DUMP_ENCODING_PROP             DISPLAY_PROP("frame_dump_encoding")
+#define FRAME_DUMP_STAGING_MB_PROP           DISPLAY_PROP("frame_dump_staging_mb")
+#define ENABLE_POST_COMMIT_WORKER_PROP       DISPLAY_PROP("enable_post_commit_worker")
+#define TRACE_BUFFER_EVENTS_PROP             DISPLAY_PROP("trace_buffer_events")
+#define ENABLE_SW_VSYNC_PROP                 DISPLAY_PROP("enable_sw_vsync")
+#define SW_VSYNC_ERROR_US_PROP               DISPLAY_PROP("sw_vsync_error_us")
+#define DISABLE_DEFAULT_OVERLAY_PROP         DISPLAY_PROP("disable_default_overlay")
 
 #define DISABLE_HDR_LUT_GEN                  DISPLAY_PROP("disable_hdr_lut_gen")
 #define ENABLE_DEFAULT_COLOR_MODE            DISPLAY_PROP("enable_default_color_mode")
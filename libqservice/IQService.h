@@ -80,6 +80,8 @@ public:
         SET_DSI_CLK = 38, // Set DSI Clk.
         GET_DSI_CLK = 39, // Get DSI Clk.
         GET_SUPPORTED_DSI_CLK = 40, // Get supported DSI Clk.
+        GET_FRAME_STATS = 41, // Get frame timing statistics of a display.
+        DUMP_TRACE_BUFFER = 42, // Write the in process trace buffer to the dump directory.
         COMMAND_LIST_END = 400,
     };
 
@@ -37,6 +37,7 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <utils/frame_stats.h>
 
 #include "layer_stack.h"
 #include "sdm_types.h"
@@ -729,6 +730,16 @@ class DisplayInterface {
   */
   virtual std::string Dump() = 0;
 
+  /*! @brief Method to get the frame timing statistics of the display, collected when
+      enable_frame_stats property is set.
+
+    @param[out] snapshot \link FrameStatsSnapshot \endlink
+    @param[in] reset clear the statistics after reading them
+
+    @return \link DisplayError \endlink
+  */
+  virtual DisplayError GetFrameStats(FrameStatsSnapshot *snapshot, bool reset) = 0;
+
   /*! @brief Method to dynamically set DSI clock rate.
 
     @param[in] bit_clk_rate DSI bit clock rate in HZ.
@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 #include <color_metadata.h>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -38,6 +39,8 @@
 
 namespace sdm {
 
+class Fence;
+
 #define NUM_UBWC_CR_STATS_LAYERS 2
 typedef std::vector<std::pair<int, int>> UbwcCrStatsVector;
 
@@ -268,6 +271,12 @@ struct LayerBuffer {
                                 //!< by display manager when buffer is already available for
                                 //!< read/write.
 
+  std::shared_ptr<Fence> release_fence;
+                                //!< Release fence of an input buffer, set by display manager
+                                //!< during Commit() in place of release_fence_fd. The same fence
+                                //!< may be shared by several layers and its fd is owned by the
+                                //!< fence, use FenceManager to get an fd owned by the client.
+
   LayerBufferFlags flags;       //!< Flags associated with this buffer.
 
   LayerBufferS3DFormat s3d_format = kS3dFormatNone;
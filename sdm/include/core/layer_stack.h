@@ -312,10 +312,6 @@ struct LayerSolidFill {
   uint32_t alpha = 0;      //!< Alpha value
 };
 
-struct LayerBufferMap {
-  std::unordered_map<uint64_t, std::shared_ptr<LayerBufferObject>> buffer_map;
-};
-
 /*! @brief This structure defines display layer object which contains layer properties and a drawing
   buffer.
 
@@ -388,7 +384,14 @@ struct Layer {
   Lut3d lut_3d = {};                               //!< o/p - Populated by SDM when tone mapping is
                                                    //!< needed on this layer.
   LayerSolidFill solid_fill_info = {};             //!< solid fill info along with depth.
-  std::shared_ptr<LayerBufferMap> buffer_map = nullptr;  //!< Map of handle_id and fb_id.
+
+  uint64_t geometry_fingerprint = 0;               //!< Hash of the layer geometry, blending,
+                                                   //!< transform, z-order and buffer format/size
+                                                   //!< maintained by the client on every change.
+                                                   //!< Display device uses it to reuse the
+                                                   //!< composition of a previously validated layer
+                                                   //!< stack. 0 indicates that client does not
+                                                   //!< track it and stack shall not be cached.
 };
 
 /*! @brief This structure defines a layer stack that contains layers which need to be composed and
@@ -60,6 +60,7 @@ class Debug {
   static bool IsExtAnimDisabled();
   static bool IsPartialSplitDisabled();
   static bool IsSrcSplitPreferred();
+  static bool IsSimBackendEnabled();
   static DisplayError GetMixerResolution(uint32_t *width, uint32_t *height);
   static DisplayError GetWindowRect(float *left, float *top, float *right, float *bottom);
   static DisplayError GetReducedConfig(uint32_t *num_vig_pipes, uint32_t *num_dma_pipes);
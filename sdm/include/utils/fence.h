@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __FENCE_H__
+#define __FENCE_H__
+
+#include <core/buffer_sync_handler.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace sdm {
+
+struct FenceStats {
+  uint64_t live = 0;            // Fences currently owning an fd.
+  uint64_t peak_live = 0;       // Highest live count seen since the counters were reset.
+  uint64_t created = 0;         // Fds handed over to the fence manager.
+  uint64_t closed = 0;          // Fds closed on the last reference drop.
+  uint64_t exported = 0;        // Fds handed out of the fence manager without a dup.
+  uint64_t dups = 0;            // Fds duplicated to hand out a shared fence.
+  uint64_t merges = 0;          // Merge calls to the buffer sync handler.
+  uint64_t merges_skipped = 0;  // Merge inputs dropped as empty or already present.
+};
+
+// Sync fence shared by reference. The fd is owned by the fence and closed when the last reference
+// goes away, so any number of layers can hold the same release fence without a dup each.
+class Fence {
+ public:
+  ~Fence();
+  int Get() const { return fd_; }
+
+ private:
+  friend class FenceManager;
+
+  explicit Fence(int fd) : fd_(fd) { }
+  Fence(const Fence &) = delete;
+  Fence &operator=(const Fence &) = delete;
+
+  int fd_ = -1;
+};
+
+// Creates, merges and hands out shared fences, and keeps process wide fd accounting for them.
+// A live count that keeps growing across frames in the dump points at a leaked reference.
+class FenceManager {
+ public:
+  static void Init(BufferSyncHandler *buffer_sync_handler);
+
+  // Takes ownership of fd. Returns an empty reference for an invalid fd.
+  static std::shared_ptr<Fence> Create(int fd);
+  static int Get(const std::shared_ptr<Fence> &fence) { return fence ? fence->Get() : -1; }
+
+  // Returns an fd owned by the caller. Dup() always duplicates, Export() hands over the fd of a
+  // fence without other references and only duplicates when the fence is still shared.
+  static int Dup(const std::shared_ptr<Fence> &fence);
+  static int Export(std::shared_ptr<Fence> *fence);
+
+  // Merges all fences in a balanced tree, so each sync point is copied log(n) times instead of n.
+  // Empty references and repeated references to the same fence are dropped first, which makes
+  // merging fences of layers sharing one release fence free. If a merge fails, the first fence of
+  // the failed pair stands in for both and the error is returned along with the partial result.
+  static DisplayError Merge(const std::vector<std::shared_ptr<Fence>> &fences,
+                            std::shared_ptr<Fence> *merged);
+  static DisplayError Merge(const std::shared_ptr<Fence> &fence1,
+                            const std::shared_ptr<Fence> &fence2, std::shared_ptr<Fence> *merged);
+  static DisplayError Wait(const std::shared_ptr<Fence> &fence);
+
+  static void GetStats(FenceStats *stats);
+  static void ResetStats();
+  static void Dump(std::ostringstream *os);
+
+ private:
+  friend class Fence;
+
+  static DisplayError MergePair(const std::shared_ptr<Fence> &fence1,
+                                const std::shared_ptr<Fence> &fence2,
+                                std::shared_ptr<Fence> *merged);
+  static void OnClose() {
+    closed_.fetch_add(1, std::memory_order_relaxed);
+    live_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  static std::atomic<BufferSyncHandler *> buffer_sync_handler_;
+  static std::atomic<uint64_t> live_;
+  static std::atomic<uint64_t> peak_live_;
+  static std::atomic<uint64_t> created_;
+  static std::atomic<uint64_t> closed_;
+  static std::atomic<uint64_t> exported_;
+  static std::atomic<uint64_t> dups_;
+  static std::atomic<uint64_t> merges_;
+  static std::atomic<uint64_t> merges_skipped_;
+};
+
+}  // namespace sdm
+
+#endif  // __FENCE_H__
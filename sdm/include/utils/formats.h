@@ -50,12 +50,88 @@ struct FormatTileSize {
   uint32_t uv_tile_height = 0;
 };
 
-bool IsUBWCFormat(LayerBufferFormat format);
-bool Is10BitFormat(LayerBufferFormat format);
-const char *GetFormatString(const LayerBufferFormat &format);
-BufferLayout GetBufferLayout(LayerBufferFormat format);
+// Tile size of a UBWC YUV format, for the Y plane and the UV plane. Zero for other formats.
+struct FormatTile {
+  uint32_t width;
+  uint32_t height;
+  uint32_t uv_width;
+  uint32_t uv_height;
+};
+
+// Static properties of a LayerBufferFormat. All of them come from one table, indexed by
+// GetFormatIndex(), so that format queries on the per layer path are plain loads. Kept a plain
+// aggregate, so that the tables can be constant initialized.
+struct FormatTraits {
+  LayerBufferFormat format;
+  const char *name;
+  float bpp;         // Bytes per pixel, averaged over all planes.
+  uint32_t planes;   // Number of color planes, not counting UBWC metadata planes.
+  bool ubwc;
+  bool ten_bit;
+  BufferLayout layout;
+  FormatTile tile;
+};
+
+// Formats are grouped by the upper byte of their value. The index packs the groups into one dense
+// range, tables indexed by it hold an entry for every format in enum order.
+constexpr uint32_t kFormatGroupSize[] = {
+  kFormatRGB101010 + 1,
+  kFormatYCrCb420PlanarStride16 - kFormatYCbCr420Planar + 1,
+  kFormatYCbCr420P010Venus - kFormatYCbCr420SemiPlanar + 1,
+  kFormatCbYCrY422H2V1Packed - kFormatYCbCr422H2V1Packed + 1,
+};
+constexpr uint32_t kFormatGroupBase[] = {
+  0,
+  kFormatGroupSize[0],
+  kFormatGroupSize[0] + kFormatGroupSize[1],
+  kFormatGroupSize[0] + kFormatGroupSize[1] + kFormatGroupSize[2],
+};
+constexpr uint32_t kFormatCount = kFormatGroupBase[3] + kFormatGroupSize[3];
+
+// Returns kFormatCount for kFormatInvalid and values outside the enum.
+constexpr uint32_t GetFormatIndex(LayerBufferFormat format) {
+  return ((format >> 8) < 4 && (format & 0xff) < kFormatGroupSize[format >> 8]) ?
+         kFormatGroupBase[format >> 8] + (format & 0xff) : kFormatCount;
+}
+
+// True when a table indexed by GetFormatIndex() holds every format, each at its own index. Checks
+// the entries from index on.
+template <typename T, uint32_t N>
+constexpr bool IsFormatTableComplete(const T (&table)[N], uint32_t index = 0) {
+  return (index == N) ? (N == kFormatCount) :
+         (GetFormatIndex(table[index].format) == index && IsFormatTableComplete(table, index + 1));
+}
+
+// The table behind the queries below, kInvalidFormatTraits is returned for unknown formats.
+extern const FormatTraits kFormatTraits[kFormatCount];
+extern const FormatTraits kInvalidFormatTraits;
+
+inline const FormatTraits &GetFormatTraits(LayerBufferFormat format) {
+  uint32_t index = GetFormatIndex(format);
+  return (index < kFormatCount) ? kFormatTraits[index] : kInvalidFormatTraits;
+}
+
+inline bool IsUBWCFormat(LayerBufferFormat format) {
+  return GetFormatTraits(format).ubwc;
+}
+
+inline bool Is10BitFormat(LayerBufferFormat format) {
+  return GetFormatTraits(format).ten_bit;
+}
+
+inline const char *GetFormatString(const LayerBufferFormat &format) {
+  return GetFormatTraits(format).name;
+}
+
+inline BufferLayout GetBufferLayout(LayerBufferFormat format) {
+  return GetFormatTraits(format).layout;
+}
+
+inline float GetBufferFormatBpp(LayerBufferFormat format) {
+  return GetFormatTraits(format).bpp;
+}
+
 DisplayError GetBufferFormatTileSize(LayerBufferFormat format, FormatTileSize *tile_size);
-float GetBufferFormatBpp(LayerBufferFormat format);
 
 }  // namespace sdm
 
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __FRAME_STATS_H__
+#define __FRAME_STATS_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <sstream>
+
+namespace sdm {
+
+enum FrameStage {
+  kStageBuildLayerStack,  // HWCDisplay::BuildLayerStack()
+  kStagePrepare,          // DisplayBase::Prepare()
+  kStageStrategy,         // CompManager::Prepare(), once per strategy attempt
+  kStageHWValidate,       // HWInterface::Validate(), once per strategy attempt
+  kStageCommit,           // DisplayBase::Commit()
+  kStageHWCommit,         // HWInterface::Commit()
+  kStagePostCommit,       // DisplayBase::PostCommit(), inline or on the post commit worker
+  kStageMax,
+};
+
+struct FrameStageSummary {
+  uint64_t count = 0;
+  uint64_t mean_ns = 0;
+  uint64_t p50_ns = 0;
+  uint64_t p90_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t max_ns = 0;
+};
+
+struct FrameStatsSnapshot {
+  static const uint32_t kMaxRetries = 8;  // Last bucket counts kMaxRetries or more retries.
+
+  uint64_t frames = 0;
+  FrameStageSummary stages[kStageMax];
+  uint64_t retries[kMaxRetries + 1] = {};
+};
+
+// Log-linear histogram of durations. All storage is preallocated and updates are lock free.
+class LatencyHistogram {
+ public:
+  void Record(uint64_t value_ns);
+  void GetSummary(FrameStageSummary *summary) const;
+  void Reset();
+
+ private:
+  // Values below 2^kSubBucketBits ns get a bucket each, every higher power of two range is split
+  // into kSubBucketCount linear sub buckets, which bounds the relative error to 1/kSubBucketCount.
+  static const uint32_t kSubBucketBits = 4;
+  static const uint32_t kSubBucketCount = 1 << kSubBucketBits;
+  static const uint32_t kMaxShift = 36;
+  static const uint32_t kNumBuckets = (kMaxShift + 2) * kSubBucketCount;
+
+  static uint32_t GetBucketIndex(uint64_t value_ns);
+  static uint64_t GetBucketValue(uint32_t index);
+  uint64_t GetPercentile(uint64_t count, uint32_t percentile) const;
+
+  std::atomic<uint64_t> count_ {0};
+  std::atomic<uint64_t> sum_ns_ {0};
+  std::atomic<uint64_t> max_ns_ {0};
+  std::atomic<uint32_t> buckets_[kNumBuckets] = {};
+};
+
+// Per display frame timing statistics. Every recorded stage goes into a log-linear latency
+// histogram and into a ring buffer holding the most recent stage timestamps. All storage is
+// preallocated and all updates are lock free, so recording can be done from the composition path
+// while a dump is in progress on another thread.
+class FrameStats {
+ public:
+  static uint64_t GetTimeNs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+  }
+  static const char *GetStageName(FrameStage stage);
+
+  void Enable(bool enable) { enabled_.store(enable, std::memory_order_relaxed); }
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void BeginFrame() { frame_.fetch_add(1, std::memory_order_relaxed); }
+  void Record(FrameStage stage, uint64_t start_ns, uint64_t end_ns);
+  void RecordRetries(uint32_t retries);
+  void GetSnapshot(FrameStatsSnapshot *snapshot) const;
+  void Dump(std::ostringstream *os) const;
+  void Reset();
+
+ private:
+  static const uint32_t kRingSize = 256;  // Must be a power of two.
+  static const uint32_t kDumpRecords = 16;
+
+  // Seqlock protected slot, seq is odd while the writer is updating it.
+  struct StageRecord {
+    std::atomic<uint32_t> seq {0};
+    std::atomic<uint32_t> stage {0};
+    std::atomic<uint64_t> frame {0};
+    std::atomic<uint64_t> start_ns {0};
+    std::atomic<uint64_t> end_ns {0};
+  };
+
+  std::atomic<bool> enabled_ {false};
+  std::atomic<uint64_t> frame_ {0};
+  std::atomic<uint64_t> frame_base_ {0};  // Value of frame_ at the last Reset().
+  std::atomic<uint32_t> write_index_ {0};
+  LatencyHistogram histograms_[kStageMax];
+  std::atomic<uint32_t> retries_[FrameStatsSnapshot::kMaxRetries + 1] = {};
+  StageRecord records_[kRingSize];
+};
+
+// Records the time spent in the enclosing scope as the given stage, when stats are enabled.
+class FrameStageTimer {
+ public:
+  FrameStageTimer(FrameStats *frame_stats, FrameStage stage)
+    : frame_stats_(frame_stats->IsEnabled() ? frame_stats : NULL), stage_(stage),
+      start_ns_(frame_stats_ ? FrameStats::GetTimeNs() : 0) { }
+  ~FrameStageTimer() {
+    if (frame_stats_) {
+      frame_stats_->Record(stage_, start_ns_, FrameStats::GetTimeNs());
+    }
+  }
+
+ private:
+  FrameStats *frame_stats_;
+  FrameStage stage_;
+  uint64_t start_ns_;
+};
+
+}  // namespace sdm
+
+#endif  // __FRAME_STATS_H__
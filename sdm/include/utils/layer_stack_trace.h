@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __LAYER_STACK_TRACE_H__
+#define __LAYER_STACK_TRACE_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <core/layer_stack.h>
+#include <vector>
+
+namespace sdm {
+
+// Records layer stacks into a compact binary trace file, one record per frame, and reads them
+// back for offline replay. Only the attributes which drive composition decisions are recorded,
+// buffer handles and fences are not.
+class LayerStackTrace {
+ public:
+  ~LayerStackTrace() { Close(); }
+
+  DisplayError Open(const char *file_name, bool record);
+  void Close();
+  bool IsOpen() const { return (file_ != NULL); }
+
+  // Appends one frame to the trace.
+  DisplayError Write(const LayerStack &layer_stack);
+
+  // Reads next frame from the trace. Layers are stored in the caller owned vector so that they
+  // persist across frames, layer_stack holds pointers to them. Returns kErrorUndefined at the end
+  // of the trace.
+  DisplayError Read(LayerStack *layer_stack, std::vector<Layer> *layers);
+
+ private:
+  static const uint32_t kMagic = 0x54534453;  // "SDST"
+  static const uint32_t kVersion = 1;
+
+  template <class T>
+  void Pack(const T &value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+  }
+
+  template <class T>
+  bool Unpack(T *value) {
+    if (offset_ + sizeof(T) > buffer_.size()) {
+      return false;
+    }
+    memcpy(value, &buffer_[offset_], sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  void PackRect(const LayerRect &rect);
+  bool UnpackRect(LayerRect *rect);
+  void PackRects(const std::vector<LayerRect> &rects);
+  bool UnpackRects(std::vector<LayerRect> *rects);
+  void PackLayer(const Layer &layer);
+  bool UnpackLayer(Layer *layer);
+
+  FILE *file_ = NULL;
+  bool record_ = false;
+  std::vector<uint8_t> buffer_ = {};  // Reused across frames to avoid per frame allocations.
+  size_t offset_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __LAYER_STACK_TRACE_H__
@@ -26,6 +26,7 @@
 #define __SYS_H__
 
 #include <sys/eventfd.h>
+#include <sys/epoll.h>
 #include <dlfcn.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -65,6 +66,9 @@ class Sys {
   typedef ssize_t (*read)(int, void *, size_t);
   typedef ssize_t (*write)(int, const void *, size_t);
   typedef int (*eventfd)(unsigned int, int);
+  typedef int (*epoll_create1)(int);
+  typedef int (*epoll_ctl)(int, int, int, struct epoll_event *);
+  typedef int (*epoll_wait)(int, struct epoll_event *, int, int);
 
   static bool getline_(fstream &fs, std::string &line);  // NOLINT
 
@@ -80,6 +84,9 @@ class Sys {
   static read read_;
   static write write_;
   static eventfd eventfd_;
+  static epoll_create1 epoll_create1_;
+  static epoll_ctl epoll_ctl_;
+  static epoll_wait epoll_wait_;
 };
 
 class DynLib {
@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __TRACE_BUFFER_H__
+#define __TRACE_BUFFER_H__
+
+#include <stdint.h>
+#include <core/sdm_types.h>
+#include <atomic>
+#include <vector>
+
+namespace sdm {
+
+enum TraceEventType {
+  kTraceBegin,
+  kTraceEnd,
+};
+
+// Fixed size trace record. Raw dumps store these back to back after a TraceFileHeader.
+struct TraceEvent {
+  static const uint32_t kNameLength = 48;
+
+  uint64_t timestamp_ns = 0;  // CLOCK_MONOTONIC
+  uint32_t tid = 0;
+  uint32_t type = kTraceBegin;
+  char name[kNameLength] = {};  // Truncated and always null terminated, empty for kTraceEnd.
+};
+
+struct TraceFileHeader {
+  static const uint32_t kMagic = 0x42544453;  // "SDTB"
+  static const uint32_t kVersion = 1;
+
+  uint32_t magic = kMagic;
+  uint32_t version = kVersion;
+  uint32_t event_size = sizeof(TraceEvent);
+  uint32_t num_events = 0;
+};
+
+// In process ring buffer for the events of the DTRACE_* macros, so that timelines can be
+// collected where atrace is not available. Slots are preallocated and recording is lock free, the
+// oldest events are overwritten once the ring is full. Each slot is guarded by a sequence number
+// which GetEvents() uses to skip slots that are overwritten while it copies them.
+class TraceBuffer {
+ public:
+  ~TraceBuffer();
+
+  // Allocates room for num_events, rounded up to a power of two, and starts recording. The ring
+  // can be set up once, later calls keep the existing one.
+  DisplayError Init(uint32_t num_events);
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void Record(TraceEventType type, const char *class_name, const char *function_name,
+              const char *custom_string);
+
+  // Copies the recorded events, oldest first.
+  void GetEvents(std::vector<TraceEvent> *events) const;
+
+  static DisplayError WriteRaw(const char *file_name, const std::vector<TraceEvent> &events);
+  static DisplayError ReadRaw(const char *file_name, std::vector<TraceEvent> *events);
+  // Writes the events in the Chrome trace event format, which chrome://tracing and Perfetto load.
+  // End events without a recorded begin, as left behind by ring wrap around, are dropped.
+  static DisplayError WriteChromeJson(const char *file_name, const std::vector<TraceEvent> &events,
+                                      int pid);
+
+ private:
+  static const uint32_t kMaxEvents = 1 << 20;
+  static const uint32_t kSlotWords = sizeof(TraceEvent) / sizeof(uint64_t);
+
+  // seq is 2 * index + 1 while event index is written to the slot and 2 * index + 2 after.
+  struct Slot {
+    std::atomic<uint64_t> seq {0};
+    std::atomic<uint64_t> words[kSlotWords];
+  };
+
+  static uint32_t GetThreadId();
+
+  Slot *slots_ = nullptr;
+  uint32_t mask_ = 0;
+  std::atomic<uint64_t> write_index_ {0};
+  std::atomic<bool> enabled_ {false};
+};
+
+}  // namespace sdm
+
+#endif  // __TRACE_BUFFER_H__
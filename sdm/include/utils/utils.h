@@ -30,15 +30,41 @@
 #ifndef __UTILS_H__
 #define __UTILS_H__
 
+#include <stdint.h>
+#include <string.h>
+
 namespace sdm {
 
 float gcd(float a, float b);
 float lcm(float a, float b);
 void CloseFd(int *fd);
 
+// Mixes value into seed, to build cache keys out of several fields.
+static inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Mixes size bytes at data into seed, a word at a time.
+static inline uint64_t HashBytes(uint64_t seed, const void *data, size_t size) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  uint64_t word = 0;
+  for (; size >= sizeof(word); size -= sizeof(word), bytes += sizeof(word)) {
+    memcpy(&word, bytes, sizeof(word));
+    seed = HashCombine(seed, word);
+  }
+  if (size) {
+    word = 0;
+    memcpy(&word, bytes, size);
+    seed = HashCombine(seed, word);
+  }
+
+  return seed;
+}
+
 enum class DriverType {
     FB = 0,
     DRM,
+    SIM,  // Software model of the display hardware, see Debug::IsSimBackendEnabled().
 };
 
 DriverType GetDriverType();
@@ -10,6 +10,7 @@ LOCAL_HEADER_LIBRARIES        := display_headers
 LOCAL_CFLAGS                  := -fno-operator-names -fexceptions -Wno-unused-parameter -DLOG_TAG=\"SDM\" \
                                  $(common_flags)
 LOCAL_HW_INTF_PATH_1          := fb
+LOCAL_HW_INTF_PATH_SIM        := sim
 LOCAL_SHARED_LIBRARIES        := libdl libdisplaydebug libsdmutils libutils
 
 ifneq ($(TARGET_IS_HEADLESS), true)
@@ -29,8 +30,10 @@ LOCAL_SRC_FILES               := core_interface.cpp \
                                  display_primary.cpp \
                                  display_hdmi.cpp \
                                  display_virtual.cpp \
+                                 post_commit_worker.cpp \
                                  comp_manager.cpp \
                                  strategy.cpp \
+                                 cost_model.cpp \
                                  resource_default.cpp \
                                  color_manager.cpp \
                                  hw_events_interface.cpp \
@@ -43,7 +46,10 @@ LOCAL_SRC_FILES               := core_interface.cpp \
                                  $(LOCAL_HW_INTF_PATH_1)/hw_virtual.cpp \
                                  $(LOCAL_HW_INTF_PATH_1)/hw_color_manager.cpp \
                                  $(LOCAL_HW_INTF_PATH_1)/hw_scale.cpp \
-                                 $(LOCAL_HW_INTF_PATH_1)/hw_events.cpp
+                                 $(LOCAL_HW_INTF_PATH_1)/hw_events.cpp \
+                                 $(LOCAL_HW_INTF_PATH_SIM)/hw_info_sim.cpp \
+                                 $(LOCAL_HW_INTF_PATH_SIM)/hw_device_sim.cpp \
+                                 $(LOCAL_HW_INTF_PATH_SIM)/hw_events_sim.cpp
 
 ifneq ($(TARGET_IS_HEADLESS), true)
     LOCAL_SRC_FILES           += $(LOCAL_HW_INTF_PATH_2)/hw_info_drm.cpp \
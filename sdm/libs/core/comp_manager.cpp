@@ -24,7 +24,9 @@
 
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/utils.h>
 #include <core/buffer_allocator.h>
+#include <algorithm>
 #include <map>
 #include <string>
 
@@ -63,6 +65,13 @@ DisplayError CompManager::Init(const HWResourceInfo &hw_res_info,
   buffer_allocator_ = buffer_allocator;
   extension_intf_ = extension_intf;
 
+  int value = 0;
+  Debug::GetProperty(DISABLE_COMP_CACHE_PROP, &value);
+  disable_comp_cache_ = (value == 1);
+  value = 0;
+  Debug::GetProperty(DISABLE_COST_MODEL_PROP, &value);
+  disable_cost_model_ = (value == 1);
+
   return error;
 }
 
@@ -134,10 +143,14 @@ DisplayError CompManager::RegisterDisplay(int32_t display_id,
   }
 
   registered_displays_[type] = 1;
+  display_comp_ctxs_.insert(display_comp_ctx);
+  comp_cache_generation_++;
   display_comp_ctx->is_primary_panel = hw_panel_info.is_primary_panel;
   display_comp_ctx->display_id = display_id;
   display_comp_ctx->display_type = type;
   display_comp_ctx->fb_config = fb_config;
+  display_comp_ctx->cost_model.Init(hw_res_info_);
+  display_comp_ctx->cost_model.Reconfigure(display_attributes, mixer_attributes);
   *display_ctx = display_comp_ctx;
   // New non-primary display device has been added, so move the composition mode to safe mode until
   // resources for the added display is configured properly.
@@ -173,6 +186,8 @@ DisplayError CompManager::UnregisterDisplay(Handle display_ctx) {
   registered_displays_.erase(display_comp_ctx->display_id);
   configured_displays_.erase(display_comp_ctx->display_id);
   powered_on_displays_.erase(display_comp_ctx->display_id);
+  display_comp_ctxs_.erase(display_comp_ctx);
+  comp_cache_generation_++;
 
   if (display_comp_ctx->display_type == kHDMI) {
     max_layers_ = kMaxSDELayers;
@@ -200,6 +215,8 @@ DisplayError CompManager::ReconfigureDisplay(Handle comp_handle,
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(comp_handle);
 
+  display_comp_ctx->comp_cache.clear();
+
   error = resource_intf_->ReconfigureDisplay(display_comp_ctx->display_resource_ctx,
                                              display_attributes, hw_panel_info, mixer_attributes);
   if (error != kErrorNone) {
@@ -236,6 +253,7 @@ DisplayError CompManager::ReconfigureDisplay(Handle comp_handle,
 
   // Update new resolution.
   display_comp_ctx->fb_config = fb_config;
+  display_comp_ctx->cost_model.Reconfigure(display_attributes, mixer_attributes);
   return error;
 }
 
@@ -275,6 +293,214 @@ void CompManager::PrepareStrategyConstraints(Handle comp_handle, HWLayers *hw_la
   }
 }
 
+// Hashes the layer state consumed by strategy and resource manager, after the display has applied
+// its own adjustments (e.g. scan adjustment of the destination rectangle) on top of the client's.
+static uint64_t HashLayer(uint64_t hash, const Layer &layer) {
+  const LayerBuffer &buffer = layer.input_buffer;
+
+  hash = HashBytes(hash, &layer.src_rect, sizeof(layer.src_rect));
+  hash = HashBytes(hash, &layer.dst_rect, sizeof(layer.dst_rect));
+  for (const LayerRect &rect : layer.visible_regions) {
+    hash = HashBytes(hash, &rect, sizeof(rect));
+  }
+  hash = HashCombine(hash, (UINT64(layer.composition) << 32) | layer.flags.flags);
+  hash = HashCombine(hash, (UINT64(layer.blending) << 40) | (UINT64(layer.plane_alpha) << 32) |
+                     layer.frame_rate);
+  hash = HashBytes(hash, &layer.transform.rotation, sizeof(layer.transform.rotation));
+  hash = HashCombine(hash, (UINT64(layer.transform.flip_horizontal) << 1) |
+                     UINT64(layer.transform.flip_vertical));
+  hash = HashCombine(hash, (UINT64(layer.solid_fill_color) << 32) | buffer.flags.flags);
+  hash = HashCombine(hash, (UINT64(buffer.width) << 32) | buffer.height);
+  hash = HashCombine(hash, (UINT64(buffer.unaligned_width) << 32) | buffer.unaligned_height);
+  hash = HashCombine(hash, (UINT64(buffer.format) << 32) | buffer.s3d_format);
+  hash = HashCombine(hash, (UINT64(buffer.color_metadata.colorPrimaries) << 32) |
+                     (UINT64(buffer.color_metadata.transfer) << 16) |
+                     UINT64(buffer.color_metadata.range));
+
+  return hash;
+}
+
+bool CompManager::GetCompositionCacheKey(Handle display_ctx, const HWLayers &hw_layers,
+                                         uint64_t *key) {
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  const HWLayersInfo &hw_layers_info = hw_layers.info;
+  const LayerStack *layer_stack = hw_layers_info.stack;
+
+  // Source pipes are shared across displays, so a composition is replayed only while this is the
+  // only active display. Partial update ROI and HDR tone mapping depend on per frame content.
+  if (disable_comp_cache_ || powered_on_displays_.size() > 1 || layer_stack->output_buffer ||
+      layer_stack->flags.attributes_changed || layer_stack->flags.hdr_present ||
+      (display_comp_ctx->pu_constraints.enable && display_comp_ctx->strategy->HasPartialUpdate())) {
+    return false;
+  }
+
+  LayerStackFlags stack_flags = layer_stack->flags;
+  stack_flags.geometry_changed = 0;
+
+  uint64_t hash = comp_cache_generation_;
+  hash = HashCombine(hash, (UINT64(safe_mode_) << 32) | max_layers_);
+  hash = HashCombine(hash, (UINT64(max_sde_builtin_layers_) << 32) | max_sde_ext_layers_);
+  hash = HashCombine(hash, (UINT64(display_comp_ctx->idle_fallback) << 2) |
+                     (UINT64(display_comp_ctx->thermal_fallback_) << 1) |
+                     UINT64(display_comp_ctx->pu_constraints.enable));
+  hash = HashCombine(hash, (UINT64(layer_stack->layers.size()) << 32) | stack_flags.flags);
+  hash = HashCombine(hash, (UINT64(hw_layers_info.app_layer_count) << 32) |
+                     hw_layers_info.gpu_target_index);
+
+  for (Layer *layer : layer_stack->layers) {
+    if (!layer->geometry_fingerprint) {
+      return false;
+    }
+
+    // The fingerprint tracks client attributes which have no direct counterpart in the layer,
+    // such as its z-order, the final layer state covers what the display derived from them.
+    hash = HashCombine(hash, layer->geometry_fingerprint);
+    hash = HashLayer(hash, *layer);
+  }
+
+  // 0 is reserved for stacks which can not be cached.
+  *key = hash ? hash : 1;
+
+  return true;
+}
+
+bool CompManager::ReplayCachedComposition(Handle display_ctx, HWLayers *hw_layers) {
+  SCOPE_LOCK(locker_);
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  uint64_t &key = display_comp_ctx->comp_cache_key;
+
+  if (!GetCompositionCacheKey(display_ctx, *hw_layers, &key)) {
+    key = 0;
+    return false;
+  }
+
+  std::list<CompositionCacheEntry> &comp_cache = display_comp_ctx->comp_cache;
+  auto it = std::find_if(comp_cache.begin(), comp_cache.end(),
+                         [key](const CompositionCacheEntry &entry) { return entry.key == key; });
+  if (it == comp_cache.end()) {
+    return false;
+  }
+
+  // Keep the entries in least recently used order.
+  comp_cache.splice(comp_cache.begin(), comp_cache, it);
+  const CompositionCacheEntry &entry = comp_cache.front();
+
+  HWLayersInfo &hw_layers_info = hw_layers->info;
+  std::vector<Layer *> &layers = hw_layers_info.stack->layers;
+  for (uint32_t i = 0; i < layers.size(); i++) {
+    layers.at(i)->composition = entry.composition.at(i);
+    layers.at(i)->request = entry.request.at(i);
+  }
+
+  hw_layers_info.index = entry.index;
+  hw_layers_info.roi_index = entry.roi_index;
+  hw_layers_info.hw_layers = entry.hw_layers;
+  for (uint32_t i = 0; i < hw_layers_info.hw_layers.size(); i++) {
+    // Geometry is the same as the cached one, only pick the buffer of the current frame.
+    Layer *layer = layers.at(hw_layers_info.index.at(i));
+    Layer &hw_layer = hw_layers_info.hw_layers.at(i);
+    hw_layer.input_buffer = layer->input_buffer;
+    // Pipe config holds pointers to its pair within the same HWLayers, which stay valid as the
+    // cache is owned by the display.
+    hw_layers->config[i] = entry.config[i];
+  }
+
+  hw_layers_info.left_frame_roi = entry.left_frame_roi;
+  hw_layers_info.right_frame_roi = entry.right_frame_roi;
+  hw_layers_info.partial_fb_roi = entry.partial_fb_roi;
+  hw_layers_info.roi_split = entry.roi_split;
+  hw_layers->output_compression = entry.output_compression;
+  hw_layers->qos_data = entry.qos_data;
+
+  // Reserve the pipes of the replayed composition through the resource manager, so that its pipe
+  // ownership matches what gets committed, exactly as for a composition from the strategy.
+  Handle &display_resource_ctx = display_comp_ctx->display_resource_ctx;
+  resource_intf_->Start(display_resource_ctx);
+  DisplayError error = resource_intf_->Prepare(display_resource_ctx, hw_layers);
+  DisplayError stop_error = resource_intf_->Stop(display_resource_ctx, hw_layers);
+  if (error == kErrorNone) {
+    error = stop_error;
+  }
+  if (error == kErrorNone) {
+    error = resource_intf_->PostPrepare(display_resource_ctx, hw_layers);
+  }
+  if (error != kErrorNone) {
+    // Resources have changed since the entry was cached, prepare the stack through the strategy.
+    DLOGV_IF(kTagCompManager, "Cached composition for display %d-%d could not be reserved, "
+             "error = %d", display_comp_ctx->display_id, display_comp_ctx->display_type, error);
+    comp_cache.pop_front();
+    return false;
+  }
+
+  DLOGV_IF(kTagCompManager, "Replayed cached composition for display %d-%d, key = %" PRIx64,
+           display_comp_ctx->display_id, display_comp_ctx->display_type, key);
+
+  return true;
+}
+
+void CompManager::UpdateCompositionCache(Handle display_ctx, const HWLayers &hw_layers) {
+  SCOPE_LOCK(locker_);
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  const HWLayersInfo &hw_layers_info = hw_layers.info;
+  uint32_t hw_layer_count = UINT32(hw_layers_info.hw_layers.size());
+
+  if (!display_comp_ctx->comp_cache_key) {
+    return;
+  }
+
+  // Destination scaler and offline rotator state is managed per frame, do not cache it.
+  if (!hw_layers_info.dest_scale_info_map.empty()) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < hw_layer_count; i++) {
+    if (hw_layers.config[i].hw_rotator_session.mode == kRotatorOffline) {
+      return;
+    }
+  }
+
+  std::list<CompositionCacheEntry> &comp_cache = display_comp_ctx->comp_cache;
+  if (comp_cache.size() >= kMaxCompositionCacheEntries) {
+    comp_cache.pop_back();
+  }
+
+  comp_cache.emplace_front();
+  CompositionCacheEntry &entry = comp_cache.front();
+  entry.key = display_comp_ctx->comp_cache_key;
+  for (Layer *layer : hw_layers_info.stack->layers) {
+    entry.composition.push_back(layer->composition);
+    entry.request.push_back(layer->request);
+  }
+
+  entry.index = hw_layers_info.index;
+  entry.roi_index = hw_layers_info.roi_index;
+  entry.hw_layers = hw_layers_info.hw_layers;
+  for (uint32_t i = 0; i < hw_layer_count; i++) {
+    entry.config[i] = hw_layers.config[i];
+  }
+
+  entry.left_frame_roi = hw_layers_info.left_frame_roi;
+  entry.right_frame_roi = hw_layers_info.right_frame_roi;
+  entry.partial_fb_roi = hw_layers_info.partial_fb_roi;
+  entry.roi_split = hw_layers_info.roi_split;
+  entry.output_compression = hw_layers.output_compression;
+  entry.qos_data = hw_layers.qos_data;
+
+  display_comp_ctx->comp_cache_key = 0;
+}
+
+void CompManager::InvalidateCompositionCache(Handle display_ctx) {
+  SCOPE_LOCK(locker_);
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+
+  display_comp_ctx->comp_cache.clear();
+  display_comp_ctx->comp_cache_key = 0;
+}
+
 void CompManager::PrePrepare(Handle display_ctx, HWLayers *hw_layers) {
   SCOPE_LOCK(locker_);
   DisplayCompositionContext *display_comp_ctx =
@@ -295,7 +521,8 @@ DisplayError CompManager::Prepare(Handle display_ctx, HWLayers *hw_layers) {
 
   PrepareStrategyConstraints(display_ctx, hw_layers);
 
-  // Select a composition strategy, and try to allocate resources for it.
+  // Select a composition strategy, and try to allocate resources for it. The resource manager
+  // holds the shared pipe pool between Start and Stop, once per Prepare as extensions expect.
   resource_intf_->Start(display_resource_ctx);
 
   bool exit = false;
@@ -343,6 +570,26 @@ DisplayError CompManager::PostPrepare(Handle display_ctx, HWLayers *hw_layers) {
   return kErrorNone;
 }
 
+DisplayError CompManager::CheckCost(Handle display_ctx, HWLayers *hw_layers) {
+  SCOPE_LOCK(locker_);
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+
+  if (disable_cost_model_) {
+    return kErrorNone;
+  }
+
+  CostEstimate estimate;
+  DisplayError error = display_comp_ctx->cost_model.Validate(*hw_layers, &estimate);
+  if (error != kErrorNone) {
+    DLOGI_IF(kTagCompManager, "Strategy rejected for display %d-%d, bw %" PRIu64 " KBps "
+             "clk %" PRIu64 " Hz", display_comp_ctx->display_id, display_comp_ctx->display_type,
+             estimate.total_bw, estimate.clk_hz);
+  }
+
+  return error;
+}
+
 DisplayError CompManager::Commit(Handle display_ctx, HWLayers *hw_layers) {
   SCOPE_LOCK(locker_);
 
@@ -412,6 +659,7 @@ void CompManager::Purge(Handle display_ctx) {
   resource_intf_->Purge(display_comp_ctx->display_resource_ctx);
 
   display_comp_ctx->strategy->Purge();
+  display_comp_ctx->comp_cache.clear();
 }
 
 DisplayError CompManager::SetIdleTimeoutMs(Handle display_ctx, uint32_t active_ms) {
@@ -458,6 +706,7 @@ void CompManager::ProcessIdlePowerCollapse(Handle display_ctx) {
   if (display_comp_ctx) {
     resource_intf_->Perform(ResourceInterface::kCmdResetScalarLUT,
                             display_comp_ctx->display_resource_ctx);
+    display_comp_ctx->comp_cache.clear();
   }
 }
 
@@ -471,6 +720,7 @@ DisplayError CompManager::SetMaxMixerStages(Handle display_ctx, uint32_t max_mix
   if (display_comp_ctx) {
     error = resource_intf_->SetMaxMixerStages(display_comp_ctx->display_resource_ctx,
                                               max_mixer_stages);
+    display_comp_ctx->comp_cache.clear();
   }
 
   return error;
@@ -504,7 +754,20 @@ DisplayError CompManager::SetMaxBandwidthMode(HWBwModes mode) {
     return kErrorNotSupported;
   }
 
-  return resource_intf_->SetMaxBandwidthMode(mode);
+  DisplayError error = resource_intf_->SetMaxBandwidthMode(mode);
+  if (error != kErrorNone) {
+    return error;
+  }
+
+  SCOPE_LOCK(locker_);
+  comp_cache_generation_++;
+  // Displays registered later pick up the current mode from the resource info.
+  hw_res_info_.dyn_bw_info.cur_mode = mode;
+  for (DisplayCompositionContext *display_comp_ctx : display_comp_ctxs_) {
+    display_comp_ctx->cost_model.SetBandwidthMode(hw_res_info_.dyn_bw_info, mode);
+  }
+
+  return kErrorNone;
 }
 
 DisplayError CompManager::GetScaleLutConfig(HWScaleLutInfo *lut_info) {
@@ -529,6 +792,7 @@ DisplayError CompManager::SetDetailEnhancerData(Handle display_ctx,
 
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  display_comp_ctx->comp_cache.clear();
 
   return resource_intf_->SetDetailEnhancerData(display_comp_ctx->display_resource_ctx, de_data);
 }
@@ -539,6 +803,7 @@ DisplayError CompManager::SetCompositionState(Handle display_ctx,
 
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  display_comp_ctx->comp_cache.clear();
 
   return display_comp_ctx->strategy->SetCompositionState(composition_type, enable);
 }
@@ -588,6 +853,7 @@ bool CompManager::SetDisplayState(Handle display_ctx,
   if (display_comp_ctx) {
     resource_intf_->Perform(ResourceInterface::kCmdUpdateSyncHandle,
                             display_comp_ctx->display_resource_ctx, sync_handle);
+    display_comp_ctx->comp_cache.clear();
   }
 
   bool inactive = (state == kStateOff) || (state == kStateDozeSuspend);
@@ -29,11 +29,14 @@
 #include <private/extension_interface.h>
 #include <utils/locker.h>
 #include <bitset>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "strategy.h"
+#include "cost_model.h"
 #include "resource_default.h"
 #include "hw_interface.h"
 
@@ -57,10 +60,14 @@ class CompManager {
                                   const HWMixerAttributes &mixer_attributes,
                                   const DisplayConfigVariableInfo &fb_config,
                                   uint32_t *default_clk_hz);
+  bool ReplayCachedComposition(Handle display_ctx, HWLayers *hw_layers);
+  void UpdateCompositionCache(Handle display_ctx, const HWLayers &hw_layers);
+  void InvalidateCompositionCache(Handle display_ctx);
   void PrePrepare(Handle display_ctx, HWLayers *hw_layers);
   DisplayError Prepare(Handle display_ctx, HWLayers *hw_layers);
   DisplayError Commit(Handle display_ctx, HWLayers *hw_layers);
   DisplayError PostPrepare(Handle display_ctx, HWLayers *hw_layers);
+  DisplayError CheckCost(Handle display_ctx, HWLayers *hw_layers);
   DisplayError ReConfigure(Handle display_ctx, HWLayers *hw_layers);
   DisplayError PostCommit(Handle display_ctx, HWLayers *hw_layers);
   void Purge(Handle display_ctx);
@@ -84,10 +91,29 @@ class CompManager {
  private:
   static const int kMaxThermalLevel = 3;
   static const int kSafeModeThreshold = 4;
+  static const uint32_t kMaxCompositionCacheEntries = 4;
+
+  // Composition of a successfully validated layer stack, replayed for a stack with the same key.
+  struct CompositionCacheEntry {
+    uint64_t key = 0;
+    std::vector<LayerComposition> composition {};
+    std::vector<LayerRequest> request {};
+    std::vector<Layer> hw_layers {};
+    std::vector<uint32_t> index {};
+    std::vector<uint32_t> roi_index {};
+    std::vector<LayerRect> left_frame_roi {};
+    std::vector<LayerRect> right_frame_roi {};
+    LayerRect partial_fb_roi {};
+    bool roi_split = false;
+    HWLayerConfig config[kMaxSDELayers] {};
+    float output_compression = 1.0f;
+    HWQosData qos_data {};
+  };
 
   void PrepareStrategyConstraints(Handle display_ctx, HWLayers *hw_layers);
   void UpdateStrategyConstraints(bool is_primary, bool disabled);
   std::string StringDisplayList(const std::map<int32_t, bool>& displays);
+  bool GetCompositionCacheKey(Handle display_ctx, const HWLayers &hw_layers, uint64_t *key);
 
   struct DisplayCompositionContext {
     Strategy *strategy = NULL;
@@ -104,6 +130,9 @@ class CompManager {
     bool is_primary_panel = false;
     PUConstraints pu_constraints = {};
     DisplayConfigVariableInfo fb_config = {};
+    std::list<CompositionCacheEntry> comp_cache = {};  // Most recently used entry first.
+    uint64_t comp_cache_key = 0;  // Key of the layer stack being prepared, 0 if not cacheable.
+    CostModel cost_model;
   };
 
   Locker locker_;
@@ -112,6 +141,7 @@ class CompManager {
   std::map<int32_t, bool> configured_displays_;  // List of sucessfully configured displays
   std::map<int32_t, uint32_t> display_state_;
   std::set<int32_t> powered_on_displays_;  // List of powered on displays.
+  std::set<DisplayCompositionContext *> display_comp_ctxs_;  // Contexts of registered displays
   bool safe_mode_ = false;              // Flag to notify all displays to be in resource crunch
                                         // mode, where strategy manager chooses the best strategy
                                         // that uses optimal number of pipes for each display
@@ -122,6 +152,9 @@ class CompManager {
   uint32_t max_sde_ext_layers_ = 0;
   uint32_t max_sde_builtin_layers_ = 2;
   DppsControlInterface *dpps_ctrl_intf_ = NULL;
+  bool disable_comp_cache_ = false;
+  bool disable_cost_model_ = false;
+  uint32_t comp_cache_generation_ = 0;  // Bumped on changes which affect all displays.
 };
 
 }  // namespace sdm
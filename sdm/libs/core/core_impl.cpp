@@ -27,6 +27,7 @@
 #include <utils/locker.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/fence.h>
 
 #include "core_impl.h"
 #include "display_primary.h"
@@ -50,6 +51,8 @@ DisplayError CoreImpl::Init() {
   SCOPE_LOCK(locker_);
   DisplayError error = kErrorNone;
 
+  FenceManager::Init(buffer_sync_handler_);
+
   // Try to load extension library & get handle to its interface.
   if (extension_lib_.Open(EXTENSION_LIBRARY_NAME)) {
     if (!extension_lib_.Sym(CREATE_EXTENSION_INTERFACE_NAME,
@@ -232,7 +235,12 @@ DisplayError CoreImpl::DestroyDisplay(DisplayInterface *intf) {
 DisplayError CoreImpl::SetMaxBandwidthMode(HWBwModes mode) {
   SCOPE_LOCK(locker_);
 
-  return comp_mgr_.SetMaxBandwidthMode(mode);
+  DisplayError error = comp_mgr_.SetMaxBandwidthMode(mode);
+  if (error == kErrorNone) {
+    HWInterface::UpdateConfigGeneration();
+  }
+
+  return error;
 }
 
 DisplayError CoreImpl::GetFirstDisplayInterfaceType(HWDisplayInterfaceInfo *hw_disp_info) {
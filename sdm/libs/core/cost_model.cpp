@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/formats.h>
+#include <utils/rect.h>
+#include <algorithm>
+
+#include "cost_model.h"
+
+#define __CLASS__ "CostModel"
+
+namespace sdm {
+
+void CostModel::Init(const HWResourceInfo &hw_res_info) {
+  if (hw_res_info.has_dyn_bw_support) {
+    const HWDynBwLimitInfo &bw_info = hw_res_info.dyn_bw_info;
+    SetBandwidthMode(bw_info, HWBwModes(bw_info.cur_mode));
+  } else {
+    total_bw_limit_ = hw_res_info.max_bandwidth_high;
+    pipe_bw_limit_ = hw_res_info.max_pipe_bw;
+  }
+
+  max_clk_hz_ = hw_res_info.max_sde_clk;
+  clk_fudge_factor_ = std::max(hw_res_info.clk_fudge_factor, 1.0f);
+  comp_ratio_map_ = hw_res_info.comp_ratio_rt_map;
+}
+
+void CostModel::SetBandwidthMode(const HWDynBwLimitInfo &bw_info, HWBwModes mode) {
+  if (mode >= kBwModeMax) {
+    return;
+  }
+
+  total_bw_limit_ = bw_info.total_bw_limit[mode];
+  pipe_bw_limit_ = bw_info.pipe_bw_limit[mode];
+}
+
+void CostModel::Reconfigure(const HWDisplayAttributes &display_attributes,
+                            const HWMixerAttributes &mixer_attributes) {
+  fps_ = FLOAT(display_attributes.fps);
+
+  // Mixer output is stretched over the active lines of the display timing, blanking included.
+  float mixer_height = FLOAT(mixer_attributes.height ? mixer_attributes.height :
+                             display_attributes.y_pixels);
+  line_count_ = mixer_height;
+  if (display_attributes.v_total > display_attributes.y_pixels && display_attributes.y_pixels) {
+    line_count_ *= FLOAT(display_attributes.v_total) / FLOAT(display_attributes.y_pixels);
+  }
+
+  mixer_width_ = FLOAT(mixer_attributes.width ? mixer_attributes.width :
+                       display_attributes.x_pixels);
+  if (display_attributes.is_device_split) {
+    mixer_width_ /= 2.0f;
+  }
+}
+
+float CostModel::GetCompressionRatio(const HWLayerConfig &hw_config,
+                                     LayerBufferFormat format) const {
+  float compression = hw_config.compression;
+  if (IsUBWCFormat(format)) {
+    auto it = comp_ratio_map_.find(format);
+    if (it != comp_ratio_map_.end()) {
+      compression = std::max(compression, it->second);
+    }
+  }
+
+  return std::max(compression, 1.0f);
+}
+
+void CostModel::EstimatePipe(const HWPipeInfo &pipe, LayerBufferFormat format, float compression,
+                             CostEstimate *estimate) const {
+  LayerRect src = pipe.src_roi;
+  LayerRect dst = pipe.dst_roi;
+  float dst_width = dst.right - dst.left;
+  float dst_height = dst.bottom - dst.top;
+  if (dst_width <= 0.0f || dst_height <= 0.0f) {
+    return;
+  }
+
+  // Decimated lines and pixels are never fetched.
+  float fetch_width = (src.right - src.left) / FLOAT(1 << pipe.horizontal_decimation);
+  float fetch_height = (src.bottom - src.top) / FLOAT(1 << pipe.vertical_decimation);
+  float v_scale = std::max(fetch_height / dst_height, 1.0f);
+  float line_rate = line_count_ * fps_ * v_scale;
+
+  uint64_t pipe_bw = UINT64(fetch_width * GetBufferFormatBpp(format) * line_rate / compression /
+                            1000.0f);
+  uint64_t pipe_clk = UINT64(dst_width * line_rate);
+
+  estimate->total_bw += pipe_bw;
+  estimate->max_pipe_bw = std::max(estimate->max_pipe_bw, pipe_bw);
+  estimate->clk_hz = std::max(estimate->clk_hz, pipe_clk);
+}
+
+void CostModel::Estimate(const HWLayers &hw_layers, CostEstimate *estimate) const {
+  const HWLayersInfo &hw_layers_info = hw_layers.info;
+  *estimate = CostEstimate();
+  estimate->clk_hz = UINT64(mixer_width_ * line_count_ * fps_);
+
+  for (uint32_t i = 0; i < hw_layers_info.hw_layers.size(); i++) {
+    const HWLayerConfig &hw_config = hw_layers.config[i];
+    if (hw_config.use_solidfill_stage) {
+      continue;
+    }
+
+    // Pipes fetch the rotator output when the layer is pre-rotated.
+    const HWRotatorSession &hw_rotator_session = hw_config.hw_rotator_session;
+    LayerBufferFormat format = hw_layers_info.hw_layers[i].input_buffer.format;
+    if (hw_rotator_session.mode != kRotatorNone) {
+      format = hw_rotator_session.output_buffer.format;
+    }
+    float compression = GetCompressionRatio(hw_config, format);
+
+    if (hw_config.left_pipe.valid) {
+      EstimatePipe(hw_config.left_pipe, format, compression, estimate);
+    }
+    if (hw_config.right_pipe.valid) {
+      EstimatePipe(hw_config.right_pipe, format, compression, estimate);
+    }
+  }
+
+  estimate->clk_hz = UINT64(FLOAT(estimate->clk_hz) * clk_fudge_factor_);
+}
+
+DisplayError CostModel::Validate(const HWLayers &hw_layers, CostEstimate *estimate) const {
+  uint64_t pipe_bw_limit = pipe_bw_limit_;
+  uint64_t total_bw_limit = total_bw_limit_;
+
+  Estimate(hw_layers, estimate);
+
+  if (pipe_bw_limit && estimate->max_pipe_bw > pipe_bw_limit) {
+    DLOGV_IF(kTagResources, "Pipe bandwidth %" PRIu64 " KBps exceeds %" PRIu64 " KBps",
+             estimate->max_pipe_bw, pipe_bw_limit);
+    return kErrorResources;
+  }
+
+  if (total_bw_limit && estimate->total_bw > total_bw_limit) {
+    DLOGV_IF(kTagResources, "Total bandwidth %" PRIu64 " KBps exceeds %" PRIu64 " KBps",
+             estimate->total_bw, total_bw_limit);
+    return kErrorResources;
+  }
+
+  if (max_clk_hz_ && estimate->clk_hz > max_clk_hz_) {
+    DLOGV_IF(kTagResources, "MDP clock %" PRIu64 " Hz exceeds %" PRIu64 " Hz", estimate->clk_hz,
+             max_clk_hz_);
+    return kErrorResources;
+  }
+
+  return kErrorNone;
+}
+
+}  // namespace sdm
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __COST_MODEL_H__
+#define __COST_MODEL_H__
+
+#include <core/display_interface.h>
+#include <private/hw_info_types.h>
+#include <atomic>
+
+namespace sdm {
+
+struct CostEstimate {
+  uint64_t total_bw = 0;     // Fetch bandwidth of all pipes in KBps
+  uint64_t max_pipe_bw = 0;  // Fetch bandwidth of the most expensive pipe in KBps
+  uint64_t clk_hz = 0;       // MDP core clock needed to process the frame
+};
+
+// Analytical model of the bandwidth and MDP clock a composition needs, computed the way the driver
+// votes for them: every pipe fetches its (decimated) source width for each line of the display
+// timing, scaled up by the vertical downscale ratio, and the core clock has to keep up with both
+// the mixer output and the most demanding pipe. Prefill and bus fudge factors are left out, so the
+// estimate stays below what the driver computes and a composition that is over budget here would
+// be rejected by the driver as well.
+class CostModel {
+ public:
+  void Init(const HWResourceInfo &hw_res_info);
+  // Bandwidth limits follow the bandwidth mode, which can change at any time for all displays.
+  void SetBandwidthMode(const HWDynBwLimitInfo &bw_info, HWBwModes mode);
+  void Reconfigure(const HWDisplayAttributes &display_attributes,
+                   const HWMixerAttributes &mixer_attributes);
+  void Estimate(const HWLayers &hw_layers, CostEstimate *estimate) const;
+  DisplayError Validate(const HWLayers &hw_layers, CostEstimate *estimate) const;
+
+ private:
+  void EstimatePipe(const HWPipeInfo &pipe, LayerBufferFormat format, float compression,
+                    CostEstimate *estimate) const;
+  float GetCompressionRatio(const HWLayerConfig &hw_config, LayerBufferFormat format) const;
+
+  std::atomic<uint64_t> total_bw_limit_ {0};
+  std::atomic<uint64_t> pipe_bw_limit_ {0};
+  uint64_t max_clk_hz_ = 0;
+  float clk_fudge_factor_ = 1.0f;
+  CompRatioMap comp_ratio_map_ = {};
+  float fps_ = 0.0f;
+  float line_count_ = 0.0f;      // Display timing lines spent per mixer frame
+  float mixer_width_ = 0.0f;     // Width processed by each layer mixer
+};
+
+}  // namespace sdm
+
+#endif  // __COST_MODEL_H__
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/fence.h>
 #include <utils/formats.h>
 #include <utils/rect.h>
 #include <utils/utils.h>
@@ -70,6 +71,8 @@ DisplayError DisplayBase::Init() {
 
   uint32_t active_index = 0;
   int drop_vsync = 0;
+  int enable_frame_stats = 0;
+  int enable_post_commit_worker = 0;
   hw_intf_->GetActiveConfig(&active_index);
   hw_intf_->GetDisplayAttributes(active_index, &display_attributes_);
   fb_config_ = display_attributes_;
@@ -134,6 +137,17 @@ DisplayError DisplayBase::Init() {
   SetPUonDestScaler();
   Debug::Get()->GetProperty(DROP_SKEWED_VSYNC_PROP, &drop_vsync);
   drop_skewed_vsync_ = (drop_vsync == 1);
+
+  Debug::Get()->GetProperty(ENABLE_FRAME_STATS_PROP, &enable_frame_stats);
+  frame_stats_.Enable(enable_frame_stats == 1);
+
+  Debug::Get()->GetProperty(ENABLE_POST_COMMIT_WORKER_PROP, &enable_post_commit_worker);
+  if (enable_post_commit_worker == 1) {
+    std::string name = "SDM_PostCommit - " + std::to_string(display_id_);
+    if (post_commit_worker_.Init(name) != kErrorNone) {
+      DLOGW("Post commit runs inline for display %d-%d", display_id_, display_type_);
+    }
+  }
   return kErrorNone;
 
 CleanupOnError:
@@ -148,6 +162,7 @@ CleanupOnError:
 DisplayError DisplayBase::Deinit() {
   {  // Scope for lock
     lock_guard<recursive_mutex> obj(recursive_mutex_);
+    post_commit_worker_.Deinit();
     ClearColorInfo();
     comp_manager_->UnregisterDisplay(display_comp_ctx_);
   }
@@ -164,9 +179,6 @@ DisplayError DisplayBase::BuildLayerStackStats(LayerStack *layer_stack) {
   hw_layers_info.stack = layer_stack;
 
   for (auto &layer : layers) {
-    if (layer->buffer_map == nullptr) {
-      layer->buffer_map = std::make_shared<LayerBufferMap>();
-    }
     if (layer->composition == kCompositionGPUTarget) {
       hw_layers_info.gpu_target_index = hw_layers_info.app_layer_count;
       break;
@@ -233,7 +245,9 @@ DisplayError DisplayBase::ValidateGPUTargetParams() {
 }
 
 DisplayError DisplayBase::Prepare(LayerStack *layer_stack) {
+  DTRACE_SCOPED();
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
   needs_validate_ = true;
   gpu_fallback_ = false;
@@ -247,6 +261,8 @@ DisplayError DisplayBase::Prepare(LayerStack *layer_stack) {
   }
 
   DLOGI_IF(kTagDisplay, "Entering Prepare for display: %d-%d", display_id_, display_type_);
+  frame_stats_.BeginFrame();
+  FrameStageTimer prepare_timer(&frame_stats_, kStagePrepare);
   error = BuildLayerStackStats(layer_stack);
   if (error != kErrorNone) {
     return error;
@@ -269,29 +285,55 @@ DisplayError DisplayBase::Prepare(LayerStack *layer_stack) {
     disable_pu_one_frame_ = false;
   }
 
-  comp_manager_->PrePrepare(display_comp_ctx_, &hw_layers_);
-  while (true) {
-    error = comp_manager_->Prepare(display_comp_ctx_, &hw_layers_);
-    if (error != kErrorNone) {
-      break;
+  // Layer stack matches a composition which has already been validated, reuse it as is.
+  if (comp_manager_->ReplayCachedComposition(display_comp_ctx_, &hw_layers_)) {
+    needs_validate_ = false;
+  } else {
+    uint32_t attempts = 0;
+    comp_manager_->PrePrepare(display_comp_ctx_, &hw_layers_);
+    while (true) {
+      {
+        FrameStageTimer strategy_timer(&frame_stats_, kStageStrategy);
+        DTRACE_BEGIN("Strategy");
+        error = comp_manager_->Prepare(display_comp_ctx_, &hw_layers_);
+        DTRACE_END();
+      }
+      if (error != kErrorNone) {
+        break;
+      }
+
+      attempts++;
+      // Skip the driver round trip for a strategy which is known to exceed bandwidth or clock.
+      error = comp_manager_->CheckCost(display_comp_ctx_, &hw_layers_);
+      if (error != kErrorNone) {
+        continue;
+      }
+
+      {
+        FrameStageTimer validate_timer(&frame_stats_, kStageHWValidate);
+        error = hw_intf_->Validate(&hw_layers_);
+      }
+      if (error == kErrorNone) {
+        // Strategy is successful now, wait for Commit().
+        needs_validate_ = false;
+        break;
+      }
+      if (error == kErrorShutDown) {
+        comp_manager_->PostPrepare(display_comp_ctx_, &hw_layers_);
+        return error;
+      }
     }
 
-    error = hw_intf_->Validate(&hw_layers_);
-    if (error == kErrorNone) {
-      // Strategy is successful now, wait for Commit().
-      needs_validate_ = false;
-      break;
+    comp_manager_->PostPrepare(display_comp_ctx_, &hw_layers_);
+    if (frame_stats_.IsEnabled() && attempts) {
+      frame_stats_.RecordRetries(attempts - 1);
     }
-    if (error == kErrorShutDown) {
-      comp_manager_->PostPrepare(display_comp_ctx_, &hw_layers_);
+
+    if (error != kErrorNone) {
       return error;
     }
-  }
 
-  comp_manager_->PostPrepare(display_comp_ctx_, &hw_layers_);
-
-  if (error != kErrorNone) {
-    return error;
+    comp_manager_->UpdateCompositionCache(display_comp_ctx_, hw_layers_);
   }
 
   error = ValidateHDR(layer_stack);
@@ -304,7 +346,9 @@ DisplayError DisplayBase::Prepare(LayerStack *layer_stack) {
 }
 
 DisplayError DisplayBase::Commit(LayerStack *layer_stack) {
+  DTRACE_SCOPED();
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
 
   if (!active_) {
@@ -336,6 +380,7 @@ DisplayError DisplayBase::Commit(LayerStack *layer_stack) {
   }
 
   DLOGI_IF(kTagDisplay, "Entering commit for display: %d-%d", display_id_, display_type_);
+  FrameStageTimer commit_timer(&frame_stats_, kStageCommit);
   CommitLayerParams(layer_stack);
 
   error = comp_manager_->Commit(display_comp_ctx_, &hw_layers_);
@@ -351,26 +396,64 @@ DisplayError DisplayBase::Commit(LayerStack *layer_stack) {
     DLOGW("ColorManager::Commit(...) isn't working");
   }
 
-  error = hw_intf_->Commit(&hw_layers_);
+  {
+    FrameStageTimer hw_commit_timer(&frame_stats_, kStageHWCommit);
+    error = hw_intf_->Commit(&hw_layers_);
+  }
   if (error != kErrorNone) {
+    // Do not replay a composition which the driver has rejected.
+    comp_manager_->InvalidateCompositionCache(display_comp_ctx_);
     return error;
   }
 
   PostCommitLayerParams(layer_stack);
   SetLutSwapFlag();
 
-  if (partial_update_control_) {
+  // Stop dropping vsync when first commit is received after idle fallback.
+  drop_hw_vsync_ = false;
+
+  // The out-fences are known at this point. Resource bookkeeping may complete on the post commit
+  // worker, every locked entry point which reaches comp_manager_ or hw_layers_ waits for it
+  // first. ReconfigureDisplay() waits just ahead of its comp_manager_ call, so config, mixer and
+  // refresh rate changes which do not alter the display attributes do not block on it.
+  bool enable_partial_update = partial_update_control_;
+  if (post_commit_worker_.IsActive()) {
+    post_commit_worker_.Post([this, enable_partial_update]() {
+      if (PostCommit(enable_partial_update) != kErrorNone) {
+        DLOGW("Deferred post commit failed for display %d-%d", display_id_, display_type_);
+      }
+    });
+  } else {
+    error = PostCommit(enable_partial_update);
+    if (error != kErrorNone) {
+      return error;
+    }
+  }
+
+  DLOGI_IF(kTagDisplay, "Exiting commit for display: %d-%d", display_id_, display_type_);
+  return kErrorNone;
+}
+
+DisplayError DisplayBase::PostCommit(bool enable_partial_update) {
+  DTRACE_SCOPED();
+  FrameStageTimer post_commit_timer(&frame_stats_, kStagePostCommit);
+  if (enable_partial_update) {
     comp_manager_->ControlPartialUpdate(display_comp_ctx_, true /* enable */);
   }
 
-  error = comp_manager_->PostCommit(display_comp_ctx_, &hw_layers_);
-  if (error != kErrorNone) {
-    return error;
+  return comp_manager_->PostCommit(display_comp_ctx_, &hw_layers_);
+}
+
+DisplayError DisplayBase::GetFrameStats(FrameStatsSnapshot *snapshot, bool reset) {
+  if (!snapshot) {
+    return kErrorParameters;
+  }
+
+  frame_stats_.GetSnapshot(snapshot);
+  if (reset) {
+    frame_stats_.Reset();
   }
 
-  // Stop dropping vsync when first commit is received after idle fallback.
-  drop_hw_vsync_ = false;
-  DLOGI_IF(kTagDisplay, "Exiting commit for display: %d-%d", display_id_, display_type_);
   return kErrorNone;
 }
 
@@ -380,6 +463,7 @@ bool DisplayBase::CanSkipValidate() {
 
 DisplayError DisplayBase::Flush(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
 
   if (!active_) {
@@ -430,6 +514,7 @@ DisplayError DisplayBase::GetConfig(uint32_t index, DisplayConfigVariableInfo *v
 
 DisplayError DisplayBase::GetConfig(DisplayConfigFixedInfo *fixed_info) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   fixed_info->is_cmdmode = (hw_panel_info_.mode == kModeCommand);
 
   HWResourceInfo hw_resource_info = {};
@@ -476,6 +561,7 @@ DisplayState DisplayBase::GetLastPowerMode() {
 
 DisplayError DisplayBase::SetDisplayState(DisplayState state, int *release_fence) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
   bool active = false;
 
@@ -568,6 +654,7 @@ DisplayError DisplayBase::SetActiveConfig(uint32_t index) {
 
 DisplayError DisplayBase::SetMaxMixerStages(uint32_t max_mixer_stages) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
 
   error = comp_manager_->SetMaxMixerStages(display_comp_ctx_, max_mixer_stages);
@@ -581,6 +668,7 @@ DisplayError DisplayBase::SetMaxMixerStages(uint32_t max_mixer_stages) {
 
 std::string DisplayBase::Dump() {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   HWDisplayAttributes attrib;
   uint32_t active_index = 0;
   uint32_t num_modes = 0;
@@ -594,6 +682,13 @@ std::string DisplayBase::Dump() {
   os << "\nstate: " << state_ << " vsync on: " << vsync_enable_ << " max. mixer stages: "
     << max_mixer_stages_;
   os << "\nnum configs: " << num_modes << " active config index: " << active_index;
+  if (frame_stats_.IsEnabled()) {
+    frame_stats_.Dump(&os);
+  }
+  hw_intf_->Dump(&os);
+  if (hw_events_intf_) {
+    hw_events_intf_->Dump(&os);
+  }
 
   os << "\nAvailable Color Modes:\n";
   for (auto it : color_mode_map_) {
@@ -1055,6 +1150,7 @@ DisplayError DisplayBase::ApplyDefaultDisplayMode() {
 
 DisplayError DisplayBase::SetCursorPosition(int x, int y) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   if (state_ != kStateOn) {
     return kErrorNotSupported;
   }
@@ -1140,6 +1236,9 @@ DisplayError DisplayBase::ReconfigureDisplay() {
     return kErrorNone;
   }
 
+  // Nothing above touches state of the post commit worker, so the check after each commit does
+  // not wait for the post commit it has just posted unless the display has actually changed.
+  post_commit_worker_.Wait();
   error = comp_manager_->ReconfigureDisplay(display_comp_ctx_, display_attributes, hw_panel_info,
                                             mixer_attributes, fb_config_,
                                             &(default_qos_data_.clock_hz));
@@ -1314,6 +1413,7 @@ bool DisplayBase::NeedsMixerReconfiguration(LayerStack *layer_stack, uint32_t *n
 
 DisplayError DisplayBase::SetFrameBufferConfig(const DisplayConfigVariableInfo &variable_info) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   uint32_t width = variable_info.x_pixels;
   uint32_t height = variable_info.y_pixels;
 
@@ -1362,6 +1462,7 @@ DisplayError DisplayBase::GetFrameBufferConfig(DisplayConfigVariableInfo *variab
 
 DisplayError DisplayBase::SetDetailEnhancerData(const DisplayDetailEnhancerData &de_data) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = comp_manager_->SetDetailEnhancerData(display_comp_ctx_, de_data);
   if (error != kErrorNone) {
     return error;
@@ -1425,6 +1526,7 @@ bool DisplayBase::IsPrimaryDisplay() {
 
 DisplayError DisplayBase::SetCompositionState(LayerComposition composition_type, bool enable) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
 
   return comp_manager_->SetCompositionState(display_comp_ctx_, composition_type, enable);
 }
@@ -1471,29 +1573,24 @@ void DisplayBase::PostCommitLayerParams(LayerStack *layer_stack) {
     Layer *sdm_layer = layer_stack->layers.at(sdm_layer_index);
     Layer &hw_layer = hw_layers_.info.hw_layers.at(i);
 
+    // Clients only get shared release fences, wrap the fd of devices that return one per layer.
+    std::shared_ptr<Fence> release_fence = std::move(hw_layer.input_buffer.release_fence);
+    if (!release_fence) {
+      release_fence = FenceManager::Create(hw_layer.input_buffer.release_fence_fd);
+    }
+    hw_layer.input_buffer.release_fence = nullptr;
+    hw_layer.input_buffer.release_fence_fd = -1;
+
     // Copy the release fence only once for a SDM Layer.
     // In S3D use case, two hw layers can share the same input buffer, So make sure to merge the
-    // output fence fd and assign it to layer's input buffer release fence fd.
+    // output fence and assign it to layer's input buffer release fence.
     if (std::find(fence_dup_flag.begin(), fence_dup_flag.end(), sdm_layer_index) ==
         fence_dup_flag.end()) {
-      sdm_layer->input_buffer.release_fence_fd = hw_layer.input_buffer.release_fence_fd;
+      sdm_layer->input_buffer.release_fence = release_fence;
       fence_dup_flag.push_back(sdm_layer_index);
     } else {
-      int temp = -1;
-      buffer_sync_handler_->SyncMerge(hw_layer.input_buffer.release_fence_fd,
-                                      sdm_layer->input_buffer.release_fence_fd, &temp);
-
-      if (hw_layer.input_buffer.release_fence_fd >= 0) {
-        Sys::close_(hw_layer.input_buffer.release_fence_fd);
-        hw_layer.input_buffer.release_fence_fd = -1;
-      }
-
-      if (sdm_layer->input_buffer.release_fence_fd >= 0) {
-        Sys::close_(sdm_layer->input_buffer.release_fence_fd);
-        sdm_layer->input_buffer.release_fence_fd = -1;
-      }
-
-      sdm_layer->input_buffer.release_fence_fd = temp;
+      FenceManager::Merge(sdm_layer->input_buffer.release_fence, release_fence,
+                          &sdm_layer->input_buffer.release_fence);
     }
   }
 
@@ -38,6 +38,7 @@
 #include "comp_manager.h"
 #include "color_manager.h"
 #include "hw_events_interface.h"
+#include "post_commit_worker.h"
 
 namespace sdm {
 
@@ -131,6 +132,7 @@ class DisplayBase : public DisplayInterface {
                                               LayerBufferFormat format,
                                               const ColorMetaData &color_metadata);
   virtual std::string Dump();
+  virtual DisplayError GetFrameStats(FrameStatsSnapshot *snapshot, bool reset);
   virtual DisplayError GetDisplayIdentificationData(uint8_t *out_port, uint32_t *out_data_size,
                                                     uint8_t *out_data);
 
@@ -140,6 +142,7 @@ class DisplayBase : public DisplayInterface {
   virtual DisplayError ValidateGPUTargetParams();
   void CommitLayerParams(LayerStack *layer_stack);
   void PostCommitLayerParams(LayerStack *layer_stack);
+  DisplayError PostCommit(bool enable_partial_update);
   DisplayError HandleHDR(LayerStack *layer_stack);
   DisplayError ValidateHDR(LayerStack *layer_stack);
   DisplayError SetHDRMode(bool set);
@@ -224,6 +227,8 @@ class DisplayBase : public DisplayInterface {
   HWQosData default_qos_data_;
   bool lut_swap_ = false;
   bool custom_mixer_resolution_ = false;
+  FrameStats frame_stats_;
+  PostCommitWorker post_commit_worker_;
 };
 
 }  // namespace sdm
@@ -140,6 +140,7 @@ DisplayError DisplayHDMI::Init() {
 
 DisplayError DisplayHDMI::Prepare(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
   uint32_t new_mixer_width = 0;
   uint32_t new_mixer_height = 0;
@@ -113,6 +113,7 @@ DisplayError DisplayPrimary::Init() {
 
 DisplayError DisplayPrimary::Prepare(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DisplayError error = kErrorNone;
   uint32_t new_mixer_width = 0;
   uint32_t new_mixer_height = 0;
@@ -143,6 +144,7 @@ DisplayError DisplayPrimary::Commit(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
   DisplayError error = kErrorNone;
   uint32_t app_layer_count = hw_layers_.info.app_layer_count;
+  int idle_time_ms = hw_layers_.info.set_idle_time_ms;
 
   // Enabling auto refresh is async and needs to happen before commit ioctl
   if (hw_panel_info_.mode == kModeCommand) {
@@ -162,7 +164,6 @@ DisplayError DisplayPrimary::Commit(LayerStack *layer_stack) {
 
   DisplayBase::ReconfigureDisplay();
 
-  int idle_time_ms = hw_layers_.info.set_idle_time_ms;
   if (idle_time_ms >= 0) {
     hw_intf_->SetIdleTimeoutMs(UINT32(idle_time_ms));
   }
@@ -194,6 +195,7 @@ DisplayError DisplayPrimary::SetDisplayState(DisplayState state, int *release_fe
 
 void DisplayPrimary::SetIdleTimeoutMs(uint32_t active_ms) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   comp_manager_->SetIdleTimeoutMs(display_comp_ctx_, active_ms);
 }
 
@@ -203,6 +205,7 @@ DisplayError DisplayPrimary::SetDisplayMode(uint32_t mode) {
   // Limit scope of mutex to this block
   {
     lock_guard<recursive_mutex> obj(recursive_mutex_);
+    post_commit_worker_.Wait();
     HWDisplayMode hw_display_mode = static_cast<HWDisplayMode>(mode);
     uint32_t pending = 0;
 
@@ -350,6 +353,7 @@ void DisplayPrimary::IdleTimeout() {
     handle_idle_timeout_ = true;
     event_handler_->Refresh();
     lock_guard<recursive_mutex> obj(recursive_mutex_);
+    post_commit_worker_.Wait();
     comp_manager_->ProcessIdleTimeout(display_comp_ctx_);
   }
 }
@@ -362,6 +366,7 @@ void DisplayPrimary::PingPongTimeout() {
 void DisplayPrimary::ThermalEvent(int64_t thermal_level) {
   event_handler_->HandleEvent(kThermalEvent);
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   comp_manager_->ProcessThermalEvent(display_comp_ctx_, thermal_level);
 }
 
@@ -369,6 +374,7 @@ void DisplayPrimary::IdlePowerCollapse() {
   if (hw_panel_info_.mode == kModeCommand) {
     event_handler_->HandleEvent(kIdlePowerCollapse);
     lock_guard<recursive_mutex> obj(recursive_mutex_);
+    post_commit_worker_.Wait();
     comp_manager_->ProcessIdlePowerCollapse(display_comp_ctx_);
   }
 }
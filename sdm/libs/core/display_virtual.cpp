@@ -104,6 +104,7 @@ DisplayError DisplayVirtual::GetActiveConfig(uint32_t *index) {
 
 DisplayError DisplayVirtual::SetActiveConfig(DisplayConfigVariableInfo *variable_info) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
 
   if (!variable_info) {
     return kErrorParameters;
@@ -166,6 +167,7 @@ DisplayError DisplayVirtual::SetActiveConfig(DisplayConfigVariableInfo *variable
 
 DisplayError DisplayVirtual::Prepare(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
 
   // Clean hw layers for reuse.
   hw_layers_ = HWLayers();
@@ -184,6 +186,7 @@ DisplayError DisplayVirtual::GetColorModeCount(uint32_t *mode_count) {
 
 DisplayError DisplayVirtual::SetDisplayState(DisplayState state, int *release_fence) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
+  post_commit_worker_.Wait();
   DLOGI("Set state = %d, display %d-%d", state, display_id_, display_type_);
 
   if (state == state_) {
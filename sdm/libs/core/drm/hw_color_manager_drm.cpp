@@ -32,7 +32,11 @@
 #ifdef PP_DRM_ENABLE
 #include <drm/msm_drm_pp.h>
 #endif
+#include <stddef.h>
+#include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/utils.h>
+#include <algorithm>
 #include "hw_color_manager_drm.h"
 
 #ifdef PP_DRM_ENABLE
@@ -964,4 +968,199 @@ DisplayError HWColorManagerDrm::GetDrmPADither(const PPFeatureInfo &in_data,
   return ret;
 }
 
+bool HWColorManagerDrm::GetFeatureHash(const PPFeatureInfo &in_data, uint64_t *hash) {
+#ifdef PP_DRM_ENABLE
+  void *config = in_data.GetConfigData();
+  if (!config) {
+    return false;
+  }
+
+  uint64_t seed = HashCombine(in_data.feature_id_,
+                              (UINT64(in_data.feature_version_) << 32) | in_data.enable_flags_);
+
+  switch (in_data.feature_id_) {
+    case kGlobalColorFeaturePcc:
+      if (in_data.feature_version_ != PPFeatureVersion::kSDEPccV4) {
+        return false;
+      }
+      seed = HashBytes(seed, config, sizeof(struct SDEPccV4Cfg));
+      break;
+    case kGlobalColorFeatureIgc: {
+      struct SDEIgcV30LUTData *sde_igc = (struct SDEIgcV30LUTData *)config;
+      if (in_data.feature_version_ != PPFeatureVersion::kSDEIgcV30 ||
+          !sde_igc->c0_c1_data || !sde_igc->c2_data) {
+        return false;
+      }
+      seed = HashCombine(seed, sde_igc->strength);
+      seed = HashBytes(seed, reinterpret_cast<void *>(sde_igc->c0_c1_data),
+                       sizeof(uint32_t) * IGC_TBL_LEN);
+      seed = HashBytes(seed, reinterpret_cast<void *>(sde_igc->c2_data),
+                       sizeof(uint32_t) * IGC_TBL_LEN);
+    } break;
+    case kGlobalColorFeaturePgc: {
+      struct SDEPgcLUTData *sde_pgc = (struct SDEPgcLUTData *)config;
+      if (!sde_pgc->c0_data || !sde_pgc->c1_data || !sde_pgc->c2_data) {
+        return false;
+      }
+      // The LUT packs two input entries into each output entry.
+      size_t size = sizeof(uint32_t) * PGC_TBL_LEN * 2;
+      seed = HashBytes(seed, sde_pgc->c0_data, size);
+      seed = HashBytes(seed, sde_pgc->c1_data, size);
+      seed = HashBytes(seed, sde_pgc->c2_data, size);
+    } break;
+    case kGlobalColorFeaturePaV2: {
+      struct SDEPaData *sde_pa = (struct SDEPaData *)config;
+      seed = HashBytes(seed, sde_pa, offsetof(struct SDEPaData, six_zone_curve_p0));
+#ifdef DRM_MSM_SIXZONE
+      if (sde_pa->six_zone_curve_p0 && sde_pa->six_zone_curve_p1 &&
+          sde_pa->six_zone_len == SIXZONE_LUT_SIZE) {
+        seed = HashBytes(seed, sde_pa->six_zone_curve_p0, sizeof(uint32_t) * SIXZONE_LUT_SIZE);
+        seed = HashBytes(seed, sde_pa->six_zone_curve_p1, sizeof(uint32_t) * SIXZONE_LUT_SIZE);
+      }
+#endif
+    } break;
+    case kGlobalColorFeatureDither:
+      seed = HashBytes(seed, config, sizeof(struct SDEDitherCfg));
+      break;
+    case kGlobalColorFeatureGamut: {
+      struct SDEGamutCfg *sde_gamut = (struct SDEGamutCfg *)config;
+      uint32_t size = 0;
+      switch (sde_gamut->mode) {
+        case SDEGamutCfgWrapper::GAMUT_FINE_MODE:
+          size = GAMUT_3D_MODE17_TBL_SZ;
+          break;
+        case SDEGamutCfgWrapper::GAMUT_COARSE_MODE:
+          size = GAMUT_3D_MODE5_TBL_SZ;
+          break;
+        case SDEGamutCfgWrapper::GAMUT_COARSE_MODE_13:
+          size = GAMUT_3D_MODE13_TBL_SZ;
+          break;
+        default:
+          return false;
+      }
+      seed = HashCombine(seed, (UINT64(sde_gamut->mode) << 32) | sde_gamut->map_en);
+      if (sde_gamut->map_en) {
+        for (uint32_t i = 0; i < SDEGamutCfg::kGamutScaleoffTableNum; i++) {
+          if (!sde_gamut->scale_off_data[i]) {
+            return false;
+          }
+          seed = HashBytes(seed, sde_gamut->scale_off_data[i],
+                           sizeof(uint32_t) * GAMUT_3D_SCALE_OFF_SZ);
+        }
+      }
+      for (uint32_t row = 0; row < GAMUT_3D_TBL_NUM; row++) {
+        if (!sde_gamut->c0_data[row] || !sde_gamut->c1_c2_data[row]) {
+          return false;
+        }
+        seed = HashBytes(seed, sde_gamut->c0_data[row], sizeof(uint32_t) * size);
+        seed = HashBytes(seed, sde_gamut->c1_c2_data[row], sizeof(uint32_t) * size);
+      }
+    } break;
+#ifdef DRM_MSM_PA_DITHER
+    case kGlobalColorFeaturePADither: {
+      struct SDEPADitherData *sde_dither = (struct SDEPADitherData *)config;
+      if (sde_dither->matrix_size != DITHER_MATRIX_SZ || !sde_dither->matrix_data_addr) {
+        return false;
+      }
+      seed = HashCombine(seed, (UINT64(sde_dither->strength) << 32) | sde_dither->offset_en);
+      seed = HashBytes(seed, reinterpret_cast<void *>(sde_dither->matrix_data_addr),
+                       sizeof(uint32_t) * DITHER_MATRIX_SZ);
+    } break;
+#endif
+    default:
+      return false;
+  }
+
+  *hash = seed;
+  return true;
+#else
+  return false;
+#endif
+}
+
+DisplayError HWColorManagerDrm::FeatureCache::GetDrmFeature(uint32_t drm_feature,
+                                                            const PPFeatureInfo &in_data,
+                                                            const uint64_t *hash,
+                                                            DRMPPFeatureInfo *out_data) {
+  if (drm_feature >= kPPFeaturesMax || !HWColorManagerDrm::GetDrmFeature[drm_feature]) {
+    return kErrorParameters;
+  }
+
+  if (!enabled_ || !hash) {
+    return HWColorManagerDrm::GetDrmFeature[drm_feature](in_data, out_data);
+  }
+
+  uint64_t key = HashCombine(*hash, drm_feature);
+  use_count_++;
+  for (Entry &entry : entries_) {
+    if (entry.key == key) {
+      entry.last_use = use_count_;
+      out_data->id = entry.info.id;
+      out_data->type = entry.info.type;
+      out_data->version = entry.info.version;
+      out_data->payload_size = entry.info.payload_size;
+      out_data->payload = entry.info.payload;
+      hits_++;
+      return kErrorNone;
+    }
+  }
+  misses_++;
+
+  DisplayError ret = HWColorManagerDrm::GetDrmFeature[drm_feature](in_data, out_data);
+  if (ret != kErrorNone || !out_data->payload) {
+    return ret;
+  }
+
+  Entry *entry = NULL;
+  if (entries_.size() < kMaxEntries) {
+    entries_.push_back(Entry());
+    entry = &entries_.back();
+  } else {
+    entry = &*std::min_element(entries_.begin(), entries_.end(),
+                               [](const Entry &a, const Entry &b) {
+                                 return a.last_use < b.last_use;
+                               });
+    FreeDrmFeatureData(&entry->info);
+  }
+  entry->key = key;
+  entry->last_use = use_count_;
+  entry->info = *out_data;
+
+  return ret;
+}
+
+void HWColorManagerDrm::FeatureCache::Release(DRMPPFeatureInfo *out_data) {
+  if (!out_data->payload) {
+    return;
+  }
+
+  for (Entry &entry : entries_) {
+    if (entry.info.payload == out_data->payload) {
+      out_data->payload = NULL;
+      return;
+    }
+  }
+
+  FreeDrmFeatureData(out_data);
+}
+
+void HWColorManagerDrm::FeatureCache::SetEnabled(bool enabled) {
+  enabled_ = enabled;
+  if (!enabled_) {
+    Clear();
+  }
+}
+
+void HWColorManagerDrm::FeatureCache::Clear() {
+  for (Entry &entry : entries_) {
+    FreeDrmFeatureData(&entry.info);
+  }
+  entries_.clear();
+}
+
+void HWColorManagerDrm::FeatureCache::Dump(std::ostringstream *os) {
+  *os << "\npp feature cache: entries " << entries_.size() << " hits " << hits_ << " misses "
+      << misses_;
+}
+
 }  // namespace sdm
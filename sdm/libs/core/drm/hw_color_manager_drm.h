@@ -32,6 +32,7 @@
 
 #include <drm_interface.h>
 #include <private/color_params.h>
+#include <sstream>
 #include <vector>
 #include <map>
 
@@ -80,6 +81,40 @@ class HWColorManagerDrm {
   static void FreeDrmFeatureData(DRMPPFeatureInfo *feature);
   static uint32_t GetFeatureVersion(const DRMPPFeatureInfo &feature);
   static DRMPPFeatureID ToDrmFeatureId(uint32_t id);
+  // Hashes the configuration content of in_data, including the tables it points to. Returns
+  // false when the feature can not be hashed.
+  static bool GetFeatureHash(const PPFeatureInfo &in_data, uint64_t *hash);
+
+  // Converted payloads, addressed by DRM feature id, version, enable flags and content hash.
+  // Reapplying a configuration seen recently, as on color mode or night light transitions,
+  // reuses its payload instead of converting the tables again.
+  class FeatureCache {
+   public:
+    ~FeatureCache() { Clear(); }
+    // Converts in_data into out_data for drm_feature. A null hash bypasses the cache. Payloads
+    // handed out by the cache remain owned by it, out_data must be released with Release().
+    DisplayError GetDrmFeature(uint32_t drm_feature, const PPFeatureInfo &in_data,
+                               const uint64_t *hash, DRMPPFeatureInfo *out_data);
+    void Release(DRMPPFeatureInfo *out_data);
+    void SetEnabled(bool enabled);
+    void Clear();
+    void Dump(std::ostringstream *os);
+
+   private:
+    static const uint32_t kMaxEntries = 16;
+
+    struct Entry {
+      uint64_t key = 0;
+      uint64_t last_use = 0;
+      DRMPPFeatureInfo info = {};
+    };
+
+    bool enabled_ = true;
+    std::vector<Entry> entries_;
+    uint64_t use_count_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+  };
 
  protected:
   HWColorManagerDrm() {}
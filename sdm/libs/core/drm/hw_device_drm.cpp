@@ -46,13 +46,18 @@
 #include <unistd.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/fence.h>
 #include <utils/formats.h>
 #include <utils/sys.h>
+#include <utils/utils.h>
 #include <drm/sde_drm.h>
 #include <private/color_params.h>
 #include <utils/rect.h>
 
 #include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -61,19 +66,11 @@
 
 #include "hw_device_drm.h"
 #include "hw_info_interface.h"
+#include "hw_info_drm.h"
 #include "hw_color_manager_drm.h"
 
 #define __CLASS__ "HWDeviceDRM"
 
-#ifndef DRM_FORMAT_MOD_QCOM_COMPRESSED
-#define DRM_FORMAT_MOD_QCOM_COMPRESSED fourcc_mod_code(QCOM, 1)
-#endif
-#ifndef DRM_FORMAT_MOD_QCOM_DX
-#define DRM_FORMAT_MOD_QCOM_DX fourcc_mod_code(QCOM, 0x2)
-#endif
-#ifndef DRM_FORMAT_MOD_QCOM_TIGHT
-#define DRM_FORMAT_MOD_QCOM_TIGHT fourcc_mod_code(QCOM, 0x4)
-#endif
 #ifndef DRM_MODE_FLAG_SUPPORTS_YUV422
 #define DRM_MODE_FLAG_SUPPORTS_YUV422 (1<<21)
 #endif
@@ -109,130 +106,10 @@ using sde_drm::DRMMultiRectMode;
 
 namespace sdm {
 
-static void GetDRMFormat(LayerBufferFormat format, uint32_t *drm_format,
-                         uint64_t *drm_format_modifier) {
-  switch (format) {
-    case kFormatRGBA8888:
-      *drm_format = DRM_FORMAT_ABGR8888;
-      break;
-    case kFormatRGBA8888Ubwc:
-      *drm_format = DRM_FORMAT_ABGR8888;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatRGBA5551:
-      *drm_format = DRM_FORMAT_ABGR1555;
-      break;
-    case kFormatRGBA4444:
-      *drm_format = DRM_FORMAT_ABGR4444;
-      break;
-    case kFormatBGRA8888:
-      *drm_format = DRM_FORMAT_ARGB8888;
-      break;
-    case kFormatRGBX8888:
-      *drm_format = DRM_FORMAT_XBGR8888;
-      break;
-    case kFormatRGBX8888Ubwc:
-      *drm_format = DRM_FORMAT_XBGR8888;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatBGRX8888:
-      *drm_format = DRM_FORMAT_XRGB8888;
-      break;
-    case kFormatRGB888:
-      *drm_format = DRM_FORMAT_BGR888;
-      break;
-    case kFormatRGB565:
-      *drm_format = DRM_FORMAT_BGR565;
-      break;
-    case kFormatBGR565:
-      *drm_format = DRM_FORMAT_RGB565;
-      break;
-    case kFormatBGR565Ubwc:
-      *drm_format = DRM_FORMAT_BGR565;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatRGBA1010102:
-      *drm_format = DRM_FORMAT_ABGR2101010;
-      break;
-    case kFormatRGBA1010102Ubwc:
-      *drm_format = DRM_FORMAT_ABGR2101010;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatARGB2101010:
-      *drm_format = DRM_FORMAT_BGRA1010102;
-      break;
-    case kFormatRGBX1010102:
-      *drm_format = DRM_FORMAT_XBGR2101010;
-      break;
-    case kFormatRGBX1010102Ubwc:
-      *drm_format = DRM_FORMAT_XBGR2101010;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatXRGB2101010:
-      *drm_format = DRM_FORMAT_BGRX1010102;
-      break;
-    case kFormatBGRA1010102:
-      *drm_format = DRM_FORMAT_ARGB2101010;
-      break;
-    case kFormatABGR2101010:
-      *drm_format = DRM_FORMAT_RGBA1010102;
-      break;
-    case kFormatBGRX1010102:
-      *drm_format = DRM_FORMAT_XRGB2101010;
-      break;
-    case kFormatXBGR2101010:
-      *drm_format = DRM_FORMAT_RGBX1010102;
-      break;
-    case kFormatYCbCr420SemiPlanar:
-      *drm_format = DRM_FORMAT_NV12;
-      break;
-    case kFormatYCbCr420SemiPlanarVenus:
-      *drm_format = DRM_FORMAT_NV12;
-      break;
-    case kFormatYCbCr420SPVenusUbwc:
-      *drm_format = DRM_FORMAT_NV12;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED;
-      break;
-    case kFormatYCrCb420SemiPlanar:
-      *drm_format = DRM_FORMAT_NV21;
-      break;
-    case kFormatYCrCb420SemiPlanarVenus:
-      *drm_format = DRM_FORMAT_NV21;
-      break;
-    case kFormatYCbCr420P010:
-    case kFormatYCbCr420P010Venus:
-      *drm_format = DRM_FORMAT_NV12;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_DX;
-      break;
-    case kFormatYCbCr420P010Ubwc:
-      *drm_format = DRM_FORMAT_NV12;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED |
-        DRM_FORMAT_MOD_QCOM_DX;
-      break;
-    case kFormatYCbCr420TP10Ubwc:
-      *drm_format = DRM_FORMAT_NV12;
-      *drm_format_modifier = DRM_FORMAT_MOD_QCOM_COMPRESSED |
-        DRM_FORMAT_MOD_QCOM_DX | DRM_FORMAT_MOD_QCOM_TIGHT;
-      break;
-    case kFormatYCbCr422H2V1SemiPlanar:
-      *drm_format = DRM_FORMAT_NV16;
-      break;
-    case kFormatYCrCb422H2V1SemiPlanar:
-      *drm_format = DRM_FORMAT_NV61;
-      break;
-    case kFormatYCrCb420PlanarStride16:
-      *drm_format = DRM_FORMAT_YVU420;
-      break;
-    default:
-      DLOGW("Unsupported format %s", GetFormatString(format));
-  }
-}
-
 class FrameBufferObject : public LayerBufferObject {
  public:
-  FrameBufferObject(uint32_t fb_id, LayerBufferFormat format,
-                             uint32_t width, uint32_t height)
-    :fb_id_(fb_id), format_(format), width_(width), height_(height) {
+  explicit FrameBufferObject(uint32_t fb_id) : fb_id_(fb_id) {
+    live_.fetch_add(1, std::memory_order_relaxed);
   }
 
   ~FrameBufferObject() {
@@ -242,21 +119,170 @@ class FrameBufferObject : public LayerBufferObject {
     if (ret < 0) {
       DLOGE("Removing fb_id %d failed with error %d", fb_id_, errno);
     }
+    live_.fetch_sub(1, std::memory_order_relaxed);
   };
   uint32_t GetFbId() { return fb_id_; }
-  bool IsEqual(LayerBufferFormat format, uint32_t width, uint32_t height) {
-    return (format == format_ && width == width_ && height == height_);
-  }
+  static uint32_t GetLiveCount() { return live_.load(std::memory_order_relaxed); }
 
  private:
+  static std::atomic<uint32_t> live_;
   uint32_t fb_id_;
-  LayerBufferFormat format_;
-  uint32_t width_;
-  uint32_t height_;
 };
 
-HWDeviceDRM::Registry::Registry(BufferAllocator *buffer_allocator) :
-  buffer_allocator_(buffer_allocator) {
+std::atomic<uint32_t> FrameBufferObject::live_(0);
+
+// fb_ids of all displays, keyed by the buffer handle_id along with its format and size, so a buffer
+// moving between layers or displays is imported once. Entries are shared with the frames holding
+// them, an evicted entry still held by a frame in flight is removed when that frame is released.
+// An fb_id keeps its buffer allocated even after the client has freed it, so the cache is bounded
+// by the bytes it pins, and entries not used by any commit for a while are dropped.
+class FrameBufferCache {
+ public:
+  struct Key {
+    uint64_t handle_id = 0;
+    LayerBufferFormat format = kFormatInvalid;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    bool operator==(const Key &key) const {
+      return (handle_id == key.handle_id && format == key.format && width == key.width &&
+              height == key.height);
+    }
+  };
+
+  static FrameBufferCache *Get() {
+    static FrameBufferCache *cache = new FrameBufferCache();
+    return cache;
+  }
+
+  std::shared_ptr<FrameBufferObject> Find(const Key &key);
+  // Returns the cached object, which is not fb_obj when another display added the key first.
+  std::shared_ptr<FrameBufferObject> Insert(const Key &key, uint64_t size,
+                                            std::shared_ptr<FrameBufferObject> fb_obj);
+  // Called on every commit of any display, drops the entries idle for too many commits.
+  void OnCommit();
+  void Dump(std::ostringstream *os);
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<uint64_t>()(key.handle_id ^ (UINT64(key.format) << 56) ^
+                                   (UINT64(key.width) << 32) ^ key.height);
+    }
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<FrameBufferObject> fb_obj;
+    uint64_t size = 0;       // Bytes of the buffer kept allocated by the fb_id.
+    uint64_t last_used = 0;  // Commit count when the entry was last found or inserted.
+  };
+  typedef std::list<Entry> EntryList;
+
+  static const uint32_t kDefaultCapacity = 64;
+  static const uint32_t kDefaultMaxPinnedMB = 256;
+  static const uint64_t kMaxIdleCommits = 120;
+
+  FrameBufferCache();
+  void EvictLocked();
+
+  std::mutex lock_;
+  EntryList entries_;  // Most recently used first.
+  std::unordered_map<Key, EntryList::iterator, KeyHash> entry_map_;
+  uint32_t capacity_ = kDefaultCapacity;
+  uint64_t max_pinned_bytes_ = UINT64(kDefaultMaxPinnedMB) << 20;
+  uint64_t pinned_bytes_ = 0;
+  uint64_t commits_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+  uint64_t deferred_ = 0;
+};
+
+FrameBufferCache::FrameBufferCache() {
+  int value = 0;
+  if (Debug::GetProperty(FBID_CACHE_SIZE_PROP, &value) == kErrorNone && value > 0) {
+    capacity_ = UINT32(value);
+  }
+
+  value = 0;
+  if (Debug::GetProperty(FBID_CACHE_MAX_MB_PROP, &value) == kErrorNone && value > 0) {
+    max_pinned_bytes_ = UINT64(value) << 20;
+  }
+}
+
+std::shared_ptr<FrameBufferObject> FrameBufferCache::Find(const Key &key) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entry_map_.find(key);
+  if (it == entry_map_.end()) {
+    misses_++;
+    return nullptr;
+  }
+
+  hits_++;
+  it->second->last_used = commits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->fb_obj;
+}
+
+std::shared_ptr<FrameBufferObject> FrameBufferCache::Insert(
+    const Key &key, uint64_t size, std::shared_ptr<FrameBufferObject> fb_obj) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entry_map_.find(key);
+  if (it != entry_map_.end()) {
+    it->second->last_used = commits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->fb_obj;
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.fb_obj = fb_obj;
+  entry.size = size;
+  entry.last_used = commits_;
+  entries_.push_front(std::move(entry));
+  entry_map_[key] = entries_.begin();
+  pinned_bytes_ += size;
+
+  // The new entry itself is kept even if it exceeds the byte bound alone.
+  while (entries_.size() > 1 &&
+         (entries_.size() > capacity_ || pinned_bytes_ > max_pinned_bytes_)) {
+    EvictLocked();
+  }
+
+  return fb_obj;
+}
+
+void FrameBufferCache::OnCommit() {
+  std::lock_guard<std::mutex> lock(lock_);
+  commits_++;
+  while (!entries_.empty() && commits_ - entries_.back().last_used > kMaxIdleCommits) {
+    EvictLocked();
+  }
+}
+
+void FrameBufferCache::EvictLocked() {
+  Entry &lru = entries_.back();
+  if (lru.fb_obj.use_count() > 1) {
+    // Still referenced by a frame in flight, fb_id goes away with its last reference.
+    deferred_++;
+  }
+  evictions_++;
+  pinned_bytes_ -= lru.size;
+  entry_map_.erase(lru.key);
+  entries_.pop_back();
+}
+
+void FrameBufferCache::Dump(std::ostringstream *os) {
+  std::lock_guard<std::mutex> lock(lock_);
+  *os << "\nfb_id cache: entries " << entries_.size() << "/" << capacity_ << " pinned(KB) "
+      << (pinned_bytes_ >> 10) << "/" << (max_pinned_bytes_ >> 10) << " hits " << hits_
+      << " misses " << misses_ << " evictions " << evictions_ << " deferred " << deferred_
+      << " live fb_ids " << FrameBufferObject::GetLiveCount();
+}
+
+HWDeviceDRM::Registry::Registry(BufferSyncHandler *buffer_sync_handler,
+                                BufferAllocator *buffer_allocator) :
+  buffer_sync_handler_(buffer_sync_handler), buffer_allocator_(buffer_allocator) {
   int value = 0;
   if (Debug::GetProperty(DISABLE_FBID_CACHE, &value) == kErrorNone) {
     disable_fbid_cache_ = (value == 1);
@@ -267,19 +293,18 @@ void HWDeviceDRM::Registry::Register(HWLayers *hw_layers) {
   HWLayersInfo &hw_layer_info = hw_layers->info;
   uint32_t hw_layer_count = UINT32(hw_layer_info.hw_layers.size());
 
+  layer_buffers_.assign(hw_layer_count, nullptr);
   for (uint32_t i = 0; i < hw_layer_count; i++) {
     Layer &layer = hw_layer_info.hw_layers.at(i);
     LayerBuffer *input_buffer = &layer.input_buffer;
     HWRotatorSession *hw_rotator_session = &hw_layers->config[i].hw_rotator_session;
     HWRotateInfo *hw_rotate_info = &hw_rotator_session->hw_rotate_info[0];
-    fbid_cache_limit_ = input_buffer->flags.video ? VIDEO_FBID_LIMIT : UI_FBID_LIMIT;
 
     if (hw_rotator_session->mode == kRotatorOffline && hw_rotate_info->valid) {
       input_buffer = &hw_rotator_session->output_buffer;
-      fbid_cache_limit_ = ROTATOR_FBID_LIMIT;
     }
 
-    MapBufferToFbId(&layer, input_buffer);
+    layer_buffers_[i] = MapBufferToFbId(input_buffer);
   }
 }
 
@@ -299,7 +324,7 @@ int HWDeviceDRM::Registry::CreateFbId(LayerBuffer *buffer, uint32_t *fb_id) {
   buf_info.aligned_width = layout.width = buffer->width;
   buf_info.aligned_height = layout.height = buffer->height;
   buf_info.format = buffer->format;
-  GetDRMFormat(buf_info.format, &layout.drm_format, &layout.drm_format_modifier);
+  HWInfoDRM::GetDRMFormat(buf_info.format, &layout.drm_format, &layout.drm_format_modifier);
   buffer_allocator_->GetBufferLayout(buf_info, layout.stride, layout.offset, &layout.num_planes);
   ret = master->CreateFbId(layout, fb_id);
   if (ret < 0) {
@@ -310,107 +335,249 @@ int HWDeviceDRM::Registry::CreateFbId(LayerBuffer *buffer, uint32_t *fb_id) {
   return ret;
 }
 
-void HWDeviceDRM::Registry::MapBufferToFbId(Layer* layer, LayerBuffer* buffer) {
+std::shared_ptr<FrameBufferObject> HWDeviceDRM::Registry::MapBufferToFbId(LayerBuffer* buffer) {
   if (buffer->planes[0].fd < 0) {
-    return;
+    return nullptr;
+  }
+
+  // In legacy path, create a new fb_id in each frame.
+  bool cacheable = buffer->handle_id && !disable_fbid_cache_;
+  FrameBufferCache::Key key;
+  if (cacheable) {
+    key.handle_id = buffer->handle_id;
+    key.format = buffer->format;
+    key.width = buffer->width;
+    key.height = buffer->height;
+    std::shared_ptr<FrameBufferObject> fb_obj = FrameBufferCache::Get()->Find(key);
+    if (fb_obj) {
+      return fb_obj;
+    }
   }
 
-  uint64_t handle_id = buffer->handle_id;
-  if (!handle_id || disable_fbid_cache_) {
-    // In legacy path, clear fb_id map in each frame.
-    layer->buffer_map->buffer_map.clear();
-  } else {
-    auto it = layer->buffer_map->buffer_map.find(handle_id);
-    if (it != layer->buffer_map->buffer_map.end()) {
-      FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it->second.get());
-      if (fb_obj->IsEqual(buffer->format, buffer->width, buffer->height)) {
-        // Found fb_id for given handle_id key
-        return;
-      } else {
-        // Erase from fb_id map if format or size have been modified
-        layer->buffer_map->buffer_map.erase(it);
-      }
-    }
+  uint32_t fb_id = 0;
+  if (CreateFbId(buffer, &fb_id) < 0) {
+    return nullptr;
+  }
+
+  auto fb_obj = std::make_shared<FrameBufferObject>(fb_id);
+  if (cacheable) {
+    uint64_t size = buffer->size ? buffer->size :
+                    UINT64(FLOAT(buffer->width * buffer->height) * GetBufferFormatBpp(key.format));
+    fb_obj = FrameBufferCache::Get()->Insert(key, size, fb_obj);
+  }
 
-    if (layer->buffer_map->buffer_map.size() >= fbid_cache_limit_) {
-      // Clear fb_id map, if the size reaches cache limit.
-      layer->buffer_map->buffer_map.clear();
+  return fb_obj;
+}
+
+void HWDeviceDRM::Registry::MapOutputBufferToFbId(LayerBuffer *output_buffer) {
+  output_buffer_ = MapBufferToFbId(output_buffer);
+}
+
+void HWDeviceDRM::Registry::OnCommit(const std::shared_ptr<Fence> &release_fence) {
+  if (!on_screen_.empty()) {
+    PendingRelease pending = {};
+    pending.release_fence = release_fence;
+    pending.frame_buffers.swap(on_screen_);
+    pending_release_.push_back(std::move(pending));
+  }
+
+  on_screen_ = layer_buffers_;
+  if (output_buffer_) {
+    on_screen_.push_back(output_buffer_);
+  }
+
+  FrameBufferCache::Get()->OnCommit();
+  ReleaseSignaled();
+}
+
+void HWDeviceDRM::Registry::ReleaseSignaled() {
+  // Release fences of a display signal in commit order.
+  while (!pending_release_.empty()) {
+    int fd = FenceManager::Get(pending_release_.front().release_fence);
+    if (fd >= 0 && !buffer_sync_handler_->IsSyncSignaled(fd)) {
+      break;
     }
+    pending_release_.pop_front();
   }
+}
 
-  uint32_t fb_id = 0;
-  if (CreateFbId(buffer, &fb_id) >= 0) {
-    // Create and cache the fb_id in map
-    layer->buffer_map->buffer_map[handle_id] = std::make_shared<FrameBufferObject>(fb_id,
-        buffer->format, buffer->width, buffer->height);
+void HWDeviceDRM::Registry::Clear() {
+  layer_buffers_.clear();
+  output_buffer_ = nullptr;
+  on_screen_.clear();
+  pending_release_.clear();
+}
+
+uint32_t HWDeviceDRM::Registry::GetFbId(uint32_t layer_index) {
+  if (layer_index < layer_buffers_.size() && layer_buffers_[layer_index]) {
+    return layer_buffers_[layer_index]->GetFbId();
   }
+
+  return 0;
 }
 
-void HWDeviceDRM::Registry::MapOutputBufferToFbId(LayerBuffer *output_buffer) {
-  if (output_buffer->planes[0].fd < 0) {
-    return;
+uint32_t HWDeviceDRM::Registry::GetOutputFbId() {
+  return output_buffer_ ? output_buffer_->GetFbId() : 0;
+}
+
+void HWDeviceDRM::Registry::Dump(std::ostringstream *os) {
+  FrameBufferCache::Get()->Dump(os);
+}
+
+bool HWDeviceDRM::PropertyCache::Stage(DRMOps op, uint32_t obj_id, const void *value,
+                                       size_t size) {
+  if (!enabled_) {
+    frame_written_++;
+    return true;
   }
 
-  uint64_t handle_id = output_buffer->handle_id;
-  if (!handle_id || disable_fbid_cache_) {
-    // In legacy path, clear output buffer map in each frame.
-    output_buffer_map_.clear();
-  } else {
-    auto it = output_buffer_map_.find(handle_id);
-    if (it != output_buffer_map_.end()) {
-      FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it->second.get());
-      if (fb_obj->IsEqual(output_buffer->format, output_buffer->width, output_buffer->height)) {
-        return;
+  uint64_t key = (UINT64(op) << 32) | obj_id;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(value);
+  auto it = committed_.find(key);
+  if (it != committed_.end() && it->second.size() == size &&
+      (!size || !memcmp(it->second.data(), bytes, size))) {
+    frame_skipped_++;
+    return false;
+  }
+
+  // Staged entries are reused across frames to keep allocations out of the commit path.
+  if (num_staged_ == staged_.size()) {
+    staged_.emplace_back();
+  }
+  staged_[num_staged_].first = key;
+  staged_[num_staged_].second.assign(bytes, bytes + size);
+  num_staged_++;
+  frame_written_++;
+
+  return true;
+}
+
+void HWDeviceDRM::PropertyCache::Commit() {
+  bool changed = (frame_written_ > 0);
+  for (uint32_t i = 0; i < num_staged_; i++) {
+    committed_[staged_[i].first].swap(staged_[i].second);
+  }
+
+  for (uint32_t plane_id : committed_planes_) {
+    if (std::find(staged_planes_.begin(), staged_planes_.end(), plane_id) !=
+        staged_planes_.end()) {
+      continue;
+    }
+    changed = true;
+    for (auto it = committed_.begin(); it != committed_.end();) {
+      if (UINT32(it->first) == plane_id) {
+        it = committed_.erase(it);
       } else {
-        output_buffer_map_.erase(it);
+        it++;
       }
     }
-
-    if (output_buffer_map_.size() >= UI_FBID_LIMIT) {
-      // Clear output buffer map, if the size reaches cache limit.
-      output_buffer_map_.clear();
-    }
   }
+  committed_planes_.swap(staged_planes_);
 
-  uint32_t fb_id = 0;
-  if (CreateFbId(output_buffer, &fb_id) >= 0) {
-    output_buffer_map_[handle_id] = std::make_shared<FrameBufferObject>(fb_id,
-        output_buffer->format, output_buffer->width, output_buffer->height);
+  total_written_ += frame_written_;
+  total_skipped_ += frame_skipped_;
+  last_written_ = frame_written_;
+  last_skipped_ = frame_skipped_;
+  Discard();
+
+  if (changed) {
+    UpdateGeneration();
   }
 }
 
-void HWDeviceDRM::Registry::Clear() {
-  output_buffer_map_.clear();
+void HWDeviceDRM::PropertyCache::Discard() {
+  num_staged_ = 0;
+  staged_planes_.clear();
+  frame_written_ = 0;
+  frame_skipped_ = 0;
 }
 
-uint32_t HWDeviceDRM::Registry::GetFbId(Layer *layer, uint64_t handle_id) {
-  auto it = layer->buffer_map->buffer_map.find(handle_id);
-  if (it != layer->buffer_map->buffer_map.end()) {
-    FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it->second.get());
-    return fb_obj->GetFbId();
+void HWDeviceDRM::PropertyCache::Reset() {
+  committed_.clear();
+  committed_planes_.clear();
+  Discard();
+  resets_++;
+  UpdateGeneration();
+}
+
+void HWDeviceDRM::PropertyCache::UpdateGeneration() {
+  // Pipes and bandwidth released or claimed by this display may change the outcome of the
+  // TEST_ONLY commits of the other displays.
+  HWInterface::UpdateConfigGeneration();
+  own_generation_++;
+}
+
+void HWDeviceDRM::PropertyCache::Dump(std::ostringstream *os) {
+  *os << "\natomic properties: last frame written " << last_written_ << " skipped "
+      << last_skipped_ << " total written " << total_written_ << " skipped " << total_skipped_
+      << " resets " << resets_;
+}
+
+bool HWDeviceDRM::ValidateCache::Find(uint64_t key, uint64_t generation, int *result) {
+  if (!enabled_) {
+    return false;
   }
 
-  return 0;
+  for (Entry &entry : entries_) {
+    if (entry.valid && entry.key == key && entry.generation == generation) {
+      *result = entry.result;
+      hits_++;
+      return true;
+    }
+  }
+  misses_++;
+
+  return false;
 }
 
-uint32_t HWDeviceDRM::Registry::GetOutputFbId(uint64_t handle_id) {
-  auto it = output_buffer_map_.find(handle_id);
-  if (it != output_buffer_map_.end()) {
-    FrameBufferObject *fb_obj = static_cast<FrameBufferObject*>(it->second.get());
-    return fb_obj->GetFbId();
+void HWDeviceDRM::ValidateCache::Insert(uint64_t key, uint64_t generation, int result) {
+  if (!enabled_) {
+    return;
   }
 
-  return 0;
+  for (Entry &entry : entries_) {
+    if (entry.valid && entry.key == key) {
+      entry.generation = generation;
+      entry.result = result;
+      return;
+    }
+  }
+
+  Entry &entry = entries_[next_];
+  entry.key = key;
+  entry.generation = generation;
+  entry.result = result;
+  entry.valid = true;
+  next_ = (next_ + 1) % kMaxEntries;
+}
+
+void HWDeviceDRM::ValidateCache::Dump(std::ostringstream *os) {
+  *os << "\nvalidate cache: hits " << hits_ << " misses " << misses_;
 }
 
 HWDeviceDRM::HWDeviceDRM(BufferSyncHandler *buffer_sync_handler, BufferAllocator *buffer_allocator,
                          HWInfoInterface *hw_info_intf)
     : hw_info_intf_(hw_info_intf), buffer_sync_handler_(buffer_sync_handler),
-      registry_(buffer_allocator) {
+      registry_(buffer_sync_handler, buffer_allocator) {
   hw_info_intf_ = hw_info_intf;
 }
 
 DisplayError HWDeviceDRM::Init() {
+  int value = 0;
+  if (Debug::GetProperty(DISABLE_ATOMIC_DELTA_PROP, &value) == kErrorNone) {
+    property_cache_.SetEnabled(value != 1);
+  }
+
+  value = 0;
+  if (Debug::GetProperty(DISABLE_VALIDATE_CACHE_PROP, &value) == kErrorNone) {
+    validate_cache_.SetEnabled(value != 1);
+  }
+
+  value = 0;
+  if (Debug::GetProperty(DISABLE_PP_FEATURE_CACHE_PROP, &value) == kErrorNone) {
+    pp_feature_cache_.SetEnabled(value != 1);
+  }
+
   DRMMaster *drm_master = {};
   DRMMaster::GetInstance(&drm_master);
   drm_master->GetHandle(&dev_fd_);
@@ -464,6 +631,7 @@ DisplayError HWDeviceDRM::Deinit() {
 
   delete hw_scale_;
   registry_.Clear();
+  property_cache_.Reset();
   display_attributes_ = {};
   drm_mgr_intf_->DestroyAtomicReq(drm_atomic_intf_);
   drm_atomic_intf_ = {};
@@ -782,6 +950,7 @@ DisplayError HWDeviceDRM::SetDisplayAttributes(uint32_t index) {
   }
 
   current_mode_index_ = index;
+  property_cache_.Reset();
   PopulateHWPanelInfo();
   UpdateMixerAttributes();
 
@@ -825,6 +994,7 @@ DisplayError HWDeviceDRM::PowerOn(const HWQosData &qos_data, int *release_fence)
   drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ACTIVE, token_.crtc_id, 1);
   drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_POWER_MODE, token_.conn_id, DRMPowerMode::ON);
   int ret = drm_atomic_intf_->Commit(true /* synchronous */, true /* retain_planes */);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("Failed with error: %d", ret);
     return kErrorHardware;
@@ -850,6 +1020,7 @@ DisplayError HWDeviceDRM::PowerOff() {
   drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_POWER_MODE, token_.conn_id, DRMPowerMode::OFF);
   drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ACTIVE, token_.crtc_id, 0);
   int ret = drm_atomic_intf_->Commit(true /* synchronous */, false /* retain_planes */);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("Failed with error: %d", ret);
     return kErrorHardware;
@@ -877,6 +1048,7 @@ DisplayError HWDeviceDRM::Doze(const HWQosData &qos_data, int *release_fence) {
   drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ACTIVE, token_.crtc_id, 1);
   drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_POWER_MODE, token_.conn_id, DRMPowerMode::DOZE);
   int ret = drm_atomic_intf_->Commit(true /* synchronous */, true /* retain_planes */);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("Failed with error: %d", ret);
     return kErrorHardware;
@@ -903,6 +1075,7 @@ DisplayError HWDeviceDRM::DozeSuspend(const HWQosData &qos_data, int *release_fe
   drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_POWER_MODE, token_.conn_id,
                             DRMPowerMode::DOZE_SUSPEND);
   int ret = drm_atomic_intf_->Commit(true /* synchronous */, true /* retain_planes */);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("Failed with error: %d", ret);
     return kErrorHardware;
@@ -917,16 +1090,16 @@ DisplayError HWDeviceDRM::DozeSuspend(const HWQosData &qos_data, int *release_fe
 }
 
 void HWDeviceDRM::SetQOSData(const HWQosData &qos_data) {
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_CORE_CLK, token_.crtc_id, qos_data.clock_hz);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_CORE_AB, token_.crtc_id, qos_data.core_ab_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_CORE_IB, token_.crtc_id, qos_data.core_ib_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_LLCC_AB, token_.crtc_id, qos_data.llcc_ab_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_LLCC_IB, token_.crtc_id, qos_data.llcc_ib_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_DRAM_AB, token_.crtc_id, qos_data.dram_ab_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_DRAM_IB, token_.crtc_id, qos_data.dram_ib_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ROT_PREFILL_BW, token_.crtc_id,
-                            qos_data.rot_prefill_bw_bps);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ROT_CLK, token_.crtc_id, qos_data.rot_clock_hz);
+  SetCachedProperty(DRMOps::CRTC_SET_CORE_CLK, token_.crtc_id, qos_data.clock_hz);
+  SetCachedProperty(DRMOps::CRTC_SET_CORE_AB, token_.crtc_id, qos_data.core_ab_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_CORE_IB, token_.crtc_id, qos_data.core_ib_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_LLCC_AB, token_.crtc_id, qos_data.llcc_ab_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_LLCC_IB, token_.crtc_id, qos_data.llcc_ib_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_DRAM_AB, token_.crtc_id, qos_data.dram_ab_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_DRAM_IB, token_.crtc_id, qos_data.dram_ib_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_ROT_PREFILL_BW, token_.crtc_id,
+                    qos_data.rot_prefill_bw_bps);
+  SetCachedProperty(DRMOps::CRTC_SET_ROT_CLK, token_.crtc_id, qos_data.rot_clock_hz);
 }
 
 DisplayError HWDeviceDRM::Standby() {
@@ -972,10 +1145,14 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
     }
 
     uint32_t num_rects = std::max(1u, static_cast<uint32_t>(hw_layer_info.left_frame_roi.size()));
-    drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ROI, token_.crtc_id,
-                              num_rects, crtc_rects);
-    drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_ROI, token_.conn_id,
-                              num_rects, conn_rects);
+    if (property_cache_.Stage(DRMOps::CRTC_SET_ROI, token_.crtc_id, crtc_rects,
+                              num_rects * sizeof(DRMRect))) {
+      drm_atomic_intf_->Perform(DRMOps::CRTC_SET_ROI, token_.crtc_id, num_rects, crtc_rects);
+    }
+    if (property_cache_.Stage(DRMOps::CONNECTOR_SET_ROI, token_.conn_id, conn_rects,
+                              num_rects * sizeof(DRMRect))) {
+      drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_ROI, token_.conn_id, num_rects, conn_rects);
+    }
   }
 
   for (uint32_t i = 0; i < hw_layer_count; i++) {
@@ -999,48 +1176,50 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
         input_buffer = &hw_rotator_session->output_buffer;
       }
 
-      uint32_t fb_id = registry_.GetFbId(&layer, input_buffer->handle_id);
+      uint32_t fb_id = registry_.GetFbId(i);
 
       if (pipe_info->valid && fb_id) {
         uint32_t pipe_id = pipe_info->pipe_id;
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_ALPHA, pipe_id, layer.plane_alpha);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_ZORDER, pipe_id, pipe_info->z_order);
+        SetCachedProperty(DRMOps::PLANE_SET_ALPHA, pipe_id, layer.plane_alpha);
+        SetCachedProperty(DRMOps::PLANE_SET_ZORDER, pipe_id, pipe_info->z_order);
         DRMBlendType blending = {};
         SetBlending(layer.blending, &blending);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_BLEND_TYPE, pipe_id, blending);
+        SetCachedProperty(DRMOps::PLANE_SET_BLEND_TYPE, pipe_id, blending);
         DRMRect src = {};
         SetRect(pipe_info->src_roi, &src);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_SRC_RECT, pipe_id, src);
+        SetCachedProperty(DRMOps::PLANE_SET_SRC_RECT, pipe_id, src);
         DRMRect rot_dst = {0, 0, 0, 0};
         if (hw_rotator_session->mode == kRotatorInline && hw_rotate_info->valid) {
           SetRect(hw_rotate_info->dst_roi, &rot_dst);
-          drm_atomic_intf_->Perform(DRMOps::PLANE_SET_ROTATION_DST_RECT, pipe_id, rot_dst);
+          SetCachedProperty(DRMOps::PLANE_SET_ROTATION_DST_RECT, pipe_id, rot_dst);
         }
         DRMRect dst = {};
         SetRect(pipe_info->dst_roi, &dst);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_DST_RECT, pipe_id, dst);
+        SetCachedProperty(DRMOps::PLANE_SET_DST_RECT, pipe_id, dst);
 
         uint32_t rot_bit_mask = 0;
         SetRotation(layer.transform, hw_rotator_session->mode, &rot_bit_mask);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_ROTATION, pipe_id, rot_bit_mask);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_H_DECIMATION, pipe_id,
-                                  pipe_info->horizontal_decimation);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_V_DECIMATION, pipe_id,
-                                  pipe_info->vertical_decimation);
+        SetCachedProperty(DRMOps::PLANE_SET_ROTATION, pipe_id, rot_bit_mask);
+        SetCachedProperty(DRMOps::PLANE_SET_H_DECIMATION, pipe_id,
+                          pipe_info->horizontal_decimation);
+        SetCachedProperty(DRMOps::PLANE_SET_V_DECIMATION, pipe_id,
+                          pipe_info->vertical_decimation);
 
         DRMSecureMode fb_secure_mode;
         DRMSecurityLevel security_level;
         SetSecureConfig(layer.input_buffer, &fb_secure_mode, &security_level);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_FB_SECURE_MODE, pipe_id, fb_secure_mode);
+        SetCachedProperty(DRMOps::PLANE_SET_FB_SECURE_MODE, pipe_id, fb_secure_mode);
         if (security_level > crtc_security_level) {
           crtc_security_level = security_level;
         }
 
         uint32_t config = 0;
         SetSrcConfig(layer.input_buffer, hw_rotator_session->mode, &config);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_SRC_CONFIG, pipe_id, config);;
+        SetCachedProperty(DRMOps::PLANE_SET_SRC_CONFIG, pipe_id, config);
+        // fb_id and CRTC keep the plane staged, they are written on every frame.
         drm_atomic_intf_->Perform(DRMOps::PLANE_SET_FB_ID, pipe_id, fb_id);
         drm_atomic_intf_->Perform(DRMOps::PLANE_SET_CRTC, pipe_id, token_.crtc_id);
+        property_cache_.StagePlane(pipe_id);
         if (!validate && input_buffer->acquire_fence_fd >= 0) {
           drm_atomic_intf_->Perform(DRMOps::PLANE_SET_INPUT_FENCE, pipe_id,
                                     input_buffer->acquire_fence_fd);
@@ -1049,7 +1228,9 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
           SDEScaler scaler_output = {};
           hw_scale_->SetScaler(pipe_info->scale_data, &scaler_output);
           // TODO(user): Remove qseed3 and add version check, then send appropriate scaler object
-          if (hw_resource_.has_qseed3) {
+          if (hw_resource_.has_qseed3 &&
+              property_cache_.Stage(DRMOps::PLANE_SET_SCALER_CONFIG, pipe_id,
+                                    &scaler_output.scaler_v2, sizeof(scaler_output.scaler_v2))) {
             drm_atomic_intf_->Perform(DRMOps::PLANE_SET_SCALER_CONFIG, pipe_id,
                                       reinterpret_cast<uint64_t>(&scaler_output.scaler_v2));
           }
@@ -1057,18 +1238,21 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
 
         DRMCscType csc_type = DRMCscType::kCscTypeMax;
         SelectCscType(layer.input_buffer, &csc_type);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_CSC_CONFIG, pipe_id, &csc_type);
+        if (property_cache_.Stage(DRMOps::PLANE_SET_CSC_CONFIG, pipe_id, &csc_type,
+                                  sizeof(csc_type))) {
+          drm_atomic_intf_->Perform(DRMOps::PLANE_SET_CSC_CONFIG, pipe_id, &csc_type);
+        }
 
         DRMMultiRectMode multirect_mode;
         SetMultiRectMode(pipe_info->flags, &multirect_mode);
-        drm_atomic_intf_->Perform(DRMOps::PLANE_SET_MULTIRECT_MODE, pipe_id, multirect_mode);
+        SetCachedProperty(DRMOps::PLANE_SET_MULTIRECT_MODE, pipe_id, multirect_mode);
       }
     }
   }
 
   SetSolidfillStages();
   SetQOSData(qos_data);
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_SECURITY_LEVEL, token_.crtc_id, crtc_security_level);
+  SetCachedProperty(DRMOps::CRTC_SET_SECURITY_LEVEL, token_.crtc_id, crtc_security_level);
 
   DLOGI_IF(kTagDriverConfig, "%s::%s System Clock=%d Hz, Core: AB=%llu Bps, IB=%llu Bps, " \
            "LLCC: AB=%llu Bps, IB=%llu Bps, DRAM AB=%llu Bps, IB=%llu Bps, "\
@@ -1127,7 +1311,10 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
              display_attributes_[index].pref_fmt == DisplayInterfaceFormat::kFormatYCbCr420d){
     current_mode.flags |= DRM_MODE_FLAG_SUPPORTS_YUV420;
   }
-  drm_atomic_intf_->Perform(DRMOps::CRTC_SET_MODE, token_.crtc_id, &current_mode);
+  if (property_cache_.Stage(DRMOps::CRTC_SET_MODE, token_.crtc_id, &current_mode,
+                            sizeof(current_mode))) {
+    drm_atomic_intf_->Perform(DRMOps::CRTC_SET_MODE, token_.crtc_id, &current_mode);
+  }
 
   if (!validate && (hw_layer_info.set_idle_time_ms >= 0)) {
     DLOGI_IF(kTagDriverConfig, "Setting idle timeout to = %d ms",
@@ -1137,7 +1324,7 @@ void HWDeviceDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
   }
 
   if (hw_panel_info_.mode == kModeCommand) {
-    drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_AUTOREFRESH, token_.conn_id, autorefresh_);
+    SetCachedProperty(DRMOps::CONNECTOR_SET_AUTOREFRESH, token_.conn_id, autorefresh_);
   }
 }
 
@@ -1170,8 +1357,21 @@ void HWDeviceDRM::AddSolidfillStage(const HWSolidfillStage &sf, uint32_t plane_a
 
 void HWDeviceDRM::SetSolidfillStages() {
   if (hw_resource_.num_solidfill_stages) {
-    drm_atomic_intf_->Perform(DRMOps::CRTC_SET_SOLIDFILL_STAGES, token_.crtc_id,
-                              reinterpret_cast<uint64_t> (&solid_fills_));
+    // Compare the stages by value, DRMSolidfillStage holds uninitialized padding.
+    solid_fill_values_.clear();
+    for (auto &sf : solid_fills_) {
+      solid_fill_values_.insert(solid_fill_values_.end(), {sf.bounding_rect.left,
+                                sf.bounding_rect.top, sf.bounding_rect.right,
+                                sf.bounding_rect.bottom, UINT32(sf.is_exclusion_rect), sf.color,
+                                sf.red, sf.blue, sf.green, sf.alpha, sf.color_bit_depth,
+                                sf.z_order, sf.plane_alpha});
+    }
+    if (property_cache_.Stage(DRMOps::CRTC_SET_SOLIDFILL_STAGES, token_.crtc_id,
+                              solid_fill_values_.data(),
+                              solid_fill_values_.size() * sizeof(uint32_t))) {
+      drm_atomic_intf_->Perform(DRMOps::CRTC_SET_SOLIDFILL_STAGES, token_.crtc_id,
+                                reinterpret_cast<uint64_t> (&solid_fills_));
+    }
   }
 }
 
@@ -1180,14 +1380,123 @@ void HWDeviceDRM::ClearSolidfillStages() {
   SetSolidfillStages();
 }
 
+template <class T>
+static uint64_t HashValue(uint64_t seed, const T &value) {
+  return HashBytes(seed, &value, sizeof(value));
+}
+
+uint64_t HWDeviceDRM::GetValidateKey(HWLayers *hw_layers) {
+  // Covers every input of SetupAtomic for a TEST_ONLY commit except fb_ids and fences, which do
+  // not change the outcome of the check.
+  HWLayersInfo &hw_layer_info = hw_layers->info;
+  uint32_t hw_layer_count = UINT32(hw_layer_info.hw_layers.size());
+  uint64_t hash = (UINT64(current_mode_index_) << 32) | vrefresh_;
+  hash = HashCombine(hash, bit_clk_rate_);
+  hash = HashCombine(hash, (UINT64(first_cycle_) << 2) | (UINT64(pending_doze_) << 1) |
+                     UINT64(autorefresh_));
+  hash = HashValue(hash, mixer_attributes_);
+  hash = HashValue(hash, hw_layers->qos_data);
+
+  if (hw_panel_info_.partial_update) {
+    for (auto &roi : hw_layer_info.left_frame_roi) {
+      hash = HashValue(hash, roi);
+    }
+  }
+
+  hash = HashCombine(hash, hw_layer_count);
+  for (uint32_t i = 0; i < hw_layer_count; i++) {
+    Layer &layer = hw_layer_info.hw_layers.at(i);
+    HWLayerConfig &config = hw_layers->config[i];
+    HWRotatorSession &hw_rotator_session = config.hw_rotator_session;
+
+    hash = HashCombine(hash, (UINT64(config.use_solidfill_stage) << 32) | layer.plane_alpha);
+    if (config.use_solidfill_stage) {
+      HWSolidfillStage &sf = config.hw_solidfill_stage;
+      hash = HashCombine(hash, (UINT64(sf.z_order) << 32) | sf.color);
+      hash = HashCombine(hash, sf.is_exclusion_rect);
+      hash = HashValue(hash, sf.roi);
+      hash = HashValue(hash, layer.solid_fill_info);
+      continue;
+    }
+
+    const LayerBuffer &input_buffer = layer.input_buffer;
+    hash = HashCombine(hash, (UINT64(layer.blending) << 32) | (registry_.GetFbId(i) != 0));
+    hash = HashValue(hash, layer.transform.rotation);
+    hash = HashCombine(hash, (UINT64(layer.transform.flip_horizontal) << 1) |
+                       UINT64(layer.transform.flip_vertical));
+    hash = HashCombine(hash, (UINT64(input_buffer.format) << 32) | input_buffer.flags.flags);
+    hash = HashCombine(hash, (UINT64(input_buffer.width) << 32) | input_buffer.height);
+    hash = HashCombine(hash, (UINT64(input_buffer.color_metadata.colorPrimaries) << 32) |
+                       input_buffer.color_metadata.range);
+
+    hash = HashCombine(hash, hw_rotator_session.mode);
+    if (hw_rotator_session.mode == kRotatorOffline) {
+      const LayerBuffer &output_buffer = hw_rotator_session.output_buffer;
+      hash = HashCombine(hash, (UINT64(output_buffer.format) << 32) | output_buffer.flags.flags);
+      hash = HashCombine(hash, (UINT64(output_buffer.width) << 32) | output_buffer.height);
+    }
+
+    for (uint32_t count = 0; count < 2; count++) {
+      HWPipeInfo &pipe_info = (count == 0) ? config.left_pipe : config.right_pipe;
+      HWRotateInfo &hw_rotate_info = hw_rotator_session.hw_rotate_info[count];
+
+      hash = HashCombine(hash, (UINT64(hw_rotate_info.valid) << 1) | UINT64(pipe_info.valid));
+      if (hw_rotate_info.valid) {
+        hash = HashValue(hash, hw_rotate_info.dst_roi);
+      }
+      if (!pipe_info.valid) {
+        continue;
+      }
+
+      hash = HashCombine(hash, (UINT64(pipe_info.pipe_id) << 32) | pipe_info.z_order);
+      hash = HashCombine(hash, (UINT64(pipe_info.sub_block_type) << 32) |
+                         (UINT64(pipe_info.rect) << 24) | (UINT64(pipe_info.flags) << 16) |
+                         (UINT64(pipe_info.horizontal_decimation) << 8) |
+                         pipe_info.vertical_decimation);
+      hash = HashValue(hash, pipe_info.src_roi);
+      hash = HashValue(hash, pipe_info.dst_roi);
+      if (hw_scale_) {
+        hash = HashValue(hash, pipe_info.scale_data);
+      }
+    }
+  }
+
+  for (auto &it : hw_layer_info.dest_scale_info_map) {
+    HWDestScaleInfo *dest_scale_info = it.second;
+    hash = HashCombine(hash, it.first);
+    hash = HashCombine(hash, (UINT64(dest_scale_info->mixer_width) << 32) |
+                       dest_scale_info->mixer_height);
+    hash = HashCombine(hash, dest_scale_info->scale_update);
+    hash = HashValue(hash, dest_scale_info->scale_data);
+  }
+
+  LayerBuffer *output_buffer = hw_layer_info.stack->output_buffer;
+  if (output_buffer) {
+    hash = HashCombine(hash, (UINT64(output_buffer->format) << 32) | output_buffer->flags.flags);
+    hash = HashCombine(hash, (UINT64(output_buffer->width) << 32) | output_buffer->height);
+  }
+
+  return hash;
+}
+
 DisplayError HWDeviceDRM::Validate(HWLayers *hw_layers) {
   DTRACE_SCOPED();
 
   DisplayError err = kErrorNone;
   registry_.Register(hw_layers);
-  SetupAtomic(hw_layers, true /* validate */);
 
-  int ret = drm_atomic_intf_->Validate();
+  // The request holds only the properties that differ from the committed state, so the result
+  // also depends on the state left by the last reset.
+  uint64_t key = HashCombine(GetValidateKey(hw_layers), property_cache_.GetResetCount());
+  uint64_t generation = property_cache_.GetExternalGeneration();
+  int ret = 0;
+  if (!validate_cache_.Find(key, generation, &ret)) {
+    SetupAtomic(hw_layers, true /* validate */);
+    ret = drm_atomic_intf_->Validate();
+    property_cache_.Discard();
+    validate_cache_.Insert(key, generation, ret);
+  }
+
   if (ret) {
     DLOGE("failed with error %d for %s", ret, device_name_);
     vrefresh_ = 0;
@@ -1221,6 +1530,7 @@ DisplayError HWDeviceDRM::DefaultCommit(HWLayers *hw_layers) {
   stack->retire_fence_fd = -1;
   for (Layer &layer : hw_layer_info.hw_layers) {
     layer.input_buffer.release_fence_fd = -1;
+    layer.input_buffer.release_fence = nullptr;
   }
 
   DRMMaster *master = nullptr;
@@ -1249,8 +1559,7 @@ DisplayError HWDeviceDRM::DefaultCommit(HWLayers *hw_layers) {
   drmModeModeInfo mode;
   res_mgr->GetMode(&mode);
 
-  uint64_t handle_id = hw_layer_info.hw_layers.at(0).input_buffer.handle_id;
-  uint32_t fb_id = registry_.GetFbId(&hw_layer_info.hw_layers.at(0), handle_id);
+  uint32_t fb_id = registry_.GetFbId(0);
   ret = drmModeSetCrtc(dev_fd, crtc_id, fb_id, 0 /* x */, 0 /* y */, &connector_id,
                        1 /* num_connectors */, &mode);
   if (ret < 0) {
@@ -1259,6 +1568,9 @@ DisplayError HWDeviceDRM::DefaultCommit(HWLayers *hw_layers) {
     return kErrorHardware;
   }
 
+  // Mode set is synchronous, the previous frame is off screen already.
+  registry_.OnCommit(nullptr);
+
   return kErrorNone;
 }
 
@@ -1269,9 +1581,11 @@ DisplayError HWDeviceDRM::AtomicCommit(HWLayers *hw_layers) {
   int ret = drm_atomic_intf_->Commit(false /* synchronous */, false /* retain_planes*/);
   if (ret) {
     DLOGE("%s failed with error %d crtc %d", __FUNCTION__, ret, token_.crtc_id);
+    property_cache_.Reset();
     vrefresh_ = 0;
     return kErrorHardware;
   }
+  property_cache_.Commit();
 
   int release_fence = -1;
   int retire_fence = -1;
@@ -1283,15 +1597,21 @@ DisplayError HWDeviceDRM::AtomicCommit(HWLayers *hw_layers) {
   LayerStack *stack = hw_layer_info.stack;
   stack->retire_fence_fd = retire_fence;
 
+  // All input buffers are released by the same CRTC fence, share a single copy of it.
+  std::shared_ptr<Fence> shared_release_fence;
+  if (release_fence >= 0) {
+    shared_release_fence = FenceManager::Create(Sys::dup_(release_fence));
+  }
   for (uint32_t i = 0; i < hw_layer_info.hw_layers.size(); i++) {
     Layer &layer = hw_layer_info.hw_layers.at(i);
     HWRotatorSession *hw_rotator_session = &hw_layers->config[i].hw_rotator_session;
     if (hw_rotator_session->mode == kRotatorOffline) {
       hw_rotator_session->output_buffer.release_fence_fd = Sys::dup_(release_fence);
     } else {
-      layer.input_buffer.release_fence_fd = Sys::dup_(release_fence);
+      layer.input_buffer.release_fence = shared_release_fence;
     }
   }
+  registry_.OnCommit(shared_release_fence);
 
   hw_layer_info.sync_handle = release_fence;
 
@@ -1331,10 +1651,18 @@ DisplayError HWDeviceDRM::AtomicCommit(HWLayers *hw_layers) {
   return kErrorNone;
 }
 
+void HWDeviceDRM::Dump(std::ostringstream *os) {
+  Registry::Dump(os);
+  property_cache_.Dump(os);
+  validate_cache_.Dump(os);
+  pp_feature_cache_.Dump(os);
+}
+
 DisplayError HWDeviceDRM::Flush(HWLayers *hw_layers) {
   DTRACE_SCOPED();
   ClearSolidfillStages();
   int ret = drm_atomic_intf_->Commit(false /* synchronous */, false /* retain_planes*/);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("failed with error %d", ret);
     return kErrorHardware;
@@ -1485,17 +1813,21 @@ DisplayError HWDeviceDRM::SetPPFeatures(PPFeaturesConfig *feature_list) {
         continue;
       }
 
+      // One hash of the configuration serves all DRM features it is split into.
+      uint64_t hash = 0;
+      bool cacheable = HWColorManagerDrm::GetFeatureHash(*feature, &hash);
       for (uint32_t drm_feature : drm_features->second) {
         if (!HWColorManagerDrm::GetDrmFeature[drm_feature]) {
           DLOGE("GetDrmFeature is not valid for DRM feature %d", drm_feature);
           continue;
         }
-        ret = HWColorManagerDrm::GetDrmFeature[drm_feature](*feature, &kernel_params);
+        ret = pp_feature_cache_.GetDrmFeature(drm_feature, *feature, cacheable ? &hash : NULL,
+                                              &kernel_params);
       if (!ret && crtc_feature)
         drm_atomic_intf_->Perform(DRMOps::CRTC_SET_POST_PROC, token_.crtc_id, &kernel_params);
       else if (!ret && !crtc_feature)
         drm_atomic_intf_->Perform(DRMOps::CONNECTOR_SET_POST_PROC, token_.conn_id, &kernel_params);
-      HWColorManagerDrm::FreeDrmFeatureData(&kernel_params);
+      pp_feature_cache_.Release(&kernel_params);
       }
     }
   }
@@ -1534,6 +1866,7 @@ DisplayError HWDeviceDRM::SetRefreshRate(uint32_t refresh_rate) {
         (current_bit_clk == connector_info_.modes[mode_index].bit_clk_rate) &&
         (refresh_rate == connector_info_.modes[mode_index].mode.vrefresh)) {
       vrefresh_ = refresh_rate;
+      property_cache_.Reset();
       DLOGV_IF(kTagDriverConfig, "Set refresh rate to %d", refresh_rate);
       return kErrorNone;
     }
@@ -1631,6 +1964,7 @@ DisplayError HWDeviceDRM::SetMixerAttributes(const HWMixerAttributes &mixer_attr
   float mixer_split_ratio = FLOAT(mixer_attributes_.split_left) / FLOAT(mixer_attributes_.width);
 
   mixer_attributes_ = mixer_attributes;
+  property_cache_.Reset();
   mixer_attributes_.split_left = mixer_attributes_.width;
   if (display_attributes_[index].is_device_split) {
     mixer_attributes_.split_left = UINT32(FLOAT(mixer_attributes.width) * mixer_split_ratio);
@@ -34,23 +34,26 @@
 #include <errno.h>
 #include <pthread.h>
 #include <xf86drmMode.h>
+#include <utils/fence.h>
+#include <deque>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "hw_color_manager_drm.h"
 #include "hw_interface.h"
 #include "hw_scale_drm.h"
 
 #define IOCTL_LOGE(ioctl, type) \
   DLOGE("ioctl %s, device = %d errno = %d, desc = %s", #ioctl, type, errno, strerror(errno))
 
-#define UI_FBID_LIMIT 3
-#define VIDEO_FBID_LIMIT 16
-#define ROTATOR_FBID_LIMIT 2
-
 using sde_drm::DRMPowerMode;
 namespace sdm {
 class HWInfoInterface;
+class FrameBufferObject;
 
 class HWDeviceDRM : public HWInterface {
  public:
@@ -104,6 +107,7 @@ class HWDeviceDRM : public HWInterface {
   virtual DisplayError GetMixerAttributes(HWMixerAttributes *mixer_attributes);
   virtual void InitializeConfigs();
   virtual DisplayError DumpDebugData() { return kErrorNone; }
+  virtual void Dump(std::ostringstream *os);
   virtual void PopulateHWPanelInfo();
   virtual DisplayError SetDynamicDSIClock(uint64_t bit_clk_rate);
   virtual DisplayError GetDynamicDSIClock(uint64_t *bit_clk_rate);
@@ -136,7 +140,8 @@ class HWDeviceDRM : public HWInterface {
   void SetRotation(LayerTransform transform, const HWRotatorMode &mode, uint32_t* rot_bit_mask);
   DisplayError DefaultCommit(HWLayers *hw_layers);
   DisplayError AtomicCommit(HWLayers *hw_layers);
-  void SetupAtomic(HWLayers *hw_layers, bool validate);
+  virtual void SetupAtomic(HWLayers *hw_layers, bool validate);
+  uint64_t GetValidateKey(HWLayers *hw_layers);
   void SetSecureConfig(const LayerBuffer &input_buffer, sde_drm::DRMSecureMode *fb_secure_mode,
                        sde_drm::DRMSecurityLevel *security_level);
   bool IsResolutionSwitchEnabled() const { return resolution_switch_enabled_; }
@@ -144,30 +149,122 @@ class HWDeviceDRM : public HWInterface {
   void SetMultiRectMode(const uint32_t flags, sde_drm::DRMMultiRectMode *target);
   void SetFullROI();
   void SetQOSData(const HWQosData &qos_data);
+  template <typename T>
+  void SetCachedProperty(sde_drm::DRMOps op, uint32_t obj_id, T value) {
+    if (property_cache_.Stage(op, obj_id, &value, sizeof(value))) {
+      drm_atomic_intf_->Perform(op, obj_id, value);
+    }
+  }
 
   class Registry {
    public:
-    explicit Registry(BufferAllocator *buffer_allocator);
+    Registry(BufferSyncHandler *buffer_sync_handler, BufferAllocator *buffer_allocator);
     // Called on each Validate and Commit to map the handle_id to fb_id of each layer buffer.
     void Register(HWLayers *hw_layers);
-    // Called on display disconnect to clear output buffer map and remove fb_ids.
+    // Called on display disconnect to drop all fb_ids referenced by this display.
     void Clear();
     // Create the fd_id for the given buffer.
     int CreateFbId(LayerBuffer *buffer, uint32_t *fb_id);
-    // Find handle_id in the layer map. Else create fb_id and add <handle_id,fb_id> in map.
-    void MapBufferToFbId(Layer* layer, LayerBuffer* buffer);
-    // Find handle_id in output buffer map. Else create fb_id and add <handle_id,fb_id> in map.
+    // Find the buffer in the device wide fb_id cache. Else create fb_id and add it to the cache.
+    std::shared_ptr<FrameBufferObject> MapBufferToFbId(LayerBuffer* buffer);
+    // Map the output buffer of this frame the same way as the layer buffers.
     void MapOutputBufferToFbId(LayerBuffer* buffer);
-    // Find fb_id for given handle_id in the layer map.
-    uint32_t GetFbId(Layer *layer, uint64_t handle_id);
-    // Find fb_id for given handle_id in output buffer map.
-    uint32_t GetOutputFbId(uint64_t handle_id);
+    // Find fb_id mapped for the hw layer at layer_index by the last Register.
+    uint32_t GetFbId(uint32_t layer_index);
+    // Find fb_id mapped for the output buffer of this frame.
+    uint32_t GetOutputFbId();
+    // Called on each commit. The fb_ids of the frame it replaces stay referenced until the
+    // release fence of the commit signals, since removing an fb_id disables planes scanning it.
+    void OnCommit(const std::shared_ptr<Fence> &release_fence);
+    // Dump the counters of the device wide fb_id cache.
+    static void Dump(std::ostringstream *os);
 
    private:
+    struct PendingRelease {
+      std::shared_ptr<Fence> release_fence = nullptr;
+      std::vector<std::shared_ptr<FrameBufferObject>> frame_buffers = {};
+    };
+
+    void ReleaseSignaled();
+
     bool disable_fbid_cache_ = false;
-    std::unordered_map<uint64_t, std::shared_ptr<LayerBufferObject>> output_buffer_map_ {};
+    BufferSyncHandler *buffer_sync_handler_ = {};
     BufferAllocator *buffer_allocator_ = {};
-    uint8_t fbid_cache_limit_ = UI_FBID_LIMIT;
+    std::vector<std::shared_ptr<FrameBufferObject>> layer_buffers_ = {};
+    std::shared_ptr<FrameBufferObject> output_buffer_ = nullptr;
+    std::vector<std::shared_ptr<FrameBufferObject>> on_screen_ = {};
+    std::deque<PendingRelease> pending_release_ = {};
+  };
+
+  // Shadow of the plane and CRTC properties of the last commit. A property set to its committed
+  // value is left out of the atomic request, the driver state keeps it across commits.
+  class PropertyCache {
+   public:
+    // Records the value of the property for this frame. Returns false when it matches the
+    // committed value and need not be added to the request.
+    bool Stage(sde_drm::DRMOps op, uint32_t obj_id, const void *value, size_t size);
+    // Records a plane staged on the CRTC in this frame.
+    void StagePlane(uint32_t plane_id) { staged_planes_.push_back(plane_id); }
+    // Makes the staged values the committed ones. Planes not staged in this frame are unstaged
+    // by the commit, so their values are dropped.
+    void Commit();
+    // Drops the staged values, when the request was only validated.
+    void Discard();
+    // Drops all values, so every property is written on the next frame. Called on any commit
+    // other than a frame commit, on power and mode changes and on failures.
+    void Reset();
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    uint64_t GetResetCount() const { return resets_; }
+    // Configuration generation of the other displays and device wide limits. Committing a
+    // different configuration or resetting the state bumps the generation of all displays.
+    uint64_t GetExternalGeneration() const {
+      return HWInterface::GetConfigGeneration() - own_generation_;
+    }
+    void Dump(std::ostringstream *os);
+
+   private:
+    void UpdateGeneration();
+
+    bool enabled_ = true;
+    uint64_t own_generation_ = 0;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> committed_ = {};
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> staged_ = {};
+    uint32_t num_staged_ = 0;
+    std::vector<uint32_t> committed_planes_ = {};
+    std::vector<uint32_t> staged_planes_ = {};
+    uint32_t frame_written_ = 0;
+    uint32_t frame_skipped_ = 0;
+    uint32_t last_written_ = 0;
+    uint32_t last_skipped_ = 0;
+    uint64_t total_written_ = 0;
+    uint64_t total_skipped_ = 0;
+    uint64_t resets_ = 0;
+  };
+
+  // Results of TEST_ONLY commits, keyed by the configuration of the request without fb_ids and
+  // fences. Entries of an older external generation are not used.
+  class ValidateCache {
+   public:
+    bool Find(uint64_t key, uint64_t generation, int *result);
+    void Insert(uint64_t key, uint64_t generation, int result);
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    void Dump(std::ostringstream *os);
+
+   private:
+    static const uint32_t kMaxEntries = 16;
+
+    struct Entry {
+      uint64_t key = 0;
+      uint64_t generation = 0;
+      int result = 0;
+      bool valid = false;
+    };
+
+    bool enabled_ = true;
+    Entry entries_[kMaxEntries] = {};
+    uint32_t next_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
   };
 
  protected:
@@ -179,6 +276,9 @@ class HWDeviceDRM : public HWInterface {
   BufferSyncHandler *buffer_sync_handler_ = {};
   int dev_fd_ = -1;
   Registry registry_;
+  PropertyCache property_cache_;
+  ValidateCache validate_cache_;
+  HWColorManagerDrm::FeatureCache pp_feature_cache_;
   sde_drm::DRMDisplayToken token_ = {};
   HWResourceInfo hw_resource_ = {};
   HWPanelInfo hw_panel_info_ = {};
@@ -197,6 +297,7 @@ class HWDeviceDRM : public HWInterface {
   HWMixerAttributes mixer_attributes_ = {};
   std::string interface_str_ = "DSI";
   std::vector<sde_drm::DRMSolidfillStage> solid_fills_ {};
+  std::vector<uint32_t> solid_fill_values_ {};
   bool resolution_switch_enabled_ = false;
   bool autorefresh_ = false;
   bool pending_doze_ = false;
@@ -30,10 +30,12 @@
 #include <drm_master.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <math.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/types.h>
@@ -54,18 +56,34 @@
 namespace sdm {
 
 using drm_utils::DRMMaster;
-HWEventsDRM* HWEventsDRM::hw_events_drm_ = nullptr;
 
-DisplayError HWEventsDRM::InitializePollFd() {
+const HWEventsDRM::HWEventEntry HWEventsDRM::kEventTable[kNumEvents] = {
+  /* VSYNC */                {&HWEventsDRM::HandleVSync, kSourceDrm, "vsync"},
+  /* EXIT */                 {&HWEventsDRM::HandleThreadExit, kSourceEventFd, "exit"},
+  /* IDLE_NOTIFY */          {&HWEventsDRM::HandleIdleTimeout, kSourceDrm, "idle_notify"},
+  /* CEC_READ_MESSAGE */     {&HWEventsDRM::HandleCECMessage, kSourceNone, "cec"},
+  /* SHOW_BLANK_EVENT */     {&HWEventsDRM::HandleBlank, kSourceNone, "blank"},
+  /* THERMAL_LEVEL */        {&HWEventsDRM::HandleThermal, kSourceNone, "thermal"},
+  /* IDLE_POWER_COLLAPSE */  {&HWEventsDRM::HandleIdlePowerCollapse, kSourceDrm, "idle_pc"},
+  /* PINGPONG_TIMEOUT */     {nullptr, kSourceNone, "pingpong"},
+  /* PANEL_DEAD */           {&HWEventsDRM::HandlePanelDead, kSourceDrm, "panel_dead"},
+};
+
+DisplayError HWEventsDRM::InitializeEventFds() {
+  epoll_fd_ = Sys::epoll_create1_(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    DLOGE("epoll_create1 failed, error = %s", strerror(errno));
+    return kErrorResources;
+  }
+
   for (uint32_t i = 0; i < event_data_list_.size(); i++) {
-    char data[kMaxStringLength]{};
     HWEventData &event_data = event_data_list_[i];
-    poll_fds_[i] = {};
-    poll_fds_[i].fd = -1;
+    struct epoll_event epoll_event = {};
+    epoll_event.events = EPOLLIN | EPOLLPRI | EPOLLERR;
+    epoll_event.data.u32 = i;
 
     switch (event_data.event_type) {
       case HWEvent::VSYNC: {
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
         if (is_primary_) {
           DRMMaster *master = nullptr;
           int ret = DRMMaster::GetInstance(&master);
@@ -73,45 +91,40 @@ DisplayError HWEventsDRM::InitializePollFd() {
             DLOGE("Failed to acquire DRMMaster instance");
             return kErrorNotSupported;
           }
-          master->GetHandle(&poll_fds_[i].fd);
+          master->GetHandle(&event_data.fd);
         } else {
-          poll_fds_[i].fd = drmOpen("msm_drm", nullptr);
+          event_data.fd = drmOpen("msm_drm", nullptr);
         }
         vsync_index_ = i;
       } break;
       case HWEvent::EXIT: {
-        // Create an eventfd to be used to unblock the poll system call when
+        // Create an eventfd to be used to unblock the epoll_wait system call when
         // a thread is exiting.
-        poll_fds_[i].fd = Sys::eventfd_(0, 0);
-        poll_fds_[i].events |= POLLIN;
-        // Clear any existing data
-        Sys::pread_(poll_fds_[i].fd, data, kMaxStringLength, 0);
+        event_data.fd = Sys::eventfd_(0, 0);
+        epoll_event.events = EPOLLIN;
       } break;
       case HWEvent::IDLE_NOTIFY: {
-        poll_fds_[i].fd = drmOpen("msm_drm", nullptr);
-        if (poll_fds_[i].fd < 0) {
-          DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
+        event_data.fd = drmOpen("msm_drm", nullptr);
+        if (event_data.fd < 0) {
+          DLOGE("drmOpen failed with error %d", event_data.fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
         idle_notify_index_ = i;
       } break;
       case HWEvent::IDLE_POWER_COLLAPSE: {
-        poll_fds_[i].fd = drmOpen("msm_drm", nullptr);
-        if (poll_fds_[i].fd < 0) {
-          DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
+        event_data.fd = drmOpen("msm_drm", nullptr);
+        if (event_data.fd < 0) {
+          DLOGE("drmOpen failed with error %d", event_data.fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
         idle_pc_index_ = i;
       } break;
       case HWEvent::PANEL_DEAD: {
-        poll_fds_[i].fd = drmOpen("msm_drm", nullptr);
-        if (poll_fds_[i].fd < 0) {
-          DLOGE("drmOpen failed with error %d", poll_fds_[i].fd);
+        event_data.fd = drmOpen("msm_drm", nullptr);
+        if (event_data.fd < 0) {
+          DLOGE("drmOpen failed with error %d", event_data.fd);
           return kErrorResources;
         }
-        poll_fds_[i].events = POLLIN | POLLPRI | POLLERR;
         panel_dead_index_ = i;
       } break;
       case HWEvent::CEC_READ_MESSAGE:
@@ -120,58 +133,30 @@ DisplayError HWEventsDRM::InitializePollFd() {
       case HWEvent::PINGPONG_TIMEOUT:
         break;
     }
-  }
-
-  return kErrorNone;
-}
-
-DisplayError HWEventsDRM::SetEventParser() {
-  DisplayError error = kErrorNone;
 
-  for (auto &event_data : event_data_list_) {
-    switch (event_data.event_type) {
-      case HWEvent::VSYNC:
-        event_data.event_parser = &HWEventsDRM::HandleVSync;
-        break;
-      case HWEvent::IDLE_NOTIFY:
-        event_data.event_parser = &HWEventsDRM::HandleIdleTimeout;
-        break;
-      case HWEvent::CEC_READ_MESSAGE:
-        event_data.event_parser = &HWEventsDRM::HandleCECMessage;
-        break;
-      case HWEvent::EXIT:
-        event_data.event_parser = &HWEventsDRM::HandleThreadExit;
-        break;
-      case HWEvent::SHOW_BLANK_EVENT:
-        event_data.event_parser = &HWEventsDRM::HandleBlank;
-        break;
-      case HWEvent::THERMAL_LEVEL:
-        event_data.event_parser = &HWEventsDRM::HandleThermal;
-        break;
-      case HWEvent::IDLE_POWER_COLLAPSE:
-        event_data.event_parser = &HWEventsDRM::HandleIdlePowerCollapse;
-        break;
-      case HWEvent::PANEL_DEAD:
-        event_data.event_parser = &HWEventsDRM::HandlePanelDead;
-        break;
-      default:
-        error = kErrorParameters;
-        break;
+    if (event_data.fd >= 0 &&
+        Sys::epoll_ctl_(epoll_fd_, EPOLL_CTL_ADD, event_data.fd, &epoll_event) < 0) {
+      DLOGE("epoll_ctl failed for event %s, error = %s",
+            kEventTable[event_data.event_type].name, strerror(errno));
+      return kErrorResources;
     }
   }
 
-  return error;
+  return kErrorNone;
 }
 
 void HWEventsDRM::PopulateHWEventData(const vector<HWEvent> &event_list) {
   for (auto &event : event_list) {
+    if (event >= kNumEvents || kEventTable[event].source == kSourceNone) {
+      DLOGW("Event %d is not supported", event);
+      continue;
+    }
     HWEventData event_data;
     event_data.event_type = event;
     event_data_list_.push_back(std::move(event_data));
   }
 
-  SetEventParser();
-  InitializePollFd();
+  InitializeEventFds();
 }
 
 DisplayError HWEventsDRM::Init(int display_id, DisplayType display_type,
@@ -187,13 +172,11 @@ DisplayError HWEventsDRM::Init(int display_id, DisplayType display_type,
         display_id, token_.crtc_id, token_.conn_id);
 
   event_handler_ = event_handler;
-  poll_fds_.resize(event_list.size());
   event_thread_name_ += " - " + std::to_string(display_id);
 
   PopulateHWEventData(event_list);
 
   std::lock_guard<std::mutex> lock(hw_events_mutex_);
-  hw_events_drm_ = this;
   if (pthread_create(&event_thread_, NULL, &DisplayEventThread, this) < 0) {
     DLOGE("Failed to start %s, error = %s", event_thread_name_.c_str());
     return kErrorResources;
@@ -209,12 +192,15 @@ DisplayError HWEventsDRM::Init(int display_id, DisplayType display_type,
 }
 
 DisplayError HWEventsDRM::Deinit() {
-  std::lock_guard<std::mutex> lock(hw_events_mutex_);
-  exit_threads_ = true;
-  hw_events_drm_ = NULL;
-  RegisterPanelDead(false);
-  RegisterIdleNotify(false);
-  RegisterIdlePowerCollapse(false);
+  {
+    // Events dispatched after this point are dropped. The lock is released before joining, the
+    // event thread may be waiting for it to dispatch a batch.
+    std::lock_guard<std::mutex> lock(hw_events_mutex_);
+    exit_threads_ = true;
+    RegisterPanelDead(false);
+    RegisterIdleNotify(false);
+    RegisterIdlePowerCollapse(false);
+  }
   Sys::pthread_cancel_(event_thread_);
   WakeUpEventThread();
   pthread_join(event_thread_, NULL);
@@ -241,13 +227,39 @@ DisplayError HWEventsDRM::SetEventState(HWEvent event, bool enable, void *arg) {
   return kErrorNone;
 }
 
+void HWEventsDRM::Dump(std::ostringstream *os) {
+  char line[128];
+
+  *os << "\nevent latency (us)";
+  *os << "\n           event    count     mean      p50      p90      p99      max";
+  for (uint32_t i = 0; i <= kNumEvents; i++) {
+    // The last row is the delay from the hardware vsync timestamp to the VSync callback.
+    const LatencyHistogram &histogram = (i < kNumEvents) ? dispatch_latency_[i] : vsync_latency_;
+    FrameStageSummary summary;
+    histogram.GetSummary(&summary);
+    if (!summary.count) {
+      continue;
+    }
+    snprintf(line, sizeof(line), "\n%16s %8" PRIu64 " %8.1f %8.1f %8.1f %8.1f %8.1f",
+             (i < kNumEvents) ? kEventTable[i].name : "vsync_timestamp", summary.count,
+             static_cast<double>(summary.mean_ns) / 1000.0,
+             static_cast<double>(summary.p50_ns) / 1000.0,
+             static_cast<double>(summary.p90_ns) / 1000.0,
+             static_cast<double>(summary.p99_ns) / 1000.0,
+             static_cast<double>(summary.max_ns) / 1000.0);
+    *os << line;
+  }
+  *os << "\nvsync coalesced: " << vsync_coalesced_.load(std::memory_order_relaxed);
+}
+
 void HWEventsDRM::WakeUpEventThread() {
   for (uint32_t i = 0; i < event_data_list_.size(); i++) {
-    if (event_data_list_[i].event_type == HWEvent::EXIT && poll_fds_[i].fd >= 0) {
+    HWEventData &event_data = event_data_list_[i];
+    if (event_data.event_type == HWEvent::EXIT && event_data.fd >= 0) {
       uint64_t exit_value = 1;
-      ssize_t write_size = Sys::write_(poll_fds_[i].fd, &exit_value, sizeof(uint64_t));
+      ssize_t write_size = Sys::write_(event_data.fd, &exit_value, sizeof(uint64_t));
       if (write_size != sizeof(uint64_t)) {
-        DLOGW("Error triggering exit fd (%d). write size = %d, error = %s", poll_fds_[i].fd,
+        DLOGW("Error triggering exit fd (%d). write size = %d, error = %s", event_data.fd,
               write_size, strerror(errno));
       }
       break;
@@ -257,22 +269,23 @@ void HWEventsDRM::WakeUpEventThread() {
 
 DisplayError HWEventsDRM::CloseFds() {
   for (uint32_t i = 0; i < event_data_list_.size(); i++) {
-    switch (event_data_list_[i].event_type) {
+    HWEventData &event_data = event_data_list_[i];
+    switch (event_data.event_type) {
       case HWEvent::VSYNC:
         if (!is_primary_) {
-          Sys::close_(poll_fds_[i].fd);
+          Sys::close_(event_data.fd);
         }
-        poll_fds_[i].fd = -1;
+        event_data.fd = -1;
         break;
       case HWEvent::EXIT:
-        Sys::close_(poll_fds_[i].fd);
-        poll_fds_[i].fd = -1;
+        Sys::close_(event_data.fd);
+        event_data.fd = -1;
         break;
       case HWEvent::IDLE_NOTIFY:
       case HWEvent::IDLE_POWER_COLLAPSE:
       case HWEvent::PANEL_DEAD:
-        drmClose(poll_fds_[i].fd);
-        poll_fds_[i].fd = -1;
+        drmClose(event_data.fd);
+        event_data.fd = -1;
         break;
       case HWEvent::CEC_READ_MESSAGE:
       case HWEvent::SHOW_BLANK_EVENT:
@@ -283,6 +296,11 @@ DisplayError HWEventsDRM::CloseFds() {
     }
   }
 
+  if (epoll_fd_ >= 0) {
+    Sys::close_(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+
   return kErrorNone;
 }
 
@@ -295,51 +313,21 @@ void *HWEventsDRM::DisplayEventThread(void *context) {
 }
 
 void *HWEventsDRM::DisplayEventHandler() {
-  char data[kMaxStringLength]{};
+  struct epoll_event events[kNumEvents] = {};
 
   prctl(PR_SET_NAME, event_thread_name_.c_str(), 0, 0, 0);
   setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
 
   while (!exit_threads_) {
-    int error = Sys::poll_(poll_fds_.data(), UINT32(poll_fds_.size()), -1);
-    if (error <= 0) {
-      DLOGW("poll failed. error = %s", strerror(errno));
+    int num_events = Sys::epoll_wait_(epoll_fd_, events, kNumEvents, -1);
+    if (num_events <= 0) {
+      if (errno != EINTR) {
+        DLOGW("epoll_wait failed. error = %s", strerror(errno));
+      }
       continue;
     }
 
-    for (uint32_t i = 0; i < event_data_list_.size(); i++) {
-      pollfd &poll_fd = poll_fds_[i];
-      if (poll_fd.fd < 0) {
-        continue;
-      }
-
-      switch (event_data_list_[i].event_type) {
-        case HWEvent::VSYNC:
-        case HWEvent::PANEL_DEAD:
-        case HWEvent::IDLE_NOTIFY:
-        case HWEvent::IDLE_POWER_COLLAPSE:
-          if (poll_fd.revents & (POLLIN | POLLPRI | POLLERR)) {
-            std::lock_guard<std::mutex> lock(hw_events_mutex_);
-            (this->*(event_data_list_[i]).event_parser)(nullptr);
-          }
-          break;
-        case HWEvent::EXIT:
-          if ((poll_fd.revents & POLLIN) &&
-              (Sys::read_(poll_fd.fd, data, kMaxStringLength) > 0)) {
-            (this->*(event_data_list_[i]).event_parser)(data);
-          }
-          break;
-        case HWEvent::CEC_READ_MESSAGE:
-        case HWEvent::SHOW_BLANK_EVENT:
-        case HWEvent::THERMAL_LEVEL:
-        case HWEvent::PINGPONG_TIMEOUT:
-          if ((poll_fd.revents & POLLPRI) &&
-              (Sys::pread_(poll_fd.fd, data, kMaxStringLength, 0) > 0)) {
-            (this->*(event_data_list_[i]).event_parser)(data);
-          }
-          break;
-      }
-    }
+    DispatchEvents(events, num_events);
   }
 
   pthread_exit(0);
@@ -347,13 +335,36 @@ void *HWEventsDRM::DisplayEventHandler() {
   return nullptr;
 }
 
+void HWEventsDRM::DispatchEvents(const struct epoll_event *events, int num_events) {
+  char data[kMaxStringLength]{};
+  uint64_t wakeup_ns = FrameStats::GetTimeNs();
+
+  // Only the ready fds are visited, the whole batch is dispatched under a single lock.
+  std::lock_guard<std::mutex> lock(hw_events_mutex_);
+  if (exit_threads_) {
+    return;
+  }
+
+  for (int i = 0; i < num_events; i++) {
+    HWEventData &event_data = event_data_list_[events[i].data.u32];
+    const HWEventEntry &entry = kEventTable[event_data.event_type];
+    if (entry.source == kSourceEventFd &&
+        Sys::read_(event_data.fd, data, kMaxStringLength) <= 0) {
+      continue;
+    }
+
+    (this->*(entry.event_parser))(data);
+    dispatch_latency_[event_data.event_type].Record(FrameStats::GetTimeNs() - wakeup_ns);
+  }
+}
+
 DisplayError HWEventsDRM::RegisterVSync() {
   drmVBlank vblank {};
   uint32_t high_crtc = token_.crtc_index << DRM_VBLANK_HIGH_CRTC_SHIFT;
   vblank.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT |
                                            (high_crtc & DRM_VBLANK_HIGH_CRTC_MASK));
   vblank.request.sequence = 1;
-  int error = drmWaitVBlank(poll_fds_[vsync_index_].fd, &vblank);
+  int error = drmWaitVBlank(event_data_list_[vsync_index_].fd, &vblank);
   if (error < 0) {
     DLOGE("drmWaitVBlank failed with err %d", errno);
     return kErrorResources;
@@ -382,9 +393,9 @@ DisplayError HWEventsDRM::RegisterPanelDead(bool enable) {
   req.object_type = DRM_MODE_OBJECT_CONNECTOR;
   req.event = DRM_EVENT_PANEL_DEAD;
   if (enable) {
-    ret = drmIoctl(poll_fds_[panel_dead_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[panel_dead_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
   } else {
-    ret = drmIoctl(poll_fds_[panel_dead_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[panel_dead_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
   }
 
   if (ret) {
@@ -415,9 +426,9 @@ DisplayError HWEventsDRM::RegisterIdleNotify(bool enable) {
   req.object_type = DRM_MODE_OBJECT_CRTC;
   req.event = DRM_EVENT_IDLE_NOTIFY;
   if (enable) {
-    ret = drmIoctl(poll_fds_[idle_notify_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[idle_notify_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
   } else {
-    ret = drmIoctl(poll_fds_[idle_notify_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[idle_notify_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
   }
 
   if (ret) {
@@ -448,9 +459,9 @@ DisplayError HWEventsDRM::RegisterIdlePowerCollapse(bool enable) {
   req.object_type = DRM_MODE_OBJECT_CRTC;
   req.event = DRM_EVENT_SDE_POWER;
   if (enable) {
-    ret = drmIoctl(poll_fds_[idle_pc_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[idle_pc_index_].fd, DRM_IOCTL_MSM_REGISTER_EVENT, &req);
   } else {
-    ret = drmIoctl(poll_fds_[idle_pc_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
+    ret = drmIoctl(event_data_list_[idle_pc_index_].fd, DRM_IOCTL_MSM_DEREGISTER_EVENT, &req);
   }
 
   if (ret) {
@@ -462,12 +473,39 @@ DisplayError HWEventsDRM::RegisterIdlePowerCollapse(bool enable) {
 }
 
 void HWEventsDRM::HandleVSync(char *data) {
-  drmEventContext event = {};
-  event.version = DRM_EVENT_CONTEXT_VERSION;
-  event.vblank_handler = &HWEventsDRM::VSyncHandlerCallback;
-  int error = drmHandleEvent(poll_fds_[vsync_index_].fd, &event);
-  if (error != 0) {
-    DLOGE("drmHandleEvent failed: %i", error);
+  char event_data[kMaxStringLength];
+  ssize_t size = Sys::read_(event_data_list_[vsync_index_].fd, event_data, kMaxStringLength);
+  if (size < 0) {
+    DLOGE("read failed, error = %s", strerror(errno));
+  }
+
+  // Parse the vblank events in place. When several are pending only the latest one is reported,
+  // older timestamps are already stale for the vsync consumers.
+  int64_t timestamp = 0;
+  uint32_t num_vsyncs = 0;
+  ssize_t i = 0;
+  while (i + static_cast<ssize_t>(sizeof(struct drm_event)) <= size) {
+    struct drm_event *event = reinterpret_cast<struct drm_event *>(&event_data[i]);
+    if (event->length < sizeof(*event) || i + event->length > size) {
+      DLOGE("invalid event length %d", event->length);
+      break;
+    }
+    if (event->type == DRM_EVENT_VBLANK && event->length >= sizeof(struct drm_event_vblank)) {
+      struct drm_event_vblank *vblank = reinterpret_cast<struct drm_event_vblank *>(event);
+      timestamp = static_cast<int64_t>(vblank->tv_sec) * 1000000000 +
+                  static_cast<int64_t>(vblank->tv_usec) * 1000;
+      num_vsyncs++;
+    }
+    i += event->length;
+  }
+
+  if (num_vsyncs) {
+    int64_t now = static_cast<int64_t>(FrameStats::GetTimeNs());
+    if (now >= timestamp) {
+      vsync_latency_.Record(UINT64(now - timestamp));
+    }
+    vsync_coalesced_.fetch_add(num_vsyncs - 1, std::memory_order_relaxed);
+    event_handler_->VSync(timestamp);
   }
 
   std::lock_guard<std::mutex> lock(vsync_mutex_);
@@ -483,7 +521,8 @@ void HWEventsDRM::HandlePanelDead(char *data) {
   int32_t size;
   struct drm_msm_event_resp *event_resp = NULL;
 
-  size = (int32_t)Sys::pread_(poll_fds_[panel_dead_index_].fd, event_data, kMaxStringLength, 0);
+  int fd = event_data_list_[panel_dead_index_].fd;
+  size = (int32_t)Sys::pread_(fd, event_data, kMaxStringLength, 0);
   if (size <= 0) {
     return;
   }
@@ -498,6 +537,8 @@ void HWEventsDRM::HandlePanelDead(char *data) {
     return;
   }
 
+  // A burst of responses in one read is reported once.
+  uint32_t num_events = 0;
   int32_t i = 0;
   while (i < size) {
     event_resp = (struct drm_msm_event_resp *)&event_data[i];
@@ -505,7 +546,7 @@ void HWEventsDRM::HandlePanelDead(char *data) {
       case DRM_EVENT_PANEL_DEAD:
       {
         DLOGI("Received panel dead event");
-        event_handler_->PanelDead();
+        num_events++;
         break;
       }
       default: {
@@ -516,15 +557,11 @@ void HWEventsDRM::HandlePanelDead(char *data) {
     i += event_resp->base.length;
   }
 
-  return;
-}
-
-void HWEventsDRM::VSyncHandlerCallback(int fd, unsigned int sequence, unsigned int tv_sec,
-                                       unsigned int tv_usec, void *data) {
-  int64_t timestamp = (int64_t)(tv_sec)*1000000000 + (int64_t)(tv_usec)*1000;
-  if (hw_events_drm_) {
-    hw_events_drm_->event_handler_->VSync(timestamp);
+  if (num_events) {
+    event_handler_->PanelDead();
   }
+
+  return;
 }
 
 void HWEventsDRM::HandleIdleTimeout(char *data) {
@@ -532,7 +569,8 @@ void HWEventsDRM::HandleIdleTimeout(char *data) {
   int32_t size;
   struct drm_msm_event_resp *event_resp = NULL;
 
-  size = (int32_t)Sys::pread_(poll_fds_[idle_notify_index_].fd, event_data, kMaxStringLength, 0);
+  int fd = event_data_list_[idle_notify_index_].fd;
+  size = (int32_t)Sys::pread_(fd, event_data, kMaxStringLength, 0);
   if (size < 0) {
     return;
   }
@@ -547,6 +585,8 @@ void HWEventsDRM::HandleIdleTimeout(char *data) {
     return;
   }
 
+  // A burst of responses in one read is reported once.
+  uint32_t num_events = 0;
   int32_t i = 0;
 
   while (i < size) {
@@ -555,7 +595,7 @@ void HWEventsDRM::HandleIdleTimeout(char *data) {
       case DRM_EVENT_IDLE_NOTIFY:
       {
         DLOGV("Received Idle time event");
-        event_handler_->IdleTimeout();
+        num_events++;
         break;
       }
       default: {
@@ -566,6 +606,10 @@ void HWEventsDRM::HandleIdleTimeout(char *data) {
     i += event_resp->base.length;
   }
 
+  if (num_events) {
+    event_handler_->IdleTimeout();
+  }
+
   return;
 }
 
@@ -578,7 +622,8 @@ void HWEventsDRM::HandleIdlePowerCollapse(char *data) {
   int32_t size;
   struct drm_msm_event_resp *event_resp = NULL;
 
-  size = (int32_t)Sys::pread_(poll_fds_[idle_pc_index_].fd, event_data, kMaxStringLength, 0);
+  int fd = event_data_list_[idle_pc_index_].fd;
+  size = (int32_t)Sys::pread_(fd, event_data, kMaxStringLength, 0);
   if (size < 0) {
     return;
   }
@@ -593,6 +638,8 @@ void HWEventsDRM::HandleIdlePowerCollapse(char *data) {
     return;
   }
 
+  // A burst of responses in one read is reported once.
+  uint32_t num_events = 0;
   int32_t i = 0;
 
   while (i < size) {
@@ -603,7 +650,7 @@ void HWEventsDRM::HandleIdlePowerCollapse(char *data) {
         uint32_t* event_payload = reinterpret_cast<uint32_t *>(event_resp->data);
         if (*event_payload == 0) {
           DLOGV("Received Idle power collapse event");
-          event_handler_->IdlePowerCollapse();
+          num_events++;
         }
         break;
       }
@@ -615,6 +662,10 @@ void HWEventsDRM::HandleIdlePowerCollapse(char *data) {
     i += event_resp->base.length;
   }
 
+  if (num_events) {
+    event_handler_->IdlePowerCollapse();
+  }
+
   return;
 }
 
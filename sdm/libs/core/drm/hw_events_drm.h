@@ -31,7 +31,8 @@
 #define __HW_EVENTS_DRM_H__
 
 #include <drm_interface.h>
-#include <sys/poll.h>
+#include <utils/frame_stats.h>
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <string>
@@ -52,22 +53,38 @@ class HWEventsDRM : public HWEventsInterface {
                             const vector<HWEvent> &event_list, const HWInterface *hw_intf);
   virtual DisplayError Deinit();
   virtual DisplayError SetEventState(HWEvent event, bool enable, void *aux = nullptr);
+  virtual void Dump(std::ostringstream *os);
 
  private:
   static const int kMaxStringLength = 1024;
+  static const uint32_t kNumEvents = HWEvent::PANEL_DEAD + 1;
 
   typedef void (HWEventsDRM::*EventParser)(char *);
 
+  enum EventSource {
+    kSourceNone,     // Not supported, no fd is opened.
+    kSourceDrm,      // DRM fd, the parser reads the pending events itself.
+    kSourceEventFd,  // eventfd used to wake up the event thread.
+  };
+
+  struct HWEventEntry {
+    EventParser event_parser;
+    EventSource source;
+    const char *name;
+  };
+
   struct HWEventData {
     HWEvent event_type {};
-    EventParser event_parser {};
+    int fd = -1;
   };
 
+  // Parser and fd source of each event, indexed by HWEvent.
+  static const HWEventEntry kEventTable[kNumEvents];
+
   static void *DisplayEventThread(void *context);
-  static void VSyncHandlerCallback(int fd, unsigned int sequence, unsigned int tv_sec,
-                                   unsigned int tv_usec, void *data);
 
   void *DisplayEventHandler();
+  void DispatchEvents(const struct epoll_event *events, int num_events);
   void HandleVSync(char *data);
   void HandleIdleTimeout(char *data);
   void HandleCECMessage(char *data);
@@ -78,8 +95,7 @@ class HWEventsDRM : public HWEventsInterface {
   void HandlePanelDead(char *data);
   void PopulateHWEventData(const vector<HWEvent> &event_list);
   void WakeUpEventThread();
-  DisplayError SetEventParser();
-  DisplayError InitializePollFd();
+  DisplayError InitializeEventFds();
   DisplayError CloseFds();
   DisplayError RegisterVSync();
   DisplayError RegisterPanelDead(bool enable);
@@ -88,7 +104,7 @@ class HWEventsDRM : public HWEventsInterface {
 
   HWEventHandler *event_handler_{};
   vector<HWEventData> event_data_list_{};
-  vector<pollfd> poll_fds_{};
+  int epoll_fd_ = -1;
   pthread_t event_thread_{};
   std::string event_thread_name_ = "SDM_EventThread";
   bool exit_threads_ = false;
@@ -101,8 +117,10 @@ class HWEventsDRM : public HWEventsInterface {
   bool is_primary_ = false;
   uint32_t panel_dead_index_ = 0;
   uint32_t idle_pc_index_ = 0;
-  std::mutex hw_events_mutex_; // To protect hw_events_drm_
-  static HWEventsDRM *hw_events_drm_;
+  std::mutex hw_events_mutex_;  // Serializes event dispatch with Deinit
+  LatencyHistogram dispatch_latency_[kNumEvents];  // Wakeup to handler completion
+  LatencyHistogram vsync_latency_;  // Hardware vsync timestamp to VSync callback
+  std::atomic<uint64_t> vsync_coalesced_ {0};  // Vsync events dropped in favor of a newer one
 };
 
 }  // namespace sdm
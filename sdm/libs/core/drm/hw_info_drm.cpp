@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/formats.h>
 #include <utils/sys.h>
 
 #include <algorithm>
@@ -294,14 +295,18 @@ DisplayError HWInfoDRM::GetSystemInfo(HWResourceInfo *hw_resource) {
   for (auto &it : info.comp_ratio_rt_map) {
     std::pair<uint32_t, uint64_t> drm_format = it.first;
     GetSDMFormat(drm_format.first, drm_format.second, &sdm_format);
-    hw_resource->comp_ratio_rt_map.insert(std::make_pair(sdm_format[0], it.second));
+    for (auto format : sdm_format) {
+      hw_resource->comp_ratio_rt_map.insert(std::make_pair(format, it.second));
+    }
     sdm_format.clear();
   }
 
   for (auto &it : info.comp_ratio_nrt_map) {
     std::pair<uint32_t, uint64_t> drm_format = it.first;
     GetSDMFormat(drm_format.first, drm_format.second, &sdm_format);
-    hw_resource->comp_ratio_rt_map.insert(std::make_pair(sdm_format[0], it.second));
+    for (auto format : sdm_format) {
+      hw_resource->comp_ratio_rt_map.insert(std::make_pair(format, it.second));
+    }
     sdm_format.clear();
   }
 
@@ -579,99 +584,96 @@ DisplayError HWInfoDRM::GetHWRotatorInfo(HWResourceInfo *hw_resource) {
   return kErrorNone;
 }
 
+static constexpr uint64_t kModQcomTP10 = DRM_FORMAT_MOD_QCOM_COMPRESSED | DRM_FORMAT_MOD_QCOM_DX |
+                                         DRM_FORMAT_MOD_QCOM_TIGHT;
+static constexpr uint64_t kModQcomP010Ubwc = DRM_FORMAT_MOD_QCOM_COMPRESSED |
+                                             DRM_FORMAT_MOD_QCOM_DX;
+
+// DRM fourcc and modifier of each SDM format in enum order, 0 where DRM has no equivalent. Both
+// directions of the conversion are served from this table.
+static constexpr struct {
+  LayerBufferFormat format;
+  uint32_t drm_format;
+  uint64_t drm_format_modifier;
+} kDRMFormats[] = {
+  { kFormatARGB8888, DRM_FORMAT_BGRA8888, 0 },
+  { kFormatRGBA8888, DRM_FORMAT_ABGR8888, 0 },
+  { kFormatBGRA8888, DRM_FORMAT_ARGB8888, 0 },
+  { kFormatXRGB8888, DRM_FORMAT_BGRX8888, 0 },
+  { kFormatRGBX8888, DRM_FORMAT_XBGR8888, 0 },
+  { kFormatBGRX8888, DRM_FORMAT_XRGB8888, 0 },
+  { kFormatRGBA5551, DRM_FORMAT_ABGR1555, 0 },
+  { kFormatRGBA4444, DRM_FORMAT_ABGR4444, 0 },
+  { kFormatRGB888, DRM_FORMAT_BGR888, 0 },
+  { kFormatBGR888, DRM_FORMAT_RGB888, 0 },
+  { kFormatRGB565, DRM_FORMAT_BGR565, 0 },
+  { kFormatBGR565, DRM_FORMAT_RGB565, 0 },
+  { kFormatRGBA8888Ubwc, DRM_FORMAT_ABGR8888, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatRGBX8888Ubwc, DRM_FORMAT_XBGR8888, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatBGR565Ubwc, DRM_FORMAT_BGR565, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatRGBA1010102, DRM_FORMAT_ABGR2101010, 0 },
+  { kFormatARGB2101010, DRM_FORMAT_BGRA1010102, 0 },
+  { kFormatRGBX1010102, DRM_FORMAT_XBGR2101010, 0 },
+  { kFormatXRGB2101010, DRM_FORMAT_BGRX1010102, 0 },
+  { kFormatBGRA1010102, DRM_FORMAT_ARGB2101010, 0 },
+  { kFormatABGR2101010, DRM_FORMAT_RGBA1010102, 0 },
+  { kFormatBGRX1010102, DRM_FORMAT_XRGB2101010, 0 },
+  { kFormatXBGR2101010, DRM_FORMAT_RGBX1010102, 0 },
+  { kFormatRGBA1010102Ubwc, DRM_FORMAT_ABGR2101010, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatRGBX1010102Ubwc, DRM_FORMAT_XBGR2101010, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatRGB101010, 0, 0 },
+
+  { kFormatYCbCr420Planar, 0, 0 },
+  { kFormatYCrCb420Planar, 0, 0 },
+  { kFormatYCrCb420PlanarStride16, DRM_FORMAT_YVU420, 0 },
+
+  { kFormatYCbCr420SemiPlanar, DRM_FORMAT_NV12, 0 },
+  { kFormatYCrCb420SemiPlanar, DRM_FORMAT_NV21, 0 },
+  { kFormatYCbCr420SemiPlanarVenus, DRM_FORMAT_NV12, 0 },
+  { kFormatYCbCr422H1V2SemiPlanar, 0, 0 },
+  { kFormatYCrCb422H1V2SemiPlanar, 0, 0 },
+  { kFormatYCbCr422H2V1SemiPlanar, DRM_FORMAT_NV16, 0 },
+  { kFormatYCrCb422H2V1SemiPlanar, DRM_FORMAT_NV61, 0 },
+  { kFormatYCbCr420SPVenusUbwc, DRM_FORMAT_NV12, DRM_FORMAT_MOD_QCOM_COMPRESSED },
+  { kFormatYCrCb420SemiPlanarVenus, DRM_FORMAT_NV21, 0 },
+  { kFormatYCbCr420P010, DRM_FORMAT_NV12, DRM_FORMAT_MOD_QCOM_DX },
+  { kFormatYCbCr420TP10Ubwc, DRM_FORMAT_NV12, kModQcomTP10 },
+  { kFormatYCbCr420P010Ubwc, DRM_FORMAT_NV12, kModQcomP010Ubwc },
+  { kFormatYCbCr420P010Venus, DRM_FORMAT_NV12, DRM_FORMAT_MOD_QCOM_DX },
+
+  { kFormatYCbCr422H2V1Packed, 0, 0 },
+  { kFormatCbYCrY422H2V1Packed, 0, 0 },
+};
+
+static_assert(IsFormatTableComplete(kDRMFormats), "DRM formats out of enum order");
+
+bool HWInfoDRM::GetDRMFormat(LayerBufferFormat format, uint32_t *drm_format,
+                             uint64_t *drm_format_modifier) {
+  uint32_t index = GetFormatIndex(format);
+  if (index >= kFormatCount || !kDRMFormats[index].drm_format) {
+    DLOGW("Unsupported format %s", GetFormatString(format));
+    return false;
+  }
+
+  *drm_format = kDRMFormats[index].drm_format;
+  *drm_format_modifier = kDRMFormats[index].drm_format_modifier;
+  return true;
+}
+
 void HWInfoDRM::GetSDMFormat(uint32_t drm_format, uint64_t drm_format_modifier,
                              vector<LayerBufferFormat> *sdm_formats) {
-  vector<LayerBufferFormat> &fmts(*sdm_formats);
-  switch (drm_format) {
-    case DRM_FORMAT_BGRA8888:
-      fmts.push_back(kFormatARGB8888);
-      break;
-    case DRM_FORMAT_ABGR8888:
-      fmts.push_back(drm_format_modifier ? kFormatRGBA8888Ubwc : kFormatRGBA8888);
-      break;
-    case DRM_FORMAT_ARGB8888:
-      fmts.push_back(kFormatBGRA8888);
-      break;
-    case DRM_FORMAT_BGRX8888:
-      fmts.push_back(kFormatXRGB8888);
-      break;
-    case DRM_FORMAT_XBGR8888:
-      fmts.push_back(drm_format_modifier ? kFormatRGBX8888Ubwc : kFormatRGBX8888);
-      break;
-    case DRM_FORMAT_XRGB8888:
-      fmts.push_back(kFormatBGRX8888);
-      break;
-    case DRM_FORMAT_ABGR1555:
-      fmts.push_back(kFormatRGBA5551);
-      break;
-    case DRM_FORMAT_ABGR4444:
-      fmts.push_back(kFormatRGBA4444);
-      break;
-    case DRM_FORMAT_BGR888:
-      fmts.push_back(kFormatRGB888);
-      break;
-    case DRM_FORMAT_RGB888:
-      fmts.push_back(kFormatBGR888);
-      break;
-    case DRM_FORMAT_BGR565:
-      fmts.push_back(drm_format_modifier ? kFormatBGR565Ubwc : kFormatRGB565);
-      break;
-    case DRM_FORMAT_RGB565:
-      fmts.push_back(kFormatBGR565);
-      break;
-    case DRM_FORMAT_ABGR2101010:
-      fmts.push_back(drm_format_modifier ? kFormatRGBA1010102Ubwc : kFormatRGBA1010102);
-      break;
-    case DRM_FORMAT_BGRA1010102:
-      fmts.push_back(kFormatARGB2101010);
-      break;
-    case DRM_FORMAT_XBGR2101010:
-      fmts.push_back(drm_format_modifier ? kFormatRGBX1010102Ubwc : kFormatRGBX1010102);
-      break;
-    case DRM_FORMAT_BGRX1010102:
-      fmts.push_back(kFormatXRGB2101010);
-      break;
-    case DRM_FORMAT_ARGB2101010:
-      fmts.push_back(kFormatBGRA1010102);
-      break;
-    case DRM_FORMAT_RGBA1010102:
-      fmts.push_back(kFormatABGR2101010);
-      break;
-    case DRM_FORMAT_XRGB2101010:
-      fmts.push_back(kFormatBGRX1010102);
-      break;
-    case DRM_FORMAT_RGBX1010102:
-      fmts.push_back(kFormatXBGR2101010);
-      break;
-    case DRM_FORMAT_YVU420:
-      fmts.push_back(kFormatYCrCb420PlanarStride16);
-      break;
-    case DRM_FORMAT_NV12:
-      if (drm_format_modifier == (DRM_FORMAT_MOD_QCOM_COMPRESSED |
-          DRM_FORMAT_MOD_QCOM_DX | DRM_FORMAT_MOD_QCOM_TIGHT)) {
-          fmts.push_back(kFormatYCbCr420TP10Ubwc);
-      } else if (drm_format_modifier == (DRM_FORMAT_MOD_QCOM_COMPRESSED |
-                                         DRM_FORMAT_MOD_QCOM_DX)) {
-        fmts.push_back(kFormatYCbCr420P010Ubwc);
-      } else if (drm_format_modifier == DRM_FORMAT_MOD_QCOM_COMPRESSED) {
-         fmts.push_back(kFormatYCbCr420SPVenusUbwc);
-      } else if (drm_format_modifier == DRM_FORMAT_MOD_QCOM_DX) {
-        fmts.push_back(kFormatYCbCr420P010);
-        fmts.push_back(kFormatYCbCr420P010Venus);
-      } else {
-         fmts.push_back(kFormatYCbCr420SemiPlanarVenus);
-         fmts.push_back(kFormatYCbCr420SemiPlanar);
-      }
-      break;
-    case DRM_FORMAT_NV21:
-      fmts.push_back(kFormatYCrCb420SemiPlanarVenus);
-      fmts.push_back(kFormatYCrCb420SemiPlanar);
-      break;
-    case DRM_FORMAT_NV16:
-      fmts.push_back(kFormatYCbCr422H2V1SemiPlanar);
-      break;
-    default:
-      break;
+  // Runs once per advertised format at init, a linear scan is enough.
+  size_t count = sdm_formats->size();
+  for (auto &entry : kDRMFormats) {
+    if (entry.drm_format && entry.drm_format == drm_format &&
+        entry.drm_format_modifier == drm_format_modifier) {
+      sdm_formats->push_back(entry.format);
+    }
+  }
+
+  // A modifier on a format without a compressed SDM equivalent maps to the plain format.
+  if (sdm_formats->size() == count && drm_format_modifier) {
+    GetSDMFormat(drm_format, 0, sdm_formats);
   }
 }
 
@@ -49,6 +49,9 @@ class HWInfoDRM: public HWInfoInterface {
   virtual DisplayError GetFirstDisplayInterfaceType(HWDisplayInterfaceInfo *hw_disp_info);
   virtual DisplayError GetDisplaysStatus(HWDisplaysInfo *hw_displays_info);
   virtual DisplayError GetMaxDisplaysSupported(DisplayType type, int32_t *max_displays);
+  // Returns false, leaving the outputs untouched, when DRM has no equivalent of format.
+  static bool GetDRMFormat(LayerBufferFormat format, uint32_t *drm_format,
+                           uint64_t *drm_format_modifier);
 
  private:
   DisplayError GetHWRotatorInfo(HWResourceInfo *hw_resource);
@@ -87,6 +87,7 @@ void HWPeripheralDRM::PopulateBitClkRates() {
 
 DisplayError HWPeripheralDRM::SetDynamicDSIClock(uint64_t bit_clk_rate) {
   bit_clk_rate_ = bit_clk_rate;
+  property_cache_.Reset();
   return kErrorNone;
 }
 
@@ -96,18 +97,12 @@ DisplayError HWPeripheralDRM::GetDynamicDSIClock(uint64_t *bit_clk_rate) {
   return kErrorNone;
 }
 
-DisplayError HWPeripheralDRM::Validate(HWLayers *hw_layers) {
-  HWLayersInfo &hw_layer_info = hw_layers->info;
-  SetDestScalarData(hw_layer_info);
-
-  return HWDeviceDRM::Validate(hw_layers);
-}
-
-DisplayError HWPeripheralDRM::Commit(HWLayers *hw_layers) {
-  HWLayersInfo &hw_layer_info = hw_layers->info;
-  SetDestScalarData(hw_layer_info);
+void HWPeripheralDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
+  if (!default_mode_) {
+    SetDestScalarData(hw_layers->info);
+  }
 
-  return HWDeviceDRM::Commit(hw_layers);
+  HWDeviceDRM::SetupAtomic(hw_layers, validate);
 }
 
 void HWPeripheralDRM::ResetDisplayParams() {
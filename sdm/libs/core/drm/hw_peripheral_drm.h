@@ -45,8 +45,7 @@ class HWPeripheralDRM : public HWDeviceDRM {
 
  protected:
   virtual DisplayError Init();
-  virtual DisplayError Validate(HWLayers *hw_layers);
-  virtual DisplayError Commit(HWLayers *hw_layers);
+  virtual void SetupAtomic(HWLayers *hw_layers, bool validate);
   virtual DisplayError Flush(HWLayers *hw_layers);
   virtual DisplayError SetDynamicDSIClock(uint64_t bit_clk_rate);
   virtual DisplayError GetDynamicDSIClock(uint64_t *bit_clk_rate);
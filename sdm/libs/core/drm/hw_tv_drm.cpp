@@ -104,6 +104,7 @@ DisplayError HWTVDRM::SetDisplayAttributes(uint32_t index) {
   }
 
   current_mode_index_ = index;
+  property_cache_.Reset();
   PopulateHWPanelInfo();
   UpdateMixerAttributes();
 
@@ -160,6 +161,7 @@ DisplayError HWTVDRM::PowerOff() {
   DTRACE_SCOPED();
 
   int ret = drm_atomic_intf_->Commit(true /* synchronous */, false /* retain_planes*/);
+  property_cache_.Reset();
   if (ret) {
     DLOGE("%s failed with error %d", __FUNCTION__, ret);
     return kErrorHardware;
@@ -135,18 +135,23 @@ void HWVirtualDRM::DumpConnectorModeInfo() {
   }
 }
 
-DisplayError HWVirtualDRM::Commit(HWLayers *hw_layers) {
+void HWVirtualDRM::SetupAtomic(HWLayers *hw_layers, bool validate) {
   LayerBuffer *output_buffer = hw_layers->info.stack->output_buffer;
-  DisplayError err = kErrorNone;
 
-  registry_.Register(hw_layers);
   registry_.MapOutputBufferToFbId(output_buffer);
-  uint32_t fb_id = registry_.GetOutputFbId(output_buffer->handle_id);
+  uint32_t fb_id = registry_.GetOutputFbId();
 
   ConfigureWbConnectorFbId(fb_id);
   ConfigureWbConnectorDestRect();
   ConfigureWbConnectorSecureMode(output_buffer->flags.secure);
 
+  HWDeviceDRM::SetupAtomic(hw_layers, validate);
+}
+
+DisplayError HWVirtualDRM::Commit(HWLayers *hw_layers) {
+  DisplayError err = kErrorNone;
+
+  registry_.Register(hw_layers);
   err = HWDeviceDRM::AtomicCommit(hw_layers);
   if (err != kErrorNone) {
     DLOGE("Atomic commit failed for crtc_id %d conn_id %d", token_.crtc_id, token_.conn_id);
@@ -168,19 +173,6 @@ DisplayError HWVirtualDRM::Flush(HWLayers *hw_layers) {
   return kErrorNone;
 }
 
-DisplayError HWVirtualDRM::Validate(HWLayers *hw_layers) {
-  LayerBuffer *output_buffer = hw_layers->info.stack->output_buffer;
-
-  registry_.MapOutputBufferToFbId(output_buffer);
-  uint32_t fb_id = registry_.GetOutputFbId(output_buffer->handle_id);
-
-  ConfigureWbConnectorFbId(fb_id);
-  ConfigureWbConnectorDestRect();
-  ConfigureWbConnectorSecureMode(output_buffer->flags.secure);
-
-  return HWDeviceDRM::Validate(hw_layers);
-}
-
 DisplayError HWVirtualDRM::SetDisplayAttributes(const HWDisplayAttributes &display_attributes) {
   if (display_attributes.x_pixels == 0 || display_attributes.y_pixels == 0) {
     return kErrorParameters;
@@ -208,6 +200,7 @@ DisplayError HWVirtualDRM::SetDisplayAttributes(const HWDisplayAttributes &displ
   }
 
   current_mode_index_ = UINT32(mode_index);
+  property_cache_.Reset();
   InitializeConfigs();
   PopulateHWPanelInfo();
   UpdateMixerAttributes();
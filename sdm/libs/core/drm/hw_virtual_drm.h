@@ -49,7 +49,7 @@ class HWVirtualDRM : public HWDeviceDRM {
   virtual DisplayError SetDisplayAttributes(const HWDisplayAttributes &display_attributes);
 
  protected:
-  virtual DisplayError Validate(HWLayers *hw_layers);
+  virtual void SetupAtomic(HWLayers *hw_layers, bool validate);
   virtual DisplayError Commit(HWLayers *hw_layers);
   virtual DisplayError Flush(HWLayers *hw_layers);
   virtual DisplayError GetPPFeaturesVersion(PPFeatureVersion *vers);
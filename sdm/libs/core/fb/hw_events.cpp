@@ -28,11 +28,13 @@
 */
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <fcntl.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
 #include <sys/resource.h>
 #include <sys/prctl.h>
 #include <utils/debug.h>
@@ -40,7 +42,6 @@
 #include <pthread.h>
 #include <algorithm>
 #include <vector>
-#include <map>
 #include <utility>
 
 #include "hw_events.h"
@@ -49,78 +50,93 @@
 
 namespace sdm {
 
-pollfd HWEvents::InitializePollFd(HWEventData *event_data) {
+const HWEvents::HWEventEntry HWEvents::kEventTable[kNumEvents] = {
+  /* VSYNC */                {&HWEvents::HandleVSync, "vsync_event"},
+  /* EXIT */                 {&HWEvents::HandleThreadExit, "thread_exit"},
+  /* IDLE_NOTIFY */          {&HWEvents::HandleIdleTimeout, "idle_notify"},
+  /* CEC_READ_MESSAGE */     {&HWEvents::HandleCECMessage, "cec/rd_msg"},
+  /* SHOW_BLANK_EVENT */     {&HWEvents::HandleBlank, "show_blank_event"},
+  /* THERMAL_LEVEL */        {&HWEvents::HandleThermal, "msm_fb_thermal_level"},
+  /* IDLE_POWER_COLLAPSE */  {&HWEvents::HandleIdlePowerCollapse, "idle_power_collapse"},
+  /* PINGPONG_TIMEOUT */     {&HWEvents::HandlePingPongTimeout, "pingpong_timeout"},
+  /* PANEL_DEAD */           {nullptr, nullptr},
+};
+
+// Parses the decimal value following prefix in data, without the overhead of the scanf family.
+static int64_t ParseEventValue(const char *data, const char *prefix) {
+  size_t prefix_length = strlen(prefix);
+  if (strncmp(data, prefix, prefix_length)) {
+    return 0;
+  }
+
+  const char *digit = data + prefix_length;
+  bool negative = (*digit == '-');
+  if (negative) {
+    digit++;
+  }
+
+  int64_t value = 0;
+  for (; *digit >= '0' && *digit <= '9'; digit++) {
+    value = value * 10 + (*digit - '0');
+  }
+
+  return negative ? -value : value;
+}
+
+int HWEvents::InitializeEventFd(HWEvent event_type) {
   char node_path[kMaxStringLength] = {0};
   char data[kMaxStringLength] = {0};
-  pollfd poll_fd = {0};
-  poll_fd.fd = -1;
+  struct epoll_event epoll_event = {};
+  int fd = -1;
 
-  if (event_data->event_type == HWEvent::EXIT) {
-    // Create an eventfd to be used to unblock the poll system call when
+  if (event_type == HWEvent::EXIT) {
+    // Create an eventfd to be used to unblock the epoll_wait system call when
     // a thread is exiting.
-    poll_fd.fd = Sys::eventfd_(0, 0);
-    poll_fd.events |= POLLIN;
-    exit_fd_ = poll_fd.fd;
+    fd = Sys::eventfd_(0, 0);
+    epoll_event.events = EPOLLIN;
+    exit_fd_ = fd;
   } else {
     snprintf(node_path, sizeof(node_path), "%s%d/%s", fb_path_, fb_num_,
-             map_event_to_node_[event_data->event_type]);
-    poll_fd.fd = Sys::open_(node_path, O_RDONLY);
-    poll_fd.events |= POLLPRI | POLLERR;
+             kEventTable[event_type].node);
+    fd = Sys::open_(node_path, O_RDONLY);
+    epoll_event.events = EPOLLPRI | EPOLLERR;
   }
 
-  if (poll_fd.fd < 0) {
+  if (fd < 0) {
     DLOGW("open failed for display=%d event=%s, error=%s", fb_num_,
-          map_event_to_node_[event_data->event_type], strerror(errno));
-    return poll_fd;
+          kEventTable[event_type].node, strerror(errno));
+    return fd;
   }
 
   // Read once on all fds to clear data on all fds.
-  Sys::pread_(poll_fd.fd, data , kMaxStringLength, 0);
-
-  return poll_fd;
-}
+  Sys::pread_(fd, data , kMaxStringLength, 0);
 
-DisplayError HWEvents::SetEventParser(HWEvent event_type, HWEventData *event_data) {
-  DisplayError error = kErrorNone;
-  switch (event_type) {
-    case HWEvent::VSYNC:
-      event_data->event_parser = &HWEvents::HandleVSync;
-      break;
-    case HWEvent::IDLE_NOTIFY:
-      event_data->event_parser = &HWEvents::HandleIdleTimeout;
-      break;
-    case HWEvent::CEC_READ_MESSAGE:
-      event_data->event_parser = &HWEvents::HandleCECMessage;
-      break;
-    case HWEvent::EXIT:
-      event_data->event_parser = &HWEvents::HandleThreadExit;
-      break;
-    case HWEvent::SHOW_BLANK_EVENT:
-      event_data->event_parser = &HWEvents::HandleBlank;
-      break;
-    case HWEvent::THERMAL_LEVEL:
-      event_data->event_parser = &HWEvents::HandleThermal;
-      break;
-    case HWEvent::IDLE_POWER_COLLAPSE:
-      event_data->event_parser = &HWEvents::HandleIdlePowerCollapse;
-      break;
-    case HWEvent::PINGPONG_TIMEOUT:
-      event_data->event_parser = &HWEvents::HandlePingPongTimeout;
-      break;
-    default:
-      error = kErrorParameters;
-      break;
+  epoll_event.data.u32 = UINT32(event_data_list_.size());
+  if (Sys::epoll_ctl_(epoll_fd_, EPOLL_CTL_ADD, fd, &epoll_event) < 0) {
+    DLOGW("epoll_ctl failed for display=%d event=%s, error=%s", fb_num_,
+          kEventTable[event_type].node, strerror(errno));
   }
 
-  return error;
+  return fd;
 }
 
 void HWEvents::PopulateHWEventData() {
+  epoll_fd_ = Sys::epoll_create1_(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    DLOGE("epoll_create1 failed, error=%s", strerror(errno));
+    return;
+  }
+
   for (uint32_t i = 0; i < event_list_.size(); i++) {
+    HWEvent event_type = event_list_[i];
+    if (event_type >= kNumEvents || !kEventTable[event_type].event_parser) {
+      DLOGW("Event %d is not supported", event_type);
+      continue;
+    }
+
     HWEventData event_data;
-    event_data.event_type = event_list_[i];
-    SetEventParser(event_list_[i], &event_data);
-    poll_fds_[i] = InitializePollFd(&event_data);
+    event_data.event_type = event_type;
+    event_data.fd = InitializeEventFd(event_type);
     event_data_list_.push_back(event_data);
   }
 }
@@ -135,16 +151,7 @@ DisplayError HWEvents::Init(int fb_num, DisplayType display_type, HWEventHandler
   // fb_num set to display_type for unit-test framework.
   fb_num_ = display_type;
   event_list_ = event_list;
-  poll_fds_.resize(event_list_.size());
   event_thread_name_ += " - " + std::to_string(fb_num_);
-  map_event_to_node_ = {{HWEvent::VSYNC, "vsync_event"},
-                        {HWEvent::EXIT, "thread_exit"},
-                        {HWEvent::IDLE_NOTIFY, "idle_notify"},
-                        {HWEvent::SHOW_BLANK_EVENT, "show_blank_event"},
-                        {HWEvent::CEC_READ_MESSAGE, "cec/rd_msg"},
-                        {HWEvent::THERMAL_LEVEL, "msm_fb_thermal_level"},
-                        {HWEvent::IDLE_POWER_COLLAPSE, "idle_power_collapse"},
-                        {HWEvent::PINGPONG_TIMEOUT, "pingpong_timeout"}};
 
   PopulateHWEventData();
 
@@ -168,14 +175,40 @@ DisplayError HWEvents::Deinit() {
 
   pthread_join(event_thread_, NULL);
 
-  for (uint32_t i = 0; i < event_list_.size(); i++) {
-    Sys::close_(poll_fds_[i].fd);
-    poll_fds_[i].fd = -1;
+  for (uint32_t i = 0; i < event_data_list_.size(); i++) {
+    Sys::close_(event_data_list_[i].fd);
+    event_data_list_[i].fd = -1;
   }
+  Sys::close_(epoll_fd_);
+  epoll_fd_ = -1;
 
   return kErrorNone;
 }
 
+void HWEvents::Dump(std::ostringstream *os) {
+  char line[128];
+
+  *os << "\nevent latency (us)";
+  *os << "\n           event    count     mean      p50      p90      p99      max";
+  for (uint32_t i = 0; i <= kNumEvents; i++) {
+    // The last row is the delay from the hardware vsync timestamp to the VSync callback.
+    const LatencyHistogram &histogram = (i < kNumEvents) ? dispatch_latency_[i] : vsync_latency_;
+    FrameStageSummary summary;
+    histogram.GetSummary(&summary);
+    if (!summary.count) {
+      continue;
+    }
+    snprintf(line, sizeof(line), "\n%16s %8" PRIu64 " %8.1f %8.1f %8.1f %8.1f %8.1f",
+             (i < kNumEvents) ? kEventTable[i].node : "vsync_timestamp", summary.count,
+             static_cast<double>(summary.mean_ns) / 1000.0,
+             static_cast<double>(summary.p50_ns) / 1000.0,
+             static_cast<double>(summary.p90_ns) / 1000.0,
+             static_cast<double>(summary.p99_ns) / 1000.0,
+             static_cast<double>(summary.max_ns) / 1000.0);
+    *os << line;
+  }
+}
+
 void* HWEvents::DisplayEventThread(void *context) {
   if (context) {
     return reinterpret_cast<HWEvents *>(context)->DisplayEventHandler();
@@ -185,33 +218,22 @@ void* HWEvents::DisplayEventThread(void *context) {
 }
 
 void* HWEvents::DisplayEventHandler() {
-  char data[kMaxStringLength] = {0};
+  struct epoll_event events[kNumEvents] = {};
 
   prctl(PR_SET_NAME, event_thread_name_.c_str(), 0, 0, 0);
   setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
 
   while (!exit_threads_) {
-    int error = Sys::poll_(poll_fds_.data(), UINT32(event_list_.size()), -1);
+    int num_events = Sys::epoll_wait_(epoll_fd_, events, kNumEvents, -1);
 
-    if (error <= 0) {
-      DLOGW("poll failed. error = %s", strerror(errno));
+    if (num_events <= 0) {
+      if (errno != EINTR) {
+        DLOGW("epoll_wait failed. error = %s", strerror(errno));
+      }
       continue;
     }
 
-    for (uint32_t event = 0; event < event_list_.size(); event++) {
-      pollfd &poll_fd = poll_fds_[event];
-
-      if (event_list_.at(event) == HWEvent::EXIT) {
-        if ((poll_fd.revents & POLLIN) && (Sys::read_(poll_fd.fd, data, kMaxStringLength) > 0)) {
-          (this->*(event_data_list_[event]).event_parser)(data);
-        }
-      } else {
-        if ((poll_fd.revents & POLLPRI) &&
-                (Sys::pread_(poll_fd.fd, data, kMaxStringLength, 0) > 0)) {
-          (this->*(event_data_list_[event]).event_parser)(data);
-        }
-      }
-    }
+    DispatchEvents(events, num_events);
   }
 
   pthread_exit(0);
@@ -219,10 +241,39 @@ void* HWEvents::DisplayEventHandler() {
   return NULL;
 }
 
+void HWEvents::DispatchEvents(const struct epoll_event *events, int num_events) {
+  char data[kMaxStringLength] = {0};
+  uint64_t wakeup_ns = FrameStats::GetTimeNs();
+
+  // Only the ready fds are visited.
+  for (int i = 0; i < num_events; i++) {
+    HWEventData &event_data = event_data_list_[events[i].data.u32];
+    ssize_t size = 0;
+
+    if (event_data.event_type == HWEvent::EXIT) {
+      if (events[i].events & EPOLLIN) {
+        size = Sys::read_(event_data.fd, data, kMaxStringLength - 1);
+      }
+    } else if (events[i].events & EPOLLPRI) {
+      // sysfs nodes hold the latest value only, a burst of notifications is read once.
+      size = Sys::pread_(event_data.fd, data, kMaxStringLength - 1, 0);
+    }
+
+    if (size <= 0) {
+      continue;
+    }
+
+    data[size] = '\0';
+    (this->*(kEventTable[event_data.event_type].event_parser))(data);
+    dispatch_latency_[event_data.event_type].Record(FrameStats::GetTimeNs() - wakeup_ns);
+  }
+}
+
 void HWEvents::HandleVSync(char *data) {
-  int64_t timestamp = 0;
-  if (!strncmp(data, "VSYNC=", strlen("VSYNC="))) {
-    timestamp = strtoll(data + strlen("VSYNC="), NULL, 0);
+  int64_t timestamp = ParseEventValue(data, "VSYNC=");
+  int64_t now = static_cast<int64_t>(FrameStats::GetTimeNs());
+  if (timestamp && now >= timestamp) {
+    vsync_latency_.Record(UINT64(now - timestamp));
   }
 
   event_handler_->VSync(timestamp);
@@ -237,10 +288,7 @@ void HWEvents::HandlePingPongTimeout(char *data) {
 }
 
 void HWEvents::HandleThermal(char *data) {
-  int64_t thermal_level = 0;
-  if (!strncmp(data, "thermal_level=", strlen("thermal_level="))) {
-    thermal_level = strtoll(data + strlen("thermal_level="), NULL, 0);
-  }
+  int64_t thermal_level = ParseEventValue(data, "thermal_level=");
 
   DLOGI("Received thermal notification with thermal level = %d", thermal_level);
 
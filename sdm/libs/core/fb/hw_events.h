@@ -25,10 +25,9 @@
 #ifndef __HW_EVENTS_H__
 #define __HW_EVENTS_H__
 
-#include <sys/poll.h>
+#include <utils/frame_stats.h>
 #include <string>
 #include <vector>
-#include <map>
 #include <utility>
 
 #include "hw_interface.h"
@@ -37,7 +36,6 @@
 namespace sdm {
 
 using std::vector;
-using std::map;
 
 class HWEvents : public HWEventsInterface {
  public:
@@ -48,19 +46,30 @@ class HWEvents : public HWEventsInterface {
   virtual DisplayError SetEventState(HWEvent event, bool enable, void *aux = nullptr) {
     return kErrorNotSupported;
   }
+  virtual void Dump(std::ostringstream *os);
 
  private:
   static const int kMaxStringLength = 1024;
+  static const uint32_t kNumEvents = HWEvent::PANEL_DEAD + 1;
 
   typedef void (HWEvents::*EventParser)(char *);
 
+  struct HWEventEntry {
+    EventParser event_parser;
+    const char *node;  // fb sysfs node, the exit event uses an eventfd instead.
+  };
+
   struct HWEventData {
     HWEvent event_type {};
-    EventParser event_parser {};
+    int fd = -1;
   };
 
+  // Parser and sysfs node of each event, indexed by HWEvent.
+  static const HWEventEntry kEventTable[kNumEvents];
+
   static void* DisplayEventThread(void *context);
   void* DisplayEventHandler();
+  void DispatchEvents(const struct epoll_event *events, int num_events);
   void HandleVSync(char *data);
   void HandleBlank(char *data) { }
   void HandleIdleTimeout(char *data);
@@ -70,20 +79,20 @@ class HWEvents : public HWEventsInterface {
   void HandleIdlePowerCollapse(char *data);
   void HandlePingPongTimeout(char *data);
   void PopulateHWEventData();
-  DisplayError SetEventParser(HWEvent event_type, HWEventData *event_data);
-  pollfd InitializePollFd(HWEventData *event_data);
+  int InitializeEventFd(HWEvent event_type);
 
   HWEventHandler *event_handler_ = {};
   vector<HWEvent> event_list_ = {};
   vector<HWEventData> event_data_list_ = {};
-  vector<pollfd> poll_fds_ = {};
-  map<HWEvent, const char *> map_event_to_node_ = {};
+  int epoll_fd_ = -1;
   pthread_t event_thread_ = {};
   std::string event_thread_name_ = "SDM_EventThread";
   bool exit_threads_ = false;
   const char* fb_path_ = "/sys/devices/virtual/graphics/fb";
   int fb_num_ = -1;
   int exit_fd_ = -1;
+  LatencyHistogram dispatch_latency_[kNumEvents];  // Wakeup to handler completion
+  LatencyHistogram vsync_latency_;  // Hardware vsync timestamp to VSync callback
 };
 
 }  // namespace sdm
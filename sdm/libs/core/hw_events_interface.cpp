@@ -33,6 +33,7 @@
 #include "hw_events_interface.h"
 #include "fb/hw_events.h"
 #include "drm/hw_events_drm.h"
+#include "sim/hw_events_sim.h"
 
 #define __CLASS__ "HWEventsInterface"
 
@@ -44,8 +45,11 @@ DisplayError HWEventsInterface::Create(int display_id, DisplayType display_type,
                                        const HWInterface *hw_intf, HWEventsInterface **intf) {
   DisplayError error = kErrorNone;
   HWEventsInterface *hw_events = nullptr;
-  if (GetDriverType() == DriverType::FB) {
+  DriverType driver_type = GetDriverType();
+  if (driver_type == DriverType::FB) {
     hw_events = new HWEvents();
+  } else if (driver_type == DriverType::SIM) {
+    hw_events = new HWEventsSim();
   } else {
     hw_events = new HWEventsDRM();
   }
@@ -27,6 +27,7 @@
 
 #include <private/hw_info_types.h>
 #include <inttypes.h>
+#include <sstream>
 #include <utility>
 #include <vector>
 
@@ -53,6 +54,7 @@ class HWEventsInterface {
                             const std::vector<HWEvent> &event_list, const HWInterface *hw_intf) = 0;
   virtual DisplayError Deinit() = 0;
   virtual DisplayError SetEventState(HWEvent event, bool enable, void *aux = nullptr) = 0;
+  virtual void Dump(std::ostringstream *os) = 0;
 
   static DisplayError Create(int display_id, DisplayType display_type,
                              HWEventHandler *event_handler, const std::vector<HWEvent> &event_list,
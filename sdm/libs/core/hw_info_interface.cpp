@@ -32,14 +32,18 @@
 #include "hw_info_interface.h"
 #include "fb/hw_info.h"
 #include "drm/hw_info_drm.h"
+#include "sim/hw_info_sim.h"
 
 #define __CLASS__ "HWInfoInterface"
 
 namespace sdm {
 
 DisplayError HWInfoInterface::Create(HWInfoInterface **intf) {
-  if (GetDriverType() == DriverType::FB) {
+  DriverType driver_type = GetDriverType();
+  if (driver_type == DriverType::FB) {
     *intf = new HWInfo();
+  } else if (driver_type == DriverType::SIM) {
+    *intf = new HWInfoSim();
   } else {
     *intf = new HWInfoDRM();
   }
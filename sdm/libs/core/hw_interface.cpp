@@ -38,11 +38,14 @@
 #include "drm/hw_peripheral_drm.h"
 #include "drm/hw_virtual_drm.h"
 #include "drm/hw_tv_drm.h"
+#include "sim/hw_device_sim.h"
 
 #define __CLASS__ "HWInterface"
 
 namespace sdm {
 
+std::atomic<uint64_t> HWInterface::config_generation_(0);
+
 DisplayError HWInterface::Create(int32_t display_id, DisplayType type,
                                  HWInfoInterface *hw_info_intf,
                                  BufferSyncHandler *buffer_sync_handler,
@@ -55,6 +58,8 @@ DisplayError HWInterface::Create(int32_t display_id, DisplayType type,
     case kBuiltIn:
       if (driver_type == DriverType::FB) {
         hw = new HWPrimary(buffer_sync_handler, hw_info_intf);
+      } else if (driver_type == DriverType::SIM) {
+        hw = new HWDeviceSim(display_id, type, hw_info_intf);
       } else {
         hw = new HWPeripheralDRM(display_id, buffer_sync_handler, buffer_allocator, hw_info_intf);
       }
@@ -62,6 +67,8 @@ DisplayError HWInterface::Create(int32_t display_id, DisplayType type,
     case kPluggable:
       if (driver_type == DriverType::FB) {
         hw = new HWHDMI(buffer_sync_handler, hw_info_intf);
+      } else if (driver_type == DriverType::SIM) {
+        hw = new HWDeviceSim(display_id, type, hw_info_intf);
       } else {
         hw = new HWTVDRM(display_id, buffer_sync_handler, buffer_allocator, hw_info_intf);
       }
@@ -69,6 +76,8 @@ DisplayError HWInterface::Create(int32_t display_id, DisplayType type,
     case kVirtual:
       if (driver_type == DriverType::FB) {
         hw = new HWVirtual(buffer_sync_handler, hw_info_intf);
+      } else if (driver_type == DriverType::SIM) {
+        hw = new HWDeviceSim(display_id, type, hw_info_intf);
       } else {
         hw = new HWVirtualDRM(display_id, buffer_sync_handler, buffer_allocator, hw_info_intf);
       }
@@ -32,6 +32,9 @@
 #include <private/color_interface.h>
 #include <utils/constants.h>
 
+#include <atomic>
+#include <sstream>
+
 #include "hw_info_interface.h"
 
 namespace sdm {
@@ -74,6 +77,11 @@ class HWInterface {
                              BufferSyncHandler *buffer_sync_handler,
                              BufferAllocator *buffer_allocator, HWInterface **intf);
   static DisplayError Destroy(HWInterface *intf);
+  // Generation of the configuration of all displays. Bumped on any change which can alter what
+  // the driver accepts on another display, such as a display committing a different layout or
+  // the bandwidth mode being limited.
+  static uint64_t GetConfigGeneration() { return config_generation_.load(); }
+  static void UpdateConfigGeneration() { config_generation_.fetch_add(1); }
 
   virtual DisplayError Init() = 0;
   virtual DisplayError Deinit() = 0;
@@ -114,6 +122,7 @@ class HWInterface {
   virtual DisplayError SetMixerAttributes(const HWMixerAttributes &mixer_attributes) = 0;
   virtual DisplayError GetMixerAttributes(HWMixerAttributes *mixer_attributes) = 0;
   virtual DisplayError DumpDebugData() = 0;
+  virtual void Dump(std::ostringstream *os) = 0;
   virtual DisplayError SetDynamicDSIClock(uint64_t bit_clk_rate) = 0;
   virtual DisplayError GetDynamicDSIClock(uint64_t *bit_clk_rate) = 0;
   virtual DisplayError GetDisplayIdentificationData(uint8_t *out_port, uint32_t *out_data_size,
@@ -121,6 +130,9 @@ class HWInterface {
 
  protected:
   virtual ~HWInterface() { }
+
+ private:
+  static std::atomic<uint64_t> config_generation_;
 };
 
 }  // namespace sdm
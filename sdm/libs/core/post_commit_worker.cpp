@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utility>
+
+#include "post_commit_worker.h"
+
+#define __CLASS__ "PostCommitWorker"
+
+namespace sdm {
+
+DisplayError PostCommitWorker::Init(const std::string &name) {
+  SCOPE_LOCK(locker_);
+  if (active_) {
+    return kErrorNone;
+  }
+
+  thread_name_ = name;
+  exit_ = false;
+  if (pthread_create(&thread_, NULL, &ThreadEntry, this) != 0) {
+    DLOGE("Failed to start %s", thread_name_.c_str());
+    return kErrorResources;
+  }
+  active_ = true;
+
+  return kErrorNone;
+}
+
+void PostCommitWorker::Deinit() {
+  {
+    SCOPE_LOCK(locker_);
+    if (!active_) {
+      return;
+    }
+    WaitLocked();
+    active_ = false;
+    exit_ = true;
+    locker_.Broadcast();
+  }
+
+  pthread_join(thread_, NULL);
+}
+
+void PostCommitWorker::Post(Job job) {
+  SCOPE_LOCK(locker_);
+  if (!active_) {
+    job();
+    return;
+  }
+
+  WaitLocked();
+  job_ = std::move(job);
+  pending_ = true;
+  locker_.Broadcast();
+}
+
+void PostCommitWorker::Wait() {
+  SCOPE_LOCK(locker_);
+  WaitLocked();
+}
+
+void PostCommitWorker::WaitLocked() {
+  while (pending_) {
+    locker_.Wait();
+  }
+}
+
+void *PostCommitWorker::ThreadEntry(void *context) {
+  reinterpret_cast<PostCommitWorker *>(context)->Run();
+  return NULL;
+}
+
+void PostCommitWorker::Run() {
+  prctl(PR_SET_NAME, thread_name_.c_str(), 0, 0, 0);
+  setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
+
+  SCOPE_LOCK(locker_);
+  while (true) {
+    while (!pending_ && !exit_) {
+      locker_.Wait();
+    }
+    if (!pending_) {
+      break;
+    }
+
+    Job job = std::move(job_);
+    job_ = nullptr;
+    locker_.Unlock();
+    job();
+    locker_.Lock();
+
+    pending_ = false;
+    locker_.Broadcast();
+  }
+}
+
+}  // namespace sdm
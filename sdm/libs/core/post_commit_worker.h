@@ -0,0 +1,67 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __POST_COMMIT_WORKER_H__
+#define __POST_COMMIT_WORKER_H__
+
+#include <core/sdm_types.h>
+#include <utils/locker.h>
+#include <pthread.h>
+#include <functional>
+#include <string>
+
+namespace sdm {
+
+// Runs the bookkeeping that follows a hardware commit on a dedicated per display thread, so that
+// the composer can return the out-fences of a frame without waiting for it. At most one job is in
+// flight; Post() and Wait() block until the previous job has completed, which keeps the deferred
+// work of frame N ordered before anything the next Prepare/Commit does for frame N+1. Jobs must
+// not acquire the display lock, as the display waits for them while holding it.
+class PostCommitWorker {
+ public:
+  typedef std::function<void()> Job;
+
+  DisplayError Init(const std::string &name);
+  void Deinit();
+  bool IsActive() { return active_; }
+  void Post(Job job);
+  void Wait();
+
+ private:
+  static void *ThreadEntry(void *context);
+  void Run();
+  void WaitLocked();
+
+  Locker locker_;
+  pthread_t thread_ {};
+  std::string thread_name_;
+  Job job_ = nullptr;
+  bool pending_ = false;  // Set from Post() till the posted job has completed.
+  bool active_ = false;
+  bool exit_ = false;
+};
+
+}  // namespace sdm
+
+#endif  // __POST_COMMIT_WORKER_H__
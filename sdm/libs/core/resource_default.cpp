@@ -79,6 +79,11 @@ DisplayError ResourceDefault::Init() {
     return kErrorParameters;
   }
 
+  if (num_pipe_ > kMaxPipes) {
+    DLOGE("Number of H/W pipes %d exceeds %d", num_pipe_, kMaxPipes);
+    return kErrorParameters;
+  }
+
   src_pipes_.resize(num_pipe_);
 
   // Priority order of pipes: VIG, RGB, DMA
@@ -108,7 +113,11 @@ DisplayError ResourceDefault::Init() {
 
   for (uint32_t i = 0; i < num_pipe_; i++) {
     src_pipes_[i].priority = INT(i);
+    if (src_pipes_[i].type <= kPipeTypeCursor) {
+      type_mask_[src_pipes_[i].type] |= (1ULL << i);
+    }
   }
+  free_mask_ = (num_pipe_ == kMaxPipes) ? ~0ULL : ((1ULL << num_pipe_) - 1);
 
   DLOGI("hw_rev=%x, DMA=%d RGB=%d VIG=%d", hw_res_info_.hw_revision, hw_res_info_.num_dma_pipe,
     hw_res_info_.num_rgb_pipe, hw_res_info_.num_vig_pipe);
@@ -123,8 +132,8 @@ DisplayError ResourceDefault::Init() {
   // TODO(user): clean it up, query from driver for initial pipe status.
 #ifndef SDM_VIRTUAL_DRIVER
   rgb_index = hw_res_info_.num_vig_pipe;
-  src_pipes_[rgb_index].owner = kPipeOwnerKernelMode;
-  src_pipes_[rgb_index + 1].owner = kPipeOwnerKernelMode;
+  kernel_mask_ = (3ULL << rgb_index);
+  free_mask_ &= ~kernel_mask_;
 #endif
 
   return error;
@@ -155,6 +164,12 @@ DisplayError ResourceDefault::RegisterDisplay(int32_t display_id, DisplayType ty
     }
     break;
 
+  case kVirtual:
+    if (!hw_block_ctx_[kHWWriteback0].is_in_use) {
+      hw_block_type = kHWWriteback0;
+    }
+    break;
+
   default:
     DLOGW("RegisterDisplay, invalid type %d", type);
     return kErrorParameters;
@@ -174,6 +189,7 @@ DisplayError ResourceDefault::RegisterDisplay(int32_t display_id, DisplayType ty
   display_resource_ctx->display_attributes = display_attributes;
   display_resource_ctx->hw_block_type = hw_block_type;
   display_resource_ctx->mixer_attributes = mixer_attributes;
+  display_resource_ctx->max_mixer_stages = MaxMixerStages();
 
   *display_ctx = display_resource_ctx;
   return error;
@@ -225,58 +241,72 @@ DisplayError ResourceDefault::Prepare(Handle display_ctx, HWLayers *hw_layers) {
   DisplayError error = kErrorNone;
   const struct HWLayersInfo &layer_info = hw_layers->info;
   HWBlockType hw_block_type = display_resource_ctx->hw_block_type;
+  uint32_t layer_count = UINT32(layer_info.hw_layers.size());
 
   DLOGV_IF(kTagResources, "==== Resource reserving start: hw_block = %d ====", hw_block_type);
 
-  if (layer_info.hw_layers.size() > 1) {
-    DLOGV_IF(kTagResources, "More than one FB layers");
+  // Each layer takes one blending stage, the right half of a source split layer shares it.
+  if (!layer_count || layer_count > display_resource_ctx->max_mixer_stages) {
+    DLOGV_IF(kTagResources, "%d layers exceed %d mixer stages", layer_count,
+             display_resource_ctx->max_mixer_stages);
     return kErrorResources;
   }
 
-  const Layer &layer = layer_info.hw_layers.at(0);
+  for (uint32_t i = 0; i < layer_count; i++) {
+    LayerComposition composition = layer_info.hw_layers.at(i).composition;
+    if (composition != kCompositionGPUTarget && composition != kCompositionSDE) {
+      DLOGV_IF(kTagResources, "Layer %d composition %d is not supported", i, composition);
+      return kErrorParameters;
+    }
 
-  if (layer.composition != kCompositionGPUTarget) {
-    DLOGV_IF(kTagResources, "Not an FB layer");
-    return kErrorParameters;
+    error = Config(display_resource_ctx, hw_layers, i);
+    if (error != kErrorNone) {
+      DLOGV_IF(kTagResources, "Resource config failed for layer %d", i);
+      return error;
+    }
   }
 
-  error = Config(display_resource_ctx, hw_layers);
-  if (error != kErrorNone) {
-    DLOGV_IF(kTagResources, "Resource config failed");
-    return error;
-  }
+  ReleasePipes(hw_block_type);
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_type == hw_block_type &&
-        src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
+  for (uint32_t i = 0; i < layer_count; i++) {
+    const Layer &layer = layer_info.hw_layers.at(i);
+    error = AcquirePipes(hw_block_type, !IS_RGB_FORMAT(layer.input_buffer.format),
+                         &hw_layers->config[i]);
+    if (error != kErrorNone) {
+      DLOGV_IF(kTagResources, "Resource reserving failed! hw_block = %d, layer = %d",
+               hw_block_type, i);
+      return kErrorResources;
     }
   }
 
+  return kErrorNone;
+}
+
+DisplayError ResourceDefault::AcquirePipes(HWBlockType hw_block_type, bool is_yuv,
+                                           HWLayerConfig *layer_config) {
+  DisplayError error = kErrorNone;
   uint32_t left_index = num_pipe_;
   uint32_t right_index = num_pipe_;
   bool need_scale = false;
 
-  struct HWLayerConfig &layer_config = hw_layers->config[0];
-
-  HWPipeInfo *left_pipe = &layer_config.left_pipe;
-  HWPipeInfo *right_pipe = &layer_config.right_pipe;
+  HWPipeInfo *left_pipe = &layer_config->left_pipe;
+  HWPipeInfo *right_pipe = &layer_config->right_pipe;
 
   // left pipe is needed
   if (left_pipe->valid) {
     need_scale = IsScalingNeeded(left_pipe);
-    left_index = GetPipe(hw_block_type, need_scale);
+    left_index = GetPipe(hw_block_type, need_scale, is_yuv);
     if (left_index >= num_pipe_) {
       DLOGV_IF(kTagResources, "Get left pipe failed: hw_block_type = %d, need_scale = %d",
                hw_block_type, need_scale);
       ResourceStateLog();
-      goto CleanupOnError;
+      return kErrorResources;
     }
-  }
 
-  error = SetDecimationFactor(left_pipe);
-  if (error != kErrorNone) {
-    goto CleanupOnError;
+    error = SetDecimationFactor(left_pipe);
+    if (error != kErrorNone) {
+      return error;
+    }
   }
 
   if (!right_pipe->valid) {
@@ -284,18 +314,18 @@ DisplayError ResourceDefault::Prepare(Handle display_ctx, HWLayers *hw_layers) {
     if (left_index < num_pipe_) {
       left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
     }
-    DLOGV_IF(kTagResources, "1 pipe acquired for FB layer, left_pipe = %x", left_pipe->pipe_id);
+    DLOGV_IF(kTagResources, "1 pipe acquired, left_pipe = %x", left_pipe->pipe_id);
     return kErrorNone;
   }
 
   need_scale = IsScalingNeeded(right_pipe);
 
-  right_index = GetPipe(hw_block_type, need_scale);
+  right_index = GetPipe(hw_block_type, need_scale, is_yuv);
   if (right_index >= num_pipe_) {
     DLOGV_IF(kTagResources, "Get right pipe failed: hw_block_type = %d, need_scale = %d",
              hw_block_type, need_scale);
     ResourceStateLog();
-    goto CleanupOnError;
+    return kErrorResources;
   }
 
   if (src_pipes_[right_index].priority < src_pipes_[left_index].priority) {
@@ -309,18 +339,13 @@ DisplayError ResourceDefault::Prepare(Handle display_ctx, HWLayers *hw_layers) {
 
   error = SetDecimationFactor(right_pipe);
   if (error != kErrorNone) {
-    goto CleanupOnError;
+    return error;
   }
 
-  DLOGV_IF(kTagResources, "2 pipes acquired for FB layer, left_pipe = %x, right_pipe = %x",
+  DLOGV_IF(kTagResources, "2 pipes acquired, left_pipe = %x, right_pipe = %x",
            left_pipe->pipe_id,  right_pipe->pipe_id);
 
   return kErrorNone;
-
-CleanupOnError:
-  DLOGV_IF(kTagResources, "Resource reserving failed! hw_block = %d", hw_block_type);
-
-  return kErrorResources;
 }
 
 DisplayError ResourceDefault::PostPrepare(Handle display_ctx, HWLayers *hw_layers) {
@@ -347,12 +372,7 @@ DisplayError ResourceDefault::PostCommit(Handle display_ctx, HWLayers *hw_layers
 
   // handoff pipes which are used by splash screen
   if ((frame_count == 0) && (hw_block_type == kHWPrimary)) {
-    for (uint32_t i = 0; i < num_pipe_; i++) {
-      if (src_pipes_[i].hw_block_type == hw_block_type &&
-          src_pipes_[i].owner == kPipeOwnerKernelMode) {
-        src_pipes_[i].owner = kPipeOwnerUserMode;
-      }
-    }
+    kernel_mask_ &= ~block_mask_[hw_block_type];
   }
 
   if (hw_layers->info.sync_handle >= 0)
@@ -370,64 +390,56 @@ void ResourceDefault::Purge(Handle display_ctx) {
                           reinterpret_cast<DisplayResourceContext *>(display_ctx);
   HWBlockType hw_block_type = display_resource_ctx->hw_block_type;
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_type == hw_block_type && src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
-    }
-  }
+  ReleasePipes(hw_block_type);
   DLOGV_IF(kTagResources, "display id = %d", display_resource_ctx->hw_block_type);
 }
 
 DisplayError ResourceDefault::SetMaxMixerStages(Handle display_ctx, uint32_t max_mixer_stages) {
   SCOPE_LOCK(locker_);
+  DisplayResourceContext *display_resource_ctx =
+                          reinterpret_cast<DisplayResourceContext *>(display_ctx);
+
+  if (max_mixer_stages) {
+    display_resource_ctx->max_mixer_stages = std::min(max_mixer_stages, MaxMixerStages());
+  }
 
   return kErrorNone;
 }
 
-uint32_t ResourceDefault::SearchPipe(HWBlockType hw_block_type, SourcePipe *src_pipes,
-                                uint32_t num_pipe) {
-  uint32_t index = num_pipe_;
-  SourcePipe *src_pipe;
-
-  // search the pipe being used
-  for (uint32_t i = 0; i < num_pipe; i++) {
-    src_pipe = &src_pipes[i];
-    if (src_pipe->owner == kPipeOwnerUserMode && src_pipe->hw_block_type == kHWBlockMax) {
-      index = src_pipe->index;
-      src_pipe->hw_block_type = hw_block_type;
-      break;
-    }
+uint32_t ResourceDefault::NextPipe(PipeType type, HWBlockType hw_block_type) {
+  if (type > kPipeTypeCursor) {
+    return num_pipe_;
   }
 
+  // Lowest set bit is the highest priority free pipe of this type.
+  uint64_t mask = free_mask_ & type_mask_[type];
+  if (!mask) {
+    return num_pipe_;
+  }
+
+  uint32_t index = UINT32(__builtin_ctzll(mask));
+  uint64_t bit = (1ULL << index);
+  free_mask_ &= ~bit;
+  block_mask_[hw_block_type] |= bit;
+
   return index;
 }
 
-uint32_t ResourceDefault::NextPipe(PipeType type, HWBlockType hw_block_type) {
-  uint32_t num_pipe = 0;
-  SourcePipe *src_pipes = NULL;
+void ResourceDefault::ReleasePipes(HWBlockType hw_block_type) {
+  uint64_t mask = block_mask_[hw_block_type] & ~kernel_mask_;
 
-  switch (type) {
-  case kPipeTypeVIG:
-    src_pipes = &src_pipes_[0];
-    num_pipe = hw_res_info_.num_vig_pipe;
-    break;
-  case kPipeTypeRGB:
-    src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe];
-    num_pipe = hw_res_info_.num_rgb_pipe;
-    break;
-  case kPipeTypeDMA:
-  default:
-    src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe + hw_res_info_.num_rgb_pipe];
-    num_pipe = hw_res_info_.num_dma_pipe;
-    break;
-  }
-
-  return SearchPipe(hw_block_type, src_pipes, num_pipe);
+  block_mask_[hw_block_type] &= ~mask;
+  free_mask_ |= mask;
 }
 
-uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_type, bool need_scale) {
+uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_type, bool need_scale, bool is_yuv) {
   uint32_t index = num_pipe_;
 
+  // Only VIG pipes fetch YUV formats.
+  if (is_yuv) {
+    return NextPipe(kPipeTypeVIG, hw_block_type);
+  }
+
   // The default behavior is to assume RGB and VG pipes have scalars
   if (!need_scale) {
     index = NextPipe(kPipeTypeDMA, hw_block_type);
@@ -457,9 +469,16 @@ void ResourceDefault::ResourceStateLog() {
   uint32_t i;
   for (i = 0; i < num_pipe_; i++) {
     SourcePipe *src_pipe = &src_pipes_[i];
+    uint64_t bit = (1ULL << i);
+    int hw_block_type = kHWBlockMax;
+    for (int block = 0; block < kHWBlockMax; block++) {
+      if (block_mask_[block] & bit) {
+        hw_block_type = block;
+      }
+    }
     DLOGV_IF(kTagResources, "index = %d, id = %x, hw_block_type = %d, owner = %s",
-                 src_pipe->index, src_pipe->mdss_pipe_id, src_pipe->hw_block_type,
-                 (src_pipe->owner == kPipeOwnerUserMode) ? "user mode" : "kernel mode");
+                 src_pipe->index, src_pipe->mdss_pipe_id, hw_block_type,
+                 (kernel_mask_ & bit) ? "kernel mode" : "user mode");
   }
 }
 
@@ -528,6 +547,15 @@ DisplayError ResourceDefault::DisplaySplitConfig(DisplayResourceContext *display
     left_pipe->valid = true;
   }
 
+  // A layer which is only on the right half, e.g. because of the frame ROI, is fetched by a single
+  // pipe. The mixer is picked from its destination, so it goes to the left pipe like any other.
+  if (!crop_left_valid && crop_right_valid) {
+    left_pipe->src_roi = crop_right;
+    left_pipe->dst_roi = dst_right;
+    left_pipe->valid = true;
+    crop_right_valid = false;
+  }
+
   // assign right pipe if needed
   if (crop_right_valid) {
     right_pipe->src_roi = crop_right;
@@ -539,23 +567,51 @@ DisplayError ResourceDefault::DisplaySplitConfig(DisplayResourceContext *display
 }
 
 DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ctx,
-                                HWLayers *hw_layers) {
+                                HWLayers *hw_layers, uint32_t index) {
   HWLayersInfo &layer_info = hw_layers->info;
   DisplayError error = kErrorNone;
-  const Layer &layer = layer_info.hw_layers.at(0);
+  const Layer &layer = layer_info.hw_layers.at(index);
 
   error = ValidateLayerParams(&layer);
   if (error != kErrorNone) {
     return error;
   }
 
-  struct HWLayerConfig *layer_config = &hw_layers->config[0];
+  struct HWLayerConfig *layer_config = &hw_layers->config[index];
+  *layer_config = {};
   HWPipeInfo &left_pipe = layer_config->left_pipe;
   HWPipeInfo &right_pipe = layer_config->right_pipe;
 
   LayerRect src_rect = layer.src_rect;
   LayerRect dst_rect = layer.dst_rect;
 
+  // Application layers may extend past the mixer, fetch only the visible part.
+  const HWMixerAttributes &mixer_attributes = display_resource_ctx->mixer_attributes;
+  LayerRect scissor(0.0f, 0.0f, FLOAT(mixer_attributes.width), FLOAT(mixer_attributes.height));
+  if (!CalculateCropRects(scissor, &src_rect, &dst_rect)) {
+    return kErrorNotSupported;
+  }
+
+  // Panel only fetches the frame ROI of a partially updated frame, pipes must stay within it.
+  // Layers outside of the ROI are not staged at all.
+  LayerRect frame_roi = {};
+  for (const LayerRect &roi : layer_info.left_frame_roi) {
+    frame_roi = Union(frame_roi, roi);
+  }
+  for (const LayerRect &roi : layer_info.right_frame_roi) {
+    frame_roi = Union(frame_roi, roi);
+  }
+  if (IsValid(frame_roi) && !IsCongruent(Intersection(scissor, frame_roi), scissor)) {
+    if (!IsValid(Intersection(dst_rect, frame_roi))) {
+      DLOGV_IF(kTagResources, "Layer %d is outside of the frame ROI", index);
+      return kErrorNone;
+    }
+
+    if (!CalculateCropRects(frame_roi, &src_rect, &dst_rect)) {
+      return kErrorNotSupported;
+    }
+  }
+
   error = ValidateDimensions(src_rect, dst_rect);
   if (error != kErrorNone) {
     return error;
@@ -584,9 +640,9 @@ DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ct
   }
 
   // set z_order, left_pipe should always be valid
-  left_pipe.z_order = 0;
+  left_pipe.z_order = index;
 
-  DLOGV_IF(kTagResources, "==== FB layer Config ====");
+  DLOGV_IF(kTagResources, "==== Layer %d Config ====", index);
   Log(kTagResources, "input layer src_rect", layer.src_rect);
   Log(kTagResources, "input layer dst_rect", layer.dst_rect);
   Log(kTagResources, "cropped src_rect", src_rect);
@@ -594,7 +650,7 @@ DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ct
   Log(kTagResources, "left pipe src", layer_config->left_pipe.src_roi);
   Log(kTagResources, "left pipe dst", layer_config->left_pipe.dst_roi);
   if (right_pipe.valid) {
-    right_pipe.z_order = 0;
+    right_pipe.z_order = index;
     Log(kTagResources, "right pipe src", layer_config->right_pipe.src_roi);
     Log(kTagResources, "right pipe dst", layer_config->right_pipe.dst_roi);
   }
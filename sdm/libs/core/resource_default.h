@@ -27,7 +27,9 @@
 
 #include <core/display_interface.h>
 #include <private/resource_interface.h>
+#include <utils/constants.h>
 #include <utils/locker.h>
+#include <algorithm>
 #include <vector>
 
 #include "hw_interface.h"
@@ -68,28 +70,21 @@ class ResourceDefault : public ResourceInterface {
   virtual DisplayError Perform(int cmd, ...) { return kErrorNone; }
 
  private:
-  enum PipeOwner {
-    kPipeOwnerUserMode,       // Pipe state when it is available for reservation
-    kPipeOwnerKernelMode,  // Pipe state when pipe is owned by kernel
-  };
-
   // todo: retrieve all these from kernel
   enum {
     kMaxDecimationDownScaleRatio = 16,
   };
 
+  // Pipe state is tracked in 64 bit masks, bit i refers to src_pipes_[i].
+  static const uint32_t kMaxPipes = 64;
+
   struct SourcePipe {
     PipeType type;
-    PipeOwner owner;
     uint32_t mdss_pipe_id;
     uint32_t index;
-    HWBlockType hw_block_type;
     int priority;
 
-    SourcePipe() : type(kPipeTypeUnused), owner(kPipeOwnerUserMode), mdss_pipe_id(0),
-                  index(0), hw_block_type(kHWBlockMax), priority(0) { }
-
-    inline void ResetState() { hw_block_type = kHWBlockMax;}
+    SourcePipe() : type(kPipeTypeUnused), mdss_pipe_id(0), index(0), priority(0) { }
   };
 
   struct DisplayResourceContext {
@@ -97,8 +92,9 @@ class ResourceDefault : public ResourceInterface {
     HWBlockType hw_block_type;
     uint64_t frame_count;
     HWMixerAttributes mixer_attributes;
+    uint32_t max_mixer_stages;
 
-    DisplayResourceContext() : hw_block_type(kHWBlockMax), frame_count(0) { }
+    DisplayResourceContext() : hw_block_type(kHWBlockMax), frame_count(0), max_mixer_stages(0) { }
   };
 
   struct HWBlockContext {
@@ -110,10 +106,17 @@ class ResourceDefault : public ResourceInterface {
   DisplayError Init();
   DisplayError Deinit();
   uint32_t NextPipe(PipeType pipe_type, HWBlockType hw_block_type);
-  uint32_t SearchPipe(HWBlockType hw_block_type, SourcePipe *src_pipes, uint32_t num_pipe);
-  uint32_t GetPipe(HWBlockType hw_block_type, bool need_scale);
+  uint32_t GetPipe(HWBlockType hw_block_type, bool need_scale, bool is_yuv);
+  void ReleasePipes(HWBlockType hw_block_type);
+  DisplayError AcquirePipes(HWBlockType hw_block_type, bool is_yuv, HWLayerConfig *layer_config);
+  uint32_t MaxMixerStages() {
+    return hw_res_info_.num_blending_stages ?
+           std::min(hw_res_info_.num_blending_stages, UINT32(kMaxSDELayers)) :
+           UINT32(kMaxSDELayers);
+  }
   bool IsScalingNeeded(const HWPipeInfo *pipe_info);
-  DisplayError Config(DisplayResourceContext *display_resource_ctx, HWLayers *hw_layers);
+  DisplayError Config(DisplayResourceContext *display_resource_ctx, HWLayers *hw_layers,
+                      uint32_t index);
   DisplayError DisplaySplitConfig(DisplayResourceContext *display_resource_ctx,
                                  const LayerRect &src_rect, const LayerRect &dst_rect,
                                  HWLayerConfig *layer_config);
@@ -140,8 +143,12 @@ class ResourceDefault : public ResourceInterface {
   Locker locker_;
   HWResourceInfo hw_res_info_;
   HWBlockContext hw_block_ctx_[kHWBlockMax];
-  std::vector<SourcePipe> src_pipes_;
+  std::vector<SourcePipe> src_pipes_;  // Sorted by priority: VIG, RGB, DMA
   uint32_t num_pipe_ = 0;
+  uint64_t type_mask_[kPipeTypeCursor + 1] = {};  // Pipes of each type
+  uint64_t block_mask_[kHWBlockMax] = {};         // Pipes reserved by each hw block
+  uint64_t free_mask_ = 0;                        // User mode pipes not reserved by any block
+  uint64_t kernel_mask_ = 0;                      // Pipes owned by the kernel, e.g. splash screen
 };
 
 }  // namespace sdm
@@ -0,0 +1,462 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/formats.h>
+
+#include <algorithm>
+
+#include "hw_device_sim.h"
+
+#define __CLASS__ "HWDeviceSim"
+
+namespace sdm {
+
+HWDeviceSim::HWDeviceSim(int32_t display_id, DisplayType display_type,
+                         HWInfoInterface *hw_info_intf)
+  : display_id_(display_id), display_type_(display_type) {
+}
+
+DisplayError HWDeviceSim::Init() {
+  if (display_type_ == kPluggable) {
+    DLOGE("Pluggable displays are not simulated");
+    return kErrorNotSupported;
+  }
+
+  HWInfoSim::GetSimConfig(&hw_resource_, &panel_config_);
+
+  if (display_id_ < 0 && display_type_ == kBuiltIn) {
+    display_id_ = HWInfoSim::kBuiltInDisplayId;
+  }
+
+  pipe_rects_.resize(hw_resource_.hw_pipes.size());
+  PopulateDisplayAttributes();
+  PopulateHWPanelInfo();
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Deinit() {
+  powered_on_ = false;
+
+  return kErrorNone;
+}
+
+void HWDeviceSim::PopulateDisplayAttributes() {
+  display_attributes_ = HWDisplayAttributes();
+
+  // Virtual displays take their attributes from SetDisplayAttributes().
+  if (display_type_ != kBuiltIn) {
+    return;
+  }
+
+  display_attributes_.x_pixels = panel_config_.width;
+  display_attributes_.y_pixels = panel_config_.height;
+  display_attributes_.x_dpi = panel_config_.dpi;
+  display_attributes_.y_dpi = panel_config_.dpi;
+  display_attributes_.fps = panel_config_.fps;
+  display_attributes_.vsync_period_ns = UINT32(1000000000L / panel_config_.fps);
+  display_attributes_.h_total = panel_config_.width;
+  display_attributes_.v_total = panel_config_.height;
+  display_attributes_.is_device_split = (panel_config_.width > hw_resource_.max_mixer_width);
+  display_attributes_.topology = display_attributes_.is_device_split ? kDualLM : kSingleLM;
+
+  mixer_attributes_.width = display_attributes_.x_pixels;
+  mixer_attributes_.height = display_attributes_.y_pixels;
+  mixer_attributes_.split_left = display_attributes_.is_device_split ?
+      (display_attributes_.x_pixels / 2) : mixer_attributes_.width;
+}
+
+void HWDeviceSim::PopulateHWPanelInfo() {
+  hw_panel_info_ = HWPanelInfo();
+
+  if (display_type_ != kBuiltIn) {
+    hw_panel_info_.port = kPortWriteBack;
+    return;
+  }
+
+  snprintf(hw_panel_info_.panel_name, sizeof(hw_panel_info_.panel_name), "sim_panel");
+  hw_panel_info_.port = kPortDSI;
+  hw_panel_info_.mode = panel_config_.mode;
+  hw_panel_info_.partial_update = panel_config_.partial_update;
+  hw_panel_info_.min_fps = panel_config_.fps;
+  hw_panel_info_.max_fps = panel_config_.fps;
+  hw_panel_info_.is_primary_panel = true;
+  hw_panel_info_.split_info.left_split = mixer_attributes_.split_left;
+  if (display_attributes_.is_device_split) {
+    hw_panel_info_.split_info.right_split = mixer_attributes_.split_left;
+  }
+}
+
+DisplayError HWDeviceSim::GetDisplayId(int32_t *display_id) {
+  *display_id = display_id_;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetActiveConfig(uint32_t *active_config) {
+  *active_config = 0;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetNumDisplayAttributes(uint32_t *count) {
+  *count = 1;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetDisplayAttributes(uint32_t index,
+                                               HWDisplayAttributes *display_attributes) {
+  if (index != 0) {
+    return kErrorParameters;
+  }
+
+  *display_attributes = display_attributes_;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetHWPanelInfo(HWPanelInfo *panel_info) {
+  *panel_info = hw_panel_info_;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetDisplayAttributes(uint32_t index) {
+  return (index == 0) ? kErrorNone : kErrorParameters;
+}
+
+DisplayError HWDeviceSim::SetDisplayAttributes(const HWDisplayAttributes &display_attributes) {
+  if (display_type_ != kVirtual) {
+    return kErrorNotSupported;
+  }
+
+  if (display_attributes.x_pixels > hw_resource_.max_mixer_width * 2) {
+    DLOGE("Virtual display width %d exceeds mixer limits", display_attributes.x_pixels);
+    return kErrorParameters;
+  }
+
+  display_attributes_ = display_attributes;
+  mixer_attributes_.width = display_attributes.x_pixels;
+  mixer_attributes_.height = display_attributes.y_pixels;
+  mixer_attributes_.split_left = display_attributes.x_pixels;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetDisplayFormat(uint32_t index, DisplayInterfaceFormat pref_fmt) {
+  if (index != 0) {
+    return kErrorParameters;
+  }
+
+  display_attributes_.pref_fmt = pref_fmt;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetConfigIndex(char *mode, uint32_t *index) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::PowerOn(const HWQosData &qos_data, int *release_fence) {
+  powered_on_ = true;
+  *release_fence = -1;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::PowerOff() {
+  powered_on_ = false;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Doze(const HWQosData &qos_data, int *release_fence) {
+  powered_on_ = true;
+  *release_fence = -1;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::DozeSuspend(const HWQosData &qos_data, int *release_fence) {
+  powered_on_ = true;
+  *release_fence = -1;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Standby() {
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::ValidatePipe(const Layer &layer, const HWPipeInfo &pipe,
+                                       uint64_t *bandwidth) {
+  if (!pipe.pipe_id || pipe.pipe_id > pipe_rects_.size()) {
+    DLOGV_IF(kTagDriverConfig, "Unknown pipe %d", pipe.pipe_id);
+    return kErrorResources;
+  }
+
+  uint32_t pipe_index = pipe.pipe_id - 1;
+  const HWPipeCaps &pipe_caps = hw_resource_.hw_pipes.at(pipe_index);
+  if (++pipe_rects_[pipe_index] > pipe_caps.max_rects) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d is used by %d rects, max %d", pipe.pipe_id,
+             pipe_rects_[pipe_index], pipe_caps.max_rects);
+    return kErrorResources;
+  }
+
+  float src_width = pipe.src_roi.right - pipe.src_roi.left;
+  float src_height = pipe.src_roi.bottom - pipe.src_roi.top;
+  float dst_width = pipe.dst_roi.right - pipe.dst_roi.left;
+  float dst_height = pipe.dst_roi.bottom - pipe.dst_roi.top;
+  if (src_width < 1.0f || src_height < 1.0f || dst_width < 1.0f || dst_height < 1.0f) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d has an empty rect", pipe.pipe_id);
+    return kErrorParameters;
+  }
+
+  if (src_width > FLOAT(hw_resource_.max_pipe_width)) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d source width %.0f exceeds %d", pipe.pipe_id, src_width,
+             hw_resource_.max_pipe_width);
+    return kErrorNotSupported;
+  }
+
+  if ((pipe.horizontal_decimation || pipe.vertical_decimation) && !hw_resource_.has_decimation) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d uses decimation which is not supported", pipe.pipe_id);
+    return kErrorNotSupported;
+  }
+
+  // Decimation is applied on fetch, the scaler sees the decimated source.
+  float fetch_width = src_width / FLOAT(1 << pipe.horizontal_decimation);
+  float fetch_height = src_height / FLOAT(1 << pipe.vertical_decimation);
+  float max_scale_up = FLOAT(hw_resource_.max_scale_up);
+  float max_scale_down = FLOAT(hw_resource_.max_scale_down);
+  if (dst_width > fetch_width * max_scale_up || dst_height > fetch_height * max_scale_up ||
+      fetch_width > dst_width * max_scale_down || fetch_height > dst_height * max_scale_down) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d scaling %.0fx%.0f -> %.0fx%.0f is out of range",
+             pipe.pipe_id, fetch_width, fetch_height, dst_width, dst_height);
+    return kErrorNotSupported;
+  }
+
+  if (!IS_RGB_FORMAT(layer.input_buffer.format) && pipe_caps.type != kPipeTypeVIG) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d can not fetch YUV format %s", pipe.pipe_id,
+             GetFormatString(layer.input_buffer.format));
+    return kErrorNotSupported;
+  }
+
+  // Source lines are fetched while the destination lines are scanned out, so vertical downscale
+  // raises the fetch rate above the plain frame rate. Bandwidth is accounted in KBps.
+  float bpp = GetBufferFormatBpp(layer.input_buffer.format);
+  float line_time_factor = FLOAT(display_attributes_.y_pixels) / dst_height;
+  uint64_t pipe_bandwidth = UINT64(src_width * src_height * bpp * FLOAT(display_attributes_.fps) *
+                                   std::max(line_time_factor, 1.0f) / 1000.0f);
+  if (hw_resource_.max_pipe_bw && pipe_bandwidth > hw_resource_.max_pipe_bw) {
+    DLOGV_IF(kTagDriverConfig, "Pipe %d bandwidth %" PRIu64 " exceeds %" PRIu64, pipe.pipe_id,
+             pipe_bandwidth, hw_resource_.max_pipe_bw);
+    return kErrorNotSupported;
+  }
+
+  *bandwidth += pipe_bandwidth;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Validate(HWLayers *hw_layers) {
+  HWLayersInfo &hw_layer_info = hw_layers->info;
+  uint32_t hw_layer_count = UINT32(hw_layer_info.hw_layers.size());
+  uint64_t total_bandwidth = 0;
+
+  if (hw_layer_count > hw_resource_.num_blending_stages) {
+    DLOGV_IF(kTagDriverConfig, "%d layers exceed %d blending stages", hw_layer_count,
+             hw_resource_.num_blending_stages);
+    return kErrorResources;
+  }
+
+  std::fill(pipe_rects_.begin(), pipe_rects_.end(), 0);
+
+  for (uint32_t i = 0; i < hw_layer_count; i++) {
+    const Layer &layer = hw_layer_info.hw_layers.at(i);
+    const HWLayerConfig &hw_config = hw_layers->config[i];
+
+    if (hw_config.use_solidfill_stage) {
+      continue;
+    }
+
+    if (IsUBWCFormat(layer.input_buffer.format) && !hw_resource_.has_ubwc) {
+      DLOGV_IF(kTagDriverConfig, "UBWC format %s is not supported",
+               GetFormatString(layer.input_buffer.format));
+      return kErrorNotSupported;
+    }
+
+    if (hw_config.hw_rotator_session.mode != kRotatorNone &&
+        !hw_resource_.hw_rot_info.num_rotator) {
+      DLOGV_IF(kTagDriverConfig, "Layer %d needs a rotator which is not present", i);
+      return kErrorResources;
+    }
+
+    const HWPipeInfo *pipes[] = { &hw_config.left_pipe, &hw_config.right_pipe };
+    for (const HWPipeInfo *pipe : pipes) {
+      if (!pipe->valid) {
+        continue;
+      }
+
+      DisplayError error = ValidatePipe(layer, *pipe, &total_bandwidth);
+      if (error != kErrorNone) {
+        return error;
+      }
+    }
+  }
+
+  if (hw_resource_.max_bandwidth_high && total_bandwidth > hw_resource_.max_bandwidth_high) {
+    DLOGV_IF(kTagDriverConfig, "Bandwidth %" PRIu64 " exceeds %" PRIu64, total_bandwidth,
+             hw_resource_.max_bandwidth_high);
+    return kErrorNotSupported;
+  }
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Commit(HWLayers *hw_layers) {
+  HWLayersInfo &hw_layer_info = hw_layers->info;
+
+  // The frame is on screen as soon as it is committed, there is nothing to wait for.
+  for (uint32_t i = 0; i < hw_layer_info.hw_layers.size(); i++) {
+    hw_layer_info.hw_layers.at(i).input_buffer.release_fence_fd = -1;
+    hw_layers->config[i].hw_rotator_session.output_buffer.release_fence_fd = -1;
+  }
+
+  hw_layer_info.stack->retire_fence_fd = -1;
+  hw_layer_info.sync_handle = -1;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::Flush(HWLayers *hw_layers) {
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetPPFeaturesVersion(PPFeatureVersion *vers) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::SetPPFeatures(PPFeaturesConfig *feature_list) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::SetVSyncState(bool enable) {
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetDisplayMode(const HWDisplayMode hw_display_mode) {
+  if (display_type_ != kBuiltIn) {
+    return kErrorNotSupported;
+  }
+
+  hw_panel_info_.mode = hw_display_mode;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetRefreshRate(uint32_t refresh_rate) {
+  if (refresh_rate != display_attributes_.fps) {
+    return kErrorNotSupported;
+  }
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetPanelBrightness(int level) {
+  panel_brightness_ = level;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetHWScanInfo(HWScanInfo *scan_info) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::GetVideoFormat(uint32_t config_index, uint32_t *video_format) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::GetMaxCEAFormat(uint32_t *max_cea_format) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::SetCursorPosition(HWLayers *hw_layers, int x, int y) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::OnMinHdcpEncryptionLevelChange(uint32_t min_enc_level) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::GetPanelBrightness(int *level) {
+  *level = panel_brightness_;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetS3DMode(HWS3DMode s3d_mode) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::SetScaleLutConfig(HWScaleLutInfo *lut_info) {
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetMixerAttributes(const HWMixerAttributes &mixer_attributes) {
+  if (mixer_attributes.width > display_attributes_.x_pixels ||
+      mixer_attributes.height > display_attributes_.y_pixels) {
+    return kErrorParameters;
+  }
+
+  mixer_attributes_ = mixer_attributes;
+  mixer_attributes_.split_left = display_attributes_.is_device_split ?
+      (mixer_attributes.width / 2) : mixer_attributes.width;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::GetMixerAttributes(HWMixerAttributes *mixer_attributes) {
+  *mixer_attributes = mixer_attributes_;
+
+  return kErrorNone;
+}
+
+DisplayError HWDeviceSim::SetDynamicDSIClock(uint64_t bit_clk_rate) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::GetDynamicDSIClock(uint64_t *bit_clk_rate) {
+  return kErrorNotSupported;
+}
+
+DisplayError HWDeviceSim::GetDisplayIdentificationData(uint8_t *out_port,
+                                                       uint32_t *out_data_size,
+                                                       uint8_t *out_data) {
+  return kErrorNotSupported;
+}
+
+}  // namespace sdm
@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/sys.h>
+#include <utils/utils.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "hw_events_sim.h"
+#include "hw_info_sim.h"
+
+#define __CLASS__ "HWEventsSim"
+
+namespace sdm {
+
+DisplayError HWEventsSim::Init(int display_id, DisplayType display_type,
+                               HWEventHandler *event_handler,
+                               const std::vector<HWEvent> &event_list,
+                               const HWInterface *hw_intf) {
+  if (!event_handler) {
+    return kErrorParameters;
+  }
+
+  event_handler_ = event_handler;
+
+  // Only the built-in panel has a timing generator.
+  if (display_type != kBuiltIn ||
+      std::find(event_list.begin(), event_list.end(), HWEvent::VSYNC) == event_list.end()) {
+    return kErrorNone;
+  }
+
+  HWSimPanelConfig panel_config;
+  HWInfoSim::GetSimConfig(NULL, &panel_config);
+
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  exit_fd_ = Sys::eventfd_(0, EFD_CLOEXEC);
+  if (timer_fd_ < 0 || exit_fd_ < 0) {
+    DLOGE("Failed to create timer or exit fd. error = %s", strerror(errno));
+    CloseFd(&timer_fd_);
+    CloseFd(&exit_fd_);
+    return kErrorResources;
+  }
+
+  // The timer runs all the time, expirations are consumed silently while vsync is disabled.
+  long period_ns = 1000000000L / panel_config.fps;
+  struct itimerspec timer_spec = {};
+  timer_spec.it_interval.tv_sec = period_ns / 1000000000L;
+  timer_spec.it_interval.tv_nsec = period_ns % 1000000000L;
+  timer_spec.it_value = timer_spec.it_interval;
+  if (timerfd_settime(timer_fd_, 0, &timer_spec, NULL)) {
+    DLOGE("Failed to start vsync timer. error = %s", strerror(errno));
+    CloseFd(&timer_fd_);
+    CloseFd(&exit_fd_);
+    return kErrorResources;
+  }
+
+  if (pthread_create(&event_thread_, NULL, &DisplayEventThread, this) < 0) {
+    DLOGE("Failed to start event thread for display %d", display_id);
+    CloseFd(&timer_fd_);
+    CloseFd(&exit_fd_);
+    return kErrorResources;
+  }
+  thread_created_ = true;
+
+  DLOGI("Simulated vsync at %d fps for display %d", panel_config.fps, display_id);
+
+  return kErrorNone;
+}
+
+DisplayError HWEventsSim::Deinit() {
+  if (thread_created_) {
+    uint64_t exit_value = 1;
+    if (Sys::write_(exit_fd_, &exit_value, sizeof(exit_value)) < 0) {
+      DLOGW("Error triggering exit fd. error = %s", strerror(errno));
+    }
+    pthread_join(event_thread_, NULL);
+    thread_created_ = false;
+  }
+
+  CloseFd(&timer_fd_);
+  CloseFd(&exit_fd_);
+
+  return kErrorNone;
+}
+
+DisplayError HWEventsSim::SetEventState(HWEvent event, bool enable, void *aux) {
+  switch (event) {
+    case HWEvent::VSYNC:
+      vsync_enabled_ = enable;
+      break;
+    default:
+      DLOGE("Event not supported");
+      return kErrorNotSupported;
+  }
+
+  return kErrorNone;
+}
+
+void *HWEventsSim::DisplayEventThread(void *context) {
+  if (context) {
+    return reinterpret_cast<HWEventsSim *>(context)->DisplayEventHandler();
+  }
+
+  return NULL;
+}
+
+void *HWEventsSim::DisplayEventHandler() {
+  prctl(PR_SET_NAME, "SDM_SimEventThread", 0, 0, 0);
+  setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
+
+  struct pollfd poll_fds[2] = {};
+  poll_fds[0].fd = timer_fd_;
+  poll_fds[0].events = POLLIN;
+  poll_fds[1].fd = exit_fd_;
+  poll_fds[1].events = POLLIN;
+
+  while (true) {
+    int error = Sys::poll_(poll_fds, 2, -1);
+    if (error <= 0) {
+      if (errno != EINTR) {
+        DLOGW("poll failed. error = %s", strerror(errno));
+      }
+      continue;
+    }
+
+    if (poll_fds[1].revents & POLLIN) {
+      break;
+    }
+
+    uint64_t expirations = 0;
+    if (!(poll_fds[0].revents & POLLIN) ||
+        Sys::read_(timer_fd_, &expirations, sizeof(expirations)) <= 0) {
+      continue;
+    }
+
+    if (vsync_enabled_) {
+      struct timespec ts = {};
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      int64_t timestamp = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+      event_handler_->VSync(timestamp);
+    }
+  }
+
+  return NULL;
+}
+
+}  // namespace sdm
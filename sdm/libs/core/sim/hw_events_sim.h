@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HW_EVENTS_SIM_H__
+#define __HW_EVENTS_SIM_H__
+
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+
+#include "hw_events_interface.h"
+#include "hw_interface.h"
+
+namespace sdm {
+
+// Generates vsync for the simulated built-in panel from a monotonic timer at the panel refresh
+// rate. Other hardware events are never raised.
+class HWEventsSim : public HWEventsInterface {
+ public:
+  virtual DisplayError Init(int display_id, DisplayType display_type, HWEventHandler *event_handler,
+                            const std::vector<HWEvent> &event_list, const HWInterface *hw_intf);
+  virtual DisplayError Deinit();
+  virtual DisplayError SetEventState(HWEvent event, bool enable, void *aux = nullptr);
+  virtual void Dump(std::ostringstream *os) { }
+
+ private:
+  static void *DisplayEventThread(void *context);
+  void *DisplayEventHandler();
+
+  HWEventHandler *event_handler_ = NULL;
+  pthread_t event_thread_ = {};
+  bool thread_created_ = false;
+  int timer_fd_ = -1;
+  int exit_fd_ = -1;
+  std::atomic<bool> vsync_enabled_ {false};
+};
+
+}  // namespace sdm
+
+#endif  // __HW_EVENTS_SIM_H__
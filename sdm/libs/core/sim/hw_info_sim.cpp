@@ -0,0 +1,316 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/sys.h>
+
+#include <string>
+
+#include "hw_info_sim.h"
+
+#define __CLASS__ "HWInfoSim"
+
+namespace sdm {
+
+// Capability file used when vendor.display.sim_caps_file is not set.
+static const char *kDefaultCapsFile = "/vendor/etc/sdm_sim_caps.conf";
+
+std::mutex HWInfoSim::caps_lock_;
+bool HWInfoSim::caps_loaded_ = false;
+HWResourceInfo HWInfoSim::hw_resource_;
+HWSimPanelConfig HWInfoSim::panel_config_;
+
+int HWInfoSim::ParseString(const char *input, char *tokens[], const uint32_t max_token,
+                           const char *delim, uint32_t *count) {
+  char *tmp_token = NULL;
+  char *temp_ptr;
+  uint32_t index = 0;
+  if (!input) {
+    return -1;
+  }
+  tmp_token = strtok_r(const_cast<char *>(input), delim, &temp_ptr);
+  while (tmp_token && index < max_token) {
+    tokens[index++] = tmp_token;
+    tmp_token = strtok_r(NULL, delim, &temp_ptr);
+  }
+  *count = index;
+
+  return 0;
+}
+
+void HWInfoSim::GetSimConfig(HWResourceInfo *hw_resource, HWSimPanelConfig *panel_config) {
+  std::lock_guard<std::mutex> lock(caps_lock_);
+  if (!caps_loaded_) {
+    LoadCapabilities();
+    caps_loaded_ = true;
+  }
+
+  if (hw_resource) {
+    *hw_resource = hw_resource_;
+  }
+
+  if (panel_config) {
+    *panel_config = panel_config_;
+  }
+}
+
+void HWInfoSim::LoadCapabilities() {
+  hw_resource_ = HWResourceInfo();
+  panel_config_ = HWSimPanelConfig();
+
+  // Defaults resemble a mid range target with four VIG and four DMA pipes.
+  hw_resource_.hw_version = 0x50000000;
+  hw_resource_.num_vig_pipe = 4;
+  hw_resource_.num_dma_pipe = 4;
+  hw_resource_.num_blending_stages = 7;
+  hw_resource_.max_scale_down = 4;
+  hw_resource_.max_scale_up = 20;
+  hw_resource_.max_mixer_width = 2560;
+  hw_resource_.max_pipe_width = 2560;
+  hw_resource_.max_cursor_size = 128;
+  hw_resource_.max_bandwidth_low = 9600000;
+  hw_resource_.max_bandwidth_high = 9600000;
+  hw_resource_.max_pipe_bw = 4500000;
+  hw_resource_.max_sde_clk = 412500000;
+  hw_resource_.has_ubwc = true;
+  hw_resource_.has_decimation = false;
+  hw_resource_.is_src_split = true;
+  hw_resource_.has_qseed3 = true;
+  hw_resource_.num_mixer_to_disp = 2;
+
+  uint32_t num_cursor_pipe = 0;
+  uint32_t max_rects = 1;
+
+  char caps_file[kMaxStringLength] = {};
+  if (Debug::GetProperty(SIM_CAPS_FILE_PROP, caps_file) != kErrorNone || !caps_file[0]) {
+    snprintf(caps_file, sizeof(caps_file), "%s", kDefaultCapsFile);
+  }
+
+  Sys::fstream fs(caps_file, std::fstream::in);
+  if (!fs.is_open()) {
+    DLOGI("File '%s' not found, using default capabilities", caps_file);
+  } else {
+    const uint32_t max_count = 256;
+    char *tokens[max_count] = { NULL };
+    uint32_t token_count = 0;
+    std::string line;
+    while (Sys::getline_(fs, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+
+      if (ParseString(line.c_str(), tokens, max_count, ":, =\n", &token_count) ||
+          token_count < 2) {
+        continue;
+      }
+
+      if (!strcmp(tokens[0], "cursor_pipes")) {
+        num_cursor_pipe = UINT32(atoi(tokens[1]));
+      } else if (!strcmp(tokens[0], "max_rects")) {
+        max_rects = std::max(UINT32(atoi(tokens[1])), 1U);
+      } else {
+        ParseCapabilityLine(tokens, token_count);
+      }
+    }
+  }
+
+  // Rotator is optional, source pipes are required by the resource manager.
+  if (!(hw_resource_.num_vig_pipe + hw_resource_.num_rgb_pipe + hw_resource_.num_dma_pipe)) {
+    DLOGW("No source pipes in '%s', using one VIG pipe", caps_file);
+    hw_resource_.num_vig_pipe = 1;
+  }
+
+  if (hw_resource_.max_scale_down < 1 || hw_resource_.max_scale_up < 1) {
+    hw_resource_.max_scale_down = 1;
+    hw_resource_.max_scale_up = 1;
+  }
+
+  if (!panel_config_.width || !panel_config_.height || !panel_config_.fps) {
+    DLOGW("Invalid panel %dx%d@%d, using default", panel_config_.width, panel_config_.height,
+          panel_config_.fps);
+    panel_config_ = HWSimPanelConfig();
+  }
+
+  for (int mode = 0; mode < kBwModeMax; mode++) {
+    hw_resource_.dyn_bw_info.total_bw_limit[mode] = hw_resource_.max_bandwidth_high;
+    hw_resource_.dyn_bw_info.pipe_bw_limit[mode] = hw_resource_.max_pipe_bw;
+  }
+
+  PopulatePipeCaps(num_cursor_pipe, max_rects);
+
+  DLOGI("VIG=%d RGB=%d DMA=%d cursor=%d rects=%d stages=%d rotators=%d panel=%dx%d@%d",
+        hw_resource_.num_vig_pipe, hw_resource_.num_rgb_pipe, hw_resource_.num_dma_pipe,
+        num_cursor_pipe, max_rects, hw_resource_.num_blending_stages,
+        hw_resource_.hw_rot_info.num_rotator, panel_config_.width, panel_config_.height,
+        panel_config_.fps);
+}
+
+void HWInfoSim::ParseCapabilityLine(char *tokens[], uint32_t token_count) {
+  const char *key = tokens[0];
+  const char *value = tokens[1];
+
+  if (!strcmp(key, "vig_pipes")) {
+    hw_resource_.num_vig_pipe = UINT32(atoi(value));
+  } else if (!strcmp(key, "rgb_pipes")) {
+    hw_resource_.num_rgb_pipe = UINT32(atoi(value));
+  } else if (!strcmp(key, "dma_pipes")) {
+    hw_resource_.num_dma_pipe = UINT32(atoi(value));
+  } else if (!strcmp(key, "blending_stages")) {
+    hw_resource_.num_blending_stages = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_downscale_ratio")) {
+    hw_resource_.max_scale_down = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_upscale_ratio")) {
+    hw_resource_.max_scale_up = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_bandwidth_low")) {
+    hw_resource_.max_bandwidth_low = std::stoull(value);
+  } else if (!strcmp(key, "max_bandwidth_high")) {
+    hw_resource_.max_bandwidth_high = std::stoull(value);
+  } else if (!strcmp(key, "max_pipe_bw")) {
+    hw_resource_.max_pipe_bw = std::stoull(value);
+  } else if (!strcmp(key, "max_mixer_width")) {
+    hw_resource_.max_mixer_width = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_pipe_width")) {
+    hw_resource_.max_pipe_width = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_cursor_size")) {
+    hw_resource_.max_cursor_size = UINT32(atoi(value));
+  } else if (!strcmp(key, "max_mdp_clk")) {
+    hw_resource_.max_sde_clk = UINT32(atoi(value));
+  } else if (!strcmp(key, "rotators")) {
+    hw_resource_.hw_rot_info.num_rotator = UINT32(atoi(value));
+    hw_resource_.hw_rot_info.type = HWRotatorInfo::ROT_TYPE_V4L2;
+  } else if (!strcmp(key, "panel_width")) {
+    panel_config_.width = UINT32(atoi(value));
+  } else if (!strcmp(key, "panel_height")) {
+    panel_config_.height = UINT32(atoi(value));
+  } else if (!strcmp(key, "panel_fps")) {
+    panel_config_.fps = UINT32(atoi(value));
+  } else if (!strcmp(key, "panel_dpi")) {
+    panel_config_.dpi = FLOAT(atof(value));
+  } else if (!strcmp(key, "panel_mode")) {
+    panel_config_.mode = strcmp(value, "command") ? kModeVideo : kModeCommand;
+  } else if (!strcmp(key, "partial_update")) {
+    panel_config_.partial_update = (atoi(value) == 1);
+  } else if (!strcmp(key, "features")) {
+    // Features replace the defaults so that each of them can be turned off.
+    hw_resource_.has_ubwc = false;
+    hw_resource_.has_decimation = false;
+    hw_resource_.is_src_split = false;
+    hw_resource_.has_qseed3 = false;
+    for (uint32_t i = 1; i < token_count; i++) {
+      if (!strcmp(tokens[i], "ubwc")) {
+        hw_resource_.has_ubwc = true;
+      } else if (!strcmp(tokens[i], "decimation")) {
+        hw_resource_.has_decimation = true;
+      } else if (!strcmp(tokens[i], "src_split")) {
+        hw_resource_.is_src_split = true;
+      } else if (!strcmp(tokens[i], "qseed3")) {
+        hw_resource_.has_qseed3 = true;
+      } else if (!strcmp(tokens[i], "avr")) {
+        hw_resource_.has_avr = true;
+      } else if (!strcmp(tokens[i], "hdr")) {
+        hw_resource_.has_hdr = true;
+      }
+    }
+  } else {
+    DLOGW("Unknown capability '%s'", key);
+  }
+}
+
+void HWInfoSim::PopulatePipeCaps(uint32_t num_cursor_pipe, uint32_t max_rects) {
+  // Pipes are listed in the priority order of the resource manager, cursor pipes come last as
+  // they are not used for regular layers. Pipe ids start from 1, 0 is an unassigned pipe.
+  struct {
+    PipeType type;
+    uint32_t count;
+    uint32_t max_rects;
+  } pipe_groups[] = {
+    { kPipeTypeVIG, hw_resource_.num_vig_pipe, 1 },
+    { kPipeTypeRGB, hw_resource_.num_rgb_pipe, 1 },
+    { kPipeTypeDMA, hw_resource_.num_dma_pipe, max_rects },
+    { kPipeTypeCursor, num_cursor_pipe, 1 },
+  };
+
+  hw_resource_.hw_pipes.clear();
+  for (auto &group : pipe_groups) {
+    for (uint32_t i = 0; i < group.count; i++) {
+      HWPipeCaps pipe_caps;
+      pipe_caps.type = group.type;
+      pipe_caps.id = UINT32(hw_resource_.hw_pipes.size()) + 1;
+      pipe_caps.master_pipe_id = pipe_caps.id;
+      pipe_caps.max_rects = group.max_rects;
+      hw_resource_.hw_pipes.push_back(pipe_caps);
+    }
+  }
+
+  hw_resource_.num_cursor_pipe = num_cursor_pipe;
+  hw_resource_.smart_dma_rev = (max_rects > 1) ? SmartDMARevision::V2 : SmartDMARevision::V1;
+}
+
+DisplayError HWInfoSim::GetHWResourceInfo(HWResourceInfo *hw_resource) {
+  GetSimConfig(hw_resource, NULL);
+
+  return kErrorNone;
+}
+
+DisplayError HWInfoSim::GetFirstDisplayInterfaceType(HWDisplayInterfaceInfo *hw_disp_info) {
+  hw_disp_info->type = kBuiltIn;
+  hw_disp_info->is_connected = true;
+
+  return kErrorNone;
+}
+
+DisplayError HWInfoSim::GetDisplaysStatus(HWDisplaysInfo *hw_displays_info) {
+  if (!hw_displays_info) {
+    DLOGE("No output parameter provided!");
+    return kErrorParameters;
+  }
+
+  hw_displays_info->clear();
+
+  HWDisplayInfo hw_info = {};
+  hw_info.display_id = kBuiltInDisplayId;
+  hw_info.display_type = kBuiltIn;
+  hw_info.is_connected = true;
+  hw_info.is_primary = true;
+  (*hw_displays_info)[hw_info.display_id] = hw_info;
+
+  return kErrorNone;
+}
+
+DisplayError HWInfoSim::GetMaxDisplaysSupported(DisplayType type, int32_t *max_displays) {
+  if (!max_displays) {
+    DLOGE("No output parameter provided!");
+    return kErrorParameters;
+  }
+
+  // One simulated panel, writeback is not modelled.
+  *max_displays = (type == kBuiltIn) ? 1 : 0;
+
+  return kErrorNone;
+}
+
+}  // namespace sdm
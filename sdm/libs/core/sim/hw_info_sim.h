@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HW_INFO_SIM_H__
+#define __HW_INFO_SIM_H__
+
+#include <core/sdm_types.h>
+#include <core/core_interface.h>
+#include <private/hw_info_types.h>
+#include <mutex>
+
+#include "hw_info_interface.h"
+
+namespace sdm {
+
+// Panel configuration of the simulated built-in display.
+struct HWSimPanelConfig {
+  uint32_t width = 1080;
+  uint32_t height = 1920;
+  uint32_t fps = 60;
+  float dpi = 400.0f;
+  HWDisplayMode mode = kModeVideo;
+  bool partial_update = false;
+};
+
+// Software model of the display hardware used when simulation is enabled. Resource capabilities
+// and panel configuration are read from a capability file in the same key=value format as the
+// MDSS caps node, with defaults applied for any key which is not present. Recognized keys are
+// vig_pipes, rgb_pipes, dma_pipes, cursor_pipes, max_rects (DMA multirect), rotators,
+// blending_stages, max_mixer_width, max_pipe_width, max_bandwidth_low, max_bandwidth_high,
+// max_pipe_bw (KBps), max_mdp_clk, max_downscale_ratio, max_upscale_ratio, max_cursor_size,
+// panel_width, panel_height, panel_fps, panel_dpi, panel_mode (video/command), partial_update
+// and features (ubwc, decimation, src_split, qseed3, avr, hdr).
+class HWInfoSim: public HWInfoInterface {
+ public:
+  virtual ~HWInfoSim() { }
+  virtual DisplayError GetHWResourceInfo(HWResourceInfo *hw_resource);
+  virtual DisplayError GetFirstDisplayInterfaceType(HWDisplayInterfaceInfo *hw_disp_info);
+  virtual DisplayError GetDisplaysStatus(HWDisplaysInfo *hw_displays_info);
+  virtual DisplayError GetMaxDisplaysSupported(DisplayType type, int32_t *max_displays);
+
+  static void GetSimConfig(HWResourceInfo *hw_resource, HWSimPanelConfig *panel_config);
+
+  static const int32_t kBuiltInDisplayId = 1;
+
+ private:
+  static const uint32_t kMaxStringLength = 1024;
+
+  static void LoadCapabilities();
+  static void ParseCapabilityLine(char *tokens[], uint32_t token_count);
+  static void PopulatePipeCaps(uint32_t num_cursor_pipe, uint32_t max_rects);
+  static int ParseString(const char *input, char *tokens[], const uint32_t max_token,
+                         const char *delim, uint32_t *count);
+
+  static std::mutex caps_lock_;
+  static bool caps_loaded_;
+  static HWResourceInfo hw_resource_;
+  static HWSimPanelConfig panel_config_;
+};
+
+}  // namespace sdm
+
+#endif  // __HW_INFO_SIM_H__
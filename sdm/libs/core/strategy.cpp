@@ -24,6 +24,9 @@
 
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <display_properties.h>
+#include <algorithm>
+#include <cmath>
 
 #include "strategy.h"
 #include "utils/rect.h"
@@ -46,6 +49,10 @@ Strategy::Strategy(ExtensionInterface *extension_intf, BufferAllocator *buffer_a
 
 DisplayError Strategy::Init() {
   DisplayError error = kErrorNone;
+  int value = 0;
+
+  Debug::GetProperty(DISABLE_DEFAULT_OVERLAY_PROP, &value);
+  disable_default_overlay_ = (value == 1);
 
   if (extension_intf_) {
     error = extension_intf_->CreateStrategyExtn(display_id_, display_type_, buffer_allocator_,
@@ -89,6 +96,7 @@ DisplayError Strategy::Start(HWLayersInfo *hw_layers_info, uint32_t *max_attempt
     return kErrorNotSupported;
   }
 
+  pu_enable_ = pu_constraints.enable;
   if (partial_update_intf_) {
     partial_update_intf_->Start(pu_constraints);
   }
@@ -102,7 +110,11 @@ DisplayError Strategy::Start(HWLayersInfo *hw_layers_info, uint32_t *max_attempt
     }
   }
 
-  *max_attempts = 1;
+  // Without a strategy extension, offer the mixed candidates before falling back to GPU
+  // composition.
+  attempt_ = 0;
+  GenerateCandidates();
+  *max_attempts = UINT32(candidates_.size()) + 1;
 
   return kErrorNone;
 }
@@ -120,22 +132,161 @@ DisplayError Strategy::GetNextStrategy(StrategyConstraints *constraints) {
     return strategy_intf_->GetNextStrategy(constraints);
   }
 
+  // Every attempt describes the complete set of hardware layers.
+  hw_layers_info_->hw_layers.clear();
+  hw_layers_info_->index.clear();
+  hw_layers_info_->roi_index.clear();
+
+  while (!constraints->safe_mode && attempt_ < candidates_.size()) {
+    const MixedCandidate &candidate = candidates_.at(attempt_++);
+    if (candidate.hw_layer_count <= constraints->max_layers) {
+      return ComposeLayers(candidate.bottom_layers, candidate.top_layers);
+    }
+  }
+
+  return ComposeLayers(0, 0);
+}
+
+void Strategy::GenerateCandidates() {
+  candidates_.clear();
+
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  uint32_t app_layer_count = hw_layers_info_->app_layer_count;
+  if (strategy_intf_ || disable_default_overlay_ || layer_stack->flags.hdr_present) {
+    return;
+  }
+
+  // Longest runs of supported layers at the bottom and at the top of the stack. The runs overlap
+  // when every layer is supported, candidates never take a layer from both of them.
+  uint32_t max_bottom = 0;
+  while (max_bottom < app_layer_count && IsSDESupported(layer_stack->layers.at(max_bottom))) {
+    max_bottom++;
+  }
+  uint32_t max_top = 0;
+  while (max_top < app_layer_count &&
+         IsSDESupported(layer_stack->layers.at(app_layer_count - 1 - max_top))) {
+    max_top++;
+  }
+
+  uint32_t max_stages = hw_resource_info_.num_blending_stages ?
+                        std::min(hw_resource_info_.num_blending_stages, UINT32(kMaxSDELayers)) :
+                        UINT32(kMaxSDELayers);
+  std::vector<uint64_t> layer_pixels(app_layer_count);
+  for (uint32_t i = 0; i < app_layer_count; i++) {
+    const LayerRect &dst_rect = layer_stack->layers.at(i)->dst_rect;
+    layer_pixels[i] = UINT64(std::max(0.0f, dst_rect.right - dst_rect.left) *
+                             std::max(0.0f, dst_rect.bottom - dst_rect.top));
+  }
+
+  bool full_sde_added = false;
+  for (uint32_t bottom = 0; bottom <= max_bottom; bottom++) {
+    for (uint32_t top = 0; top <= max_top && bottom + top <= app_layer_count; top++) {
+      bool needs_gpu = (bottom + top < app_layer_count);
+      MixedCandidate candidate;
+      candidate.bottom_layers = bottom;
+      candidate.top_layers = top;
+      candidate.hw_layer_count = bottom + top + (needs_gpu ? 1 : 0);
+      // All GPU is the final fallback, and there is no GPU target to fall back on if disabled.
+      // Every split of a fully supported stack describes the same composition, keep one of them.
+      if (!(bottom + top) || (needs_gpu && disable_gpu_comp_) || (!needs_gpu && full_sde_added) ||
+          candidate.hw_layer_count > max_stages) {
+        continue;
+      }
+      full_sde_added |= !needs_gpu;
+
+      for (uint32_t i = bottom; i < app_layer_count - top; i++) {
+        candidate.gpu_pixels += layer_pixels[i];
+      }
+      candidates_.push_back(candidate);
+    }
+  }
+
+  // Least GPU work first, with fewer pipes breaking ties.
+  std::sort(candidates_.begin(), candidates_.end(),
+            [](const MixedCandidate &lhs, const MixedCandidate &rhs) {
+              if (lhs.gpu_pixels != rhs.gpu_pixels) {
+                return lhs.gpu_pixels < rhs.gpu_pixels;
+              }
+              return lhs.hw_layer_count < rhs.hw_layer_count;
+            });
+  if (candidates_.size() > kMaxMixedCandidates) {
+    candidates_.resize(kMaxMixedCandidates);
+  }
+}
+
+bool Strategy::IsSDESupported(const Layer *layer) {
+  const LayerBuffer &input_buffer = layer->input_buffer;
+
+  if (layer->flags.skip || layer->flags.solid_fill || input_buffer.format == kFormatInvalid ||
+      input_buffer.color_metadata.range == Range_Extended) {
+    return false;
+  }
+
+  // The default resource manager neither rotates nor tone maps.
+  if (layer->transform.rotation != 0.0f || layer->request.flags.tone_map) {
+    return false;
+  }
+
+  return true;
+}
+
+void Strategy::MapToMixer(Layer *layer) {
+  float layer_mixer_width = FLOAT(mixer_attributes_.width);
+  float layer_mixer_height = FLOAT(mixer_attributes_.height);
+  float fb_width = FLOAT(fb_config_.x_pixels);
+  float fb_height = FLOAT(fb_config_.y_pixels);
+  LayerRect src_domain = (LayerRect){0.0f, 0.0f, fb_width, fb_height};
+  LayerRect dst_domain = (LayerRect){0.0f, 0.0f, layer_mixer_width, layer_mixer_height};
+  LayerTransform panel_transform = {};
+
+  panel_transform.flip_horizontal = hw_panel_info_.panel_orientation.flip_horizontal;
+  panel_transform.flip_vertical = hw_panel_info_.panel_orientation.flip_vertical;
+  layer->transform.flip_horizontal ^= panel_transform.flip_horizontal;
+  layer->transform.flip_vertical ^= panel_transform.flip_vertical;
+  TransformHV(src_domain, layer->dst_rect, panel_transform, &layer->dst_rect);
+  MapRect(src_domain, dst_domain, layer->dst_rect, &layer->dst_rect);
+}
+
+DisplayError Strategy::ComposeLayers(uint32_t bottom_layers, uint32_t top_layers) {
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  uint32_t app_layer_count = hw_layers_info_->app_layer_count;
+  uint32_t gpu_begin = bottom_layers;
+  uint32_t gpu_end = app_layer_count - top_layers;
+
   // Do not fallback to GPU if GPU comp is disabled.
-  if (disable_gpu_comp_) {
+  if (gpu_begin < gpu_end && disable_gpu_comp_) {
     return kErrorNotSupported;
   }
 
-  // Mark all application layers for GPU composition. Find GPU target buffer and store its index for
-  // programming the hardware.
-  LayerStack *layer_stack = hw_layers_info_->stack;
-  for (uint32_t i = 0; i < hw_layers_info_->app_layer_count; i++) {
-    layer_stack->layers.at(i)->composition = kCompositionGPU;
-    layer_stack->layers.at(i)->request.flags.request_flags = 0;  // Reset layer request
+  // Layers outside [gpu_begin, gpu_end) are fetched on their own pipes, the ones in between are
+  // composed by the GPU. Hardware layers are listed in z-order with the GPU target in between.
+  for (uint32_t i = 0; i < app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(i);
+    layer->request.flags.request_flags = 0;  // Reset layer request
+    if (i >= gpu_begin && i < gpu_end) {
+      layer->composition = kCompositionGPU;
+      if (i == gpu_begin) {
+        AddGPUTarget();
+      }
+      continue;
+    }
+
+    layer->composition = kCompositionSDE;
+    Layer hw_layer = *layer;
+    MapToMixer(&hw_layer);
+    hw_layers_info_->index.push_back(i);
+    hw_layers_info_->roi_index.push_back(0);
+    hw_layers_info_->hw_layers.push_back(hw_layer);
   }
 
+  return kErrorNone;
+}
+
+void Strategy::AddGPUTarget() {
   // When mixer resolution and panel resolutions are same (1600x2560) and FB resolution is
   // 1080x1920 FB_Target destination coordinates(mapped to FB resolution 1080x1920) need to
   // be mapped to destination coordinates of mixer resolution(1600x2560).
+  LayerStack *layer_stack = hw_layers_info_->stack;
   Layer *gpu_target_layer = layer_stack->layers.at(hw_layers_info_->gpu_target_index);
   float layer_mixer_width = FLOAT(mixer_attributes_.width);
   float layer_mixer_height = FLOAT(mixer_attributes_.height);
@@ -154,8 +305,6 @@ DisplayError Strategy::GetNextStrategy(StrategyConstraints *constraints) {
   // Scale to mixer resolution.
   MapRect(src_domain, dst_domain, layer.dst_rect, &layer.dst_rect);
   hw_layers_info_->hw_layers.push_back(layer);
-
-  return kErrorNone;
 }
 
 void Strategy::GenerateROI() {
@@ -186,6 +335,131 @@ void Strategy::GenerateROI() {
                                 layer_mixer_width, layer_mixer_height));
     hw_layers_info_->right_frame_roi.push_back(LayerRect(0.0f, 0.0f, 0.0f, 0.0f));
   }
+
+  if (partial_update_intf_ || !pu_enable_ || !hw_panel_info_.partial_update) {
+    return;
+  }
+
+  LayerRect fb_roi = {};
+  LayerRect roi = {};
+  if (!GenerateDirtyROI(&fb_roi, &roi)) {
+    return;
+  }
+
+  // Horizontal restrictions apply to each half of a split panel. Both halves share the top and
+  // bottom of the ROI, and a ROI crossing the split stays contiguous so that it can be merged by
+  // panels which need it.
+  int split_left = split_display ? INT(mixer_attributes_.split_left) : INT(layer_mixer_width);
+  LayerRect left_roi = Intersection(roi, LayerRect(0.0f, 0.0f, FLOAT(split_left),
+                                                   layer_mixer_height));
+  LayerRect right_roi = Intersection(roi, LayerRect(FLOAT(split_left), 0.0f, layer_mixer_width,
+                                                    layer_mixer_height));
+  if (IsValid(left_roi) && !AlignROISpan(hw_panel_info_.left_align, hw_panel_info_.width_align,
+                                         hw_panel_info_.min_roi_width, 0, split_left,
+                                         &left_roi.left, &left_roi.right)) {
+    return;
+  }
+  if (IsValid(right_roi) && !AlignROISpan(hw_panel_info_.left_align, hw_panel_info_.width_align,
+                                          hw_panel_info_.min_roi_width, split_left,
+                                          INT(layer_mixer_width), &right_roi.left,
+                                          &right_roi.right)) {
+    return;
+  }
+
+  LayerRect full_roi = Union(left_roi, right_roi);
+  if (IsCongruent(full_roi, LayerRect(0.0f, 0.0f, layer_mixer_width, layer_mixer_height))) {
+    return;
+  }
+
+  hw_layers_info_->partial_fb_roi = fb_roi;
+  hw_layers_info_->left_frame_roi.at(0) = left_roi;
+  if (split_display) {
+    hw_layers_info_->right_frame_roi.at(0) = right_roi;
+  }
+}
+
+bool Strategy::GenerateDirtyROI(LayerRect *fb_roi, LayerRect *roi) {
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  float layer_mixer_width = FLOAT(mixer_attributes_.width);
+  float layer_mixer_height = FLOAT(mixer_attributes_.height);
+  LayerRect fb_rect = LayerRect(0.0f, 0.0f, FLOAT(fb_config_.x_pixels),
+                                FLOAT(fb_config_.y_pixels));
+  LayerRect mixer_rect = LayerRect(0.0f, 0.0f, layer_mixer_width, layer_mixer_height);
+  LayerRect dirty_rect = {};
+
+  // Area uncovered by moved or removed layers is not described by the dirty regions.
+  if (layer_stack->flags.geometry_changed || layer_stack->flags.attributes_changed) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < hw_layers_info_->app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(i);
+    if (!layer->flags.updating) {
+      continue;
+    }
+
+    // Dirty regions are in buffer coordinates. Translate them to the display frame when the
+    // layer is not transformed, otherwise treat the whole layer as updated.
+    const LayerTransform &transform = layer->transform;
+    bool transformed = transform.rotation != 0.0f || transform.flip_horizontal ||
+                       transform.flip_vertical;
+    if (layer->dirty_regions.empty() || transformed || layer->flags.single_buffer) {
+      dirty_rect = Union(dirty_rect, layer->dst_rect);
+      continue;
+    }
+
+    for (const LayerRect &dirty_region : layer->dirty_regions) {
+      LayerRect dirty = Intersection(dirty_region, layer->src_rect);
+      if (!IsValid(dirty)) {
+        continue;
+      }
+      MapRect(layer->src_rect, layer->dst_rect, dirty, &dirty);
+      dirty_rect = Union(dirty_rect, dirty);
+    }
+  }
+
+  *fb_roi = Intersection(dirty_rect, fb_rect);
+  if (!IsValid(*fb_roi) || IsCongruent(*fb_roi, fb_rect)) {
+    return false;
+  }
+
+  LayerTransform panel_transform = {};
+  panel_transform.flip_horizontal = hw_panel_info_.panel_orientation.flip_horizontal;
+  panel_transform.flip_vertical = hw_panel_info_.panel_orientation.flip_vertical;
+  TransformHV(fb_rect, *fb_roi, panel_transform, roi);
+  MapRect(fb_rect, mixer_rect, *roi, roi);
+
+  return AlignROISpan(hw_panel_info_.top_align, hw_panel_info_.height_align,
+                      hw_panel_info_.min_roi_height, 0, INT(layer_mixer_height), &roi->top,
+                      &roi->bottom);
+}
+
+bool Strategy::AlignROISpan(int start_align, int size_align, int min_size, int origin, int limit,
+                            float *start, float *end) {
+  start_align = std::max(start_align, 1);
+  size_align = std::max(size_align, 1);
+
+  int aligned_start = INT(std::floor(*start)) - origin;
+  int aligned_end = INT(std::ceil(*end)) - origin;
+  aligned_start -= aligned_start % start_align;
+
+  int size = std::max(aligned_end - aligned_start, min_size);
+  size = ((size + size_align - 1) / size_align) * size_align;
+  limit -= origin;
+
+  // Keep the grown span within the mixer, moving it back towards the origin if needed.
+  if (aligned_start + size > limit) {
+    aligned_start = limit - size;
+    aligned_start -= aligned_start % start_align;
+  }
+  if (aligned_start < 0 || aligned_start + size > limit) {
+    return false;
+  }
+
+  *start = FLOAT(origin + aligned_start);
+  *end = FLOAT(origin + aligned_start + size);
+
+  return true;
 }
 
 DisplayError Strategy::Reconfigure(const HWPanelInfo &hw_panel_info,
@@ -194,27 +468,26 @@ DisplayError Strategy::Reconfigure(const HWPanelInfo &hw_panel_info,
                          const DisplayConfigVariableInfo &fb_config) {
   DisplayError error = kErrorNone;
 
-  if (!extension_intf_) {
-    return kErrorNone;
-  }
-
-  // TODO(user): PU Intf will not be created for video mode panels, hence re-evaluate if
-  // reconfigure is needed.
-  if (partial_update_intf_) {
-    extension_intf_->DestroyPartialUpdate(partial_update_intf_);
-    partial_update_intf_ = NULL;
-  }
+  if (extension_intf_) {
+    // TODO(user): PU Intf will not be created for video mode panels, hence re-evaluate if
+    // reconfigure is needed.
+    if (partial_update_intf_) {
+      extension_intf_->DestroyPartialUpdate(partial_update_intf_);
+      partial_update_intf_ = NULL;
+    }
 
-  extension_intf_->CreatePartialUpdate(display_id_, display_type_, hw_resource_info_,
-                                       hw_panel_info, mixer_attributes, display_attributes,
-                                       fb_config, &partial_update_intf_);
+    extension_intf_->CreatePartialUpdate(display_id_, display_type_, hw_resource_info_,
+                                         hw_panel_info, mixer_attributes, display_attributes,
+                                         fb_config, &partial_update_intf_);
 
-  error = strategy_intf_->Reconfigure(hw_panel_info, hw_resource_info_, mixer_attributes,
-                                      fb_config);
-  if (error != kErrorNone) {
-    return error;
+    error = strategy_intf_->Reconfigure(hw_panel_info, hw_resource_info_, mixer_attributes,
+                                        fb_config);
+    if (error != kErrorNone) {
+      return error;
+    }
   }
 
+  // The default strategy maps layers to the mixer, so it needs the new attributes as well.
   hw_panel_info_ = hw_panel_info;
   display_attributes_ = display_attributes;
   mixer_attributes_ = mixer_attributes;
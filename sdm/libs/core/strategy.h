@@ -28,6 +28,7 @@
 #include <core/display_interface.h>
 #include <private/extension_interface.h>
 #include <core/buffer_allocator.h>
+#include <vector>
 
 namespace sdm {
 
@@ -54,9 +55,34 @@ class Strategy {
   DisplayError Purge();
   DisplayError SetIdleTimeoutMs(uint32_t active_ms);
   DisplayError GetCapabilities(HWDisplayCaps *caps);
+  bool HasPartialUpdate() {
+    return (partial_update_intf_ != NULL) || hw_panel_info_.partial_update;
+  }
 
  private:
+  // Composition used without a strategy extension. The bottom and top most layers are fetched
+  // on pipes, the layers in between are composed by the GPU.
+  struct MixedCandidate {
+    uint32_t bottom_layers = 0;
+    uint32_t top_layers = 0;
+    uint32_t hw_layer_count = 0;  // Including the GPU target, if used
+    uint64_t gpu_pixels = 0;      // Destination pixels composed by the GPU
+  };
+
+  static const uint32_t kMaxMixedCandidates = 4;
+
   void GenerateROI();
+  // Without a partial update extension, the ROI is the union of the regions updated by the app
+  // layers. It is returned in framebuffer and mixer coordinates, the latter aligned vertically to
+  // the panel restrictions. Returns false if the full frame is to be updated.
+  bool GenerateDirtyROI(LayerRect *fb_roi, LayerRect *roi);
+  bool AlignROISpan(int start_align, int size_align, int min_size, int origin, int limit,
+                    float *start, float *end);
+  void GenerateCandidates();
+  bool IsSDESupported(const Layer *layer);
+  void MapToMixer(Layer *layer);
+  DisplayError ComposeLayers(uint32_t bottom_layers, uint32_t top_layers);
+  void AddGPUTarget();
 
   ExtensionInterface *extension_intf_ = NULL;
   StrategyInterface *strategy_intf_ = NULL;
@@ -71,6 +97,10 @@ class Strategy {
   DisplayConfigVariableInfo fb_config_ = {};
   bool extn_start_success_ = false;
   bool disable_gpu_comp_ = false;
+  bool disable_default_overlay_ = false;
+  bool pu_enable_ = false;
+  std::vector<MixedCandidate> candidates_;
+  uint32_t attempt_ = 0;
   BufferAllocator *buffer_allocator_ = NULL;
 };
 
@@ -38,6 +38,9 @@ LOCAL_SRC_FILES               := hwc_session.cpp \
                                  hwc_display_virtual.cpp \
                                  hwc_debugger.cpp \
                                  hwc_buffer_sync_handler.cpp \
+                                 hwc_fence_watcher.cpp \
+                                 hwc_frame_dump_writer.cpp \
+                                 hwc_vsync_model.cpp \
                                  hwc_color_manager.cpp \
                                  hwc_layers.cpp \
                                  hwc_callbacks.cpp \
@@ -52,5 +55,25 @@ ifeq ($(TARGET_HAS_WIDE_COLOR_DISPLAY), true)
     LOCAL_CFLAGS += -DFEATURE_WIDE_COLOR
 endif
 
+hwc_cflags                    := $(LOCAL_CFLAGS)
+hwc_shared_libraries          := $(LOCAL_SHARED_LIBRARIES)
+hwc_src_files                 := $(LOCAL_SRC_FILES)
+
 include $(BUILD_SHARED_LIBRARY)
+
+# Validate path benchmark, runs the HAL sources on a display without hardware.
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../../common.mk
+
+LOCAL_MODULE                  := hwc_validate_bench
+LOCAL_VENDOR_MODULE           := true
+LOCAL_MODULE_TAGS             := optional
+LOCAL_C_INCLUDES              := $(common_includes) $(LOCAL_PATH)
+LOCAL_HEADER_LIBRARIES        := display_headers
+LOCAL_CFLAGS                  := $(hwc_cflags)
+LOCAL_CLANG                   := true
+LOCAL_SHARED_LIBRARIES        := $(hwc_shared_libraries)
+LOCAL_SRC_FILES               := $(hwc_src_files) ../../tools/hwc_validate_bench.cpp
+
+include $(BUILD_EXECUTABLE)
 endif
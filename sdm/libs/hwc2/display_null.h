@@ -109,6 +109,7 @@ class DisplayNull : public DisplayInterface {
   MAKE_NO_OP(SetDynamicDSIClock(uint64_t bit_clk_rate))
   MAKE_NO_OP(GetDynamicDSIClock(uint64_t *bit_clk_rate))
   MAKE_NO_OP(GetSupportedDSIClock(vector<uint64_t> *bitclk_rates))
+  MAKE_NO_OP(GetFrameStats(FrameStatsSnapshot *, bool))
 
  protected:
   // 1920x1080 60fps panel of name Null Display with PnPID QCM
@@ -32,6 +32,9 @@
 #include <core/buffer_allocator.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/formats.h>
+
+#include <unordered_map>
 
 #include "gr_utils.h"
 #include "hwc_buffer_allocator.h"
@@ -215,125 +218,137 @@ uint32_t HWCBufferAllocator::GetBufferSize(BufferInfo *buffer_info) {
   return buffer_size;
 }
 
+// gralloc format of each SDM format in enum order, 0 where gralloc has no equivalent. UBWC formats
+// are allocated with GRALLOC_USAGE_PRIVATE_ALLOC_UBWC and reported with PRIV_FLAGS_UBWC_ALIGNED
+// on top of their gralloc format. Both directions of the conversion are served from this table.
+static constexpr struct {
+  LayerBufferFormat format;
+  int32_t hal_format;
+} kHALFormats[] = {
+  { kFormatARGB8888, 0 },
+  { kFormatRGBA8888, HAL_PIXEL_FORMAT_RGBA_8888 },
+  { kFormatBGRA8888, HAL_PIXEL_FORMAT_BGRA_8888 },
+  { kFormatXRGB8888, 0 },
+  { kFormatRGBX8888, HAL_PIXEL_FORMAT_RGBX_8888 },
+  { kFormatBGRX8888, HAL_PIXEL_FORMAT_BGRX_8888 },
+  { kFormatRGBA5551, HAL_PIXEL_FORMAT_RGBA_5551 },
+  { kFormatRGBA4444, HAL_PIXEL_FORMAT_RGBA_4444 },
+  { kFormatRGB888, HAL_PIXEL_FORMAT_RGB_888 },
+  { kFormatBGR888, HAL_PIXEL_FORMAT_BGR_888 },
+  { kFormatRGB565, HAL_PIXEL_FORMAT_RGB_565 },
+  { kFormatBGR565, HAL_PIXEL_FORMAT_BGR_565 },
+  { kFormatRGBA8888Ubwc, HAL_PIXEL_FORMAT_RGBA_8888 },
+  { kFormatRGBX8888Ubwc, HAL_PIXEL_FORMAT_RGBX_8888 },
+  { kFormatBGR565Ubwc, HAL_PIXEL_FORMAT_BGR_565 },
+  { kFormatRGBA1010102, HAL_PIXEL_FORMAT_RGBA_1010102 },
+  { kFormatARGB2101010, HAL_PIXEL_FORMAT_ARGB_2101010 },
+  { kFormatRGBX1010102, HAL_PIXEL_FORMAT_RGBX_1010102 },
+  { kFormatXRGB2101010, HAL_PIXEL_FORMAT_XRGB_2101010 },
+  { kFormatBGRA1010102, HAL_PIXEL_FORMAT_BGRA_1010102 },
+  { kFormatABGR2101010, HAL_PIXEL_FORMAT_ABGR_2101010 },
+  { kFormatBGRX1010102, HAL_PIXEL_FORMAT_BGRX_1010102 },
+  { kFormatXBGR2101010, HAL_PIXEL_FORMAT_XBGR_2101010 },
+  { kFormatRGBA1010102Ubwc, HAL_PIXEL_FORMAT_RGBA_1010102 },
+  { kFormatRGBX1010102Ubwc, HAL_PIXEL_FORMAT_RGBX_1010102 },
+  { kFormatRGB101010, 0 },
+
+  { kFormatYCbCr420Planar, 0 },
+  { kFormatYCrCb420Planar, 0 },
+  { kFormatYCrCb420PlanarStride16, HAL_PIXEL_FORMAT_YV12 },
+
+  { kFormatYCbCr420SemiPlanar, HAL_PIXEL_FORMAT_YCbCr_420_SP },
+  { kFormatYCrCb420SemiPlanar, HAL_PIXEL_FORMAT_YCrCb_420_SP },
+  { kFormatYCbCr420SemiPlanarVenus, HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS },
+  { kFormatYCbCr422H1V2SemiPlanar, 0 },
+  { kFormatYCrCb422H1V2SemiPlanar, 0 },
+  { kFormatYCbCr422H2V1SemiPlanar, HAL_PIXEL_FORMAT_YCbCr_422_SP },
+  { kFormatYCrCb422H2V1SemiPlanar, 0 },
+  { kFormatYCbCr420SPVenusUbwc, HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC },
+  { kFormatYCrCb420SemiPlanarVenus, HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS },
+  { kFormatYCbCr420P010, HAL_PIXEL_FORMAT_YCbCr_420_P010 },
+  { kFormatYCbCr420TP10Ubwc, HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC },
+  { kFormatYCbCr420P010Ubwc, HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC },
+  { kFormatYCbCr420P010Venus, HAL_PIXEL_FORMAT_YCbCr_420_P010_VENUS },
+
+  { kFormatYCbCr422H2V1Packed, HAL_PIXEL_FORMAT_YCbCr_422_I },
+  { kFormatCbYCrY422H2V1Packed, HAL_PIXEL_FORMAT_CbYCrY_422_I },
+};
+
+static_assert(IsFormatTableComplete(kHALFormats), "gralloc formats out of enum order");
+
+struct SDMFormatPair {
+  LayerBufferFormat linear;
+  LayerBufferFormat ubwc;
+};
+
+// gralloc formats which are not the gralloc format of exactly one linear and one UBWC format.
+static const struct {
+  int32_t hal_format;
+  SDMFormatPair sdm_formats;
+} kHALFormatAliases[] = {
+  { HAL_PIXEL_FORMAT_NV12_ENCODEABLE,
+    { kFormatYCbCr420SemiPlanarVenus, kFormatYCbCr420SPVenusUbwc } },
+  { HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS,
+    { kFormatYCbCr420SemiPlanarVenus, kFormatYCbCr420SPVenusUbwc } },
+  { HAL_PIXEL_FORMAT_RGBA_FP16, { kFormatInvalid, kFormatInvalid } },  // Composed by GPU.
+};
+
+static const std::unordered_map<int32_t, SDMFormatPair> &GetSDMFormatMap() {
+  static const std::unordered_map<int32_t, SDMFormatPair> sdm_format_map = [] {
+    std::unordered_map<int32_t, SDMFormatPair> formats;
+    for (auto &entry : kHALFormats) {
+      if (!entry.hal_format) {
+        continue;
+      }
+      auto it = formats.emplace(entry.hal_format, SDMFormatPair{kFormatInvalid, kFormatInvalid});
+      SDMFormatPair &pair = it.first->second;
+      (IsUBWCFormat(entry.format) ? pair.ubwc : pair.linear) = entry.format;
+    }
+    // gralloc formats which exist only as UBWC are UBWC even without the UBWC flag.
+    for (auto &format : formats) {
+      if (format.second.linear == kFormatInvalid) {
+        format.second.linear = format.second.ubwc;
+      }
+    }
+    for (auto &alias : kHALFormatAliases) {
+      formats[alias.hal_format] = alias.sdm_formats;
+    }
+    return formats;
+  }();
+
+  return sdm_format_map;
+}
+
+LayerBufferFormat GetSDMFormat(int32_t hal_format, int flags) {
+  const std::unordered_map<int32_t, SDMFormatPair> &sdm_format_map = GetSDMFormatMap();
+  auto it = sdm_format_map.find(hal_format);
+  if (it == sdm_format_map.end()) {
+    DLOGW("Unsupported format type = %d", hal_format);
+    return kFormatInvalid;
+  }
+
+  if (flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED) {
+    if (it->second.ubwc == kFormatInvalid) {
+      DLOGE("Unsupported format type for UBWC %d", hal_format);
+    }
+    return it->second.ubwc;
+  }
+
+  return it->second.linear;
+}
+
 int HWCBufferAllocator::SetBufferInfo(LayerBufferFormat format, int *target, uint64_t *flags) {
-  switch (format) {
-    case kFormatRGBA8888:
-      *target = HAL_PIXEL_FORMAT_RGBA_8888;
-      break;
-    case kFormatRGBX8888:
-      *target = HAL_PIXEL_FORMAT_RGBX_8888;
-      break;
-    case kFormatRGB888:
-      *target = HAL_PIXEL_FORMAT_RGB_888;
-      break;
-    case kFormatRGB565:
-      *target = HAL_PIXEL_FORMAT_RGB_565;
-      break;
-    case kFormatBGR565:
-      *target = HAL_PIXEL_FORMAT_BGR_565;
-      break;
-    case kFormatBGR888:
-      *target = HAL_PIXEL_FORMAT_BGR_888;
-      break;
-    case kFormatBGRA8888:
-      *target = HAL_PIXEL_FORMAT_BGRA_8888;
-      break;
-    case kFormatYCrCb420PlanarStride16:
-      *target = HAL_PIXEL_FORMAT_YV12;
-      break;
-    case kFormatYCrCb420SemiPlanar:
-      *target = HAL_PIXEL_FORMAT_YCrCb_420_SP;
-      break;
-    case kFormatYCbCr420SemiPlanar:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_SP;
-      break;
-    case kFormatYCbCr422H2V1Packed:
-      *target = HAL_PIXEL_FORMAT_YCbCr_422_I;
-      break;
-    case kFormatCbYCrY422H2V1Packed:
-      *target = HAL_PIXEL_FORMAT_CbYCrY_422_I;
-      break;
-    case kFormatYCbCr422H2V1SemiPlanar:
-      *target = HAL_PIXEL_FORMAT_YCbCr_422_SP;
-      break;
-    case kFormatYCbCr420SemiPlanarVenus:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS;
-      break;
-    case kFormatYCrCb420SemiPlanarVenus:
-      *target = HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS;
-      break;
-    case kFormatYCbCr420SPVenusUbwc:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatRGBA5551:
-      *target = HAL_PIXEL_FORMAT_RGBA_5551;
-      break;
-    case kFormatRGBA4444:
-      *target = HAL_PIXEL_FORMAT_RGBA_4444;
-      break;
-    case kFormatRGBA1010102:
-      *target = HAL_PIXEL_FORMAT_RGBA_1010102;
-      break;
-    case kFormatARGB2101010:
-      *target = HAL_PIXEL_FORMAT_ARGB_2101010;
-      break;
-    case kFormatRGBX1010102:
-      *target = HAL_PIXEL_FORMAT_RGBX_1010102;
-      break;
-    case kFormatXRGB2101010:
-      *target = HAL_PIXEL_FORMAT_XRGB_2101010;
-      break;
-    case kFormatBGRA1010102:
-      *target = HAL_PIXEL_FORMAT_BGRA_1010102;
-      break;
-    case kFormatABGR2101010:
-      *target = HAL_PIXEL_FORMAT_ABGR_2101010;
-      break;
-    case kFormatBGRX1010102:
-      *target = HAL_PIXEL_FORMAT_BGRX_1010102;
-      break;
-    case kFormatXBGR2101010:
-      *target = HAL_PIXEL_FORMAT_XBGR_2101010;
-      break;
-    case kFormatYCbCr420P010:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_P010;
-      break;
-    case kFormatYCbCr420TP10Ubwc:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatYCbCr420P010Ubwc:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatYCbCr420P010Venus:
-      *target = HAL_PIXEL_FORMAT_YCbCr_420_P010_VENUS;
-      break;
-    case kFormatRGBA8888Ubwc:
-      *target = HAL_PIXEL_FORMAT_RGBA_8888;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatRGBX8888Ubwc:
-      *target = HAL_PIXEL_FORMAT_RGBX_8888;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatBGR565Ubwc:
-      *target = HAL_PIXEL_FORMAT_BGR_565;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatRGBA1010102Ubwc:
-      *target = HAL_PIXEL_FORMAT_RGBA_1010102;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    case kFormatRGBX1010102Ubwc:
-      *target = HAL_PIXEL_FORMAT_RGBX_1010102;
-      *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
-      break;
-    default:
-      DLOGE("Unsupported format = 0x%x", format);
-      return -EINVAL;
+  uint32_t index = GetFormatIndex(format);
+  if (index >= kFormatCount || !kHALFormats[index].hal_format) {
+    DLOGE("Unsupported format = 0x%x", format);
+    return -EINVAL;
   }
+
+  *target = kHALFormats[index].hal_format;
+  if (IsUBWCFormat(format)) {
+    *flags |= GRALLOC_USAGE_PRIVATE_ALLOC_UBWC;
+  }
+
   return 0;
 }
 
@@ -440,4 +455,32 @@ DisplayError HWCBufferAllocator::UnmapBuffer(const private_handle_t *handle, int
   return err;
 }
 
+DisplayError HWCBufferAllocator::ImportBuffer(const private_handle_t *handle,
+                                              private_handle_t **imported_handle) {
+  auto err = GetGrallocInstance();
+  if (err != kErrorNone) {
+    return err;
+  }
+
+  auto hidl_err = Error::NONE;
+  const native_handle_t *buf = nullptr;
+  hidl_handle raw_handle = static_cast<const native_handle_t *>(handle);
+  mapper_->importBuffer(raw_handle, [&](const auto &_error, const auto &_buffer) {
+    hidl_err = _error;
+    buf = static_cast<const native_handle_t *>(_buffer);
+  });
+
+  if (hidl_err != Error::NONE) {
+    DLOGE("Failed to import buffer into HWC");
+    return kErrorMemory;
+  }
+
+  *imported_handle = (private_handle_t *)buf;  // NOLINT
+  return kErrorNone;
+}
+
+void HWCBufferAllocator::FreeImportedBuffer(private_handle_t *imported_handle) {
+  mapper_->freeBuffer(reinterpret_cast<void *>(imported_handle));
+}
+
 }  // namespace sdm
@@ -62,6 +62,9 @@ class HWCBufferAllocator : public BufferAllocator {
   int SetBufferInfo(LayerBufferFormat format, int *target, uint64_t *flags);
   DisplayError MapBuffer(const private_handle_t *handle, int acquire_fence);
   DisplayError UnmapBuffer(const private_handle_t *handle, int *release_fence);
+  // Imports a buffer owned by a client, so it can be accessed after the client frees it.
+  DisplayError ImportBuffer(const private_handle_t *handle, private_handle_t **imported_handle);
+  void FreeImportedBuffer(private_handle_t *imported_handle);
 
  private:
   DisplayError GetGrallocInstance();
@@ -69,5 +72,8 @@ class HWCBufferAllocator : public BufferAllocator {
   android::sp<IAllocator> allocator_;
 };
 
+// Maps a gralloc format to its SDM format, flags are the private handle flags of the buffer.
+LayerBufferFormat GetSDMFormat(int32_t hal_format, int flags);
+
 }  // namespace sdm
 #endif  // __HWC_BUFFER_ALLOCATOR_H__
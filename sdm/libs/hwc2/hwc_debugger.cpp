@@ -199,6 +199,7 @@ void HWCDebugHandler::Verbose(const char *format, ...) {
 
 void HWCDebugHandler::BeginTrace(const char *class_name, const char *function_name,
                                  const char *custom_string) {
+  trace_buffer_.Record(kTraceBegin, class_name, function_name, custom_string);
   if (atrace_is_tag_enabled(ATRACE_TAG)) {
     char name[PATH_MAX] = {0};
     snprintf(name, sizeof(name), "%s::%s::%s", class_name, function_name, custom_string);
@@ -207,9 +208,18 @@ void HWCDebugHandler::BeginTrace(const char *class_name, const char *function_na
 }
 
 void HWCDebugHandler::EndTrace() {
+  trace_buffer_.Record(kTraceEnd, NULL, NULL, NULL);
   atrace_end(ATRACE_TAG);
 }
 
+void HWCDebugHandler::InitTraceBuffer() {
+  int num_events = 0;
+  debug_handler_.GetProperty(TRACE_BUFFER_EVENTS_PROP, &num_events);
+  if (num_events > 0) {
+    debug_handler_.trace_buffer_.Init(UINT32(num_events));
+  }
+}
+
 int  HWCDebugHandler::GetIdleTimeoutMs() {
   int value = IDLE_TIMEOUT_DEFAULT_MS;
   debug_handler_.GetProperty(IDLE_TIME_PROP, &value);
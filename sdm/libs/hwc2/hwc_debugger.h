@@ -36,6 +36,7 @@
 #include <debug_handler.h>
 #include <log/log.h>
 #include <utils/Trace.h>
+#include <utils/trace_buffer.h>
 #include <bitset>
 
 namespace sdm {
@@ -59,6 +60,8 @@ class HWCDebugHandler : public DebugHandler {
   static void DebugClient(bool enable, int verbose_level);
   static void DebugDisplay(bool enable, int verbose_level);
   static int  GetIdleTimeoutMs();
+  static void InitTraceBuffer();
+  static TraceBuffer *GetTraceBuffer() { return &debug_handler_.trace_buffer_; }
 
   virtual void Error(const char *format, ...);
   virtual void Warning(const char *format, ...);
@@ -75,6 +78,7 @@ class HWCDebugHandler : public DebugHandler {
   static HWCDebugHandler debug_handler_;
   std::bitset<32> log_mask_;
   int32_t verbose_level_;
+  TraceBuffer trace_buffer_;
 };
 
 }  // namespace sdm
@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/fence.h>
 #include <utils/utils.h>
 #include <utils/formats.h>
 #include <utils/rect.h>
@@ -40,6 +41,8 @@
 
 #include "hwc_display.h"
 #include "hwc_debugger.h"
+#include "hwc_fence_watcher.h"
+#include "hwc_frame_dump_writer.h"
 #include "hwc_tonemapper.h"
 #include "hwc_session.h"
 
@@ -400,12 +403,49 @@ int HWCDisplay::Init() {
   current_refresh_rate_ = max_refresh_rate_;
 
   GetUnderScanConfig();
+
+  int trace_layer_stack = 0;
+  HWCDebugHandler::Get()->GetProperty(TRACE_LAYER_STACK_PROP, &trace_layer_stack);
+  if (trace_layer_stack == 1) {
+    char file_name[PATH_MAX];
+    snprintf(file_name, sizeof(file_name), "%s/layer_stack_%s_%" PRIu64 ".trace",
+             HWCDebugHandler::DumpDir(), GetDisplayString(), id_);
+    layer_stack_trace_.Open(file_name, true /* record */);
+  }
+
+  int enable_frame_stats = 0;
+  HWCDebugHandler::Get()->GetProperty(ENABLE_FRAME_STATS_PROP, &enable_frame_stats);
+  frame_stats_.Enable(enable_frame_stats == 1);
+
+  int enable_sw_vsync = 0;
+  HWCDebugHandler::Get()->GetProperty(ENABLE_SW_VSYNC_PROP, &enable_sw_vsync);
+  sw_vsync_ = (enable_sw_vsync == 1) && (current_refresh_rate_ > 0);
+  if (sw_vsync_) {
+    int error_us = 0;
+    if (HWCDebugHandler::Get()->GetProperty(SW_VSYNC_ERROR_US_PROP, &error_us) == kErrorNone &&
+        error_us > 0) {
+      vsync_model_.SetErrorThreshold(static_cast<int64_t>(error_us) * 1000);
+    }
+    ResetVsyncModel(1000000000LL / current_refresh_rate_);
+  }
+
   DLOGI("Display created with id: %d", id_);
 
   return 0;
 }
 
 int HWCDisplay::Deinit() {
+  for (auto id : fence_watches_) {
+    HWCFenceWatcher::Get()->Cancel(id);
+  }
+  fence_watches_.clear();
+
+  if (sw_vsync_) {
+    HWCSoftVsync::Get()->Remove(id_);
+    HWCSoftVsync::Get()->Wait(id_);
+    HWCFenceWatcher::Get()->Cancel(retire_watch_);
+  }
+
   DisplayError error = core_intf_->DestroyDisplay(display_intf_);
   if (error != kErrorNone) {
     DLOGE("Display destroy failed. Error = %d", error);
@@ -425,12 +465,16 @@ int HWCDisplay::Deinit() {
   delete tone_mapper_;
   tone_mapper_ = nullptr;
 
+  layer_stack_trace_.Close();
+
   return 0;
 }
 
 // LayerStack operations
 HWC2::Error HWCDisplay::CreateLayer(hwc2_layer_t *out_layer_id) {
-  HWCLayer *layer = *layer_set_.emplace(new HWCLayer(id_, buffer_allocator_));
+  HWCLayer *layer = new HWCLayer(id_, buffer_allocator_, &layer_validation_state_);
+  layer_set_.push_back(layer);
+  layer_set_sorted_ = false;
   layer_map_.emplace(std::make_pair(layer->GetId(), layer));
   *out_layer_id = layer->GetId();
   geometry_changes_ |= GeometryChanges::kAdded;
@@ -458,14 +502,21 @@ HWC2::Error HWCDisplay::DestroyLayer(hwc2_layer_t layer_id) {
   }
   const auto layer = map_layer->second;
   layer_map_.erase(map_layer);
-  const auto z_range = layer_set_.equal_range(layer);
-  for (auto current = z_range.first; current != z_range.second; ++current) {
-    if (*current == layer) {
-      current = layer_set_.erase(current);
-      delete layer;
-      break;
-    }
-  }
+  // Erasing keeps the remaining layers sorted.
+  layer_set_.erase(std::find(layer_set_.begin(), layer_set_.end(), layer));
+  if (layer->HasState()) {
+    CountLayerState(layer->GetState(), false);
+  }
+  // Results of the last validation may still be queried after the layer is gone.
+  layer_changes_.erase(std::remove_if(layer_changes_.begin(), layer_changes_.end(),
+                                      [layer](const auto &change) {
+                                        return change.first == layer;
+                                      }), layer_changes_.end());
+  layer_requests_.erase(std::remove_if(layer_requests_.begin(), layer_requests_.end(),
+                                       [layer_id](const auto &request) {
+                                         return request.first == layer_id;
+                                       }), layer_requests_.end());
+  delete layer;
 
   geometry_changes_ |= GeometryChanges::kRemoved;
   validated_ = false;
@@ -476,41 +527,62 @@ HWC2::Error HWCDisplay::DestroyLayer(hwc2_layer_t layer_id) {
 
 
 void HWCDisplay::BuildLayerStack() {
+  frame_stats_.BeginFrame();
+  FrameStageTimer build_timer(&frame_stats_, kStageBuildLayerStack);
   layer_stack_ = LayerStack();
   display_rect_ = LayerRect();
   metadata_refresh_rate_ = 0;
-  auto working_primaries = ColorPrimaries_BT709_5;
-  bool secure_display_active = false;
   layer_stack_.flags.animating = animating_;
-  bool extended_range = false;
+  SortLayers();
 
-  // Add one layer for fb target
-  // TODO(user): Add blit target layers
+  // Refresh the cached state of the layers which changed since the last build.
   for (auto hwc_layer : layer_set_) {
     // Reset layer data which SDM may change
     hwc_layer->ResetPerFrameData();
 
     Layer *layer = hwc_layer->GetSDMLayer();
-    layer->flags = {};   // Reset earlier flags
-    if (hwc_layer->GetClientRequestedCompositionType() == HWC2::Composition::Client) {
-      layer->flags.skip = true;
-    } else if (hwc_layer->GetClientRequestedCompositionType() == HWC2::Composition::SolidColor) {
-      layer->flags.solid_fill = true;
+    // TODO(user): Move to a getter if this is needed at other places
+    if (hwc_layer->GetGeometryChanges() & kDisplayFrame) {
+      hwc_rect_t scaled_display_frame = {INT(layer->dst_rect.left), INT(layer->dst_rect.top),
+                                         INT(layer->dst_rect.right), INT(layer->dst_rect.bottom)};
+      ApplyScanAdjustment(&scaled_display_frame);
+      hwc_layer->SetLayerDisplayFrame(scaled_display_frame);
+      hwc_layer->ResetPerFrameData();
     }
 
-    if (!hwc_layer->ValidateAndSetCSC()) {
-#ifdef FEATURE_WIDE_COLOR
-      layer->flags.skip = true;
-#endif
+    if (hwc_layer->IsStateDirty()) {
+      if (hwc_layer->HasState()) {
+        CountLayerState(hwc_layer->GetState(), false);
+      }
+      hwc_layer->UpdateState();
+      CountLayerState(hwc_layer->GetState(), true);
     }
+  }
 
-    auto range = hwc_layer->GetLayerDataspace() & HAL_DATASPACE_RANGE_MASK;
-    if (range == HAL_DATASPACE_RANGE_EXTENDED) {
-      extended_range = true;
-    }
+  const LayerStateCounters &counters = layer_state_counters_;
+#ifdef FEATURE_WIDE_COLOR
+  auto working_primaries = GetWorkingPrimaries();
+#endif
+  // Dont honor HDR when its handling is disabled
+  // Also, when the color mode is native, it implies that
+  // SF has not correctly set the mode to BT2100_PQ in the presence of an HDR layer
+  // In such cases, we should not handle HDR as the HDR mode isn't applied
+  bool hdr_enabled = !disable_hdr_handling_ && GetCurrentColorMode() != HAL_COLOR_MODE_NATIVE;
+  layer_stack_.flags.video_present = (counters.video > 0);
+  layer_stack_.flags.secure_present = (counters.secure > 0);
+  layer_stack_.flags.secure_camera_present = (counters.secure_camera > 0);
+  layer_stack_.flags.single_buffered_layer_present = (counters.single_buffer > 0);
+  layer_stack_.flags.hdr_present = (hdr_enabled && counters.hdr > 0);
+  bool secure_display_active = (counters.secure_display > 0);
+  bool extended_range = (counters.extended_range > 0);
 
-    working_primaries = WidestPrimaries(working_primaries,
-                                        layer->input_buffer.color_metadata.colorPrimaries);
+  // Add one layer for fb target
+  // TODO(user): Add blit target layers
+  for (auto hwc_layer : layer_set_) {
+    Layer *layer = hwc_layer->GetSDMLayer();
+    const HWCLayerState &state = hwc_layer->GetState();
+    layer->flags = state.flags;  // Reset earlier flags
+    layer->input_buffer.flags.hdr = (hdr_enabled && state.hdr);
 
     // set default composition as GPU for SDM
     layer->composition = kCompositionGPU;
@@ -522,61 +594,25 @@ void HWCDisplay::BuildLayerStack() {
       }
     }
 
-    bool is_secure = false;
-    const private_handle_t *handle =
-        reinterpret_cast<const private_handle_t *>(layer->input_buffer.buffer_id);
-    if (handle) {
-      if (handle->buffer_type == BUFFER_TYPE_VIDEO) {
-        layer_stack_.flags.video_present = true;
-      }
-      // TZ Protected Buffer - L1
-      // Gralloc Usage Protected Buffer - L3 - which needs to be treated as Secure & avoid fallback
-      if (handle->flags & private_handle_t::PRIV_FLAGS_PROTECTED_BUFFER ||
-          handle->flags & private_handle_t::PRIV_FLAGS_SECURE_BUFFER) {
-        layer_stack_.flags.secure_present = true;
-        is_secure = true;
-      }
-    }
-
-    if (layer->input_buffer.flags.secure_display) {
-      secure_display_active = true;
-      is_secure = true;
-    }
-
-    if (layer->input_buffer.flags.secure_camera) {
-      layer_stack_.flags.secure_camera_present = true;
-      is_secure = true;
-    }
-
-    if (hwc_layer->IsSingleBuffered() &&
-       !(hwc_layer->IsRotationPresent() || hwc_layer->IsScalingPresent())) {
-      layer->flags.single_buffer = true;
-      layer_stack_.flags.single_buffered_layer_present = true;
-    }
-
     if (hwc_layer->GetClientRequestedCompositionType() == HWC2::Composition::Cursor) {
       // Currently we support only one HWCursor & only at top most z-order
-      if ((*layer_set_.rbegin())->GetId() == hwc_layer->GetId()) {
+      if (layer_set_.back() == hwc_layer) {
         layer->flags.cursor = true;
         layer_stack_.flags.cursor_present = true;
       }
     }
 
-    bool hdr_layer = layer->input_buffer.color_metadata.colorPrimaries == ColorPrimaries_BT2020 &&
-                     (layer->input_buffer.color_metadata.transfer == Transfer_SMPTE_ST2084 ||
-                     layer->input_buffer.color_metadata.transfer == Transfer_HLG);
-    if (hdr_layer && !disable_hdr_handling_  &&
-        GetCurrentColorMode() != HAL_COLOR_MODE_NATIVE) {
-      // Dont honor HDR when its handling is disabled
-      // Also, when the color mode is native, it implies that
-      // SF has not correctly set the mode to BT2100_PQ in the presence of an HDR layer
-      // In such cases, we should not handle HDR as the HDR mode isn't applied
-      layer->input_buffer.flags.hdr = true;
-      layer_stack_.flags.hdr_present = true;
+#ifdef FEATURE_WIDE_COLOR
+    if (state.primaries != working_primaries &&
+        !hwc_layer->SupportLocalConversion(working_primaries) && !state.secure) {
+      layer->flags.skip = true;
     }
+#endif
 
-    if (hwc_layer->IsNonIntegralSourceCrop() && !is_secure && !hdr_layer &&
-        !layer->flags.single_buffer && !layer->flags.solid_fill) {
+    // MDP can't handle secure camera and normal rotation together.
+    // TODO(user): Need to add proper downscaling check.
+    if (layer_stack_.flags.secure_camera_present && !state.secure_camera &&
+        (hwc_layer->IsRotationPresent() || (hwc_layer->GetScaleFactor() < 0.25))) {
       layer->flags.skip = true;
     }
 
@@ -584,14 +620,6 @@ void HWCDisplay::BuildLayerStack() {
       layer_stack_.flags.skip_present = true;
     }
 
-    // TODO(user): Move to a getter if this is needed at other places
-    hwc_rect_t scaled_display_frame = {INT(layer->dst_rect.left), INT(layer->dst_rect.top),
-                                       INT(layer->dst_rect.right), INT(layer->dst_rect.bottom)};
-    if (hwc_layer->GetGeometryChanges() & kDisplayFrame) {
-      ApplyScanAdjustment(&scaled_display_frame);
-    }
-    hwc_layer->SetLayerDisplayFrame(scaled_display_frame);
-    hwc_layer->ResetPerFrameData();
     // SDM requires these details even for solid fill
     if (layer->flags.solid_fill) {
       LayerBuffer *layer_buffer = &layer->input_buffer;
@@ -622,46 +650,6 @@ void HWCDisplay::BuildLayerStack() {
     layer_stack_.layers.push_back(layer);
   }
 
-
-#ifdef FEATURE_WIDE_COLOR
-  for (auto hwc_layer : layer_set_) {
-    auto layer = hwc_layer->GetSDMLayer();
-    bool is_secure = false;
-    const private_handle_t *handle =
-        reinterpret_cast<const private_handle_t *>(layer->input_buffer.buffer_id);
-    if (handle) {
-      // TZ Protected Buffer - L1
-      // Gralloc Usage Protected Buffer - L3 - which needs to be treated as Secure & avoid fallback
-      if (handle->flags & private_handle_t::PRIV_FLAGS_PROTECTED_BUFFER ||
-          handle->flags & private_handle_t::PRIV_FLAGS_SECURE_BUFFER) {
-        is_secure = true;
-      }
-    }
-
-    if (layer->input_buffer.color_metadata.colorPrimaries != working_primaries &&
-        !hwc_layer->SupportLocalConversion(working_primaries) && !is_secure) {
-      layer->flags.skip = true;
-    }
-    if (layer->flags.skip) {
-      layer_stack_.flags.skip_present = true;
-    }
-  }
-#endif
-
-  //MDP can't handle secure camera and normal rotation together.
-  if (layer_stack_.flags.secure_camera_present){
-    for (auto hwc_layer : layer_set_) {
-      auto layer = hwc_layer->GetSDMLayer();
-      //TODO(user): Need to add proper downscaling check.
-      if (hwc_layer->IsRotationPresent() || (hwc_layer->GetScaleFactor() < 0.25)) {
-        if (!layer->input_buffer.flags.secure_camera) {
-          layer->flags.skip = true;
-          layer_stack_.flags.skip_present = true;
-        }
-      }
-    }
-  }
-
   // TODO(user): Set correctly when SDM supports geometry_changes as bitmask
   layer_stack_.flags.geometry_changed = UINT32(geometry_changes_ > 0);
   // Append client target to the layer stack
@@ -677,6 +665,48 @@ void HWCDisplay::BuildLayerStack() {
   }
   // set secure display
   SetSecureDisplay(secure_display_active);
+
+  if (layer_stack_trace_.IsOpen()) {
+    layer_stack_trace_.Write(layer_stack_);
+  }
+}
+
+void HWCDisplay::SortLayers() {
+  if (layer_set_sorted_) {
+    return;
+  }
+
+  // Stable, so that layers with the same Z keep their relative order.
+  std::stable_sort(layer_set_.begin(), layer_set_.end(), SortLayersByZ());
+  layer_set_sorted_ = true;
+}
+
+void HWCDisplay::CountLayerState(const HWCLayerState &state, bool add) {
+  LayerStateCounters &counters = layer_state_counters_;
+  uint32_t delta = add ? 1 : UINT32(-1);
+
+  counters.video += state.video ? delta : 0;
+  counters.secure += state.secure ? delta : 0;
+  counters.secure_camera += state.secure_camera ? delta : 0;
+  counters.secure_display += state.secure_display ? delta : 0;
+  counters.single_buffer += state.flags.single_buffer ? delta : 0;
+  counters.hdr += state.hdr ? delta : 0;
+  counters.extended_range += state.extended_range ? delta : 0;
+
+  auto &primaries_count = counters.primaries[state.primaries];
+  primaries_count += delta;
+  if (!primaries_count) {
+    counters.primaries.erase(state.primaries);
+  }
+}
+
+ColorPrimaries HWCDisplay::GetWorkingPrimaries() {
+  auto working_primaries = ColorPrimaries_BT709_5;
+  for (auto &primaries : layer_state_counters_.primaries) {
+    working_primaries = WidestPrimaries(working_primaries, primaries.first);
+  }
+
+  return working_primaries;
 }
 
 void HWCDisplay::BuildSolidFillStack() {
@@ -697,27 +727,13 @@ HWC2::Error HWCDisplay::SetLayerZOrder(hwc2_layer_t layer_id, uint32_t z) {
   }
 
   const auto layer = map_layer->second;
-  const auto z_range = layer_set_.equal_range(layer);
-  bool layer_on_display = false;
-  for (auto current = z_range.first; current != z_range.second; ++current) {
-    if (*current == layer) {
-      if ((*current)->GetZ() == z) {
-        // Don't change anything if the Z hasn't changed
-        return HWC2::Error::None;
-      }
-      current = layer_set_.erase(current);
-      layer_on_display = true;
-      break;
-    }
-  }
-
-  if (!layer_on_display) {
-    DLOGE("[%" PRIu64 "] updateLayerZ failed to find layer on display", id_);
-    return HWC2::Error::BadLayer;
+  if (layer->GetZ() == z) {
+    // Don't change anything if the Z hasn't changed
+    return HWC2::Error::None;
   }
 
   layer->SetLayerZOrder(z);
-  layer_set_.emplace(layer);
+  layer_set_sorted_ = false;
   return HWC2::Error::None;
 }
 
@@ -738,6 +754,22 @@ HWC2::Error HWCDisplay::SetVsyncEnabled(HWC2::Vsync enabled) {
   else
     return HWC2::Error::BadParameter;
 
+  if (sw_vsync_) {
+    {
+      std::lock_guard<std::mutex> lock(vsync_mutex_);
+      vsync_requested_ = state;
+      soft_vsync_active_ = false;
+      soft_vsync_generation_++;
+    }
+    // Not waited for, a running tick drops its callback since the generation has changed.
+    HWCSoftVsync::Get()->Remove(id_);
+    if (state && !vsync_model_.NeedsResync(static_cast<int64_t>(FrameStats::GetTimeNs()))) {
+      std::lock_guard<std::mutex> lock(vsync_mutex_);
+      StartSoftVsyncLocked();
+      return HWC2::Error::None;
+    }
+  }
+
   error = display_intf_->SetVSyncState(state);
 
   if (error != kErrorNone) {
@@ -805,21 +837,24 @@ HWC2::Error HWCDisplay::SetPowerMode(HWC2::PowerMode mode) {
   }
 
   if (release_fence >= 0) {
+    std::shared_ptr<Fence> state_fence = FenceManager::Create(release_fence);
+    // Layers released by the same commit share one fence, so they share the merged fence too.
+    std::shared_ptr<Fence> last_fence;
+    std::shared_ptr<Fence> last_merged_fence;
     for (auto hwc_layer : layer_set_) {
       auto fence = hwc_layer->PopBackReleaseFence();
-      auto merged_fence = -1;
-      if (fence >= 0) {
-        merged_fence = sync_merge("sync_merge", release_fence, fence);
-        ::close(fence);
-      } else {
-        merged_fence = ::dup(release_fence);
+      if (!last_merged_fence || fence != last_fence) {
+        last_fence = fence;
+        if (FenceManager::Merge(state_fence, fence, &last_merged_fence) != kErrorNone) {
+          DLOGW("Release fence of layer %" PRIu64 " not merged with state fence",
+                hwc_layer->GetId());
+        }
       }
-      hwc_layer->PushBackReleaseFence(merged_fence);
+      hwc_layer->PushBackReleaseFence(last_merged_fence);
     }
 
     // Add this release fence onto fbt_release fence.
-    CloseFd(&fbt_release_fence_);
-    fbt_release_fence_ = release_fence;
+    fbt_release_fence_ = state_fence;
   }
   return HWC2::Error::None;
 }
@@ -1051,10 +1086,123 @@ HWC2::PowerMode HWCDisplay::GetLastPowerMode() {
 }
 
 DisplayError HWCDisplay::VSync(const DisplayEventVSync &vsync) {
+  if (sw_vsync_) {
+    vsync_model_.AddVsync(vsync.timestamp);
+    std::lock_guard<std::mutex> lock(vsync_mutex_);
+    if (soft_vsync_active_) {
+      // Hardware vsync is about to be disabled, callbacks are served by the soft vsync timer.
+      return kErrorNone;
+    }
+    if (vsync_requested_ && !vsync_model_.NeedsResync(vsync.timestamp)) {
+      StartSoftVsyncLocked();
+    }
+    last_vsync_ns_ = vsync.timestamp;
+  }
+
+  // Called without vsync_mutex_, the framework may disable vsync from the callback.
   callbacks_->Vsync(id_, vsync.timestamp);
   return kErrorNone;
 }
 
+void HWCDisplay::ResetVsyncModel(int64_t period_ns) {
+  if (sw_vsync_ && period_ns > 0) {
+    DLOGI_IF(kTagDisplay, "Display %d vsync period %" PRId64 " ns", id_, period_ns);
+    vsync_model_.Reset(period_ns);
+  }
+}
+
+void HWCDisplay::StartSoftVsyncLocked() {
+  soft_vsync_active_ = true;
+  hw_vsync_handoff_ = true;
+  soft_vsync_next_ns_ = 0;
+  uint64_t generation = ++soft_vsync_generation_;
+  HWCSoftVsync::Get()->Add(id_, [this, generation](int64_t now_ns, int64_t *next_ns) {
+    return HandleSoftVsync(generation, now_ns, next_ns);
+  });
+}
+
+bool HWCDisplay::HandleSoftVsync(uint64_t generation, int64_t now_ns, int64_t *next_ns) {
+  bool resync = vsync_model_.NeedsResync(now_ns);
+  int64_t vsync_ns = 0;
+  {
+    // Hardware vsync is switched with the lock held, so that it is ordered against
+    // SetVsyncEnabled() of a newer generation.
+    std::lock_guard<std::mutex> lock(vsync_mutex_);
+    if (generation != soft_vsync_generation_ || !vsync_requested_ || !soft_vsync_active_) {
+      return false;
+    }
+    soft_vsync_active_ = !resync;
+
+    if (resync) {
+      DLOGI_IF(kTagDisplay, "Display %d resyncs with hardware vsync", id_);
+      display_intf_->SetVSyncState(true);
+      return false;
+    }
+
+    if (hw_vsync_handoff_) {
+      hw_vsync_handoff_ = false;
+      display_intf_->SetVSyncState(false);
+    }
+    vsync_ns = soft_vsync_next_ns_;
+  }
+
+  // Called without vsync_mutex_, the framework may disable vsync from the callback. A disable
+  // racing with this point may still see this callback, as it may with hardware vsync.
+  if (vsync_ns && vsync_ns <= now_ns) {
+    last_vsync_ns_ = vsync_ns;
+    callbacks_->Vsync(id_, vsync_ns);
+  }
+
+  // Skip the vsync last delivered, whether it came from hardware or from the model.
+  int64_t period_ns = vsync_model_.GetPeriod();
+  if (!vsync_model_.GetNextVsync(std::max(now_ns, last_vsync_ns_ + period_ns / 2), &vsync_ns)) {
+    return true;  // Model dropped meanwhile, resync on the next tick.
+  }
+
+  std::lock_guard<std::mutex> lock(vsync_mutex_);
+  if (generation != soft_vsync_generation_) {
+    return false;
+  }
+  soft_vsync_next_ns_ = vsync_ns;
+  *next_ns = vsync_ns;
+
+  return true;
+}
+
+void HWCDisplay::WatchRetireFence(int retire_fence_fd) {
+  // One retire fence in flight is enough to verify the model.
+  if (retire_watch_pending_.exchange(true)) {
+    return;
+  }
+
+  std::shared_ptr<Fence> retire_fence = FenceManager::Create(dup(retire_fence_fd));
+  auto on_retire = [this, retire_fence](int status) {
+    retire_watch_pending_ = false;
+    if (status < 0) {
+      return;
+    }
+
+    struct sync_file_info *info = sync_file_info(retire_fence->Get());
+    if (!info) {
+      return;
+    }
+    struct sync_fence_info *fences = sync_get_fence_info(info);
+    int64_t timestamp_ns = 0;
+    for (uint32_t i = 0; i < info->num_fences; i++) {
+      timestamp_ns = std::max(timestamp_ns, static_cast<int64_t>(fences[i].timestamp_ns));
+    }
+    sync_file_info_free(info);
+
+    if (timestamp_ns) {
+      vsync_model_.AddRetire(timestamp_ns);
+    }
+  };
+  retire_watch_ = HWCFenceWatcher::Get()->Watch(retire_fence, 1000, on_retire);
+  if (!retire_watch_) {
+    retire_watch_pending_ = false;
+  }
+}
+
 DisplayError HWCDisplay::Refresh() {
   return kErrorNotSupported;
 }
@@ -1141,7 +1289,8 @@ HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
 
     if ((composition == kCompositionSDE) || (composition == kCompositionHybrid) ||
         (composition == kCompositionBlit)) {
-      layer_requests_[hwc_layer->GetId()] = HWC2::LayerRequest::ClearClientTarget;
+      layer_requests_.push_back(std::make_pair(hwc_layer->GetId(),
+                                               HWC2::LayerRequest::ClearClientTarget));
     }
 
     HWC2::Composition requested_composition = hwc_layer->GetClientRequestedCompositionType();
@@ -1154,7 +1303,7 @@ HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
     // Update the changes list only if the requested composition is different from SDM comp type
     // TODO(user): Take Care of other comptypes(BLIT)
     if (requested_composition != device_composition) {
-      layer_changes_[hwc_layer->GetId()] = device_composition;
+      layer_changes_.push_back(std::make_pair(hwc_layer, device_composition));
     }
     hwc_layer->ResetValidation();
   }
@@ -1181,14 +1330,9 @@ HWC2::Error HWCDisplay::AcceptDisplayChanges() {
     return HWC2::Error::NotValidated;
   }
 
+  // Destroyed layers are dropped from the changes by DestroyLayer.
   for (const auto& change : layer_changes_) {
-    auto hwc_layer = layer_map_[change.first];
-    auto composition = change.second;
-    if (hwc_layer != nullptr) {
-      hwc_layer->UpdateClientCompositionType(composition);
-    } else {
-      DLOGW("Invalid layer: %" PRIu64, change.first);
-    }
+    change.first->UpdateClientCompositionType(change.second);
   }
   return HWC2::Error::None;
 }
@@ -1211,8 +1355,8 @@ HWC2::Error HWCDisplay::GetChangedCompositionTypes(uint32_t *out_num_elements,
   *out_num_elements = UINT32(layer_changes_.size());
   if (out_layers != nullptr && out_types != nullptr) {
     int i = 0;
-    for (auto change : layer_changes_) {
-      out_layers[i] = change.first;
+    for (const auto &change : layer_changes_) {
+      out_layers[i] = change.first->GetId();
       out_types[i] = INT32(change.second);
       i++;
     }
@@ -1228,11 +1372,11 @@ HWC2::Error HWCDisplay::GetReleaseFences(uint32_t *out_num_elements, hwc2_layer_
 
   if (out_layers != nullptr && out_fences != nullptr) {
     *out_num_elements = std::min(*out_num_elements, UINT32(layer_set_.size()));
-    auto it = layer_set_.begin();
-    for (uint32_t i = 0; i < *out_num_elements; i++, it++) {
-      auto hwc_layer = *it;
+    for (uint32_t i = 0; i < *out_num_elements; i++) {
+      auto hwc_layer = layer_set_[i];
       out_layers[i] = hwc_layer->GetId();
-      out_fences[i] = hwc_layer->PopFrontReleaseFence();
+      auto fence = hwc_layer->PopFrontReleaseFence();
+      out_fences[i] = FenceManager::Export(&fence);
     }
   } else {
     *out_num_elements = UINT32(layer_set_.size());
@@ -1267,10 +1411,9 @@ HWC2::Error HWCDisplay::GetDisplayRequests(int32_t *out_display_requests,
   *out_display_requests = 0;
   if (out_layers != nullptr && out_layer_requests != nullptr) {
     *out_num_elements = std::min(*out_num_elements, UINT32(layer_requests_.size()));
-    auto it = layer_requests_.begin();
-    for (uint32_t i = 0; i < *out_num_elements; i++, it++) {
-      out_layers[i] = it->first;
-      out_layer_requests[i] = INT32(it->second);
+    for (uint32_t i = 0; i < *out_num_elements; i++) {
+      out_layers[i] = layer_requests_[i].first;
+      out_layer_requests[i] = INT32(layer_requests_[i].second);
     }
   } else {
     *out_num_elements = UINT32(layer_requests_.size());
@@ -1338,6 +1481,7 @@ HWC2::Error HWCDisplay::CommitLayerStack(void) {
     return HWC2::Error::None;
   }
 
+  WaitOnFenceWatches();
   DumpInputBuffers();
 
   DisplayError error = kErrorUndefined;
@@ -1391,15 +1535,11 @@ HWC2::Error HWCDisplay::PostCommitLayerStack(int32_t *out_retire_fence) {
   }
 
   // TODO(user): No way to set the client target release fence on SF
-  int32_t &client_target_release_fence =
-      client_target_->GetSDMLayer()->input_buffer.release_fence_fd;
-  if (client_target_release_fence >= 0) {
-    // Close cached release fence.
-    close(fbt_release_fence_);
-    fbt_release_fence_ = dup(client_target_release_fence);
-    // Close fence returned by driver.
-    close(client_target_release_fence);
-    client_target_release_fence = -1;
+  std::shared_ptr<Fence> &client_target_release_fence =
+      client_target_->GetSDMLayer()->input_buffer.release_fence;
+  if (client_target_release_fence) {
+    fbt_release_fence_ = std::move(client_target_release_fence);
+    client_target_release_fence = nullptr;
   }
   client_target_->ResetGeometryChanges();
 
@@ -1412,20 +1552,20 @@ HWC2::Error HWCDisplay::PostCommitLayerStack(int32_t *out_retire_fence) {
       // If swapinterval property is set to 0 or for single buffer layers, do not update f/w
       // release fences and discard fences from driver
       if (swap_interval_zero_ || layer->flags.single_buffer) {
-        close(layer_buffer->release_fence_fd);
+        // Dropping the reference is enough, the fence is closed with its last reference.
       } else if (layer->composition != kCompositionGPU) {
-        hwc_layer->PushBackReleaseFence(layer_buffer->release_fence_fd);
+        hwc_layer->PushBackReleaseFence(layer_buffer->release_fence);
       } else {
-        hwc_layer->PushBackReleaseFence(-1);
+        hwc_layer->PushBackReleaseFence(nullptr);
       }
     } else {
       // In case of flush or display paused, we don't return an error to f/w, so it will
       // get a release fence out of the hwc_layer's release fence queue.
-      // We should push a -1 to preserve release fence circulation semantics.
-      hwc_layer->PushBackReleaseFence(-1);
+      // We should push an empty fence to preserve release fence circulation semantics.
+      hwc_layer->PushBackReleaseFence(nullptr);
     }
 
-    layer_buffer->release_fence_fd = -1;
+    layer_buffer->release_fence = nullptr;
     if (layer_buffer->acquire_fence_fd >= 0) {
       close(layer_buffer->acquire_fence_fd);
       layer_buffer->acquire_fence_fd = -1;
@@ -1441,12 +1581,23 @@ HWC2::Error HWCDisplay::PostCommitLayerStack(int32_t *out_retire_fence) {
     close(layer_stack_.retire_fence_fd);
     layer_stack_.retire_fence_fd = -1;
   }
+  if (sw_vsync_ && layer_stack_.retire_fence_fd >= 0) {
+    WatchRetireFence(layer_stack_.retire_fence_fd);
+  }
   *out_retire_fence = layer_stack_.retire_fence_fd;
   layer_stack_.retire_fence_fd = -1;
 
   if (dump_frame_count_) {
     dump_frame_count_--;
     dump_frame_index_++;
+    if (!dump_frame_count_ && HWCFrameDumpWriter::IsStarted()) {
+      // Last frame of the session, its buffers are queued once the pending dumps are done.
+      WaitOnFenceWatches();
+      char dir_path[PATH_MAX];
+      snprintf(dir_path, sizeof(dir_path), "%s/frame_dump_%s", HWCDebugHandler::DumpDir(),
+               GetDisplayString());
+      HWCFrameDumpWriter::Get()->EndSession(dir_path);
+    }
   }
 
   geometry_changes_ = GeometryChanges::kNone;
@@ -1471,146 +1622,6 @@ DisplayError HWCDisplay::SetMaxMixerStages(uint32_t max_mixer_stages) {
   return error;
 }
 
-LayerBufferFormat HWCDisplay::GetSDMFormat(const int32_t &source, const int flags) {
-  LayerBufferFormat format = kFormatInvalid;
-  if (flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED) {
-    switch (source) {
-      case HAL_PIXEL_FORMAT_RGBA_8888:
-        format = kFormatRGBA8888Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBX_8888:
-        format = kFormatRGBX8888Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_BGR_565:
-        format = kFormatBGR565Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
-      case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC:
-      case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
-        format = kFormatYCbCr420SPVenusUbwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBA_1010102:
-        format = kFormatRGBA1010102Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBX_1010102:
-        format = kFormatRGBX1010102Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC:
-        format = kFormatYCbCr420TP10Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC:
-        format = kFormatYCbCr420P010Ubwc;
-        break;
-      default:
-        DLOGE("Unsupported format type for UBWC %d", source);
-        return kFormatInvalid;
-    }
-    return format;
-  }
-
-  switch (source) {
-    case HAL_PIXEL_FORMAT_RGBA_8888:
-      format = kFormatRGBA8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_5551:
-      format = kFormatRGBA5551;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_4444:
-      format = kFormatRGBA4444;
-      break;
-    case HAL_PIXEL_FORMAT_BGRA_8888:
-      format = kFormatBGRA8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGBX_8888:
-      format = kFormatRGBX8888;
-      break;
-    case HAL_PIXEL_FORMAT_BGRX_8888:
-      format = kFormatBGRX8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGB_888:
-      format = kFormatRGB888;
-      break;
-    case HAL_PIXEL_FORMAT_RGB_565:
-      format = kFormatRGB565;
-      break;
-    case HAL_PIXEL_FORMAT_BGR_565:
-      format = kFormatBGR565;
-      break;
-    case HAL_PIXEL_FORMAT_BGR_888:
-      format = kFormatBGR888;
-      break;
-    case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
-      format = kFormatYCbCr420SemiPlanarVenus;
-      break;
-    case HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS:
-      format = kFormatYCrCb420SemiPlanarVenus;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC:
-      format = kFormatYCbCr420SPVenusUbwc;
-      break;
-    case HAL_PIXEL_FORMAT_YV12:
-      format = kFormatYCrCb420PlanarStride16;
-      break;
-    case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-      format = kFormatYCrCb420SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP:
-      format = kFormatYCbCr420SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_422_SP:
-      format = kFormatYCbCr422H2V1SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_422_I:
-      format = kFormatYCbCr422H2V1Packed;
-      break;
-    case HAL_PIXEL_FORMAT_CbYCrY_422_I:
-      format = kFormatCbYCrY422H2V1Packed;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_1010102:
-      format = kFormatRGBA1010102;
-      break;
-    case HAL_PIXEL_FORMAT_ARGB_2101010:
-      format = kFormatARGB2101010;
-      break;
-    case HAL_PIXEL_FORMAT_RGBX_1010102:
-      format = kFormatRGBX1010102;
-      break;
-    case HAL_PIXEL_FORMAT_XRGB_2101010:
-      format = kFormatXRGB2101010;
-      break;
-    case HAL_PIXEL_FORMAT_BGRA_1010102:
-      format = kFormatBGRA1010102;
-      break;
-    case HAL_PIXEL_FORMAT_ABGR_2101010:
-      format = kFormatABGR2101010;
-      break;
-    case HAL_PIXEL_FORMAT_BGRX_1010102:
-      format = kFormatBGRX1010102;
-      break;
-    case HAL_PIXEL_FORMAT_XBGR_2101010:
-      format = kFormatXBGR2101010;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010:
-      format = kFormatYCbCr420P010;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC:
-      format = kFormatYCbCr420TP10Ubwc;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC:
-      format = kFormatYCbCr420P010Ubwc;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010_VENUS:
-      format = kFormatYCbCr420P010Venus;
-      break;
-    default:
-      DLOGW("Unsupported format type = %d", source);
-      return kFormatInvalid;
-  }
-
-  return format;
-}
-
 void HWCDisplay::DumpInputBuffers() {
   char dir_path[PATH_MAX];
 
@@ -1633,20 +1644,15 @@ void HWCDisplay::DumpInputBuffers() {
     return;
   }
 
+  // Buffers are dumped once their acquire fence signals. The client may free a buffer before
+  // that, so each dump holds its own import of the buffer until it is done.
+  std::string dir_path_str = dir_path;
   for (uint32_t i = 0; i < layer_stack_.layers.size(); i++) {
     auto layer = layer_stack_.layers.at(i);
     const private_handle_t *pvt_handle =
         reinterpret_cast<const private_handle_t *>(layer->input_buffer.buffer_id);
     auto acquire_fence_fd = layer->input_buffer.acquire_fence_fd;
 
-    if (acquire_fence_fd >= 0) {
-      int error = sync_wait(acquire_fence_fd, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-        return;
-      }
-    }
-
     DLOGI("Dump layer[%d] of %d pvt_handle %x pvt_handle->base %x", i, layer_stack_.layers.size(),
           pvt_handle, pvt_handle? pvt_handle->base : 0);
 
@@ -1655,39 +1661,64 @@ void HWCDisplay::DumpInputBuffers() {
       return;
     }
 
-    if (!pvt_handle->base) {
-      DisplayError error = buffer_allocator_->MapBuffer(pvt_handle, -1);
-      if (error != kErrorNone) {
-        DLOGE("Failed to map buffer, error = %d", error);
-        return;
-      }
+    private_handle_t *imported_handle = nullptr;
+    DisplayError error = buffer_allocator_->ImportBuffer(pvt_handle, &imported_handle);
+    if (error != kErrorNone) {
+      DLOGE("Failed to import buffer of layer %d, error = %d", i, error);
+      continue;
     }
 
-    char dump_file_name[PATH_MAX];
-    size_t result = 0;
-
-    snprintf(dump_file_name, sizeof(dump_file_name), "%s/input_layer%d_%dx%d_%s_frame%d.raw",
-             dir_path, i, pvt_handle->width, pvt_handle->height,
-             qdutils::GetHALPixelFormatString(pvt_handle->format), dump_frame_index_);
-
-    FILE *fp = fopen(dump_file_name, "w+");
-    if (fp) {
-      result = fwrite(reinterpret_cast<void *>(pvt_handle->base), pvt_handle->size, 1, fp);
-      fclose(fp);
+    HWCBufferAllocator *buffer_allocator = buffer_allocator_;
+    std::shared_ptr<private_handle_t> dump_handle(imported_handle,
+                                                  [buffer_allocator](private_handle_t *handle) {
+      buffer_allocator->FreeImportedBuffer(handle);
+    });
+    std::shared_ptr<Fence> acquire_fence =
+        FenceManager::Create((acquire_fence_fd >= 0) ? dup(acquire_fence_fd) : -1);
+    uint32_t frame_index = dump_frame_index_;
+    uint64_t id = HWCFenceWatcher::Get()->Watch(acquire_fence, 1000, [=](int status) {
+      if (status < 0) {
+        DLOGW("Acquire fence of layer %d, error = %d", i, status);
+        return;
+      }
+      DumpInputBuffer(dump_handle.get(), dir_path_str, i, frame_index);
+    });
+    if (id) {
+      fence_watches_.push_back(id);
     }
+  }
+}
 
-    int release_fence = -1;
-    DisplayError error = buffer_allocator_->UnmapBuffer(pvt_handle, &release_fence);
+void HWCDisplay::DumpInputBuffer(const private_handle_t *pvt_handle, const std::string &dir_path,
+                                 uint32_t layer_index, uint32_t frame_index) {
+  if (!pvt_handle->base) {
+    DisplayError error = buffer_allocator_->MapBuffer(pvt_handle, -1);
     if (error != kErrorNone) {
-      DLOGE("Failed to unmap buffer, error = %d", error);
+      DLOGE("Failed to map buffer, error = %d", error);
       return;
     }
+  }
 
-    DLOGI("Frame Dump %s: is %s", dump_file_name, result ? "Successful" : "Failed");
+  // Only a copy into staging memory happens here, the file is written by the dump writer.
+  FrameDumpInfo info;
+  info.dir_path = dir_path;
+  info.name = "input_layer" + std::to_string(layer_index);
+  info.format = qdutils::GetHALPixelFormatString(pvt_handle->format);
+  info.width = UINT32(pvt_handle->width);
+  info.height = UINT32(pvt_handle->height);
+  info.frame_index = frame_index;
+  HWCFrameDumpWriter::Get()->Enqueue(info, reinterpret_cast<void *>(pvt_handle->base),
+                                     pvt_handle->size);
+
+  int release_fence = -1;
+  DisplayError error = buffer_allocator_->UnmapBuffer(pvt_handle, &release_fence);
+  if (error != kErrorNone) {
+    DLOGE("Failed to unmap buffer, error = %d", error);
   }
 }
 
-void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence) {
+void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence,
+                                  uint32_t frame_index) {
   char dir_path[PATH_MAX];
 
   snprintf(dir_path, sizeof(dir_path), "%s/frame_dump_%s", HWCDebugHandler::DumpDir(),
@@ -1705,9 +1736,6 @@ void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int
   }
 
   if (base) {
-    char dump_file_name[PATH_MAX];
-    size_t result = 0;
-
     if (fence >= 0) {
       int error = sync_wait(fence, 1000);
       if (error < 0) {
@@ -1716,17 +1744,14 @@ void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int
       }
     }
 
-    snprintf(dump_file_name, sizeof(dump_file_name), "%s/output_layer_%dx%d_%s_frame%d.raw",
-             dir_path, buffer_info.buffer_config.width, buffer_info.buffer_config.height,
-             GetFormatString(buffer_info.buffer_config.format), dump_frame_index_);
-
-    FILE *fp = fopen(dump_file_name, "w+");
-    if (fp) {
-      result = fwrite(base, buffer_info.alloc_buffer_info.size, 1, fp);
-      fclose(fp);
-    }
-
-    DLOGI("Frame Dump of %s is %s", dump_file_name, result ? "Successful" : "Failed");
+    FrameDumpInfo info;
+    info.dir_path = dir_path;
+    info.name = "output_layer";
+    info.format = GetFormatString(buffer_info.buffer_config.format);
+    info.width = buffer_info.buffer_config.width;
+    info.height = buffer_info.buffer_config.height;
+    info.frame_index = frame_index;
+    HWCFrameDumpWriter::Get()->Enqueue(info, base, buffer_info.alloc_buffer_info.size);
   }
 }
 
@@ -2023,10 +2048,7 @@ void HWCDisplay::SolidFillPrepare() {
 void HWCDisplay::SolidFillCommit() {
   if (solid_fill_enable_ && solid_fill_layer_) {
     LayerBuffer *layer_buffer = &solid_fill_layer_->input_buffer;
-    if (layer_buffer->release_fence_fd > 0) {
-      close(layer_buffer->release_fence_fd);
-      layer_buffer->release_fence_fd = -1;
-    }
+    layer_buffer->release_fence = nullptr;
     if (layer_stack_.retire_fence_fd > 0) {
       close(layer_stack_.retire_fence_fd);
       layer_stack_.retire_fence_fd = -1;
@@ -2068,6 +2090,10 @@ int HWCDisplay::SetActiveDisplayConfig(uint32_t config) {
 
   validated_ = false;
   display_intf_->SetActiveConfig(config);
+  DisplayConfigVariableInfo variable_info = {};
+  if (display_intf_->GetConfig(config, &variable_info) == kErrorNone) {
+    ResetVsyncModel(variable_info.vsync_period_ns);
+  }
   callbacks_->Refresh(id_);
 
   return 0;
@@ -2171,6 +2197,28 @@ std::string HWCDisplay::Dump() {
     color_mode_->Dump(&os);
   }
 
+  if (frame_stats_.IsEnabled()) {
+    os << "\n------------Frame Stats--------";
+    frame_stats_.Dump(&os);
+    os << "\n";
+  }
+
+  if (sw_vsync_) {
+    os << "\n------------Vsync Model--------\n";
+    vsync_model_.Dump(&os);
+  }
+
+  os << "\n------------Fences-------------";
+  FenceManager::Dump(&os);
+  HWCFenceWatcher::Get()->Dump(&os);
+  os << "\n";
+
+  if (HWCFrameDumpWriter::IsStarted()) {
+    os << "\n------------Frame Dump---------";
+    HWCFrameDumpWriter::Get()->Dump(&os);
+    os << "\n";
+  }
+
   if (display_intf_) {
     os << "\n------------SDM----------------\n";
     os << display_intf_->Dump();
@@ -2198,19 +2246,17 @@ bool HWCDisplay::CanSkipValidate() {
     return false;
   }
 
-  for (auto hwc_layer : layer_set_) {
-    if (hwc_layer->NeedsValidation()) {
-      DLOGV_IF(kTagClient, "hwc_layer[%d] needs validation. Returning false.",
-               hwc_layer->GetId());
-      return false;
-    }
+  if (layer_validation_state_.needs_validation) {
+    DLOGV_IF(kTagClient, "%u layers need validation. Returning false.",
+             layer_validation_state_.needs_validation);
+    return false;
+  }
 
-    // Do not allow Skip Validate, if any layer needs GPU Composition.
-    if (hwc_layer->GetDeviceSelectedCompositionType() == HWC2::Composition::Client) {
-      DLOGV_IF(kTagClient, "hwc_layer[%d] is GPU composed. Returning false.",
-               hwc_layer->GetId());
-      return false;
-    }
+  // Do not allow Skip Validate, if any layer needs GPU Composition.
+  if (layer_validation_state_.client_composition) {
+    DLOGV_IF(kTagClient, "%u layers are GPU composed. Returning false.",
+             layer_validation_state_.client_composition);
+    return false;
   }
 
   if (!display_intf_->CanSkipValidate()) {
@@ -2253,28 +2299,37 @@ void HWCDisplay::WaitOnPreviousFence() {
   }
 
   // Since prepare failed commit would follow the same.
-  // Wait for previous rel fence.
+  // Hold the next commit until the previous release fences have signaled, without blocking here.
+  std::vector<std::shared_ptr<Fence>> fences;
   for (auto hwc_layer : layer_set_) {
     auto fence = hwc_layer->PopBackReleaseFence();
-    if (fence >= 0) {
-      int error = sync_wait(fence, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-        return;
-      }
-    }
     hwc_layer->PushBackReleaseFence(fence);
+    fences.push_back(fence);
   }
+  fences.push_back(fbt_release_fence_);
 
-  if (fbt_release_fence_ >= 0) {
-    int error = sync_wait(fbt_release_fence_, 1000);
-    if (error < 0) {
-      DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-      return;
+  std::shared_ptr<Fence> merged_fence;
+  if (FenceManager::Merge(fences, &merged_fence) != kErrorNone) {
+    DLOGW("Not all previous release fences could be merged");
+  }
+
+  uint64_t id = HWCFenceWatcher::Get()->Watch(merged_fence, 1000, [](int status) {
+    if (status < 0) {
+      DLOGW("Previous release fence error = %d", status);
     }
+  });
+  if (id) {
+    fence_watches_.push_back(id);
   }
 }
 
+void HWCDisplay::WaitOnFenceWatches() {
+  for (auto id : fence_watches_) {
+    HWCFenceWatcher::Get()->Wait(id);
+  }
+  fence_watches_.clear();
+}
+
 HWC2::Error HWCDisplay::GetValidateDisplayOutput(uint32_t *out_num_types,
                                                  uint32_t *out_num_requests) {
   *out_num_types = UINT32(layer_changes_.size());
@@ -2283,4 +2338,21 @@ HWC2::Error HWCDisplay::GetValidateDisplayOutput(uint32_t *out_num_types,
   return ((*out_num_types > 0) ? HWC2::Error::HasChanges : HWC2::Error::None);
 }
 
+DisplayError HWCDisplay::GetFrameStats(FrameStatsSnapshot *snapshot, bool reset) {
+  DisplayError error = display_intf_->GetFrameStats(snapshot, reset);
+  if (error != kErrorNone) {
+    return error;
+  }
+
+  // Layer stack is built by HWC, merge its stage into the SDM statistics.
+  FrameStatsSnapshot hwc_snapshot;
+  frame_stats_.GetSnapshot(&hwc_snapshot);
+  snapshot->stages[kStageBuildLayerStack] = hwc_snapshot.stages[kStageBuildLayerStack];
+  if (reset) {
+    frame_stats_.Reset();
+  }
+
+  return kErrorNone;
+}
+
 }  // namespace sdm
@@ -26,7 +26,10 @@
 #include <hardware/hwcomposer.h>
 #include <private/color_params.h>
 #include <qdMetaData.h>
+#include <utils/layer_stack_trace.h>
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <string>
@@ -36,6 +39,7 @@
 #include "hwc_buffer_allocator.h"
 #include "hwc_callbacks.h"
 #include "hwc_layers.h"
+#include "hwc_vsync_model.h"
 #include "display_null.h"
 
 using android::hardware::graphics::common::V1_1::RenderIntent;
@@ -134,6 +138,7 @@ class HWCDisplay : public DisplayEventHandler {
   virtual DisplayError GetMixerResolution(uint32_t *width, uint32_t *height);
   virtual void GetPanelResolution(uint32_t *width, uint32_t *height);
   virtual std::string Dump();
+  DisplayError GetFrameStats(FrameStatsSnapshot *snapshot, bool reset);
 
   // Captures frame output in the buffer specified by output_buffer_info. The API is
   // non-blocking and the client is expected to check operation status later on.
@@ -284,19 +289,24 @@ class HWCDisplay : public DisplayEventHandler {
   virtual DisplayError VSync(const DisplayEventVSync &vsync);
   virtual DisplayError CECMessage(char *message);
   virtual DisplayError HandleEvent(DisplayEvent event);
-  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence);
+  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence,
+                                uint32_t frame_index);
   virtual HWC2::Error PrepareLayerStack(uint32_t *out_num_types, uint32_t *out_num_requests);
   virtual HWC2::Error CommitLayerStack(void);
   virtual HWC2::Error PostCommitLayerStack(int32_t *out_retire_fence);
   virtual DisplayError DisablePartialUpdateOneFrame() {
     return kErrorNotSupported;
   }
-  LayerBufferFormat GetSDMFormat(const int32_t &source, const int flags);
+  // Drops the vsync model after a refresh rate or config switch, hardware vsync is enabled again
+  // until the model is refitted at the new period.
+  void ResetVsyncModel(int64_t period_ns);
   const char *GetDisplayString();
   void MarkLayersForGPUBypass(void);
   void MarkLayersForClientComposition(void);
   virtual void ApplyScanAdjustment(hwc_rect_t *display_frame);
   uint32_t GetUpdatingLayersCount(void);
+  void SortLayers();
+  void WaitOnFenceWatches();
   bool IsSurfaceUpdated(const std::vector<LayerRect> &dirty_regions);
   bool IsLayerUpdating(const Layer *layer);
   uint32_t SanitizeRefreshRate(uint32_t req_refresh_rate);
@@ -320,13 +330,17 @@ class HWCDisplay : public DisplayEventHandler {
   LayerStack layer_stack_;
   HWCLayer *client_target_ = nullptr;                   // Also known as framebuffer target
   std::map<hwc2_layer_t, HWCLayer *> layer_map_;        // Look up by Id - TODO
-  std::multiset<HWCLayer *, SortLayersByZ> layer_set_;  // Maintain a set sorted by Z
-  std::map<hwc2_layer_t, HWC2::Composition> layer_changes_;
-  std::map<hwc2_layer_t, HWC2::LayerRequest> layer_requests_;
+  // Layers sorted by Z. The order is restored lazily by SortLayers() after a layer is added or
+  // its Z changes, so indices are stable between Z order changes.
+  std::vector<HWCLayer *> layer_set_;
+  bool layer_set_sorted_ = true;
+  std::vector<std::pair<HWCLayer *, HWC2::Composition>> layer_changes_;
+  std::vector<std::pair<hwc2_layer_t, HWC2::LayerRequest>> layer_requests_;
   bool flush_on_error_ = false;
   bool flush_ = false;
   uint32_t dump_frame_count_ = 0;
   uint32_t dump_frame_index_ = 0;
+  std::vector<uint64_t> fence_watches_;  // Fence callbacks to complete before the next commit
   bool dump_input_layers_ = false;
   HWC2::PowerMode last_power_mode_ = HWC2::PowerMode::Off;
   bool swap_interval_zero_ = false;
@@ -356,20 +370,56 @@ class HWCDisplay : public DisplayEventHandler {
   LayerRect window_rect_ = {};
   bool skip_commit_ = false;
   DisplayNull display_null_;
+  LayerStackTrace layer_stack_trace_;
+  FrameStats frame_stats_;
 
  private:
+  // Number of layers with each cached state attribute. Kept up to date as layers change, so that
+  // the layer stack flags do not need a pass over all layers.
+  struct LayerStateCounters {
+    uint32_t video = 0;
+    uint32_t secure = 0;
+    uint32_t secure_camera = 0;
+    uint32_t secure_display = 0;
+    uint32_t single_buffer = 0;
+    uint32_t hdr = 0;
+    uint32_t extended_range = 0;
+    std::map<ColorPrimaries, uint32_t> primaries;
+  };
+
   void DumpInputBuffers(void);
+  void DumpInputBuffer(const private_handle_t *pvt_handle, const std::string &dir_path,
+                       uint32_t layer_index, uint32_t frame_index);
   void UpdateRefreshRate();
   void WaitOnPreviousFence();
+  bool HandleSoftVsync(uint64_t generation, int64_t now_ns, int64_t *next_ns);
+  void StartSoftVsyncLocked();
+  void WatchRetireFence(int retire_fence_fd);
+  void CountLayerState(const HWCLayerState &state, bool add);
+  ColorPrimaries GetWorkingPrimaries();
   qService::QService *qservice_ = NULL;
   DisplayClass display_class_;
   uint32_t geometry_changes_ = GeometryChanges::kNone;
   bool animating_ = false;
   bool active_ = true;
   bool layers_bypassed_ = false;
-  int fbt_release_fence_ = -1;
+  std::shared_ptr<Fence> fbt_release_fence_;
   bool has_client_composition_ = false;
   DisplayValidateState validate_state_ = kNormalValidate;
+  // Software vsync, vsync_mutex_ guards the requested and active states and the generation.
+  bool sw_vsync_ = false;
+  HWCVsyncModel vsync_model_;
+  std::mutex vsync_mutex_;
+  bool vsync_requested_ = false;
+  bool soft_vsync_active_ = false;
+  bool hw_vsync_handoff_ = false;  // Hardware vsync to be disabled by the next soft tick.
+  int64_t soft_vsync_next_ns_ = 0;  // Predicted vsync the next soft tick delivers.
+  uint64_t soft_vsync_generation_ = 0;  // Changes whenever soft vsync is started or stopped.
+  std::atomic<int64_t> last_vsync_ns_ = {0};
+  std::atomic<bool> retire_watch_pending_ = {false};
+  uint64_t retire_watch_ = 0;
+  LayerStateCounters layer_state_counters_;
+  HWCLayerValidationState layer_validation_state_;
 };
 
 inline int HWCDisplay::Perform(uint32_t operation, ...) {
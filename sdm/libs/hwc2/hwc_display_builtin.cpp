@@ -40,6 +40,7 @@
 
 #include "hwc_display_builtin.h"
 #include "hwc_debugger.h"
+#include "hwc_fence_watcher.h"
 #include "hwc_session.h"
 
 #define __CLASS__ "HWCDisplayBuiltIn"
@@ -218,6 +219,9 @@ HWC2::Error HWCDisplayBuiltIn::Validate(uint32_t *out_num_types, uint32_t *out_n
   bool final_rate = force_refresh_rate_ ? true : false;
   error = display_intf_->SetRefreshRate(refresh_rate, final_rate);
   if (error == kErrorNone) {
+    if (refresh_rate != current_refresh_rate_ && refresh_rate) {
+      ResetVsyncModel(1000000000LL / refresh_rate);
+    }
     // On success, set current refresh rate to new refresh rate
     current_refresh_rate_ = refresh_rate;
   }
@@ -510,10 +514,14 @@ void HWCDisplayBuiltIn::HandleFrameOutput() {
 }
 
 void HWCDisplayBuiltIn::HandleFrameCapture() {
-  if (output_buffer_.release_fence_fd >= 0) {
-    frame_capture_status_ = sync_wait(output_buffer_.release_fence_fd, 1000);
-    ::close(output_buffer_.release_fence_fd);
-    output_buffer_.release_fence_fd = -1;
+  // Writeback completes asynchronously, its status is polled through GetFrameCaptureStatus().
+  std::shared_ptr<Fence> release_fence = FenceManager::Create(output_buffer_.release_fence_fd);
+  output_buffer_.release_fence_fd = -1;
+  if (release_fence) {
+    frame_capture_watch_ = HWCFenceWatcher::Get()->Watch(release_fence, 1000, [this](int status) {
+      frame_capture_status_ = status;
+    });
+    fence_watches_.push_back(frame_capture_watch_);
   }
 
   frame_capture_buffer_queued_ = false;
@@ -523,17 +531,24 @@ void HWCDisplayBuiltIn::HandleFrameCapture() {
 
 void HWCDisplayBuiltIn::HandleFrameDump() {
   if (dump_frame_count_ && output_buffer_.release_fence_fd >= 0) {
-    int ret = sync_wait(output_buffer_.release_fence_fd, 1000);
-    ::close(output_buffer_.release_fence_fd);
+    // The output buffer is written again by the next commit, which waits for this dump first.
+    std::shared_ptr<Fence> release_fence = FenceManager::Create(output_buffer_.release_fence_fd);
     output_buffer_.release_fence_fd = -1;
-    if (ret < 0) {
-      DLOGE("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-    } else {
-      DumpOutputBuffer(output_buffer_info_, output_buffer_base_, layer_stack_.retire_fence_fd);
+    uint32_t frame_index = dump_frame_index_;
+    uint64_t id = HWCFenceWatcher::Get()->Watch(release_fence, 1000, [=](int status) {
+      if (status < 0) {
+        DLOGE("Output buffer release fence error = %d", status);
+      } else {
+        DumpOutputBuffer(output_buffer_info_, output_buffer_base_, -1, frame_index);
+      }
+    });
+    if (id) {
+      fence_watches_.push_back(id);
     }
   }
 
   if (0 == dump_frame_count_) {
+    WaitOnFenceWatches();
     dump_output_to_file_ = false;
     // Unmap and Free buffer
     if (munmap(output_buffer_base_, output_buffer_info_.alloc_buffer_info.size) != 0) {
@@ -619,6 +634,8 @@ int HWCDisplayBuiltIn::FrameCaptureAsync(const BufferInfo &output_buffer_info,
   post_processed_output_ = post_processed_output;
   frame_capture_buffer_queued_ = true;
   // Status is only cleared on a new call to dump and remains valid otherwise
+  HWCFenceWatcher::Get()->Cancel(frame_capture_watch_);
+  frame_capture_watch_ = 0;
   frame_capture_status_ = -EAGAIN;
   DisablePartialUpdateOneFrame();
 
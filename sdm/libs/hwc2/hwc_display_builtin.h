@@ -30,6 +30,7 @@
 #ifndef __HWC_DISPLAY_BUILTIN_H__
 #define __HWC_DISPLAY_BUILTIN_H__
 
+#include <atomic>
 #include <string>
 
 #include "cpuhint.h"
@@ -106,7 +107,8 @@ class HWCDisplayBuiltIn : public HWCDisplay {
 
   // Members for 1 frame capture in a client provided buffer
   bool frame_capture_buffer_queued_ = false;
-  int frame_capture_status_ = -EAGAIN;
+  std::atomic<int> frame_capture_status_ {-EAGAIN};  // Set from the fence watcher thread
+  uint64_t frame_capture_watch_ = 0;
 
   // Members for N frame output dump to file
   bool dump_output_to_file_ = false;
@@ -737,8 +737,7 @@ HWC2::Error HWCDisplayPluggableTest::PostCommit(int32_t *out_retire_fence) {
       Layer *layer = layer_stack_.layers.at(i);
       LayerBuffer &layer_buffer = layer->input_buffer;
 
-      close(layer_buffer.release_fence_fd);
-      layer_buffer.release_fence_fd = -1;
+      layer_buffer.release_fence = nullptr;
     }
     close(layer_stack_.retire_fence_fd);
     layer_stack_.retire_fence_fd = -1;
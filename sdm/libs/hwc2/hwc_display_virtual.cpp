@@ -180,7 +180,7 @@ HWC2::Error HWCDisplayVirtual::Present(int32_t *out_retire_fence) {
       buffer_info.buffer_config.format = GetSDMFormat(output_handle->format, output_handle->flags);
       buffer_info.alloc_buffer_info.size = static_cast<uint32_t>(output_handle->size);
       DumpOutputBuffer(buffer_info, reinterpret_cast<void *>(output_handle->base),
-                       layer_stack_.retire_fence_fd);
+                       layer_stack_.retire_fence_fd, dump_frame_index_);
 
       int release_fence = -1;
       error = buffer_allocator_->UnmapBuffer(output_handle, &release_fence);
@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sync/sync.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/frame_stats.h>
+#include <algorithm>
+#include <utility>
+
+#include "hwc_fence_watcher.h"
+
+#define __CLASS__ "HWCFenceWatcher"
+
+namespace sdm {
+
+HWCFenceWatcher *HWCFenceWatcher::Get() {
+  // Never destroyed, callbacks may still be pending while the process exits.
+  static HWCFenceWatcher *fence_watcher = new HWCFenceWatcher();
+  return fence_watcher;
+}
+
+HWCFenceWatcher::HWCFenceWatcher() {
+  if (Init() != 0) {
+    DLOGE("Failed to start, fences will be waited on in place");
+  }
+}
+
+int HWCFenceWatcher::Init() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epoll_fd_ < 0 || event_fd_ < 0) {
+    DLOGE("epoll_fd %d event_fd %d errno = %d, desc = %s", epoll_fd_, event_fd_, errno,
+          strerror(errno));
+    return -errno;
+  }
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = event_fd_;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event) < 0) {
+    DLOGE("Failed to add event fd errno = %d, desc = %s", errno, strerror(errno));
+    return -errno;
+  }
+
+  std::thread thread(&HWCFenceWatcher::Run, this);
+  thread_id_ = thread.get_id();
+  thread.detach();
+  initialized_ = true;
+
+  return 0;
+}
+
+uint64_t HWCFenceWatcher::Watch(const std::shared_ptr<Fence> &fence, int timeout_ms,
+                                Callback callback) {
+  int fd = FenceManager::Get(fence);
+  if (fd < 0) {
+    callback(0);
+    return 0;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool wait_in_place = !initialized_;
+  if (!wait_in_place && !watches_by_fd_.count(fd)) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      DLOGW("Failed to watch fence %d errno = %d, desc = %s", fd, errno, strerror(errno));
+      wait_in_place = true;
+    }
+  }
+
+  if (wait_in_place) {
+    lock.unlock();
+    int status = sync_wait(fd, timeout_ms);
+    callback(status < 0 ? -errno : 0);
+    return 0;
+  }
+
+  uint64_t id = next_id_++;
+  WatchEntry &entry = watches_[id];
+  entry.fence = fence;
+  entry.callback = std::move(callback);
+  entry.start_ns = FrameStats::GetTimeNs();
+  entry.deadline_ns = entry.start_ns + UINT64(std::max(timeout_ms, 0)) * 1000000ULL;
+  watches_by_fd_.emplace(fd, id);
+  stats_.watches++;
+  stats_.pending++;
+
+  // Wake up the thread to pick up the new deadline.
+  uint64_t value = 1;
+  if (write(event_fd_, &value, sizeof(value)) < 0) {
+    DLOGW("Failed to wake up watcher errno = %d", errno);
+  }
+
+  return id;
+}
+
+void HWCFenceWatcher::Wait(uint64_t id) {
+  if (!id || std::this_thread::get_id() == thread_id_) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (IsPending(id)) {
+    stats_.blocked++;
+    cond_.wait(lock, [this, id] { return !IsPending(id); });
+  }
+}
+
+void HWCFenceWatcher::Cancel(uint64_t id) {
+  if (!id) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (watches_.count(id)) {
+    Remove(id);
+    stats_.cancelled++;
+    stats_.pending--;
+  }
+
+  if (std::this_thread::get_id() != thread_id_) {
+    cond_.wait(lock, [this, id] { return running_id_ != id; });
+  }
+}
+
+void HWCFenceWatcher::Remove(uint64_t id) {
+  int fd = FenceManager::Get(watches_[id].fence);
+  auto range = watches_by_fd_.equal_range(fd);
+  for (auto it = range.first; it != range.second; it++) {
+    if (it->second == id) {
+      watches_by_fd_.erase(it);
+      break;
+    }
+  }
+
+  if (!watches_by_fd_.count(fd)) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+  }
+
+  // The fence reference is dropped after the epoll registration of its fd.
+  watches_.erase(id);
+}
+
+int HWCFenceWatcher::GetTimeoutMs() {
+  if (watches_.empty()) {
+    return -1;
+  }
+
+  uint64_t now_ns = FrameStats::GetTimeNs();
+  uint64_t deadline_ns = UINT64(-1);
+  for (auto &watch : watches_) {
+    deadline_ns = std::min(deadline_ns, watch.second.deadline_ns);
+  }
+
+  return (deadline_ns <= now_ns) ? 0 : INT((deadline_ns - now_ns + 999999) / 1000000);
+}
+
+void HWCFenceWatcher::Run() {
+  prctl(PR_SET_NAME, "HWCFenceWatcher", 0, 0, 0);
+
+  struct epoll_event events[kMaxEvents];
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    int timeout_ms = GetTimeoutMs();
+    lock.unlock();
+    int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+    lock.lock();
+    if (count < 0 && errno != EINTR) {
+      DLOGE("epoll_wait failed errno = %d, desc = %s", errno, strerror(errno));
+    }
+
+    // Collect completed watches first, their callbacks run without the lock held.
+    std::vector<std::pair<uint64_t, int>> completed;
+    for (int i = 0; i < count; i++) {
+      int fd = events[i].data.fd;
+      if (fd == event_fd_) {
+        uint64_t value = 0;
+        if (read(event_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+          DLOGW("Failed to read event fd errno = %d", errno);
+        }
+        continue;
+      }
+
+      // The fence has signaled, a zero timeout wait only fetches its status.
+      int status = (sync_wait(fd, 0) < 0) ? -errno : 0;
+      auto range = watches_by_fd_.equal_range(fd);
+      for (auto it = range.first; it != range.second; it++) {
+        completed.push_back(std::make_pair(it->second, status));
+      }
+    }
+
+    uint64_t now_ns = FrameStats::GetTimeNs();
+    for (auto &watch : watches_) {
+      if (watch.second.deadline_ns <= now_ns &&
+          std::find_if(completed.begin(), completed.end(), [&watch](auto &done) {
+            return done.first == watch.first;
+          }) == completed.end()) {
+        completed.push_back(std::make_pair(watch.first, -ETIME));
+      }
+    }
+
+    for (auto &done : completed) {
+      auto it = watches_.find(done.first);
+      if (it == watches_.end()) {
+        continue;  // Cancelled while the lock was dropped for an earlier callback.
+      }
+
+      Callback callback = std::move(it->second.callback);
+      uint64_t wait_ns = now_ns - std::min(now_ns, it->second.start_ns);
+      Remove(done.first);
+      stats_.pending--;
+      if (done.second == -ETIME) {
+        stats_.timeouts++;
+        DLOGW("Fence not signaled after %" PRIu64 " ms", wait_ns / 1000000);
+      } else {
+        stats_.signaled++;
+        stats_.wait_ns += wait_ns;
+        stats_.max_wait_ns = std::max(stats_.max_wait_ns, wait_ns);
+      }
+
+      running_id_ = done.first;
+      lock.unlock();
+      DTRACE_BEGIN((done.second == -ETIME) ? "Timeout" : "Signaled");
+      callback(done.second);
+      DTRACE_END();
+      lock.lock();
+      running_id_ = 0;
+      cond_.notify_all();
+    }
+  }
+}
+
+void HWCFenceWatcher::GetStats(HWCFenceWatcherStats *stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *stats = stats_;
+}
+
+void HWCFenceWatcher::Dump(std::ostringstream *os) {
+  HWCFenceWatcherStats stats;
+  GetStats(&stats);
+
+  uint64_t mean_us = stats.signaled ? (stats.wait_ns / stats.signaled / 1000) : 0;
+  *os << "\nwatches: " << stats.watches << " pending: " << stats.pending;
+  *os << " signaled: " << stats.signaled << " timeouts: " << stats.timeouts;
+  *os << " cancelled: " << stats.cancelled << " blocked: " << stats.blocked;
+  *os << "\nwait(us) mean: " << mean_us << " max: " << stats.max_wait_ns / 1000;
+}
+
+}  // namespace sdm
@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HWC_FENCE_WATCHER_H__
+#define __HWC_FENCE_WATCHER_H__
+
+#include <utils/fence.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace sdm {
+
+struct HWCFenceWatcherStats {
+  uint64_t watches = 0;      // Fences handed to the watcher.
+  uint64_t signaled = 0;     // Fences that signaled, with or without an error status.
+  uint64_t timeouts = 0;     // Fences still pending when their timeout expired.
+  uint64_t cancelled = 0;    // Watches dropped before their callback ran.
+  uint64_t pending = 0;      // Watches not completed yet.
+  uint64_t blocked = 0;      // Wait() calls that had to block for a callback.
+  uint64_t wait_ns = 0;      // Total time from Watch() until the fence signaled.
+  uint64_t max_wait_ns = 0;  // Longest time from Watch() until the fence signaled.
+};
+
+// Waits for sync fences on a worker thread and runs a callback for each of them, so callers on the
+// composition path never block on a fence. All fences are polled through a single epoll instance.
+class HWCFenceWatcher {
+ public:
+  // status is 0 once the fence signaled, otherwise a negative errno for a fence error or -ETIME
+  // when timeout_ms expired first.
+  typedef std::function<void(int status)> Callback;
+
+  static HWCFenceWatcher *Get();
+
+  // Returns an id to Wait() or Cancel() on. An empty fence completes in place and returns 0.
+  uint64_t Watch(const std::shared_ptr<Fence> &fence, int timeout_ms, Callback callback);
+  // On return the callback of id has run. Does not block when called from a callback.
+  void Wait(uint64_t id);
+  // On return the callback of id is neither pending nor running.
+  void Cancel(uint64_t id);
+  void GetStats(HWCFenceWatcherStats *stats);
+  void Dump(std::ostringstream *os);
+
+ private:
+  static const int kMaxEvents = 16;
+
+  struct WatchEntry {
+    std::shared_ptr<Fence> fence;
+    Callback callback;
+    uint64_t start_ns = 0;
+    uint64_t deadline_ns = 0;
+  };
+
+  HWCFenceWatcher();
+  int Init();
+  void Run();
+  void Remove(uint64_t id);
+  int GetTimeoutMs();
+  bool IsPending(uint64_t id) { return watches_.count(id) || running_id_ == id; }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread::id thread_id_;
+  bool initialized_ = false;
+  int epoll_fd_ = -1;
+  int event_fd_ = -1;
+  uint64_t next_id_ = 1;
+  uint64_t running_id_ = 0;
+  std::map<uint64_t, WatchEntry> watches_;
+  std::multimap<int, uint64_t> watches_by_fd_;  // epoll keeps one registration per fd
+  HWCFenceWatcherStats stats_ = {};
+};
+
+}  // namespace sdm
+
+#endif  // __HWC_FENCE_WATCHER_H__
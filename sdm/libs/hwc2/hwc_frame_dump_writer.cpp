@@ -0,0 +1,367 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include "hwc_debugger.h"
+#include "hwc_frame_dump_writer.h"
+
+#define __CLASS__ "HWCFrameDumpWriter"
+
+namespace sdm {
+
+std::atomic<bool> HWCFrameDumpWriter::started_ {false};
+
+HWCFrameDumpWriter *HWCFrameDumpWriter::Get() {
+  // Never destroyed, the writer may still be draining while the process exits.
+  static HWCFrameDumpWriter *frame_dump_writer = new HWCFrameDumpWriter();
+  return frame_dump_writer;
+}
+
+HWCFrameDumpWriter::HWCFrameDumpWriter() : Worker("FrameDumpWriter", kPriority) {
+  int value = 0;
+  HWCDebugHandler::Get()->GetProperty(FRAME_DUMP_ENCODING_PROP, &value);
+  if (value >= kFrameDumpRaw && value <= kFrameDumpDeltaRLE) {
+    encoding_ = static_cast<FrameDumpEncoding>(value);
+  }
+
+  value = 0;
+  HWCDebugHandler::Get()->GetProperty(FRAME_DUMP_STAGING_MB_PROP, &value);
+  max_staging_bytes_ = size_t(value > 0 ? UINT32(value) : kDefaultStagingMB) << 20;
+
+  DLOGI("encoding %s staging %zu MB", GetEncodingString(encoding_), max_staging_bytes_ >> 20);
+  InitWorker();
+  started_ = true;
+}
+
+bool HWCFrameDumpWriter::Enqueue(const FrameDumpInfo &info, const void *data, size_t size) {
+  DumpRequest request;
+  request.info = info;
+  request.size = size;
+
+  Lock();
+  if (requests_.size() >= kMaxQueued || !AcquireStaging(size, &request.buffer)) {
+    stats_.dropped++;
+    uint64_t staging_bytes = stats_.staging_bytes;
+    // Keep a marker for the index file while the queue has room for it.
+    if (requests_.size() < 2 * kMaxQueued) {
+      request.dropped = true;
+      requests_.push_back(std::move(request));
+      Signal();
+    }
+    Unlock();
+    DLOGW("Dropped %s frame %u, %" PRIu64 " bytes of staging memory in use", info.name.c_str(),
+          info.frame_index, staging_bytes);
+    return false;
+  }
+  Unlock();
+
+  // Copy outside of the lock, the writer keeps draining meanwhile.
+  memcpy(request.buffer.data.get(), data, size);
+
+  Lock();
+  stats_.queued++;
+  requests_.push_back(std::move(request));
+  Signal();
+  Unlock();
+
+  return true;
+}
+
+void HWCFrameDumpWriter::EndSession(const std::string &dir_path) {
+  DumpRequest request;
+  request.info.dir_path = dir_path;
+  request.end_session = true;
+
+  Lock();
+  requests_.push_back(std::move(request));
+  Signal();
+  Unlock();
+}
+
+bool HWCFrameDumpWriter::AcquireStaging(size_t size, StagingBuffer *buffer) {
+  auto best = free_buffers_.end();
+  for (auto it = free_buffers_.begin(); it != free_buffers_.end(); it++) {
+    if (it->capacity >= size && (best == free_buffers_.end() || it->capacity < best->capacity)) {
+      best = it;
+    }
+  }
+
+  if (best != free_buffers_.end()) {
+    *buffer = std::move(*best);
+    free_buffers_.erase(best);
+    return true;
+  }
+
+  uint64_t pooled_bytes = 0;
+  for (auto &free_buffer : free_buffers_) {
+    pooled_bytes += free_buffer.capacity;
+  }
+  if (stats_.staging_bytes - pooled_bytes + stats_.reference_bytes + size > max_staging_bytes_) {
+    return false;
+  }
+
+  // None of the pooled buffers fits, give them back to make room for a new one.
+  while (stats_.staging_bytes + stats_.reference_bytes + size > max_staging_bytes_) {
+    stats_.staging_bytes -= free_buffers_.back().capacity;
+    free_buffers_.pop_back();
+  }
+
+  buffer->data.reset(new (std::nothrow) uint8_t[size]);
+  if (!buffer->data) {
+    return false;
+  }
+  buffer->capacity = size;
+  stats_.staging_bytes += size;
+
+  return true;
+}
+
+// Replaces a previous frame of released bytes by one of size bytes, pooled staging buffers are
+// given back if needed. Returns false if the new frame does not fit, the old one is released then.
+bool HWCFrameDumpWriter::ChargeReference(size_t released, size_t size) {
+  stats_.reference_bytes -= released;
+  while (!free_buffers_.empty() &&
+         stats_.staging_bytes + stats_.reference_bytes + size > max_staging_bytes_) {
+    stats_.staging_bytes -= free_buffers_.back().capacity;
+    free_buffers_.pop_back();
+  }
+
+  if (stats_.staging_bytes + stats_.reference_bytes + size > max_staging_bytes_) {
+    return false;
+  }
+  stats_.reference_bytes += size;
+
+  return true;
+}
+
+void HWCFrameDumpWriter::ReleaseSession(const std::string &dir_path) {
+  std::string prefix = dir_path + "/";
+  size_t released = 0;
+  for (auto it = previous_frames_.begin(); it != previous_frames_.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      released += it->second.size();
+      it = previous_frames_.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  Lock();
+  stats_.reference_bytes -= released;
+  // Nothing else is dumping, the staging pool would only sit on memory until the next session.
+  if (previous_frames_.empty() && requests_.empty()) {
+    for (auto &free_buffer : free_buffers_) {
+      stats_.staging_bytes -= free_buffer.capacity;
+    }
+    free_buffers_.clear();
+    free_buffers_.shrink_to_fit();
+  }
+  Unlock();
+}
+
+void HWCFrameDumpWriter::Routine() {
+  Lock();
+  if (requests_.empty() && WaitForSignalOrExitLocked() == -EINTR) {
+    Unlock();
+    return;
+  }
+
+  if (requests_.empty()) {
+    Unlock();
+    return;
+  }
+
+  DumpRequest request = std::move(requests_.front());
+  requests_.pop_front();
+  Unlock();
+
+  if (request.end_session) {
+    ReleaseSession(request.info.dir_path);
+    return;
+  }
+
+  Write(request);
+
+  Lock();
+  if (request.buffer.data) {
+    free_buffers_.push_back(std::move(request.buffer));
+  }
+  Unlock();
+}
+
+void HWCFrameDumpWriter::Write(const DumpRequest &request) {
+  const FrameDumpInfo &info = request.info;
+  FrameDumpEncoding encoding = kFrameDumpRaw;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  size_t result = 0;
+  char dump_file_name[PATH_MAX] = {};
+
+  if (!request.dropped) {
+    data = Encode(request, &encoding, &size);
+    snprintf(dump_file_name, sizeof(dump_file_name), "%s/%s_%ux%u_%s_frame%u.%s",
+             info.dir_path.c_str(), info.name.c_str(), info.width, info.height,
+             info.format.c_str(), info.frame_index, GetEncodingString(encoding));
+
+    FILE *fp = fopen(dump_file_name, "w+");
+    if (fp) {
+      result = fwrite(data, size, 1, fp);
+      fclose(fp);
+    }
+    DLOGI("Frame Dump %s: is %s", dump_file_name, result ? "Successful" : "Failed");
+  }
+
+  std::string index_file_name = info.dir_path + "/frame_dump_index.txt";
+  FILE *index_fp = fopen(index_file_name.c_str(), "a");
+  if (index_fp) {
+    if (ftell(index_fp) == 0) {
+      fprintf(index_fp, "# frame name width height format raw_bytes stored_bytes encoding\n");
+    }
+    fprintf(index_fp, "%u %s %u %u %s %zu %zu %s\n", info.frame_index, info.name.c_str(),
+            info.width, info.height, info.format.c_str(), request.size, result ? size : 0,
+            request.dropped ? "dropped" : (result ? GetEncodingString(encoding) : "failed"));
+    fclose(index_fp);
+  }
+
+  Lock();
+  if (result) {
+    stats_.written++;
+    stats_.raw_bytes += request.size;
+    stats_.stored_bytes += size;
+  } else if (!request.dropped) {
+    stats_.write_errors++;
+  }
+  Unlock();
+}
+
+const uint8_t *HWCFrameDumpWriter::Encode(const DumpRequest &request,
+                                          FrameDumpEncoding *encoding, size_t *size) {
+  const uint8_t *data = request.buffer.data.get();
+  *encoding = encoding_;
+  *size = request.size;
+  if (encoding_ == kFrameDumpRaw) {
+    return data;
+  }
+
+  encoded_.clear();
+  if (encoding_ == kFrameDumpRLE) {
+    PackBits(data, request.size, &encoded_);
+  } else {
+    // Most of a frame is usually unchanged, which XORs to long runs of zero bytes.
+    auto it = previous_frames_.emplace(request.info.dir_path + "/" + request.info.name,
+                                       std::vector<uint8_t>()).first;
+    std::vector<uint8_t> &previous = it->second;
+    if (previous.size() == request.size) {
+      for (size_t i = 0; i < request.size; i++) {
+        previous[i] ^= data[i];
+      }
+      PackBits(previous.data(), request.size, &encoded_);
+      previous.assign(data, data + request.size);
+    } else {
+      // First frame of the stream or a new buffer size, store a key frame.
+      *encoding = kFrameDumpRLE;
+      PackBits(data, request.size, &encoded_);
+
+      Lock();
+      bool charged = ChargeReference(previous.size(), request.size);
+      Unlock();
+      if (charged) {
+        previous = std::vector<uint8_t>(data, data + request.size);
+      } else {
+        // Out of staging memory, the next frame of the stream is a key frame again.
+        previous_frames_.erase(it);
+      }
+    }
+  }
+
+  *size = encoded_.size();
+  return encoded_.data();
+}
+
+// Standard PackBits: a control byte n in [0, 127] is followed by n + 1 literal bytes, a control
+// byte n in [129, 255] is followed by one byte repeated 257 - n times.
+void HWCFrameDumpWriter::PackBits(const uint8_t *data, size_t size, std::vector<uint8_t> *out) {
+  out->reserve(size + size / 128 + 1);
+  size_t i = 0;
+  while (i < size) {
+    size_t run = 1;
+    while (i + run < size && run < 128 && data[i + run] == data[i]) {
+      run++;
+    }
+
+    if (run > 1) {
+      out->push_back(UINT8(257 - run));
+      out->push_back(data[i]);
+      i += run;
+      continue;
+    }
+
+    // Literals up to the next run of three equal bytes.
+    size_t start = i;
+    while (i < size && i - start < 128 &&
+           !(i + 2 < size && data[i] == data[i + 1] && data[i] == data[i + 2])) {
+      i++;
+    }
+    out->push_back(UINT8(i - start - 1));
+    out->insert(out->end(), data + start, data + i);
+  }
+}
+
+const char *HWCFrameDumpWriter::GetEncodingString(FrameDumpEncoding encoding) {
+  switch (encoding) {
+  case kFrameDumpRaw:       return "raw";
+  case kFrameDumpRLE:       return "rle";
+  case kFrameDumpDeltaRLE:  return "drle";
+  default:                  return "invalid";
+  }
+}
+
+void HWCFrameDumpWriter::GetStats(FrameDumpStats *stats) {
+  Lock();
+  *stats = stats_;
+  Unlock();
+}
+
+void HWCFrameDumpWriter::Dump(std::ostringstream *os) {
+  FrameDumpStats stats;
+  GetStats(&stats);
+
+  *os << "\nqueued: " << stats.queued << " written: " << stats.written;
+  *os << " dropped: " << stats.dropped << " errors: " << stats.write_errors;
+  *os << "\nraw(KB): " << (stats.raw_bytes >> 10) << " stored(KB): " << (stats.stored_bytes >> 10);
+  *os << " staging(KB): " << (stats.staging_bytes >> 10);
+  *os << " reference(KB): " << (stats.reference_bytes >> 10);
+}
+
+}  // namespace sdm
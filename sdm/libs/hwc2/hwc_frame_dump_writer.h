@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HWC_FRAME_DUMP_WRITER_H__
+#define __HWC_FRAME_DUMP_WRITER_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "worker.h"
+
+namespace sdm {
+
+enum FrameDumpEncoding {
+  kFrameDumpRaw,       // Plain copy of the buffer.
+  kFrameDumpRLE,       // PackBits run length encoding of the buffer.
+  kFrameDumpDeltaRLE,  // PackBits of the XOR with the previous frame of the same stream.
+};
+
+struct FrameDumpInfo {
+  std::string dir_path;
+  std::string name;      // Stream name, e.g. input_layer0. Deltas are taken per stream.
+  std::string format;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t frame_index = 0;
+};
+
+struct FrameDumpStats {
+  uint64_t queued = 0;
+  uint64_t written = 0;
+  uint64_t dropped = 0;          // Frames not dumped because the staging memory was exhausted.
+  uint64_t write_errors = 0;
+  uint64_t raw_bytes = 0;        // Bytes of the frames written.
+  uint64_t stored_bytes = 0;     // Bytes written to files after encoding.
+  uint64_t staging_bytes = 0;    // Staging memory allocated now, in use or pooled.
+  uint64_t reference_bytes = 0;  // Previous frames kept for delta encoding.
+};
+
+// Writes frame dumps from a background thread. Callers snapshot the buffer into a pooled staging
+// arena of bounded size and return, the writer thread encodes it, writes it and appends a line to
+// the frame_dump_index.txt of the dump directory. A frame that does not fit into the arena is
+// dropped and recorded in the index instead of stalling the caller. Previous frames kept for delta
+// encoding count against the same budget.
+class HWCFrameDumpWriter : public Worker {
+ public:
+  static HWCFrameDumpWriter *Get();
+  static bool IsStarted() { return started_.load(); }
+
+  // Returns false if the frame was dropped.
+  bool Enqueue(const FrameDumpInfo &info, const void *data, size_t size);
+  // Once the frames queued for dir_path are written, drops its previous frames. The staging pool
+  // is freed as well when no other dump is in progress.
+  void EndSession(const std::string &dir_path);
+  void GetStats(FrameDumpStats *stats);
+  void Dump(std::ostringstream *os);
+
+ protected:
+  void Routine() override;
+
+ private:
+  static const int kPriority = 10;  // ANDROID_PRIORITY_BACKGROUND
+  static const uint32_t kMaxQueued = 64;
+  static const uint32_t kDefaultStagingMB = 64;
+
+  struct StagingBuffer {
+    std::unique_ptr<uint8_t[]> data;
+    size_t capacity = 0;
+  };
+
+  struct DumpRequest {
+    FrameDumpInfo info;
+    StagingBuffer buffer;
+    size_t size = 0;
+    bool dropped = false;
+    bool end_session = false;
+  };
+
+  static std::atomic<bool> started_;
+
+  HWCFrameDumpWriter();
+  bool AcquireStaging(size_t size, StagingBuffer *buffer);
+  bool ChargeReference(size_t released, size_t size);
+  void ReleaseSession(const std::string &dir_path);
+  void Write(const DumpRequest &request);
+  const uint8_t *Encode(const DumpRequest &request, FrameDumpEncoding *encoding, size_t *size);
+  static void PackBits(const uint8_t *data, size_t size, std::vector<uint8_t> *out);
+  static const char *GetEncodingString(FrameDumpEncoding encoding);
+
+  FrameDumpEncoding encoding_ = kFrameDumpRaw;
+  size_t max_staging_bytes_ = 0;
+  FrameDumpStats stats_ = {};
+  std::deque<DumpRequest> requests_;
+  std::vector<StagingBuffer> free_buffers_;
+  // Writer thread only.
+  std::map<std::string, std::vector<uint8_t>> previous_frames_;
+  std::vector<uint8_t> encoded_;
+};
+
+}  // namespace sdm
+
+#endif  // __HWC_FRAME_DUMP_WRITER_H__
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <utility>
 #include <cmath>
+#include <cstring>
 #include <qdMetaData.h>
 
 #define __CLASS__ "HWCLayer"
@@ -168,28 +169,30 @@ bool GetSDMColorSpace(const int32_t &dataspace, ColorMetaData *color_metadata) {
 }
 
 // Layer operations
-HWCLayer::HWCLayer(hwc2_display_t display_id, HWCBufferAllocator *buf_allocator)
-  : id_(next_id_++), display_id_(display_id), buffer_allocator_(buf_allocator) {
-  layer_ = new Layer();
+HWCLayer::HWCLayer(hwc2_display_t display_id, HWCBufferAllocator *buf_allocator,
+                   HWCLayerValidationState *validation_state)
+  : id_(next_id_++), display_id_(display_id), buffer_allocator_(buf_allocator),
+    validation_state_(validation_state) {
+  // Seed the fingerprint so that a tracked layer never reports the untracked value of 0.
+  layer_.geometry_fingerprint = UINT64(id_) | (UINT64(1) << 63);
   // Fences are deferred, so the first time this layer is presented, return -1
   // TODO(user): Verify that fences are properly obtained on suspend/resume
-  release_fences_.push_back(-1);
+  release_fences_.push_back(nullptr);
+  UpdateValidationState();
 }
 
 HWCLayer::~HWCLayer() {
-  // Close any fences left for this layer
-  while (!release_fences_.empty()) {
-    ::close(release_fences_.front());
-    release_fences_.pop_front();
-  }
-  if (layer_) {
-    if (layer_->input_buffer.acquire_fence_fd >= 0) {
-      ::close(layer_->input_buffer.acquire_fence_fd);
-    }
-    if (buffer_fd_ >= 0) {
-      ::close(buffer_fd_);
-    }
-    delete layer_;
+  if (validation_state_) {
+    validation_state_->needs_validation -= counted_needs_validation_ ? 1 : 0;
+    validation_state_->client_composition -=
+        (device_selected_ == HWC2::Composition::Client) ? 1 : 0;
+  }
+
+  if (layer_.input_buffer.acquire_fence_fd >= 0) {
+    ::close(layer_.input_buffer.acquire_fence_fd);
+  }
+  if (buffer_fd_ >= 0) {
+    ::close(buffer_fd_);
   }
 }
 
@@ -217,7 +220,7 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
     return HWC2::Error::BadParameter;
   }
 
-  LayerBuffer *layer_buffer = &layer_->input_buffer;
+  LayerBuffer *layer_buffer = &layer_.input_buffer;
   int aligned_width, aligned_height;
   buffer_allocator_->GetCustomWidthAndHeight(handle, &aligned_width, &aligned_height);
 
@@ -225,7 +228,9 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   if ((format != layer_buffer->format) || (UINT32(aligned_width) != layer_buffer->width) ||
       (UINT32(aligned_height) != layer_buffer->height)) {
     // Layer buffer geometry has changed.
-    geometry_changes_ |= kBufferGeometry;
+    AddGeometryChanges(kBufferGeometry);
+    UpdateFingerprint(kFingerprintBufferGeometry, (UINT64(format) << 40) |
+                      (UINT64(aligned_width & 0xfffff) << 20) | UINT64(aligned_height & 0xfffff));
   }
 
   layer_buffer->format = format;
@@ -234,7 +239,7 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   layer_buffer->unaligned_width = UINT32(handle->unaligned_width);
   layer_buffer->unaligned_height = UINT32(handle->unaligned_height);
 
-  if (SetMetaData(const_cast<private_handle_t *>(handle), layer_) != kErrorNone) {
+  if (SetMetaData(const_cast<private_handle_t *>(handle), &layer_) != kErrorNone) {
     return HWC2::Error::BadLayer;
   }
 
@@ -247,12 +252,13 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   if (secure != layer_buffer->flags.secure || secure_camera != layer_buffer->flags.secure_camera ||
       secure_display != layer_buffer->flags.secure_display) {
     // Secure attribute of layer buffer has changed.
-    needs_validate_ = true;
+    SetNeedsValidation();
   }
 
   layer_buffer->flags.secure = secure;
   layer_buffer->flags.secure_camera = secure_camera;
   layer_buffer->flags.secure_display = secure_display;
+  UpdateFingerprint(kFingerprintBufferFlags, layer_buffer->flags.flags);
 
   if (layer_buffer->acquire_fence_fd >= 0) {
     ::close(layer_buffer->acquire_fence_fd);
@@ -269,30 +275,31 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   buffer_flipped_ = reinterpret_cast<uint64_t>(handle) != layer_buffer->buffer_id;
   layer_buffer->buffer_id = reinterpret_cast<uint64_t>(handle);
   layer_buffer->handle_id = handle->id;
+  state_changes_ |= kStateBuffer;
 
   return HWC2::Error::None;
 }
 
 HWC2::Error HWCLayer::SetLayerSurfaceDamage(hwc_region_t damage) {
   // Check if there is an update in SurfaceDamage rects
-  if (layer_->dirty_regions.size() != damage.numRects) {
-    needs_validate_ = true;
+  if (layer_.dirty_regions.size() != damage.numRects) {
+    SetNeedsValidation();
   } else {
     for (uint32_t j = 0; j < damage.numRects; j++) {
       LayerRect damage_rect;
       SetRect(damage.rects[j], &damage_rect);
-      if (damage_rect != layer_->dirty_regions.at(j)) {
-        needs_validate_ = true;
+      if (damage_rect != layer_.dirty_regions.at(j)) {
+        SetNeedsValidation();
         break;
       }
     }
   }
 
-  layer_->dirty_regions.clear();
+  layer_.dirty_regions.clear();
   for (uint32_t i = 0; i < damage.numRects; i++) {
     LayerRect rect;
     SetRect(damage.rects[i], &rect);
-    layer_->dirty_regions.push_back(rect);
+    layer_.dirty_regions.push_back(rect);
   }
   return HWC2::Error::None;
 }
@@ -313,9 +320,10 @@ HWC2::Error HWCLayer::SetLayerBlendMode(HWC2::BlendMode mode) {
       return HWC2::Error::BadParameter;
   }
 
-  if (layer_->blending != blending) {
-    geometry_changes_ |= kBlendMode;
-    layer_->blending = blending;
+  if (layer_.blending != blending) {
+    AddGeometryChanges(kBlendMode);
+    layer_.blending = blending;
+    UpdateFingerprint(kFingerprintBlendMode, blending);
   }
   return HWC2::Error::None;
 }
@@ -324,20 +332,23 @@ HWC2::Error HWCLayer::SetLayerColor(hwc_color_t color) {
   if (client_requested_ != HWC2::Composition::SolidColor) {
     return HWC2::Error::None;
   }
-  if (layer_->solid_fill_color != GetUint32Color(color)) {
-    layer_->solid_fill_color = GetUint32Color(color);
-    needs_validate_ = true;
+  if (layer_.solid_fill_color != GetUint32Color(color)) {
+    layer_.solid_fill_color = GetUint32Color(color);
+    SetNeedsValidation();
+    UpdateFingerprint(kFingerprintColor, layer_.solid_fill_color);
   }
-  layer_->input_buffer.format = kFormatARGB8888;
+  layer_.input_buffer.format = kFormatARGB8888;
   DLOGV_IF(kTagClient, "[%" PRIu64 "][%" PRIu64 "] Layer color set to %x", display_id_, id_,
-           layer_->solid_fill_color);
+           layer_.solid_fill_color);
   return HWC2::Error::None;
 }
 
 HWC2::Error HWCLayer::SetLayerCompositionType(HWC2::Composition type) {
   // Validation is required when the client changes the composition type
   if (client_requested_ != type) {
-    needs_validate_ = true;
+    SetNeedsValidation();
+    state_changes_ |= kStateComposition;
+    UpdateFingerprint(kFingerprintComposition, UINT64(type));
   }
   client_requested_ = type;
   switch (type) {
@@ -359,6 +370,16 @@ HWC2::Error HWCLayer::SetLayerCompositionType(HWC2::Composition type) {
   return HWC2::Error::None;
 }
 
+void HWCLayer::UpdateClientCompositionType(HWC2::Composition type) {
+  // Client accepted the composition selected by SDM. State derived from the requested composition
+  // has to follow it, exactly as for a type set by the client itself.
+  if (client_requested_ != type) {
+    state_changes_ |= kStateComposition;
+    UpdateFingerprint(kFingerprintComposition, UINT64(type));
+  }
+  client_requested_ = type;
+}
+
 HWC2::Error HWCLayer::SetLayerDataspace(int32_t dataspace) {
   // Map deprecated dataspace values to appropriate
   // new enums
@@ -390,8 +411,10 @@ HWC2::Error HWCLayer::SetLayerDataspace(int32_t dataspace) {
 
   // cache the dataspace, to be used later to update SDM ColorMetaData
   if (dataspace_ != dataspace) {
-    geometry_changes_ |= kDataspace;
+    AddGeometryChanges(kDataspace);
+    state_changes_ |= kStateDataspace;
     dataspace_ = dataspace;
+    UpdateFingerprint(kFingerprintDataspace, UINT64(UINT32(dataspace)));
   }
   return HWC2::Error::None;
 }
@@ -401,24 +424,26 @@ HWC2::Error HWCLayer::SetLayerDisplayFrame(hwc_rect_t frame) {
 
   SetRect(frame, &dst_rect);
   if (dst_rect_ != dst_rect) {
-    geometry_changes_ |= kDisplayFrame;
+    AddGeometryChanges(kDisplayFrame);
+    state_changes_ |= kStateGeometry;
     dst_rect_ = dst_rect;
+    UpdateFingerprint(kFingerprintDisplayFrame, dst_rect);
   }
 
   return HWC2::Error::None;
 }
 
 void HWCLayer::ResetPerFrameData() {
-  layer_->dst_rect = dst_rect_;
-  layer_->transform = layer_transform_;
+  layer_.dst_rect = dst_rect_;
+  layer_.transform = layer_transform_;
 }
 
 HWC2::Error HWCLayer::SetCursorPosition(int32_t x, int32_t y) {
   hwc_rect_t frame = {};
   frame.left = x;
   frame.top = y;
-  frame.right = x + INT(layer_->dst_rect.right - layer_->dst_rect.left);
-  frame.bottom = y + INT(layer_->dst_rect.bottom - layer_->dst_rect.top);
+  frame.right = x + INT(layer_.dst_rect.right - layer_.dst_rect.left);
+  frame.bottom = y + INT(layer_.dst_rect.bottom - layer_.dst_rect.top);
   SetLayerDisplayFrame(frame);
 
   return HWC2::Error::None;
@@ -432,9 +457,10 @@ HWC2::Error HWCLayer::SetLayerPlaneAlpha(float alpha) {
   //  Conversion of float alpha in range 0.0 to 1.0 similar to the HWC Adapter
   uint8_t plane_alpha = static_cast<uint8_t>(std::round(255.0f * alpha));
 
-  if (layer_->plane_alpha != plane_alpha) {
-    geometry_changes_ |= kPlaneAlpha;
-    layer_->plane_alpha = plane_alpha;
+  if (layer_.plane_alpha != plane_alpha) {
+    AddGeometryChanges(kPlaneAlpha);
+    layer_.plane_alpha = plane_alpha;
+    UpdateFingerprint(kFingerprintPlaneAlpha, plane_alpha);
   }
 
   return HWC2::Error::None;
@@ -443,16 +469,22 @@ HWC2::Error HWCLayer::SetLayerPlaneAlpha(float alpha) {
 HWC2::Error HWCLayer::SetLayerSourceCrop(hwc_frect_t crop) {
   LayerRect src_rect = {};
   SetRect(crop, &src_rect);
-  non_integral_source_crop_ = ((crop.left != roundf(crop.left)) ||
-                              (crop.top != roundf(crop.top)) ||
-                              (crop.right != roundf(crop.right)) ||
-                              (crop.bottom != roundf(crop.bottom)));
-  if (non_integral_source_crop_) {
+  bool non_integral_source_crop = ((crop.left != roundf(crop.left)) ||
+                                   (crop.top != roundf(crop.top)) ||
+                                   (crop.right != roundf(crop.right)) ||
+                                   (crop.bottom != roundf(crop.bottom)));
+  if (non_integral_source_crop) {
     DLOGV_IF(kTagClient, "Crop: LTRB %f %f %f %f", crop.left, crop.top, crop.right, crop.bottom);
   }
-  if (layer_->src_rect != src_rect) {
-    geometry_changes_ |= kSourceCrop;
-    layer_->src_rect = src_rect;
+  if (non_integral_source_crop_ != non_integral_source_crop) {
+    state_changes_ |= kStateGeometry;
+    non_integral_source_crop_ = non_integral_source_crop;
+  }
+  if (layer_.src_rect != src_rect) {
+    AddGeometryChanges(kSourceCrop);
+    state_changes_ |= kStateGeometry;
+    layer_.src_rect = src_rect;
+    UpdateFingerprint(kFingerprintSourceCrop, src_rect);
   }
 
   return HWC2::Error::None;
@@ -495,19 +527,23 @@ HWC2::Error HWCLayer::SetLayerTransform(HWC2::Transform transform) {
   }
 
   if (layer_transform_ != layer_transform) {
-    geometry_changes_ |= kTransform;
+    AddGeometryChanges(kTransform);
+    state_changes_ |= kStateGeometry;
     layer_transform_ = layer_transform;
+    UpdateFingerprint(kFingerprintTransform, (UINT64(layer_transform.rotation) << 2) |
+                      (UINT64(layer_transform.flip_horizontal) << 1) |
+                      UINT64(layer_transform.flip_vertical));
   }
 
   return HWC2::Error::None;
 }
 
 HWC2::Error HWCLayer::SetLayerVisibleRegion(hwc_region_t visible) {
-  layer_->visible_regions.clear();
+  layer_.visible_regions.clear();
   for (uint32_t i = 0; i < visible.numRects; i++) {
     LayerRect rect;
     SetRect(visible.rects[i], &rect);
-    layer_->visible_regions.push_back(rect);
+    layer_.visible_regions.push_back(rect);
   }
 
   return HWC2::Error::None;
@@ -515,8 +551,9 @@ HWC2::Error HWCLayer::SetLayerVisibleRegion(hwc_region_t visible) {
 
 HWC2::Error HWCLayer::SetLayerZOrder(uint32_t z) {
   if (z_ != z) {
-    geometry_changes_ |= kZOrder;
+    AddGeometryChanges(kZOrder);
     z_ = z;
+    UpdateFingerprint(kFingerprintZOrder, z);
   }
   return HWC2::Error::None;
 }
@@ -524,8 +561,9 @@ HWC2::Error HWCLayer::SetLayerZOrder(uint32_t z) {
 HWC2::Error HWCLayer::SetLayerPerFrameMetadata(uint32_t num_elements,
                                                const PerFrameMetadataKey *keys,
                                                const float *metadata) {
-  auto &mastering_display = layer_->input_buffer.color_metadata.masteringDisplayInfo;
-  auto &content_light = layer_->input_buffer.color_metadata.contentLightLevel;
+  auto &mastering_display = layer_.input_buffer.color_metadata.masteringDisplayInfo;
+  auto &content_light = layer_.input_buffer.color_metadata.contentLightLevel;
+  state_changes_ |= kStateMetadata;
   for (uint32_t i = 0; i < num_elements; i++) {
     switch (keys[i]) {
       case PerFrameMetadataKey::DISPLAY_RED_PRIMARY_X:
@@ -596,149 +634,6 @@ uint32_t HWCLayer::GetUint32Color(const hwc_color_t &source) {
   return color;
 }
 
-LayerBufferFormat HWCLayer::GetSDMFormat(const int32_t &source, const int flags) {
-  LayerBufferFormat format = kFormatInvalid;
-  if (flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED) {
-    switch (source) {
-      case HAL_PIXEL_FORMAT_RGBA_8888:
-        format = kFormatRGBA8888Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBX_8888:
-        format = kFormatRGBX8888Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_BGR_565:
-        format = kFormatBGR565Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
-      case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC:
-      case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
-        format = kFormatYCbCr420SPVenusUbwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBA_1010102:
-        format = kFormatRGBA1010102Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_RGBX_1010102:
-        format = kFormatRGBX1010102Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC:
-        format = kFormatYCbCr420TP10Ubwc;
-        break;
-      case HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC:
-        format = kFormatYCbCr420P010Ubwc;
-        break;
-      default:
-        DLOGE("Unsupported format type for UBWC %d", source);
-        return kFormatInvalid;
-    }
-    return format;
-  }
-
-  switch (source) {
-    case HAL_PIXEL_FORMAT_RGBA_8888:
-      format = kFormatRGBA8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_5551:
-      format = kFormatRGBA5551;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_4444:
-      format = kFormatRGBA4444;
-      break;
-    case HAL_PIXEL_FORMAT_BGRA_8888:
-      format = kFormatBGRA8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGBX_8888:
-      format = kFormatRGBX8888;
-      break;
-    case HAL_PIXEL_FORMAT_BGRX_8888:
-      format = kFormatBGRX8888;
-      break;
-    case HAL_PIXEL_FORMAT_RGB_888:
-      format = kFormatRGB888;
-      break;
-    case HAL_PIXEL_FORMAT_BGR_888:
-      format = kFormatBGR888;
-      break;
-    case HAL_PIXEL_FORMAT_RGB_565:
-      format = kFormatRGB565;
-      break;
-    case HAL_PIXEL_FORMAT_BGR_565:
-      format = kFormatBGR565;
-      break;
-    case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
-      format = kFormatYCbCr420SemiPlanarVenus;
-      break;
-    case HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS:
-      format = kFormatYCrCb420SemiPlanarVenus;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC:
-      format = kFormatYCbCr420SPVenusUbwc;
-      break;
-    case HAL_PIXEL_FORMAT_YV12:
-      format = kFormatYCrCb420PlanarStride16;
-      break;
-    case HAL_PIXEL_FORMAT_YCrCb_420_SP:
-      format = kFormatYCrCb420SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_SP:
-      format = kFormatYCbCr420SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_422_SP:
-      format = kFormatYCbCr422H2V1SemiPlanar;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_422_I:
-      format = kFormatYCbCr422H2V1Packed;
-      break;
-    case HAL_PIXEL_FORMAT_CbYCrY_422_I:
-      format = kFormatCbYCrY422H2V1Packed;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_1010102:
-      format = kFormatRGBA1010102;
-      break;
-    case HAL_PIXEL_FORMAT_ARGB_2101010:
-      format = kFormatARGB2101010;
-      break;
-    case HAL_PIXEL_FORMAT_RGBX_1010102:
-      format = kFormatRGBX1010102;
-      break;
-    case HAL_PIXEL_FORMAT_XRGB_2101010:
-      format = kFormatXRGB2101010;
-      break;
-    case HAL_PIXEL_FORMAT_BGRA_1010102:
-      format = kFormatBGRA1010102;
-      break;
-    case HAL_PIXEL_FORMAT_ABGR_2101010:
-      format = kFormatABGR2101010;
-      break;
-    case HAL_PIXEL_FORMAT_BGRX_1010102:
-      format = kFormatBGRX1010102;
-      break;
-    case HAL_PIXEL_FORMAT_XBGR_2101010:
-      format = kFormatXBGR2101010;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010:
-      format = kFormatYCbCr420P010;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC:
-      format = kFormatYCbCr420TP10Ubwc;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010_UBWC:
-      format = kFormatYCbCr420P010Ubwc;
-      break;
-    case HAL_PIXEL_FORMAT_YCbCr_420_P010_VENUS:
-      format = kFormatYCbCr420P010Venus;
-      break;
-    case HAL_PIXEL_FORMAT_RGBA_FP16:
-      format = kFormatInvalid;
-      break;
-    default:
-      DLOGW("Unsupported format type = %d", source);
-      return kFormatInvalid;
-  }
-
-  return format;
-}
-
 LayerBufferS3DFormat HWCLayer::GetS3DFormat(uint32_t s3d_format) {
   LayerBufferS3DFormat sdm_s3d_format = kS3dFormatNone;
   switch (s3d_format) {
@@ -815,7 +710,7 @@ DisplayError HWCLayer::SetMetaData(const private_handle_t *pvt_handle, Layer *la
   if ((interlace != layer_buffer->flags.interlace) ||
       (frame_rate != layer->frame_rate) || (s3d_format != layer_buffer->s3d_format)) {
     // Layer buffer metadata has changed.
-    needs_validate_ = true;
+    SetNeedsValidation();
     layer->frame_rate = frame_rate;
     layer_buffer->s3d_format = s3d_format;
     layer_buffer->flags.interlace = interlace;
@@ -842,7 +737,7 @@ DisplayError HWCLayer::SetMetaData(const private_handle_t *pvt_handle, Layer *la
 
 
 bool HWCLayer::SupportLocalConversion(ColorPrimaries working_primaries) {
-  if (layer_->input_buffer.color_metadata.colorPrimaries <= ColorPrimaries_BT601_6_525 &&
+  if (layer_.input_buffer.color_metadata.colorPrimaries <= ColorPrimaries_BT601_6_525 &&
       working_primaries <= ColorPrimaries_BT601_6_525) {
     return true;
   }
@@ -857,7 +752,7 @@ bool HWCLayer::ValidateAndSetCSC() {
     return true;
   }
 
-  LayerBuffer *layer_buffer = &layer_->input_buffer;
+  LayerBuffer *layer_buffer = &layer_.input_buffer;
   bool use_color_metadata = true;
 #ifdef FEATURE_WIDE_COLOR
   ColorMetaData csc = {};
@@ -891,6 +786,60 @@ bool HWCLayer::ValidateAndSetCSC() {
   return true;
 }
 
+void HWCLayer::UpdateState() {
+  LayerBuffer *layer_buffer = &layer_.input_buffer;
+
+  // Color space only depends on the buffer and the client attributes, not on the geometry.
+  if (state_changes_ & ~kStateGeometry) {
+    csc_valid_ = ValidateAndSetCSC();
+  }
+
+  state_ = {};
+  if (client_requested_ == HWC2::Composition::Client) {
+    state_.flags.skip = true;
+  } else if (client_requested_ == HWC2::Composition::SolidColor) {
+    state_.flags.solid_fill = true;
+  }
+
+#ifdef FEATURE_WIDE_COLOR
+  if (!csc_valid_) {
+    state_.flags.skip = true;
+  }
+#endif
+
+  const private_handle_t *handle =
+      reinterpret_cast<const private_handle_t *>(layer_buffer->buffer_id);
+  if (handle) {
+    state_.video = (handle->buffer_type == BUFFER_TYPE_VIDEO);
+    // TZ Protected Buffer - L1
+    // Gralloc Usage Protected Buffer - L3 - which needs to be treated as Secure & avoid fallback
+    state_.secure = (handle->flags & private_handle_t::PRIV_FLAGS_PROTECTED_BUFFER ||
+                     handle->flags & private_handle_t::PRIV_FLAGS_SECURE_BUFFER);
+  }
+  state_.secure_display = layer_buffer->flags.secure_display;
+  state_.secure_camera = layer_buffer->flags.secure_camera;
+
+  if (single_buffer_ && !(IsRotationPresent() || IsScalingPresent())) {
+    state_.flags.single_buffer = true;
+  }
+
+  const ColorMetaData &color_metadata = layer_buffer->color_metadata;
+  state_.primaries = color_metadata.colorPrimaries;
+  state_.hdr = color_metadata.colorPrimaries == ColorPrimaries_BT2020 &&
+               (color_metadata.transfer == Transfer_SMPTE_ST2084 ||
+               color_metadata.transfer == Transfer_HLG);
+  state_.extended_range = ((dataspace_ & HAL_DATASPACE_RANGE_MASK) ==
+                           HAL_DATASPACE_RANGE_EXTENDED);
+
+  bool is_secure = state_.secure || state_.secure_display || state_.secure_camera;
+  if (non_integral_source_crop_ && !is_secure && !state_.hdr && !state_.flags.single_buffer &&
+      !state_.flags.solid_fill) {
+    state_.flags.skip = true;
+  }
+
+  state_changes_ = kStateNone;
+  has_state_ = true;
+}
 
 uint32_t HWCLayer::RoundToStandardFPS(float fps) {
   static const uint32_t standard_fps[4] = {24, 30, 48, 60};
@@ -908,6 +857,30 @@ uint32_t HWCLayer::RoundToStandardFPS(float fps) {
   return frame_rate;
 }
 
+void HWCLayer::UpdateFingerprint(FingerprintField field, uint64_t value) {
+  // Mix the value with the field index so that identical values of different attributes do not
+  // cancel out, then swap the contribution of this attribute in the layer fingerprint.
+  uint64_t hash = value + (UINT64(field) + 1) * 0x9e3779b97f4a7c15ULL;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  hash ^= (hash >> 31);
+
+  layer_.geometry_fingerprint ^= fingerprint_[field] ^ hash;
+  fingerprint_[field] = hash;
+}
+
+void HWCLayer::UpdateFingerprint(FingerprintField field, const LayerRect &rect) {
+  uint32_t ltrb[4] = {};
+  std::memcpy(&ltrb[0], &rect.left, sizeof(uint32_t));
+  std::memcpy(&ltrb[1], &rect.top, sizeof(uint32_t));
+  std::memcpy(&ltrb[2], &rect.right, sizeof(uint32_t));
+  std::memcpy(&ltrb[3], &rect.bottom, sizeof(uint32_t));
+
+  uint64_t lt = (UINT64(ltrb[0]) << 32) | ltrb[1];
+  uint64_t rb = (UINT64(ltrb[2]) << 32) | ltrb[3];
+  UpdateFingerprint(field, lt ^ ((rb << 29) | (rb >> 35)));
+}
+
 void HWCLayer::SetComposition(const LayerComposition &sdm_composition) {
   auto hwc_composition = HWC2::Composition::Invalid;
   switch (sdm_composition) {
@@ -922,21 +895,56 @@ void HWCLayer::SetComposition(const LayerComposition &sdm_composition) {
       break;
   }
   // Update solid fill composition
-  if (sdm_composition == kCompositionSDE && layer_->flags.solid_fill != 0) {
+  if (sdm_composition == kCompositionSDE && layer_.flags.solid_fill != 0) {
     hwc_composition = HWC2::Composition::SolidColor;
   }
+  if (validation_state_ && (device_selected_ == HWC2::Composition::Client) !=
+      (hwc_composition == HWC2::Composition::Client)) {
+    validation_state_->client_composition += (hwc_composition == HWC2::Composition::Client) ?
+                                             1 : UINT32(-1);
+  }
   device_selected_ = hwc_composition;
 
   return;
 }
 
-void HWCLayer::PushBackReleaseFence(int32_t fence) {
+void HWCLayer::ResetValidation() {
+  needs_validate_ = false;
+  UpdateValidationState();
+}
+
+void HWCLayer::ResetGeometryChanges() {
+  geometry_changes_ = GeometryChanges::kNone;
+  UpdateValidationState();
+}
+
+void HWCLayer::SetNeedsValidation() {
+  needs_validate_ = true;
+  UpdateValidationState();
+}
+
+void HWCLayer::AddGeometryChanges(uint32_t changes) {
+  geometry_changes_ |= changes;
+  UpdateValidationState();
+}
+
+void HWCLayer::UpdateValidationState() {
+  bool needs_validation = NeedsValidation();
+  if (!validation_state_ || needs_validation == counted_needs_validation_) {
+    return;
+  }
+
+  validation_state_->needs_validation += needs_validation ? 1 : UINT32(-1);
+  counted_needs_validation_ = needs_validation;
+}
+
+void HWCLayer::PushBackReleaseFence(const std::shared_ptr<Fence> &fence) {
   release_fences_.push_back(fence);
 }
 
-int32_t HWCLayer::PopBackReleaseFence() {
+std::shared_ptr<Fence> HWCLayer::PopBackReleaseFence() {
   if (release_fences_.empty())
-    return -1;
+    return nullptr;
 
   auto fence = release_fences_.back();
   release_fences_.pop_back();
@@ -944,9 +952,9 @@ int32_t HWCLayer::PopBackReleaseFence() {
   return fence;
 }
 
-int32_t HWCLayer::PopFrontReleaseFence() {
+std::shared_ptr<Fence> HWCLayer::PopFrontReleaseFence() {
   if (release_fences_.empty())
-    return -1;
+    return nullptr;
 
   auto fence = release_fences_.front();
   release_fences_.pop_front();
@@ -955,25 +963,25 @@ int32_t HWCLayer::PopFrontReleaseFence() {
 }
 
 bool HWCLayer::IsRotationPresent() {
-  return ((layer_->transform.rotation != 0.0f) ||
-         layer_->transform.flip_horizontal ||
-         layer_->transform.flip_vertical);
+  return ((layer_.transform.rotation != 0.0f) ||
+         layer_.transform.flip_horizontal ||
+         layer_.transform.flip_vertical);
 }
 
 bool HWCLayer::IsScalingPresent() {
-  uint32_t src_width  = static_cast<uint32_t>(layer_->src_rect.right - layer_->src_rect.left);
-  uint32_t src_height = static_cast<uint32_t>(layer_->src_rect.bottom - layer_->src_rect.top);
-  uint32_t dst_width  = static_cast<uint32_t>(layer_->dst_rect.right - layer_->dst_rect.left);
-  uint32_t dst_height = static_cast<uint32_t>(layer_->dst_rect.bottom - layer_->dst_rect.top);
+  uint32_t src_width  = static_cast<uint32_t>(layer_.src_rect.right - layer_.src_rect.left);
+  uint32_t src_height = static_cast<uint32_t>(layer_.src_rect.bottom - layer_.src_rect.top);
+  uint32_t dst_width  = static_cast<uint32_t>(layer_.dst_rect.right - layer_.dst_rect.left);
+  uint32_t dst_height = static_cast<uint32_t>(layer_.dst_rect.bottom - layer_.dst_rect.top);
 
   return ((src_width != dst_width) || (dst_height != src_height));
 }
 
 float HWCLayer::GetScaleFactor() {
-  uint32_t src_width  = UINT32(layer_->src_rect.right - layer_->src_rect.left);
-  uint32_t src_height = UINT32(layer_->src_rect.bottom - layer_->src_rect.top);
-  uint32_t dst_width  = UINT32(layer_->dst_rect.right - layer_->dst_rect.left);
-  uint32_t dst_height = UINT32(layer_->dst_rect.bottom - layer_->dst_rect.top);
+  uint32_t src_width  = UINT32(layer_.src_rect.right - layer_.src_rect.left);
+  uint32_t src_height = UINT32(layer_.src_rect.bottom - layer_.src_rect.top);
+  uint32_t dst_width  = UINT32(layer_.dst_rect.right - layer_.dst_rect.left);
+  uint32_t dst_height = UINT32(layer_.dst_rect.bottom - layer_.dst_rect.top);
   if ((dst_width < src_width) || (dst_height < src_height)) {
     return (std::min(dst_width/src_width, dst_height/src_height));
   }
@@ -26,6 +26,7 @@
 #include <gralloc_priv.h>
 #include <qdMetaData.h>
 #include <core/layer_stack.h>
+#include <utils/fence.h>
 #define HWC2_INCLUDE_STRINGIFICATION
 #define HWC2_USE_CPP11
 #include <hardware/hwcomposer2.h>
@@ -34,6 +35,7 @@
 #include <android/hardware/graphics/composer/2.2/IComposerClient.h>
 #include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include "core/buffer_allocator.h"
 #include "hwc_buffer_allocator.h"
@@ -63,13 +65,45 @@ enum GeometryChanges {
   kBufferGeometry = 0x200,
 };
 
+// Client attributes which the cached state of a layer is derived from.
+enum LayerStateChanges {
+  kStateNone        = 0x00,
+  kStateBuffer      = 0x01,
+  kStateComposition = 0x02,
+  kStateDataspace   = 0x04,
+  kStateGeometry    = 0x08,
+  kStateMetadata    = 0x10,
+  kStateAll         = 0x1f,
+};
+
+// Layer stack attributes derived from the client state of a layer. These are refreshed only when
+// the layer changes, instead of on every layer stack build.
+struct HWCLayerState {
+  LayerFlags flags = {};  // skip, solid_fill and single_buffer flags
+  ColorPrimaries primaries = ColorPrimaries_BT709_5;
+  bool video = false;
+  bool secure = false;    // Protected or secure buffer
+  bool secure_camera = false;
+  bool secure_display = false;
+  bool hdr = false;       // HDR content, honored only if the display handles HDR
+  bool extended_range = false;
+};
+
+// Validation state aggregated over the layers of a display. Maintained by the layers as their
+// state changes, so that the display can decide to skip validation without visiting each layer.
+struct HWCLayerValidationState {
+  uint32_t needs_validation = 0;    // Layers which need validation
+  uint32_t client_composition = 0;  // Layers selected for client composition
+};
+
 class HWCLayer {
  public:
-  explicit HWCLayer(hwc2_display_t display_id, HWCBufferAllocator *buf_allocator);
+  HWCLayer(hwc2_display_t display_id, HWCBufferAllocator *buf_allocator,
+           HWCLayerValidationState *validation_state = nullptr);
   ~HWCLayer();
   uint32_t GetZ() const { return z_; }
   hwc2_layer_t GetId() const { return id_; }
-  Layer *GetSDMLayer() { return layer_; }
+  Layer *GetSDMLayer() { return &layer_; }
   void ResetPerFrameData();
 
   HWC2::Error SetLayerBlendMode(HWC2::BlendMode mode);
@@ -89,17 +123,17 @@ class HWCLayer {
   HWC2::Error SetLayerZOrder(uint32_t z);
   void SetComposition(const LayerComposition &sdm_composition);
   HWC2::Composition GetClientRequestedCompositionType() { return client_requested_; }
-  void UpdateClientCompositionType(HWC2::Composition type) { client_requested_ = type; }
+  void UpdateClientCompositionType(HWC2::Composition type);
   HWC2::Composition GetDeviceSelectedCompositionType() { return device_selected_; }
   int32_t GetLayerDataspace() { return dataspace_; }
   uint32_t GetGeometryChanges() { return geometry_changes_; }
-  void ResetGeometryChanges() { geometry_changes_ = GeometryChanges::kNone; }
-  void PushBackReleaseFence(int32_t fence);
-  int32_t PopBackReleaseFence(void);
-  int32_t PopFrontReleaseFence(void);
+  void ResetGeometryChanges();
+  void PushBackReleaseFence(const std::shared_ptr<Fence> &fence);
+  std::shared_ptr<Fence> PopBackReleaseFence(void);
+  std::shared_ptr<Fence> PopFrontReleaseFence(void);
   bool ValidateAndSetCSC();
   bool SupportLocalConversion(ColorPrimaries working_primaries);
-  void ResetValidation() { needs_validate_ = false; }
+  void ResetValidation();
   bool NeedsValidation() { return (needs_validate_ || geometry_changes_); }
   bool IsSingleBuffered() { return single_buffer_; }
   bool IsScalingPresent();
@@ -109,14 +143,34 @@ class HWCLayer {
   bool HasMetaDataRefreshRate() { return has_metadata_refresh_rate_; }
   bool BufferLatched() { return buffer_flipped_; }
   void ResetBufferFlip() { buffer_flipped_ = false; }
+  bool IsStateDirty() { return (state_changes_ != kStateNone); }
+  bool HasState() { return has_state_; }
+  const HWCLayerState &GetState() { return state_; }
+  void UpdateState();
 
  private:
-  Layer *layer_ = nullptr;
+  // Attributes which contribute to the geometry fingerprint of the SDM layer.
+  enum FingerprintField {
+    kFingerprintBlendMode,
+    kFingerprintDataspace,
+    kFingerprintDisplayFrame,
+    kFingerprintPlaneAlpha,
+    kFingerprintSourceCrop,
+    kFingerprintTransform,
+    kFingerprintZOrder,
+    kFingerprintBufferGeometry,
+    kFingerprintBufferFlags,
+    kFingerprintComposition,
+    kFingerprintColor,
+    kFingerprintMax,
+  };
+
+  Layer layer_ = {};  // Kept inline to avoid a separate allocation per layer
   uint32_t z_ = 0;
   const hwc2_layer_t id_;
   const hwc2_display_t display_id_;
   static std::atomic<hwc2_layer_t> next_id_;
-  std::deque<int32_t> release_fences_;
+  std::deque<std::shared_ptr<Fence>> release_fences_;
   HWCBufferAllocator *buffer_allocator_ = NULL;
   int32_t dataspace_ =  HAL_DATASPACE_UNKNOWN;
   LayerTransform layer_transform_ = {};
@@ -133,15 +187,26 @@ class HWCLayer {
   // Composition selected by SDM
   HWC2::Composition device_selected_ = HWC2::Composition::Device;
   uint32_t geometry_changes_ = GeometryChanges::kNone;
+  uint64_t fingerprint_[kFingerprintMax] = {};
+  HWCLayerValidationState *validation_state_ = nullptr;
+  bool counted_needs_validation_ = false;
+  uint32_t state_changes_ = kStateAll;
+  HWCLayerState state_ = {};
+  bool has_state_ = false;
+  bool csc_valid_ = true;
 
   void SetRect(const hwc_rect_t &source, LayerRect *target);
   void SetRect(const hwc_frect_t &source, LayerRect *target);
   uint32_t GetUint32Color(const hwc_color_t &source);
-  LayerBufferFormat GetSDMFormat(const int32_t &source, const int flags);
   LayerBufferS3DFormat GetS3DFormat(uint32_t s3d_format);
   void GetUBWCStatsFromMetaData(UBWCStats *cr_stats, UbwcCrStatsVector *cr_vec);
   DisplayError SetMetaData(const private_handle_t *pvt_handle, Layer *layer);
   uint32_t RoundToStandardFPS(float fps);
+  void UpdateFingerprint(FingerprintField field, uint64_t value);
+  void UpdateFingerprint(FingerprintField field, const LayerRect &rect);
+  void SetNeedsValidation();
+  void AddGeometryChanges(uint32_t changes);
+  void UpdateValidationState();
 };
 
 struct SortLayersByZ {
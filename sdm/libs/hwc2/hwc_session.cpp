@@ -26,6 +26,7 @@
 #include <hardware_legacy/uevent.h>
 #include <sys/resource.h>
 #include <sys/prctl.h>
+#include <unistd.h>
 #include <binder/Parcel.h>
 #include <QService.h>
 #include <utils/debug.h>
@@ -453,6 +454,7 @@ int HWCSession::Init() {
   }
 
   StartServices();
+  HWCDebugHandler::InitTraceBuffer();
 
   g_hwc_uevent_.Register(this);
 
@@ -1824,6 +1826,22 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       status = GetSupportedDsiClk(input_parcel, output_parcel);
       break;
 
+    case qService::IQService::GET_FRAME_STATS:
+      if (!input_parcel || !output_parcel) {
+        DLOGE("QService command = %d: input_parcel and output_parcel needed.", command);
+        break;
+      }
+      status = GetFrameStats(input_parcel, output_parcel);
+      break;
+
+    case qService::IQService::DUMP_TRACE_BUFFER:
+      if (!input_parcel || !output_parcel) {
+        DLOGE("QService command = %d: input_parcel and output_parcel needed.", command);
+        break;
+      }
+      status = DumpTraceBuffer(input_parcel, output_parcel);
+      break;
+
     default:
       DLOGW("QService command = %d is not supported.", command);
       break;
@@ -2362,6 +2380,77 @@ android::status_t HWCSession::GetSupportedDsiClk(const android::Parcel *input_pa
   return 0;
 }
 
+android::status_t HWCSession::GetFrameStats(const android::Parcel *input_parcel,
+                                            android::Parcel *output_parcel) {
+  int disp_id = input_parcel->readInt32();
+  bool reset = (input_parcel->readInt32() != 0);
+  if (disp_id < 0 || disp_id >= HWCCallbacks::kNumDisplays) {
+    return -EINVAL;
+  }
+
+  FrameStatsSnapshot snapshot;
+  {
+    SCOPE_LOCK(locker_[disp_id]);
+    if (!hwc_display_[disp_id]) {
+      return -EINVAL;
+    }
+
+    DisplayError error = hwc_display_[disp_id]->GetFrameStats(&snapshot, reset);
+    if (error != kErrorNone) {
+      return -EINVAL;
+    }
+  }
+
+  // Durations are reported in nanoseconds.
+  output_parcel->writeUint64(snapshot.frames);
+  output_parcel->writeInt32(kStageMax);
+  for (int stage = 0; stage < kStageMax; stage++) {
+    const FrameStageSummary &summary = snapshot.stages[stage];
+    output_parcel->writeCString(FrameStats::GetStageName(static_cast<FrameStage>(stage)));
+    output_parcel->writeUint64(summary.count);
+    output_parcel->writeUint64(summary.mean_ns);
+    output_parcel->writeUint64(summary.p50_ns);
+    output_parcel->writeUint64(summary.p90_ns);
+    output_parcel->writeUint64(summary.p99_ns);
+    output_parcel->writeUint64(summary.max_ns);
+  }
+
+  output_parcel->writeInt32(INT32(FrameStatsSnapshot::kMaxRetries + 1));
+  for (auto &retries : snapshot.retries) {
+    output_parcel->writeUint64(retries);
+  }
+
+  return 0;
+}
+
+android::status_t HWCSession::DumpTraceBuffer(const android::Parcel *input_parcel,
+                                              android::Parcel *output_parcel) {
+  // 0 writes a Chrome trace JSON file, 1 a raw dump for the sdm_trace_decode tool.
+  bool raw = (input_parcel->readInt32() == 1);
+  TraceBuffer *trace_buffer = HWCDebugHandler::GetTraceBuffer();
+  if (!trace_buffer->IsEnabled()) {
+    DLOGW("Trace buffer is disabled, set %s", TRACE_BUFFER_EVENTS_PROP);
+    return -EINVAL;
+  }
+
+  std::vector<TraceEvent> events;
+  trace_buffer->GetEvents(&events);
+
+  std::string file_name = std::string(HWCDebugHandler::DumpDir()) +
+                          (raw ? "/sdm_trace.bin" : "/sdm_trace.json");
+  DisplayError error = raw ? TraceBuffer::WriteRaw(file_name.c_str(), events) :
+                       TraceBuffer::WriteChromeJson(file_name.c_str(), events, getpid());
+  if (error != kErrorNone) {
+    return -EINVAL;
+  }
+
+  DLOGI("Wrote %zu trace events to %s", events.size(), file_name.c_str());
+  output_parcel->writeInt32(INT32(events.size()));
+  output_parcel->writeCString(file_name.c_str());
+
+  return 0;
+}
+
 void HWCSession::UEventHandler(const char *uevent_data, int length) {
   if (strcasestr(uevent_data, HWC_UEVENT_GRAPHICS_FB0)) {
     DLOGI("Uevent FB0 = %s", uevent_data);
@@ -347,6 +347,10 @@ class HWCSession : hwc2_device_t, HWCUEventListener, public qClient::BnQClient,
   android::status_t GetDsiClk(const android::Parcel *input_parcel, android::Parcel *output_parcel);
   android::status_t GetSupportedDsiClk(const android::Parcel *input_parcel,
                                        android::Parcel *output_parcel);
+  android::status_t GetFrameStats(const android::Parcel *input_parcel,
+                                  android::Parcel *output_parcel);
+  android::status_t DumpTraceBuffer(const android::Parcel *input_parcel,
+                                    android::Parcel *output_parcel);
 
   void Refresh(hwc2_display_t display);
   void HotPlug(hwc2_display_t display, HWC2::Connection state);
@@ -122,9 +122,7 @@ DisplayError ToneMapSession::AllocateIntermediateBuffers(const Layer *layer) {
 void ToneMapSession::FreeIntermediateBuffers() {
   for (uint8_t i = 0; i < kNumIntermediateBuffers; i++) {
     // Free the valid fence
-    if (release_fence_fd_[i] >= 0) {
-      CloseFd(&release_fence_fd_[i]);
-    }
+    release_fence_[i] = nullptr;
     BufferInfo &buffer_info = buffer_info_[i];
     if (buffer_info.private_data) {
       buffer_allocator_->FreeBuffer(&buffer_info);
@@ -141,10 +139,9 @@ void ToneMapSession::UpdateBuffer(int acquire_fence, LayerBuffer *buffer) {
   buffer->handle_id = buffer_info_[current_buffer_index_].alloc_buffer_info.id;
 }
 
-void ToneMapSession::SetReleaseFence(int fd) {
-  CloseFd(&release_fence_fd_[current_buffer_index_]);
+void ToneMapSession::SetReleaseFence(const std::shared_ptr<Fence> &fence) {
   // Used to give to GPU tonemapper along with input layer fd
-  release_fence_fd_[current_buffer_index_] = dup(fd);
+  release_fence_[current_buffer_index_] = fence;
 }
 
 void ToneMapSession::SetToneMapConfig(Layer *layer, PrimariesTransfer blend_cs) {
@@ -236,19 +233,17 @@ void HWCToneMapper::ToneMap(Layer* layer, ToneMapSession *session) {
   ctx.layer = layer;
 
   uint8_t buffer_index = session->current_buffer_index_;
-  int &release_fence_fd = session->release_fence_fd_[buffer_index];
+  std::shared_ptr<Fence> &release_fence = session->release_fence_[buffer_index];
 
   // use and close the layer->input_buffer acquire fence fd.
   int acquire_fd = layer->input_buffer.acquire_fence_fd;
-  buffer_sync_handler_.SyncMerge(release_fence_fd, acquire_fd, &ctx.merged_fd);
+  buffer_sync_handler_.SyncMerge(FenceManager::Get(release_fence), acquire_fd, &ctx.merged_fd);
 
   if (acquire_fd >= 0) {
     CloseFd(&acquire_fd);
   }
 
-  if (release_fence_fd >= 0) {
-    CloseFd(&release_fence_fd);
-  }
+  release_fence = nullptr;
 
   DTRACE_BEGIN("GPU_TM_BLIT");
   session->tone_map_task_.PerformTask(ToneMapTaskCode::kCodeBlit, &ctx);
@@ -268,7 +263,7 @@ void HWCToneMapper::PostCommit(LayerStack *layer_stack) {
       // Close the fd returned by GPU ToneMapper and set release fence.
       LayerBuffer &layer_buffer = layer->input_buffer;
       CloseFd(&layer_buffer.acquire_fence_fd);
-      session->SetReleaseFence(layer_buffer.release_fence_fd);
+      session->SetReleaseFence(layer_buffer.release_fence);
       session->acquired_ = false;
       it++;
     } else {
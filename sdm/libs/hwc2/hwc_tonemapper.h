@@ -36,8 +36,10 @@
 #include <hardware/hwcomposer.h>
 
 #include <core/layer_stack.h>
+#include <utils/fence.h>
 #include <utils/sys.h>
 #include <utils/sync_task.h>
+#include <memory>
 #include <vector>
 #include "hwc_buffer_sync_handler.h"
 #include "hwc_buffer_allocator.h"
@@ -77,7 +79,7 @@ class ToneMapSession : public SyncTask<ToneMapTaskCode>::TaskHandler {
   DisplayError AllocateIntermediateBuffers(const Layer *layer);
   void FreeIntermediateBuffers();
   void UpdateBuffer(int acquire_fence, LayerBuffer *buffer);
-  void SetReleaseFence(int fd);
+  void SetReleaseFence(const std::shared_ptr<Fence> &fence);
   void SetToneMapConfig(Layer *layer, PrimariesTransfer blend_cs);
   bool IsSameToneMapConfig(Layer *layer, PrimariesTransfer blend_cs);
 
@@ -92,7 +94,7 @@ class ToneMapSession : public SyncTask<ToneMapTaskCode>::TaskHandler {
   ToneMapConfig tone_map_config_ = {};
   uint8_t current_buffer_index_ = 0;
   std::vector<BufferInfo> buffer_info_ = {};
-  int release_fence_fd_[kNumIntermediateBuffers] = {-1, -1};
+  std::shared_ptr<Fence> release_fence_[kNumIntermediateBuffers];
   bool acquired_ = false;
   int layer_index_ = -1;
 };
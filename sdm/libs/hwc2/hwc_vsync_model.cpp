@@ -0,0 +1,300 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/frame_stats.h>
+#include <algorithm>
+#include <utility>
+
+#include "hwc_vsync_model.h"
+
+#define __CLASS__ "HWCVsyncModel"
+
+namespace sdm {
+
+void HWCVsyncModel::Reset(int64_t period_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nominal_period_ns_ = period_ns;
+  num_samples_ = 0;
+  next_sample_ = 0;
+  valid_ = false;
+  resync_ = false;
+  period_ns_ = 0;
+  max_residual_ns_ = 0;
+  retire_offset_ns_ = 0;
+  num_offset_samples_ = 0;
+}
+
+void HWCVsyncModel::SetErrorThreshold(int64_t error_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  error_threshold_ns_ = error_ns;
+}
+
+void HWCVsyncModel::AddVsync(int64_t timestamp_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AddSample(timestamp_ns);
+  Fit();
+  if (valid_) {
+    resync_ = false;
+    last_verified_ns_ = timestamp_ns;
+  }
+}
+
+void HWCVsyncModel::AddRetire(int64_t timestamp_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!valid_ || resync_) {
+    return;
+  }
+
+  int64_t error_ns = GetPhaseError(timestamp_ns);
+  if (num_offset_samples_ < kMinOffsetSamples) {
+    retire_offset_ns_ = (retire_offset_ns_ * num_offset_samples_ + error_ns) /
+                        (num_offset_samples_ + 1);
+    num_offset_samples_++;
+    return;
+  }
+
+  int64_t miss_ns = GetPhaseError(timestamp_ns - retire_offset_ns_);
+  max_retire_error_ns_ = std::max(max_retire_error_ns_, std::abs(miss_ns));
+  if (std::abs(miss_ns) > error_threshold_ns_) {
+    DLOGI_IF(kTagDisplay, "Retire fence missed prediction by %" PRId64 " ns", miss_ns);
+    resync_ = true;
+    num_resyncs_++;
+    return;
+  }
+
+  // Let the offset follow slow drift, the sample itself corrects the fit.
+  retire_offset_ns_ += miss_ns / 8;
+  AddSample(timestamp_ns - retire_offset_ns_);
+  Fit();
+  if (valid_) {
+    last_verified_ns_ = timestamp_ns;
+  } else {
+    num_resyncs_++;
+  }
+}
+
+bool HWCVsyncModel::NeedsResync(int64_t now_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !valid_ || resync_ || (now_ns - last_verified_ns_ > kMaxUnverifiedNs);
+}
+
+bool HWCVsyncModel::GetNextVsync(int64_t time_ns, int64_t *vsync_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!valid_) {
+    return false;
+  }
+
+  int64_t delta_ns = time_ns - phase_ns_;
+  int64_t count = delta_ns / period_ns_;
+  if (delta_ns < 0 && (delta_ns % period_ns_)) {
+    count--;  // Round towards negative infinity.
+  }
+  *vsync_ns = phase_ns_ + (count + 1) * period_ns_;
+
+  return true;
+}
+
+int64_t HWCVsyncModel::GetPeriod() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return valid_ ? period_ns_ : 0;
+}
+
+void HWCVsyncModel::AddSample(int64_t timestamp_ns) {
+  if (num_samples_) {
+    int64_t last_ns = samples_[(next_sample_ + kMaxSamples - 1) % kMaxSamples];
+    // Drop late samples and a second sample of the same vsync.
+    if (timestamp_ns - last_ns < nominal_period_ns_ / 2) {
+      return;
+    }
+  }
+
+  samples_[next_sample_] = timestamp_ns;
+  next_sample_ = (next_sample_ + 1) % kMaxSamples;
+  if (num_samples_ < kMaxSamples) {
+    num_samples_++;
+  }
+}
+
+void HWCVsyncModel::Fit() {
+  valid_ = false;
+  if (num_samples_ < kMinSamples || nominal_period_ns_ <= 0) {
+    return;
+  }
+
+  // Samples are numbered by their vsync count relative to the newest one, and fitted as
+  // t = phase + count * period. Relative times keep the doubles exact.
+  int64_t reference_ns = samples_[(next_sample_ + kMaxSamples - 1) % kMaxSamples];
+  double counts[kMaxSamples] = {};
+  double times[kMaxSamples] = {};
+  double mean_count = 0.0;
+  double mean_time = 0.0;
+  for (uint32_t i = 0; i < num_samples_; i++) {
+    times[i] = static_cast<double>(samples_[i] - reference_ns);
+    counts[i] = round(times[i] / static_cast<double>(nominal_period_ns_));
+    mean_count += counts[i];
+    mean_time += times[i];
+  }
+  mean_count /= num_samples_;
+  mean_time /= num_samples_;
+
+  double covariance = 0.0;
+  double variance = 0.0;
+  for (uint32_t i = 0; i < num_samples_; i++) {
+    covariance += (counts[i] - mean_count) * (times[i] - mean_time);
+    variance += (counts[i] - mean_count) * (counts[i] - mean_count);
+  }
+  if (variance == 0.0) {
+    return;
+  }
+
+  double period = covariance / variance;
+  double phase = mean_time - period * mean_count;
+  double max_residual = 0.0;
+  for (uint32_t i = 0; i < num_samples_; i++) {
+    max_residual = std::max(max_residual, fabs(times[i] - (phase + period * counts[i])));
+  }
+
+  period_ns_ = llround(period);
+  phase_ns_ = reference_ns + llround(phase);
+  max_residual_ns_ = llround(max_residual);
+
+  // A period far off the nominal one means the refresh rate changed underneath the model.
+  if (std::abs(period_ns_ - nominal_period_ns_) > nominal_period_ns_ / 10 ||
+      max_residual_ns_ > error_threshold_ns_) {
+    return;
+  }
+
+  valid_ = true;
+}
+
+int64_t HWCVsyncModel::GetPhaseError(int64_t timestamp_ns) {
+  int64_t error_ns = (timestamp_ns - phase_ns_) % period_ns_;
+  if (error_ns < 0) {
+    error_ns += period_ns_;
+  }
+  if (error_ns > period_ns_ / 2) {
+    error_ns -= period_ns_;
+  }
+
+  return error_ns;
+}
+
+void HWCVsyncModel::Dump(std::ostringstream *os) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *os << "valid: " << valid_ << " resync: " << resync_;
+  *os << " period(ns): " << period_ns_ << " nominal(ns): " << nominal_period_ns_;
+  *os << " max residual(ns): " << max_residual_ns_;
+  *os << " retire offset(ns): " << retire_offset_ns_;
+  *os << " max retire error(ns): " << max_retire_error_ns_;
+  *os << " resyncs: " << num_resyncs_ << std::endl;
+}
+
+#undef __CLASS__
+#define __CLASS__ "HWCSoftVsync"
+
+HWCSoftVsync *HWCSoftVsync::Get() {
+  // Never destroyed, like the other hwc2 worker threads.
+  static HWCSoftVsync *soft_vsync = new HWCSoftVsync();
+  return soft_vsync;
+}
+
+HWCSoftVsync::HWCSoftVsync() : Worker("SoftVsync", kThreadPriorityUrgent) {
+  InitWorker();
+}
+
+void HWCSoftVsync::Add(uint64_t id, Tick tick) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Client &client = clients_[id];
+  client.tick = std::move(tick);
+  client.next_ns = 0;
+  client.generation = ++generation_;
+  Signal();
+}
+
+void HWCSoftVsync::Remove(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients_.erase(id);
+  Signal();
+}
+
+void HWCSoftVsync::Wait(uint64_t id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (std::this_thread::get_id() == thread_id_) {
+    DLOGE("Called from a tick of client %" PRIu64, running_id_);
+    return;
+  }
+
+  cond_.wait(lock, [this, id]() { return !running_ || running_id_ != id; });
+}
+
+void HWCSoftVsync::Routine() {
+  Lock();
+  thread_id_ = std::this_thread::get_id();
+  auto next = std::min_element(clients_.begin(), clients_.end(), [](auto &a, auto &b) {
+    return a.second.next_ns < b.second.next_ns;
+  });
+  if (next == clients_.end()) {
+    WaitForSignalOrExitLocked();
+    Unlock();
+    return;
+  }
+
+  int64_t now_ns = static_cast<int64_t>(FrameStats::GetTimeNs());
+  if (next->second.next_ns > now_ns) {
+    WaitForSignalOrExitLocked(next->second.next_ns - now_ns);
+    Unlock();
+    return;
+  }
+
+  uint64_t id = next->first;
+  uint64_t generation = next->second.generation;
+  Tick tick = next->second.tick;
+  running_ = true;
+  running_id_ = id;
+  Unlock();
+
+  int64_t next_ns = 0;
+  bool keep = tick(now_ns, &next_ns);
+
+  Lock();
+  running_ = false;
+  // Removed or added again while the tick was running.
+  auto client = clients_.find(id);
+  if (client != clients_.end() && client->second.generation == generation) {
+    if (keep) {
+      client->second.next_ns = next_ns;
+    } else {
+      clients_.erase(client);
+    }
+  }
+  Unlock();
+  Signal();
+}
+
+}  // namespace sdm
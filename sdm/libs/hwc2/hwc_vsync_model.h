@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HWC_VSYNC_MODEL_H__
+#define __HWC_VSYNC_MODEL_H__
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "worker.h"
+
+namespace sdm {
+
+// Predicts vsync timestamps of a display from recent hardware vsync and retire fence timestamps.
+// Period and phase are fitted by least squares over the most recent samples. Retire fences signal
+// at a fixed offset from vsync, the offset is learnt while the model is verified and removed before
+// their timestamps are used. A retire timestamp that misses the prediction by more than the error
+// threshold marks the model for resynchronization with hardware vsync.
+class HWCVsyncModel {
+ public:
+  // Drops all samples, e.g. after a refresh rate switch, the model is invalid until refitted.
+  void Reset(int64_t period_ns);
+  void SetErrorThreshold(int64_t error_ns);
+  void AddVsync(int64_t timestamp_ns);
+  void AddRetire(int64_t timestamp_ns);
+  // True when the model is not fitted, missed a retire fence or was not verified for too long.
+  bool NeedsResync(int64_t now_ns);
+  // First predicted vsync after time_ns. Returns false when the model is not fitted.
+  bool GetNextVsync(int64_t time_ns, int64_t *vsync_ns);
+  // Fitted period, 0 when the model is not fitted.
+  int64_t GetPeriod();
+  void Dump(std::ostringstream *os);
+
+ private:
+  static const uint32_t kMaxSamples = 32;
+  static const uint32_t kMinSamples = 8;
+  static const uint32_t kMinOffsetSamples = 4;
+  static const int64_t kDefaultErrorNs = 500000;
+  static const int64_t kMaxUnverifiedNs = 1000000000;
+
+  void AddSample(int64_t timestamp_ns);
+  void Fit();
+  // Distance of timestamp_ns from the closest predicted vsync, in (-period / 2, period / 2].
+  int64_t GetPhaseError(int64_t timestamp_ns);
+
+  std::mutex mutex_;
+  int64_t nominal_period_ns_ = 0;
+  int64_t error_threshold_ns_ = kDefaultErrorNs;
+  int64_t samples_[kMaxSamples] = {};
+  uint32_t num_samples_ = 0;
+  uint32_t next_sample_ = 0;
+  bool valid_ = false;
+  bool resync_ = false;
+  int64_t period_ns_ = 0;
+  int64_t phase_ns_ = 0;  // Timestamp of one predicted vsync.
+  int64_t max_residual_ns_ = 0;
+  int64_t retire_offset_ns_ = 0;
+  uint32_t num_offset_samples_ = 0;
+  int64_t last_verified_ns_ = 0;
+  uint64_t num_resyncs_ = 0;
+  int64_t max_retire_error_ns_ = 0;
+};
+
+// Serves predicted vsync callbacks of all displays from one timer thread. Each client is ticked
+// at the deadline it returned from its previous tick, a tick returning false removes the client.
+// Every Add() starts a new generation of the client, the result of a tick which was running for
+// an earlier generation is dropped.
+class HWCSoftVsync : public Worker {
+ public:
+  // Returns false to stop ticking, otherwise the time of the next tick in next_ns.
+  typedef std::function<bool(int64_t now_ns, int64_t *next_ns)> Tick;
+
+  static HWCSoftVsync *Get();
+  // The first tick runs right away.
+  void Add(uint64_t id, Tick tick);
+  // On return the tick of id is no longer scheduled. A tick already running is not waited for,
+  // the tick has to drop its own stale callbacks.
+  void Remove(uint64_t id);
+  // Waits till no tick of id is running, e.g. before the state used by the tick is destroyed.
+  // Must not be called from a tick.
+  void Wait(uint64_t id);
+
+ protected:
+  void Routine() override;
+
+ private:
+  struct Client {
+    Tick tick;
+    int64_t next_ns = 0;
+    uint64_t generation = 0;
+  };
+
+  HWCSoftVsync();
+
+  std::map<uint64_t, Client> clients_;
+  uint64_t generation_ = 0;
+  uint64_t running_id_ = 0;
+  bool running_ = false;
+  std::thread::id thread_id_;
+};
+
+}  // namespace sdm
+
+#endif  // __HWC_VSYNC_MODEL_H__
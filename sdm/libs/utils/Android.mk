@@ -12,7 +12,11 @@ LOCAL_SRC_FILES               := debug.cpp \
                                  rect.cpp \
                                  sys.cpp \
                                  formats.cpp \
-                                 utils.cpp
+                                 utils.cpp \
+                                 layer_stack_trace.cpp \
+                                 frame_stats.cpp \
+                                 fence.cpp \
+                                 trace_buffer.cpp
 
 LOCAL_SHARED_LIBRARIES        := libdisplaydebug
 include $(BUILD_SHARED_LIBRARY)
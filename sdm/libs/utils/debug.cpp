@@ -179,6 +179,13 @@ bool Debug::IsSrcSplitPreferred() {
   return (value == 1);
 }
 
+bool Debug::IsSimBackendEnabled() {
+  int value = 0;
+  DebugHandler::Get()->GetProperty(ENABLE_SIM_BACKEND_PROP, &value);
+
+  return (value == 1);
+}
+
 DisplayError Debug::GetMixerResolution(uint32_t *width, uint32_t *height) {
   char value[64] = {};
 
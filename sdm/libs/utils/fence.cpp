@@ -0,0 +1,226 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/fence.h>
+#include <utils/sys.h>
+#include <algorithm>
+
+#define __CLASS__ "FenceManager"
+
+namespace sdm {
+
+std::atomic<BufferSyncHandler *> FenceManager::buffer_sync_handler_ {nullptr};
+std::atomic<uint64_t> FenceManager::live_ {0};
+std::atomic<uint64_t> FenceManager::peak_live_ {0};
+std::atomic<uint64_t> FenceManager::created_ {0};
+std::atomic<uint64_t> FenceManager::closed_ {0};
+std::atomic<uint64_t> FenceManager::exported_ {0};
+std::atomic<uint64_t> FenceManager::dups_ {0};
+std::atomic<uint64_t> FenceManager::merges_ {0};
+std::atomic<uint64_t> FenceManager::merges_skipped_ {0};
+
+Fence::~Fence() {
+  if (fd_ >= 0) {
+    Sys::close_(fd_);
+    FenceManager::OnClose();
+  }
+}
+
+void FenceManager::Init(BufferSyncHandler *buffer_sync_handler) {
+  buffer_sync_handler_.store(buffer_sync_handler);
+}
+
+std::shared_ptr<Fence> FenceManager::Create(int fd) {
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  created_.fetch_add(1, std::memory_order_relaxed);
+  uint64_t live = live_.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t peak_live = peak_live_.load(std::memory_order_relaxed);
+  while (live > peak_live &&
+         !peak_live_.compare_exchange_weak(peak_live, live, std::memory_order_relaxed)) { }
+
+  return std::shared_ptr<Fence>(new Fence(fd));
+}
+
+int FenceManager::Dup(const std::shared_ptr<Fence> &fence) {
+  if (!fence || fence->fd_ < 0) {
+    return -1;
+  }
+
+  dups_.fetch_add(1, std::memory_order_relaxed);
+  return Sys::dup_(fence->fd_);
+}
+
+int FenceManager::Export(std::shared_ptr<Fence> *fence) {
+  std::shared_ptr<Fence> local = std::move(*fence);
+  if (!local || local->fd_ < 0) {
+    return -1;
+  }
+
+  // Nobody else can pick up a new reference to a fence this caller holds the only one of.
+  if (local.use_count() > 1) {
+    return Dup(local);
+  }
+
+  int fd = local->fd_;
+  local->fd_ = -1;
+  exported_.fetch_add(1, std::memory_order_relaxed);
+  live_.fetch_sub(1, std::memory_order_relaxed);
+
+  return fd;
+}
+
+DisplayError FenceManager::Merge(const std::vector<std::shared_ptr<Fence>> &fences,
+                                std::shared_ptr<Fence> *merged) {
+  std::vector<std::shared_ptr<Fence>> level;
+  level.reserve(fences.size());
+  for (auto &fence : fences) {
+    if (!fence || fence->fd_ < 0 || std::find(level.begin(), level.end(), fence) != level.end()) {
+      merges_skipped_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    level.push_back(fence);
+  }
+
+  *merged = nullptr;
+  if (level.empty()) {
+    return kErrorNone;
+  }
+
+  DisplayError status = kErrorNone;
+  while (level.size() > 1) {
+    size_t count = 0;
+    for (size_t i = 0; i < level.size(); i += 2) {
+      if (i + 1 == level.size()) {
+        level[count++] = level[i];
+        continue;
+      }
+
+      std::shared_ptr<Fence> pair;
+      DisplayError error = MergePair(level[i], level[i + 1], &pair);
+      if (error != kErrorNone) {
+        status = error;
+        pair = level[i];
+      }
+      level[count++] = pair;
+    }
+    level.resize(count);
+  }
+
+  *merged = level.front();
+
+  return status;
+}
+
+DisplayError FenceManager::Merge(const std::shared_ptr<Fence> &fence1,
+                                 const std::shared_ptr<Fence> &fence2,
+                                 std::shared_ptr<Fence> *merged) {
+  bool valid1 = (fence1 && fence1->fd_ >= 0);
+  bool valid2 = (fence2 && fence2->fd_ >= 0);
+  if (!valid1 || !valid2 || fence1 == fence2) {
+    merges_skipped_.fetch_add(1, std::memory_order_relaxed);
+    *merged = valid1 ? fence1 : (valid2 ? fence2 : nullptr);
+    return kErrorNone;
+  }
+
+  DisplayError error = MergePair(fence1, fence2, merged);
+  if (error != kErrorNone) {
+    *merged = fence1;
+  }
+
+  return error;
+}
+
+DisplayError FenceManager::MergePair(const std::shared_ptr<Fence> &fence1,
+                                     const std::shared_ptr<Fence> &fence2,
+                                     std::shared_ptr<Fence> *merged) {
+  BufferSyncHandler *buffer_sync_handler = buffer_sync_handler_.load();
+  if (!buffer_sync_handler) {
+    DLOGE("No buffer sync handler to merge fences %d and %d", fence1->fd_, fence2->fd_);
+    return kErrorNotSupported;
+  }
+
+  int merged_fd = -1;
+  merges_.fetch_add(1, std::memory_order_relaxed);
+  DisplayError error = buffer_sync_handler->SyncMerge(fence1->fd_, fence2->fd_, &merged_fd);
+  if (error != kErrorNone) {
+    DLOGE("Failed to merge fences %d and %d, error %d", fence1->fd_, fence2->fd_, error);
+    return error;
+  }
+
+  *merged = Create(merged_fd);
+
+  return kErrorNone;
+}
+
+DisplayError FenceManager::Wait(const std::shared_ptr<Fence> &fence) {
+  if (!fence || fence->fd_ < 0) {
+    return kErrorNone;
+  }
+
+  BufferSyncHandler *buffer_sync_handler = buffer_sync_handler_.load();
+  if (!buffer_sync_handler) {
+    return kErrorNotSupported;
+  }
+
+  return buffer_sync_handler->SyncWait(fence->fd_);
+}
+
+void FenceManager::GetStats(FenceStats *stats) {
+  stats->live = live_.load(std::memory_order_relaxed);
+  stats->peak_live = peak_live_.load(std::memory_order_relaxed);
+  stats->created = created_.load(std::memory_order_relaxed);
+  stats->closed = closed_.load(std::memory_order_relaxed);
+  stats->exported = exported_.load(std::memory_order_relaxed);
+  stats->dups = dups_.load(std::memory_order_relaxed);
+  stats->merges = merges_.load(std::memory_order_relaxed);
+  stats->merges_skipped = merges_skipped_.load(std::memory_order_relaxed);
+}
+
+void FenceManager::ResetStats() {
+  // Live fences are real fds, only the peak and the event counters start over.
+  peak_live_.store(live_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  created_.store(0, std::memory_order_relaxed);
+  closed_.store(0, std::memory_order_relaxed);
+  exported_.store(0, std::memory_order_relaxed);
+  dups_.store(0, std::memory_order_relaxed);
+  merges_.store(0, std::memory_order_relaxed);
+  merges_skipped_.store(0, std::memory_order_relaxed);
+}
+
+void FenceManager::Dump(std::ostringstream *os) {
+  FenceStats stats;
+  GetStats(&stats);
+
+  *os << "\nlive: " << stats.live << " peak: " << stats.peak_live;
+  *os << "\ncreated: " << stats.created << " closed: " << stats.closed;
+  *os << " exported: " << stats.exported << " dups: " << stats.dups;
+  *os << "\nmerges: " << stats.merges << " skipped: " << stats.merges_skipped;
+}
+
+}  // namespace sdm
@@ -33,182 +33,89 @@
 
 namespace sdm {
 
-bool IsUBWCFormat(LayerBufferFormat format) {
-  switch (format) {
-  case kFormatRGBA8888Ubwc:
-  case kFormatRGBX8888Ubwc:
-  case kFormatBGR565Ubwc:
-  case kFormatYCbCr420SPVenusUbwc:
-  case kFormatRGBA1010102Ubwc:
-  case kFormatRGBX1010102Ubwc:
-  case kFormatYCbCr420TP10Ubwc:
-  case kFormatYCbCr420P010Ubwc:
-    return true;
-  default:
-    return false;
-  }
-}
+// Tile sizes of the UBWC YUV formats, for the Y plane and the UV plane.
+static constexpr FormatTile kTileVenusUbwc = { 32, 8, 16, 8 };
+static constexpr FormatTile kTileTP10Ubwc = { 48, 4, 24, 4 };
+static constexpr FormatTile kTileP010Ubwc = { 32, 4, 16, 4 };
 
-bool Is10BitFormat(LayerBufferFormat format) {
-  switch (format) {
-  case kFormatRGBA1010102:
-  case kFormatARGB2101010:
-  case kFormatRGBX1010102:
-  case kFormatXRGB2101010:
-  case kFormatBGRA1010102:
-  case kFormatABGR2101010:
-  case kFormatBGRX1010102:
-  case kFormatXBGR2101010:
-  case kFormatRGBA1010102Ubwc:
-  case kFormatRGBX1010102Ubwc:
-  case kFormatYCbCr420P010:
-  case kFormatYCbCr420TP10Ubwc:
-  case kFormatYCbCr420P010Ubwc:
-  case kFormatYCbCr420P010Venus:
-    return true;
-  default:
-    return false;
-  }
-}
+// format, name, bpp, planes, ubwc, 10 bit, layout, tile size. One entry per format in enum order.
+constexpr FormatTraits kFormatTraits[kFormatCount] = {
+  { kFormatARGB8888, "ARGB_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatRGBA8888, "RGBA_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatBGRA8888, "BGRA_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatXRGB8888, "XRGB_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatRGBX8888, "RGBX_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatBGRX8888, "BGRX_8888", 4.0f, 1, false, false, kLinear, {} },
+  { kFormatRGBA5551, "RGBA_5551", 2.0f, 1, false, false, kLinear, {} },
+  { kFormatRGBA4444, "RGBA_4444", 2.0f, 1, false, false, kLinear, {} },
+  { kFormatRGB888, "RGB_888", 3.0f, 1, false, false, kLinear, {} },
+  { kFormatBGR888, "BGR_888", 3.0f, 1, false, false, kLinear, {} },
+  { kFormatRGB565, "RGB_565", 2.0f, 1, false, false, kLinear, {} },
+  { kFormatBGR565, "BGR_565", 2.0f, 1, false, false, kLinear, {} },
+  { kFormatRGBA8888Ubwc, "RGBA_8888_UBWC", 4.0f, 1, true, false, kUBWC, {} },
+  { kFormatRGBX8888Ubwc, "RGBX_8888_UBWC", 4.0f, 1, true, false, kUBWC, {} },
+  { kFormatBGR565Ubwc, "BGR_565_UBWC", 2.0f, 1, true, false, kUBWC, {} },
+  { kFormatRGBA1010102, "RGBA_1010102", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatARGB2101010, "ARGB_2101010", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatRGBX1010102, "RGBX_1010102", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatXRGB2101010, "XRGB_2101010", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatBGRA1010102, "BGRA_1010102", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatABGR2101010, "ABGR_2101010", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatBGRX1010102, "BGRX_1010102", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatXBGR2101010, "XBGR_2101010", 4.0f, 1, false, true, kLinear, {} },
+  { kFormatRGBA1010102Ubwc, "RGBA_1010102_UBWC", 4.0f, 1, true, true, kUBWC, {} },
+  { kFormatRGBX1010102Ubwc, "RGBX_1010102_UBWC", 4.0f, 1, true, true, kUBWC, {} },
+  { kFormatRGB101010, "RGB_101010", 0.0f, 1, false, false, kLinear, {} },
 
-const char *GetFormatString(const LayerBufferFormat &format) {
-  switch (format) {
-  case kFormatARGB8888:                 return "ARGB_8888";
-  case kFormatRGBA8888:                 return "RGBA_8888";
-  case kFormatBGRA8888:                 return "BGRA_8888";
-  case kFormatXRGB8888:                 return "XRGB_8888";
-  case kFormatRGBX8888:                 return "RGBX_8888";
-  case kFormatBGRX8888:                 return "BGRX_8888";
-  case kFormatRGBA5551:                 return "RGBA_5551";
-  case kFormatRGBA4444:                 return "RGBA_4444";
-  case kFormatRGB888:                   return "RGB_888";
-  case kFormatBGR888:                   return "BGR_888";
-  case kFormatRGB565:                   return "RGB_565";
-  case kFormatBGR565:                   return "BGR_565";
-  case kFormatRGBA8888Ubwc:             return "RGBA_8888_UBWC";
-  case kFormatRGBX8888Ubwc:             return "RGBX_8888_UBWC";
-  case kFormatBGR565Ubwc:               return "BGR_565_UBWC";
-  case kFormatYCbCr420Planar:           return "Y_CB_CR_420";
-  case kFormatYCrCb420Planar:           return "Y_CR_CB_420";
-  case kFormatYCrCb420PlanarStride16:   return "Y_CR_CB_420_STRIDE16";
-  case kFormatYCbCr420SemiPlanar:       return "Y_CBCR_420";
-  case kFormatYCrCb420SemiPlanar:       return "Y_CRCB_420";
-  case kFormatYCbCr420SemiPlanarVenus:  return "Y_CBCR_420_VENUS";
-  case kFormatYCrCb420SemiPlanarVenus:  return "Y_CRCB_420_VENUS";
-  case kFormatYCbCr422H1V2SemiPlanar:   return "Y_CBCR_422_H1V2";
-  case kFormatYCrCb422H1V2SemiPlanar:   return "Y_CRCB_422_H1V2";
-  case kFormatYCbCr422H2V1SemiPlanar:   return "Y_CBCR_422_H2V1";
-  case kFormatYCrCb422H2V1SemiPlanar:   return "Y_CRCB_422_H2V2";
-  case kFormatYCbCr420SPVenusUbwc:      return "Y_CBCR_420_VENUS_UBWC";
-  case kFormatYCbCr422H2V1Packed:       return "YCBYCR_422_H2V1";
-  case kFormatCbYCrY422H2V1Packed:      return "CBYCRY_422_H2V1";
-  case kFormatRGBA1010102:              return "RGBA_1010102";
-  case kFormatARGB2101010:              return "ARGB_2101010";
-  case kFormatRGBX1010102:              return "RGBX_1010102";
-  case kFormatXRGB2101010:              return "XRGB_2101010";
-  case kFormatBGRA1010102:              return "BGRA_1010102";
-  case kFormatABGR2101010:              return "ABGR_2101010";
-  case kFormatBGRX1010102:              return "BGRX_1010102";
-  case kFormatXBGR2101010:              return "XBGR_2101010";
-  case kFormatRGBA1010102Ubwc:          return "RGBA_1010102_UBWC";
-  case kFormatRGBX1010102Ubwc:          return "RGBX_1010102_UBWC";
-  case kFormatYCbCr420P010:             return "Y_CBCR_420_P010";
-  case kFormatYCbCr420TP10Ubwc:         return "Y_CBCR_420_TP10_UBWC";
-  case kFormatYCbCr420P010Ubwc:         return "Y_CBCR_420_P010_UBWC";
-  case kFormatYCbCr420P010Venus:        return "Y_CBCR_420_P010_VENUS";
-  default:                              return "UNKNOWN";
-  }
-}
+  { kFormatYCbCr420Planar, "Y_CB_CR_420", 1.5f, 3, false, false, kLinear, {} },
+  { kFormatYCrCb420Planar, "Y_CR_CB_420", 1.5f, 3, false, false, kLinear, {} },
+  { kFormatYCrCb420PlanarStride16, "Y_CR_CB_420_STRIDE16", 1.5f, 3, false, false, kLinear, {} },
 
-BufferLayout GetBufferLayout(LayerBufferFormat format) {
-  switch (format) {
-  case kFormatYCbCr420TP10Ubwc:
-    return kTPTiled;
-  default:
-    return (IsUBWCFormat(format) ? kUBWC : kLinear);
-  }
-}
+  { kFormatYCbCr420SemiPlanar, "Y_CBCR_420", 1.5f, 2, false, false, kLinear, {} },
+  { kFormatYCrCb420SemiPlanar, "Y_CRCB_420", 1.5f, 2, false, false, kLinear, {} },
+  { kFormatYCbCr420SemiPlanarVenus, "Y_CBCR_420_VENUS", 1.5f, 2, false, false, kLinear, {} },
+  { kFormatYCbCr422H1V2SemiPlanar, "Y_CBCR_422_H1V2", 2.0f, 2, false, false, kLinear, {} },
+  { kFormatYCrCb422H1V2SemiPlanar, "Y_CRCB_422_H1V2", 2.0f, 2, false, false, kLinear, {} },
+  { kFormatYCbCr422H2V1SemiPlanar, "Y_CBCR_422_H2V1", 2.0f, 2, false, false, kLinear, {} },
+  { kFormatYCrCb422H2V1SemiPlanar, "Y_CRCB_422_H2V2", 2.0f, 2, false, false, kLinear, {} },
+  { kFormatYCbCr420SPVenusUbwc, "Y_CBCR_420_VENUS_UBWC", 1.5f, 2, true, false, kUBWC,
+    kTileVenusUbwc },
+  { kFormatYCrCb420SemiPlanarVenus, "Y_CRCB_420_VENUS", 1.5f, 2, false, false, kLinear, {} },
+  { kFormatYCbCr420P010, "Y_CBCR_420_P010", 3.0f, 2, false, true, kLinear, {} },
+  { kFormatYCbCr420TP10Ubwc, "Y_CBCR_420_TP10_UBWC", 2.0f, 2, true, true, kTPTiled,
+    kTileTP10Ubwc },
+  { kFormatYCbCr420P010Ubwc, "Y_CBCR_420_P010_UBWC", 3.0f, 2, true, true, kUBWC,
+    kTileP010Ubwc },
+  { kFormatYCbCr420P010Venus, "Y_CBCR_420_P010_VENUS", 3.0f, 2, false, true, kLinear, {} },
 
-float GetBufferFormatBpp(LayerBufferFormat format) {
-  float bpp = 0.0f;
-  switch (format) {
-    case kFormatARGB8888:
-    case kFormatRGBA8888:
-    case kFormatBGRA8888:
-    case kFormatXRGB8888:
-    case kFormatRGBX8888:
-    case kFormatBGRX8888:
-    case kFormatRGBA8888Ubwc:
-    case kFormatRGBX8888Ubwc:
-    case kFormatRGBA1010102:
-    case kFormatARGB2101010:
-    case kFormatRGBX1010102:
-    case kFormatXRGB2101010:
-    case kFormatBGRA1010102:
-    case kFormatABGR2101010:
-    case kFormatBGRX1010102:
-    case kFormatXBGR2101010:
-    case kFormatRGBA1010102Ubwc:
-    case kFormatRGBX1010102Ubwc:
-      return 4.0f;
-    case kFormatRGB888:
-    case kFormatBGR888:
-    case kFormatYCbCr420P010:
-    case kFormatYCbCr420P010Ubwc:
-    case kFormatYCbCr420P010Venus:
-      return 3.0f;
-    case kFormatRGB565:
-    case kFormatBGR565:
-    case kFormatRGBA5551:
-    case kFormatRGBA4444:
-    case kFormatBGR565Ubwc:
-    case kFormatYCbCr422H2V1Packed:
-    case kFormatCbYCrY422H2V1Packed:
-    case kFormatYCrCb422H2V1SemiPlanar:
-    case kFormatYCbCr422H2V1SemiPlanar:
-    case kFormatYCbCr420TP10Ubwc:
-    case kFormatYCbCr422H1V2SemiPlanar:
-    case kFormatYCrCb422H1V2SemiPlanar:
-      return 2.0f;
-    case kFormatYCbCr420Planar:
-    case kFormatYCrCb420Planar:
-    case kFormatYCrCb420PlanarStride16:
-    case kFormatYCbCr420SemiPlanar:
-    case kFormatYCrCb420SemiPlanar:
-    case kFormatYCbCr420SemiPlanarVenus:
-    case kFormatYCrCb420SemiPlanarVenus:
-    case kFormatYCbCr420SPVenusUbwc:
-      return 1.5f;
-    default:
-      return 0.0f;
-  }
+  { kFormatYCbCr422H2V1Packed, "YCBYCR_422_H2V1", 2.0f, 1, false, false, kLinear, {} },
+  { kFormatCbYCrY422H2V1Packed, "CBYCRY_422_H2V1", 2.0f, 1, false, false, kLinear, {} },
+};
 
-  return bpp;
+constexpr FormatTraits kInvalidFormatTraits = {
+  kFormatInvalid, "UNKNOWN", 0.0f, 0, false, false, kLinear, {}
+};
+
+static constexpr bool IsFormatLayoutConsistent(uint32_t index = 0) {
+  return (index == kFormatCount) ||
+         (kFormatTraits[index].ubwc == (kFormatTraits[index].layout != kLinear) &&
+          (kFormatTraits[index].ubwc && kFormatTraits[index].planes == 2) ==
+          (kFormatTraits[index].tile.width != 0) && IsFormatLayoutConsistent(index + 1));
 }
 
+static_assert(IsFormatTableComplete(kFormatTraits), "Format traits out of enum order");
+static_assert(IsFormatLayoutConsistent(), "UBWC formats need a tiled layout and YUV tile sizes");
+
 DisplayError GetBufferFormatTileSize(LayerBufferFormat format, FormatTileSize *tile_size) {
-  switch (format) {
-  case kFormatYCbCr420SPVenusUbwc:
-    tile_size->tile_width = 32;
-    tile_size->tile_height = 8;
-    tile_size->uv_tile_width = 16;
-    tile_size->uv_tile_height = 8;
-    break;
-  case kFormatYCbCr420TP10Ubwc:
-    tile_size->tile_width = 48;
-    tile_size->tile_height = 4;
-    tile_size->uv_tile_width = 24;
-    tile_size->uv_tile_height = 4;
-    break;
-  case kFormatYCbCr420P010Ubwc:
-    tile_size->tile_width = 32;
-    tile_size->tile_height = 4;
-    tile_size->uv_tile_width = 16;
-    tile_size->uv_tile_height = 4;
-    break;
-  default:
+  const FormatTraits &traits = GetFormatTraits(format);
+  if (!traits.tile.width) {
     return kErrorNotSupported;
   }
+
+  tile_size->tile_width = traits.tile.width;
+  tile_size->tile_height = traits.tile.height;
+  tile_size->uv_tile_width = traits.tile.uv_width;
+  tile_size->uv_tile_height = traits.tile.uv_height;
   return kErrorNone;
 }
 
@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include <utils/constants.h>
+#include <utils/frame_stats.h>
+
+namespace sdm {
+
+const char *FrameStats::GetStageName(FrameStage stage) {
+  switch (stage) {
+  case kStageBuildLayerStack:  return "BuildLayerStack";
+  case kStagePrepare:          return "Prepare";
+  case kStageStrategy:         return "Strategy";
+  case kStageHWValidate:       return "HWValidate";
+  case kStageCommit:           return "Commit";
+  case kStageHWCommit:         return "HWCommit";
+  case kStagePostCommit:       return "PostCommit";
+  default:                     return "Unknown";
+  }
+}
+
+uint32_t LatencyHistogram::GetBucketIndex(uint64_t value_ns) {
+  if (value_ns < kSubBucketCount) {
+    return static_cast<uint32_t>(value_ns);
+  }
+
+  uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(value_ns));
+  uint32_t shift = msb - kSubBucketBits;
+  if (shift > kMaxShift) {
+    return kNumBuckets - 1;
+  }
+
+  uint32_t sub_bucket = static_cast<uint32_t>(value_ns >> shift) & (kSubBucketCount - 1);
+  return (shift + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(uint32_t index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+
+  // Report the upper bound of the bucket.
+  uint32_t shift = index / kSubBucketCount - 1;
+  uint64_t sub_bucket = index % kSubBucketCount;
+  return ((kSubBucketCount + sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::GetPercentile(uint64_t count, uint32_t percentile) const {
+  uint64_t threshold = std::max((count * percentile + 99) / 100, UINT64(1));
+  uint64_t cumulative = 0;
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    cumulative += buckets_[i].load(std::memory_order_relaxed);
+    if (cumulative >= threshold) {
+      return GetBucketValue(i);
+    }
+  }
+
+  return GetBucketValue(kNumBuckets - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value_ns) {
+  buckets_[GetBucketIndex(value_ns)].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(value_ns, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+  while (value_ns > max_ns &&
+         !max_ns_.compare_exchange_weak(max_ns, value_ns, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::GetSummary(FrameStageSummary *summary) const {
+  *summary = FrameStageSummary();
+  summary->count = count_.load(std::memory_order_relaxed);
+  if (!summary->count) {
+    return;
+  }
+  summary->mean_ns = sum_ns_.load(std::memory_order_relaxed) / summary->count;
+  summary->max_ns = max_ns_.load(std::memory_order_relaxed);
+  // Percentiles report bucket upper bounds, never exceed the recorded maximum.
+  summary->p50_ns = std::min(GetPercentile(summary->count, 50), summary->max_ns);
+  summary->p90_ns = std::min(GetPercentile(summary->count, 90), summary->max_ns);
+  summary->p99_ns = std::min(GetPercentile(summary->count, 99), summary->max_ns);
+}
+
+void LatencyHistogram::Reset() {
+  count_.store(0, std::memory_order_relaxed);
+  sum_ns_.store(0, std::memory_order_relaxed);
+  max_ns_.store(0, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void FrameStats::Record(FrameStage stage, uint64_t start_ns, uint64_t end_ns) {
+  if (stage >= kStageMax) {
+    return;
+  }
+
+  histograms_[stage].Record(end_ns - start_ns);
+
+  uint32_t index = write_index_.fetch_add(1, std::memory_order_relaxed) & (kRingSize - 1);
+  StageRecord &record = records_[index];
+  uint32_t seq = record.seq.load(std::memory_order_relaxed);
+  record.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  record.stage.store(stage, std::memory_order_relaxed);
+  record.frame.store(frame_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  record.start_ns.store(start_ns, std::memory_order_relaxed);
+  record.end_ns.store(end_ns, std::memory_order_relaxed);
+  record.seq.store(seq + 2, std::memory_order_release);
+}
+
+void FrameStats::RecordRetries(uint32_t retries) {
+  retries = std::min(retries, UINT32(FrameStatsSnapshot::kMaxRetries));
+  retries_[retries].fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameStats::GetSnapshot(FrameStatsSnapshot *snapshot) const {
+  // Load the base first, frame_ only grows so the difference cannot wrap.
+  uint64_t frame_base = frame_base_.load(std::memory_order_acquire);
+  snapshot->frames = frame_.load(std::memory_order_relaxed) - frame_base;
+  for (uint32_t i = 0; i < kStageMax; i++) {
+    histograms_[i].GetSummary(&snapshot->stages[i]);
+  }
+
+  for (uint32_t i = 0; i <= FrameStatsSnapshot::kMaxRetries; i++) {
+    snapshot->retries[i] = retries_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void FrameStats::Dump(std::ostringstream *os) const {
+  FrameStatsSnapshot snapshot;
+  GetSnapshot(&snapshot);
+  char line[128];
+
+  *os << "\nframe stats: " << snapshot.frames << " frames (us)";
+  *os << "\n           stage    count     mean      p50      p90      p99      max";
+  for (uint32_t i = 0; i < kStageMax; i++) {
+    const FrameStageSummary &summary = snapshot.stages[i];
+    if (!summary.count) {
+      continue;
+    }
+    snprintf(line, sizeof(line), "\n%16s %8" PRIu64 " %8.1f %8.1f %8.1f %8.1f %8.1f",
+             GetStageName(static_cast<FrameStage>(i)), summary.count,
+             static_cast<double>(summary.mean_ns) / 1000.0,
+             static_cast<double>(summary.p50_ns) / 1000.0,
+             static_cast<double>(summary.p90_ns) / 1000.0,
+             static_cast<double>(summary.p99_ns) / 1000.0,
+             static_cast<double>(summary.max_ns) / 1000.0);
+    *os << line;
+  }
+
+  *os << "\nstrategy retries:";
+  for (uint32_t i = 0; i <= FrameStatsSnapshot::kMaxRetries; i++) {
+    *os << " " << i << (i == FrameStatsSnapshot::kMaxRetries ? "+:" : ":") << snapshot.retries[i];
+  }
+
+  *os << "\nrecent stages (frame stage start_us duration_us):";
+  uint32_t write_index = write_index_.load(std::memory_order_relaxed);
+  uint32_t num_records = std::min(write_index, UINT32(kDumpRecords));
+  for (uint32_t i = write_index - num_records; i != write_index; i++) {
+    const StageRecord &record = records_[i & (kRingSize - 1)];
+    uint32_t seq = record.seq.load(std::memory_order_acquire);
+    FrameStage stage = static_cast<FrameStage>(record.stage.load(std::memory_order_relaxed));
+    uint64_t frame = record.frame.load(std::memory_order_relaxed);
+    uint64_t start_ns = record.start_ns.load(std::memory_order_relaxed);
+    uint64_t end_ns = record.end_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((seq & 1) || seq != record.seq.load(std::memory_order_relaxed)) {
+      // Being overwritten.
+      continue;
+    }
+    snprintf(line, sizeof(line), "\n  %8" PRIu64 " %16s %14" PRIu64 " %8.1f", frame,
+             GetStageName(stage), start_ns / 1000,
+             static_cast<double>(end_ns - start_ns) / 1000.0);
+    *os << line;
+  }
+}
+
+void FrameStats::Reset() {
+  // frame_ keeps counting so that the ring records stay ordered.
+  frame_base_.store(frame_.load(std::memory_order_relaxed), std::memory_order_release);
+  for (uint32_t i = 0; i < kStageMax; i++) {
+    histograms_[i].Reset();
+  }
+
+  for (uint32_t i = 0; i <= FrameStatsSnapshot::kMaxRetries; i++) {
+    retries_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace sdm
@@ -0,0 +1,224 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/layer_stack_trace.h>
+
+#define __CLASS__ "LayerStackTrace"
+
+namespace sdm {
+
+DisplayError LayerStackTrace::Open(const char *file_name, bool record) {
+  Close();
+
+  file_ = fopen(file_name, record ? "wb" : "rb");
+  if (!file_) {
+    DLOGW("Failed to open %s", file_name);
+    return kErrorResources;
+  }
+
+  record_ = record;
+  uint32_t header[2] = { kMagic, kVersion };
+  if (record_) {
+    if (fwrite(header, sizeof(header), 1, file_) != 1) {
+      Close();
+      return kErrorResources;
+    }
+
+    return kErrorNone;
+  }
+
+  if (fread(header, sizeof(header), 1, file_) != 1 || header[0] != kMagic ||
+      header[1] != kVersion) {
+    DLOGW("%s is not a layer stack trace", file_name);
+    Close();
+    return kErrorParameters;
+  }
+
+  return kErrorNone;
+}
+
+void LayerStackTrace::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = NULL;
+  }
+}
+
+void LayerStackTrace::PackRect(const LayerRect &rect) {
+  Pack(rect.left);
+  Pack(rect.top);
+  Pack(rect.right);
+  Pack(rect.bottom);
+}
+
+bool LayerStackTrace::UnpackRect(LayerRect *rect) {
+  return Unpack(&rect->left) && Unpack(&rect->top) && Unpack(&rect->right) &&
+         Unpack(&rect->bottom);
+}
+
+void LayerStackTrace::PackRects(const std::vector<LayerRect> &rects) {
+  Pack(UINT32(rects.size()));
+  for (const LayerRect &rect : rects) {
+    PackRect(rect);
+  }
+}
+
+bool LayerStackTrace::UnpackRects(std::vector<LayerRect> *rects) {
+  uint32_t count = 0;
+  if (!Unpack(&count) || (offset_ + count * 4 * sizeof(float)) > buffer_.size()) {
+    return false;
+  }
+
+  rects->resize(count);
+  for (LayerRect &rect : *rects) {
+    UnpackRect(&rect);
+  }
+
+  return true;
+}
+
+void LayerStackTrace::PackLayer(const Layer &layer) {
+  const LayerBuffer &buffer = layer.input_buffer;
+
+  Pack(UINT32(buffer.format));
+  Pack(buffer.width);
+  Pack(buffer.height);
+  Pack(buffer.unaligned_width);
+  Pack(buffer.unaligned_height);
+  Pack(buffer.flags.flags);
+  Pack(UINT32(buffer.color_metadata.colorPrimaries));
+  Pack(UINT32(buffer.color_metadata.transfer));
+  Pack(UINT32(buffer.color_metadata.range));
+  Pack(UINT32(layer.composition));
+  Pack(UINT32(layer.blending));
+  Pack(layer.flags.flags);
+  Pack(layer.request.flags.request_flags);
+  Pack(layer.transform.rotation);
+  Pack(UINT8((layer.transform.flip_horizontal ? 1 : 0) | (layer.transform.flip_vertical ? 2 : 0)));
+  Pack(layer.plane_alpha);
+  Pack(layer.frame_rate);
+  Pack(layer.solid_fill_color);
+  Pack(layer.geometry_fingerprint);
+  PackRect(layer.src_rect);
+  PackRect(layer.dst_rect);
+  PackRects(layer.visible_regions);
+  PackRects(layer.dirty_regions);
+}
+
+bool LayerStackTrace::UnpackLayer(Layer *layer) {
+  LayerBuffer &buffer = layer->input_buffer;
+  uint32_t format = 0, primaries = 0, transfer = 0, range = 0, composition = 0, blending = 0;
+  uint8_t flips = 0;
+
+  bool valid = Unpack(&format) && Unpack(&buffer.width) && Unpack(&buffer.height) &&
+               Unpack(&buffer.unaligned_width) && Unpack(&buffer.unaligned_height) &&
+               Unpack(&buffer.flags.flags) && Unpack(&primaries) && Unpack(&transfer) &&
+               Unpack(&range) && Unpack(&composition) && Unpack(&blending) &&
+               Unpack(&layer->flags.flags) && Unpack(&layer->request.flags.request_flags) &&
+               Unpack(&layer->transform.rotation) && Unpack(&flips) &&
+               Unpack(&layer->plane_alpha) && Unpack(&layer->frame_rate) &&
+               Unpack(&layer->solid_fill_color) && Unpack(&layer->geometry_fingerprint) &&
+               UnpackRect(&layer->src_rect) && UnpackRect(&layer->dst_rect) &&
+               UnpackRects(&layer->visible_regions) && UnpackRects(&layer->dirty_regions);
+  if (!valid) {
+    return false;
+  }
+
+  buffer.format = static_cast<LayerBufferFormat>(format);
+  buffer.color_metadata.colorPrimaries = static_cast<ColorPrimaries>(primaries);
+  buffer.color_metadata.transfer = static_cast<GammaTransfer>(transfer);
+  buffer.color_metadata.range = static_cast<ColorRange>(range);
+  layer->composition = static_cast<LayerComposition>(composition);
+  layer->blending = static_cast<LayerBlending>(blending);
+  layer->transform.flip_horizontal = (flips & 1);
+  layer->transform.flip_vertical = (flips & 2);
+
+  return true;
+}
+
+DisplayError LayerStackTrace::Write(const LayerStack &layer_stack) {
+  if (!file_ || !record_) {
+    return kErrorNotSupported;
+  }
+
+  buffer_.clear();
+  Pack(layer_stack.flags.flags);
+  Pack(UINT32(layer_stack.layers.size()));
+  for (const Layer *layer : layer_stack.layers) {
+    PackLayer(*layer);
+  }
+
+  uint32_t frame_size = UINT32(buffer_.size());
+  if (fwrite(&frame_size, sizeof(frame_size), 1, file_) != 1 ||
+      fwrite(buffer_.data(), frame_size, 1, file_) != 1) {
+    DLOGW("Failed to write frame of %d bytes", frame_size);
+    Close();
+    return kErrorResources;
+  }
+
+  return kErrorNone;
+}
+
+DisplayError LayerStackTrace::Read(LayerStack *layer_stack, std::vector<Layer> *layers) {
+  if (!file_ || record_) {
+    return kErrorNotSupported;
+  }
+
+  uint32_t frame_size = 0;
+  if (fread(&frame_size, sizeof(frame_size), 1, file_) != 1) {
+    return kErrorUndefined;
+  }
+
+  buffer_.resize(frame_size);
+  offset_ = 0;
+  if (fread(buffer_.data(), frame_size, 1, file_) != 1) {
+    DLOGW("Truncated frame of %d bytes", frame_size);
+    return kErrorUndefined;
+  }
+
+  uint32_t layer_count = 0;
+  if (!Unpack(&layer_stack->flags.flags) || !Unpack(&layer_count)) {
+    return kErrorParameters;
+  }
+
+  // Keep the previously read layers, their addresses must stay the same for unchanged layers.
+  if (layers->size() != layer_count) {
+    layers->resize(layer_count);
+  }
+
+  layer_stack->layers.clear();
+  for (Layer &layer : *layers) {
+    if (!UnpackLayer(&layer)) {
+      DLOGW("Corrupted frame of %d bytes", frame_size);
+      return kErrorParameters;
+    }
+    layer_stack->layers.push_back(&layer);
+  }
+
+  return kErrorNone;
+}
+
+}  // namespace sdm
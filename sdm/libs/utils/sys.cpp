@@ -56,6 +56,9 @@ Sys::dup Sys::dup_ = ::dup;
 Sys::read Sys::read_ = ::read;
 Sys::write Sys::write_ = ::write;
 Sys::eventfd Sys::eventfd_ = ::eventfd;
+Sys::epoll_create1 Sys::epoll_create1_ = ::epoll_create1;
+Sys::epoll_ctl Sys::epoll_ctl_ = ::epoll_ctl;
+Sys::epoll_wait Sys::epoll_wait_ = ::epoll_wait;
 
 bool Sys::getline_(fstream &fs, std::string &line) {
   return std::getline(fs, line) ? true : false;
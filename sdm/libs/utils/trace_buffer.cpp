@@ -0,0 +1,246 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/frame_stats.h>
+#include <utils/trace_buffer.h>
+#include <map>
+
+#define __CLASS__ "TraceBuffer"
+
+namespace sdm {
+
+static_assert(sizeof(TraceEvent) % sizeof(uint64_t) == 0, "TraceEvent must pack into words");
+
+TraceBuffer::~TraceBuffer() {
+  enabled_ = false;
+  delete [] slots_;
+}
+
+DisplayError TraceBuffer::Init(uint32_t num_events) {
+  if (slots_) {
+    return kErrorNone;
+  }
+
+  if (!num_events || num_events > kMaxEvents) {
+    return kErrorParameters;
+  }
+
+  uint32_t size = 1;
+  while (size < num_events) {
+    size <<= 1;
+  }
+
+  slots_ = new Slot[size];
+  mask_ = size - 1;
+  enabled_.store(true, std::memory_order_release);
+  DLOGI("Recording up to %u trace events", size);
+
+  return kErrorNone;
+}
+
+uint32_t TraceBuffer::GetThreadId() {
+  static thread_local uint32_t tid = UINT32(syscall(SYS_gettid));
+  return tid;
+}
+
+void TraceBuffer::Record(TraceEventType type, const char *class_name, const char *function_name,
+                         const char *custom_string) {
+  if (!enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  TraceEvent event;
+  event.timestamp_ns = FrameStats::GetTimeNs();
+  event.tid = GetThreadId();
+  event.type = type;
+  if (type == kTraceBegin) {
+    if (custom_string && custom_string[0]) {
+      snprintf(event.name, sizeof(event.name), "%s::%s::%s", class_name, function_name,
+               custom_string);
+    } else {
+      snprintf(event.name, sizeof(event.name), "%s::%s", class_name, function_name);
+    }
+  }
+
+  uint64_t words[kSlotWords];
+  memcpy(words, &event, sizeof(words));
+
+  uint64_t index = write_index_.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = slots_[index & mask_];
+  slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (uint32_t i = 0; i < kSlotWords; i++) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.seq.store(2 * index + 2, std::memory_order_release);
+}
+
+void TraceBuffer::GetEvents(std::vector<TraceEvent> *events) const {
+  events->clear();
+  if (!enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  uint64_t end = write_index_.load(std::memory_order_acquire);
+  uint64_t size = UINT64(mask_) + 1;
+  uint64_t begin = (end > size) ? (end - size) : 0;
+  events->reserve(end - begin);
+
+  for (uint64_t index = begin; index < end; index++) {
+    const Slot &slot = slots_[index & mask_];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * index + 2) {
+      // Still being written, or already overwritten by a newer event.
+      continue;
+    }
+
+    uint64_t words[kSlotWords];
+    for (uint32_t i = 0; i < kSlotWords; i++) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+
+    TraceEvent event;
+    memcpy(&event, words, sizeof(event));
+    event.name[TraceEvent::kNameLength - 1] = '\0';
+    events->push_back(event);
+  }
+}
+
+DisplayError TraceBuffer::WriteRaw(const char *file_name, const std::vector<TraceEvent> &events) {
+  FILE *file = fopen(file_name, "wb");
+  if (!file) {
+    DLOGW("Failed to open %s", file_name);
+    return kErrorResources;
+  }
+
+  TraceFileHeader header;
+  header.num_events = UINT32(events.size());
+  bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+  if (ok && events.size()) {
+    ok = (fwrite(events.data(), sizeof(TraceEvent), events.size(), file) == events.size());
+  }
+  fclose(file);
+
+  return ok ? kErrorNone : kErrorResources;
+}
+
+DisplayError TraceBuffer::ReadRaw(const char *file_name, std::vector<TraceEvent> *events) {
+  FILE *file = fopen(file_name, "rb");
+  if (!file) {
+    DLOGW("Failed to open %s", file_name);
+    return kErrorResources;
+  }
+
+  TraceFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TraceFileHeader::kMagic ||
+      header.version != TraceFileHeader::kVersion || header.event_size != sizeof(TraceEvent)) {
+    DLOGW("%s is not a trace buffer dump", file_name);
+    fclose(file);
+    return kErrorParameters;
+  }
+
+  events->resize(header.num_events);
+  size_t count = 0;
+  if (events->size()) {
+    count = fread(events->data(), sizeof(TraceEvent), events->size(), file);
+  }
+  fclose(file);
+  if (count != events->size()) {
+    DLOGW("%s is truncated, read %zu of %u events", file_name, count, header.num_events);
+    events->resize(count);
+  }
+
+  for (auto &event : *events) {
+    event.name[TraceEvent::kNameLength - 1] = '\0';
+  }
+
+  return kErrorNone;
+}
+
+static void WriteJsonString(FILE *file, const char *str) {
+  fputc('"', file);
+  for (const char *c = str; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if (UINT8(*c) < 0x20) {
+      fprintf(file, "\\u%04x", UINT8(*c));
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+DisplayError TraceBuffer::WriteChromeJson(const char *file_name,
+                                          const std::vector<TraceEvent> &events, int pid) {
+  FILE *file = fopen(file_name, "w");
+  if (!file) {
+    DLOGW("Failed to open %s", file_name);
+    return kErrorResources;
+  }
+
+  std::map<uint32_t, uint32_t> depth;  // Open begin events per thread.
+  const char *separator = "\n";
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (const auto &event : events) {
+    uint32_t &thread_depth = depth[event.tid];
+    if (event.type == kTraceEnd) {
+      if (!thread_depth) {
+        continue;
+      }
+      thread_depth--;
+    } else {
+      thread_depth++;
+    }
+
+    fprintf(file, "%s{\"ph\":\"%s\",\"pid\":%d,\"tid\":%u,\"ts\":%" PRIu64 ".%03u", separator,
+            (event.type == kTraceEnd) ? "E" : "B", pid, event.tid, event.timestamp_ns / 1000,
+            UINT32(event.timestamp_ns % 1000));
+    if (event.type == kTraceBegin) {
+      fprintf(file, ",\"name\":");
+      WriteJsonString(file, event.name);
+    }
+    fputc('}', file);
+    separator = ",\n";
+  }
+  fprintf(file, "\n]}\n");
+
+  bool ok = !ferror(file);
+  fclose(file);
+
+  return ok ? kErrorNone : kErrorResources;
+}
+
+}  // namespace sdm
@@ -29,6 +29,7 @@
 
 #include <unistd.h>
 #include <math.h>
+#include <utils/debug.h>
 #include <utils/sys.h>
 #include <utils/utils.h>
 
@@ -64,6 +65,9 @@ void CloseFd(int *fd) {
 }
 
 DriverType GetDriverType() {
+    if (Debug::IsSimBackendEnabled()) {
+        return DriverType::SIM;
+    }
     const char *fb_caps = "/sys/devices/virtual/graphics/fb0/mdp/caps";
     // 0 - File exists
     return Sys::access_(fb_caps, F_OK) ? DriverType::DRM : DriverType::FB;
@@ -0,0 +1,46 @@
+LOCAL_PATH := $(call my-dir)
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../common.mk
+
+LOCAL_MODULE                  := sdm_replay
+LOCAL_VENDOR_MODULE           := true
+LOCAL_MODULE_TAGS             := optional
+LOCAL_C_INCLUDES              := $(common_includes) $(kernel_includes) $(LOCAL_PATH)/../libs/core
+LOCAL_HEADER_LIBRARIES        := display_headers
+LOCAL_CFLAGS                  := -fno-operator-names -fexceptions -Wno-unused-parameter \
+                                 -DLOG_TAG=\"SDM\" $(common_flags)
+LOCAL_SHARED_LIBRARIES        := libdisplaydebug libsdmcore libsdmutils libutils
+LOCAL_ADDITIONAL_DEPENDENCIES := $(common_deps)
+LOCAL_SRC_FILES               := layer_stack_replay.cpp
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../common.mk
+
+LOCAL_MODULE                  := sdm_trace_decode
+LOCAL_VENDOR_MODULE           := true
+LOCAL_MODULE_TAGS             := optional
+LOCAL_C_INCLUDES              := $(common_includes)
+LOCAL_HEADER_LIBRARIES        := display_headers
+LOCAL_CFLAGS                  := -Wno-unused-parameter -DLOG_TAG=\"SDM\" $(common_flags)
+LOCAL_SHARED_LIBRARIES        := libdisplaydebug libsdmutils
+LOCAL_ADDITIONAL_DEPENDENCIES := $(common_deps)
+LOCAL_SRC_FILES               := trace_decode.cpp
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+include $(LOCAL_PATH)/../../common.mk
+
+LOCAL_MODULE                  := sdm_format_bench
+LOCAL_VENDOR_MODULE           := true
+LOCAL_MODULE_TAGS             := optional
+LOCAL_C_INCLUDES              := $(common_includes)
+LOCAL_HEADER_LIBRARIES        := display_headers
+LOCAL_CFLAGS                  := -Wno-unused-parameter -DLOG_TAG=\"SDM\" $(common_flags)
+LOCAL_SHARED_LIBRARIES        := libdisplaydebug libsdmutils
+LOCAL_ADDITIONAL_DEPENDENCIES := $(common_deps)
+LOCAL_SRC_FILES               := format_bench.cpp
+
+include $(BUILD_EXECUTABLE)
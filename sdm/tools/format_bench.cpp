@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+* Micro benchmark of the per layer format queries made by strategy, resource and cost model code
+* on every draw cycle. Runs the queries over a fixed mix of layer formats and prints the mean cost
+* per layer.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/formats.h>
+#include <vector>
+
+namespace sdm {
+
+// Typical layer stack content: mostly RGB, some video and a few 10 bit and UBWC buffers.
+static const LayerBufferFormat kLayerFormats[] = {
+  kFormatRGBA8888, kFormatRGBA8888Ubwc, kFormatRGBX8888, kFormatBGRA8888, kFormatRGB565,
+  kFormatRGBA8888Ubwc, kFormatYCbCr420SPVenusUbwc, kFormatYCbCr420SemiPlanarVenus,
+  kFormatRGBA1010102, kFormatYCbCr420TP10Ubwc, kFormatRGBX8888Ubwc, kFormatRGBA8888,
+};
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// The queries made for one layer. The result only keeps the compiler from dropping them.
+static uint32_t QueryLayerFormat(LayerBufferFormat format) {
+  uint32_t result = IsUBWCFormat(format) ? 1 : 0;
+  result += Is10BitFormat(format) ? 2 : 0;
+  result += static_cast<uint32_t>(GetBufferFormatBpp(format) * 4.0f);
+  result += static_cast<uint32_t>(GetBufferLayout(format));
+  result += static_cast<uint32_t>(GetFormatString(format)[0]);
+  FormatTileSize tile_size;
+  if (GetBufferFormatTileSize(format, &tile_size) == kErrorNone) {
+    result += tile_size.tile_width;
+  }
+  return result;
+}
+
+static void PrintUsage(const char *name) {
+  printf("Usage: %s [options]\n", name);
+  printf("  -f <frames>      Frames to run, default 100000\n");
+  printf("  -l <layers>      Layers per frame, default 16\n");
+}
+
+static int Run(int argc, char **argv) {
+  uint32_t num_frames = 100000;
+  uint32_t num_layers = 16;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "f:l:")) != -1) {
+    switch (opt) {
+    case 'f': num_frames = static_cast<uint32_t>(atoi(optarg)); break;
+    case 'l': num_layers = static_cast<uint32_t>(atoi(optarg)); break;
+    default:
+      PrintUsage(argv[0]);
+      return -EINVAL;
+    }
+  }
+
+  if (!num_frames || !num_layers) {
+    PrintUsage(argv[0]);
+    return -EINVAL;
+  }
+
+  const uint32_t num_formats = sizeof(kLayerFormats) / sizeof(kLayerFormats[0]);
+  std::vector<LayerBufferFormat> layers(num_layers);
+  for (uint32_t i = 0; i < num_layers; i++) {
+    layers[i] = kLayerFormats[(i * 7) % num_formats];
+  }
+
+  volatile uint32_t sink = 0;
+  uint64_t start_ns = GetTimeNs();
+  for (uint32_t frame = 0; frame < num_frames; frame++) {
+    uint32_t result = 0;
+    for (auto format : layers) {
+      result += QueryLayerFormat(format);
+    }
+    sink = sink + result;
+  }
+  uint64_t elapsed_ns = GetTimeNs() - start_ns;
+
+  double per_layer_ns = static_cast<double>(elapsed_ns) / num_frames / num_layers;
+  printf("%u frames x %u layers: %.2f ns per layer, %.2f us per frame\n", num_frames, num_layers,
+         per_layer_ns, per_layer_ns * num_layers / 1000.0);
+
+  return 0;
+}
+
+}  // namespace sdm
+
+int main(int argc, char **argv) {
+  return sdm::Run(argc, argv);
+}
@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+* Benchmark of the HWC2 validate path over large layer stacks. Drives a display without hardware
+* the way SurfaceFlinger does on every frame: surface damage for all layers, validate, changed
+* composition types, accept, display requests, present and release fences, with a z-order and
+* geometry change every few frames. Layers are allocated between unrelated heap blocks so that
+* they end up scattered, as they are in a long running composer process. Prints the mean cost
+* of the validate path per frame.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+#include "hwc_display_dummy.h"
+#include "hwc_layers.h"
+
+namespace sdm {
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void PrintUsage(const char *name) {
+  printf("Usage: %s [options]\n", name);
+  printf("  -f <frames>      Frames to run, default 10000\n");
+  printf("  -l <layers>      Layers per frame, default 64\n");
+  printf("  -g <frames>      Frames between z-order and geometry changes, default 16\n");
+}
+
+static void RunFrame(HWCDisplay *display, const std::vector<hwc2_layer_t> &layer_ids,
+                     std::vector<hwc2_layer_t> *out_layers, std::vector<int32_t> *out_values) {
+  hwc_region_t damage = {0, nullptr};
+  for (auto layer_id : layer_ids) {
+    display->GetHWCLayer(layer_id)->SetLayerSurfaceDamage(damage);
+  }
+
+  uint32_t num_types = 0;
+  uint32_t num_requests = 0;
+  display->Validate(&num_types, &num_requests);
+
+  uint32_t num_elements = 0;
+  display->GetChangedCompositionTypes(&num_elements, nullptr, nullptr);
+  out_layers->resize(num_elements);
+  out_values->resize(num_elements);
+  display->GetChangedCompositionTypes(&num_elements, out_layers->data(), out_values->data());
+  display->AcceptDisplayChanges();
+
+  int32_t display_requests = 0;
+  num_elements = 0;
+  display->GetDisplayRequests(&display_requests, &num_elements, nullptr, nullptr);
+  out_layers->resize(num_elements);
+  out_values->resize(num_elements);
+  display->GetDisplayRequests(&display_requests, &num_elements, out_layers->data(),
+                              out_values->data());
+
+  int32_t retire_fence = -1;
+  display->Present(&retire_fence);
+  if (retire_fence >= 0) {
+    close(retire_fence);
+  }
+
+  num_elements = 0;
+  display->GetReleaseFences(&num_elements, nullptr, nullptr);
+  out_layers->resize(num_elements);
+  out_values->resize(num_elements);
+  display->GetReleaseFences(&num_elements, out_layers->data(), out_values->data());
+  for (auto fence : *out_values) {
+    if (fence >= 0) {
+      close(fence);
+    }
+  }
+}
+
+static int Run(int argc, char **argv) {
+  uint32_t num_frames = 10000;
+  uint32_t num_layers = 64;
+  uint32_t geometry_interval = 16;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "f:l:g:")) != -1) {
+    switch (opt) {
+    case 'f': num_frames = static_cast<uint32_t>(atoi(optarg)); break;
+    case 'l': num_layers = static_cast<uint32_t>(atoi(optarg)); break;
+    case 'g': geometry_interval = static_cast<uint32_t>(atoi(optarg)); break;
+    default:
+      PrintUsage(argv[0]);
+      return -EINVAL;
+    }
+  }
+
+  if (!num_frames || !num_layers || !geometry_interval) {
+    PrintUsage(argv[0]);
+    return -EINVAL;
+  }
+
+  HWCDisplay *display = nullptr;
+  HWCDisplayDummy::Create(nullptr, nullptr, nullptr, nullptr, 0, 0, &display);
+  if (!display) {
+    return -ENOMEM;
+  }
+
+  // Unrelated allocations between the layers keep them apart on the heap.
+  std::vector<std::unique_ptr<char[]>> spacers;
+  std::vector<hwc2_layer_t> layer_ids(num_layers);
+  for (uint32_t i = 0; i < num_layers; i++) {
+    spacers.emplace_back(new char[256 + (i * 97) % 4096]);
+    display->CreateLayer(&layer_ids[i]);
+    HWCLayer *layer = display->GetHWCLayer(layer_ids[i]);
+    int offset = static_cast<int>((i * 37) % 512);
+    layer->SetLayerDisplayFrame({offset, offset, offset + 540, offset + 960});
+    layer->SetLayerSourceCrop({0.0f, 0.0f, 540.0f, 960.0f});
+    layer->SetLayerCompositionType(HWC2::Composition::Device);
+    // Reverse order of creation, so that the stack has to be sorted.
+    display->SetLayerZOrder(layer_ids[i], num_layers - i);
+  }
+
+  std::vector<hwc2_layer_t> out_layers;
+  std::vector<int32_t> out_values;
+  uint64_t start_ns = GetTimeNs();
+  for (uint32_t frame = 0; frame < num_frames; frame++) {
+    if (!(frame % geometry_interval)) {
+      // Swap the z-order of two layers and move a third one.
+      uint32_t a = (frame * 7) % num_layers;
+      uint32_t b = (frame * 13 + 1) % num_layers;
+      uint32_t z_a = display->GetHWCLayer(layer_ids[a])->GetZ();
+      display->SetLayerZOrder(layer_ids[a], display->GetHWCLayer(layer_ids[b])->GetZ());
+      display->SetLayerZOrder(layer_ids[b], z_a);
+      int offset = static_cast<int>(frame % 256);
+      display->GetHWCLayer(layer_ids[(a + b) % num_layers])->SetLayerDisplayFrame(
+          {offset, offset, offset + 540, offset + 960});
+    }
+    RunFrame(display, layer_ids, &out_layers, &out_values);
+  }
+  uint64_t elapsed_ns = GetTimeNs() - start_ns;
+
+  printf("%u frames x %u layers: %.2f us per frame\n", num_frames, num_layers,
+         static_cast<double>(elapsed_ns) / num_frames / 1000.0);
+
+  for (auto layer_id : layer_ids) {
+    display->DestroyLayer(layer_id);
+  }
+  HWCDisplayDummy::Destroy(display);
+
+  return 0;
+}
+
+}  // namespace sdm
+
+int main(int argc, char **argv) {
+  return sdm::Run(argc, argv);
+}
@@ -0,0 +1,849 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+* Offline replay of layer stack traces recorded by HWCDisplay (vendor.display.trace_layer_stack).
+* Recorded frames are pushed through DisplayBase::Prepare and Commit on top of CompManager,
+* Strategy and ResourceDefault, with a stub hardware interface that accepts every validation.
+* This makes strategy and resource manager changes measurable on a host without a device.
+* With -c the trace is replayed concurrently on up to three displays, one thread each, to measure
+* how well composition manager calls for different displays run in parallel. With -j the DTRACE_*
+* events of the replay are recorded and written as a Chrome trace JSON file.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <core/buffer_allocator.h>
+#include <core/buffer_sync_handler.h>
+#include <utils/constants.h>
+#include <utils/layer_stack_trace.h>
+#include <utils/trace_buffer.h>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "comp_manager.h"
+#include "display_base.h"
+#include "hw_info_interface.h"
+#include "hw_interface.h"
+#include "resource_default.h"
+
+// Counts heap allocations made by the calling thread while a frame is being prepared.
+static thread_local bool count_allocations = false;
+static thread_local uint64_t num_allocations = 0;
+
+void *operator new(size_t size) {
+  if (count_allocations) {
+    num_allocations++;
+  }
+
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace sdm {
+
+static const uint32_t kMaxDisplays = 3;
+
+struct ReplayConfig {
+  uint32_t width = 1080;
+  uint32_t height = 1920;
+  uint32_t fps = 60;
+  uint32_t num_vig_pipe = 4;
+  uint32_t num_rgb_pipe = 4;
+  uint32_t num_dma_pipe = 2;
+  uint32_t num_blending_stages = 7;
+  uint32_t iterations = 1;
+  uint32_t num_displays = 1;
+  uint32_t strategy_cost_us = 0;
+  uint32_t pipe_rounds = 0;
+};
+
+// Drops log messages like the default handler and records traces into a TraceBuffer.
+class ReplayDebugHandler : public DebugHandler {
+ public:
+  virtual void Error(const char *, ...) { }
+  virtual void Warning(const char *, ...) { }
+  virtual void Info(const char *, ...) { }
+  virtual void Debug(const char *, ...) { }
+  virtual void Verbose(const char *, ...) { }
+  virtual void BeginTrace(const char *class_name, const char *function_name,
+                          const char *custom_string) {
+    trace_buffer_.Record(kTraceBegin, class_name, function_name, custom_string);
+  }
+  virtual void EndTrace() { trace_buffer_.Record(kTraceEnd, NULL, NULL, NULL); }
+  virtual int GetProperty(const char *, int *) { return -1; }
+  virtual int GetProperty(const char *, char *) { return -1; }
+
+  TraceBuffer trace_buffer_;
+};
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return UINT64(ts.tv_sec) * 1000000000ULL + UINT64(ts.tv_nsec);
+}
+
+class ReplayHWInfo : public HWInfoInterface {
+ public:
+  explicit ReplayHWInfo(const ReplayConfig &config) : config_(config) { }
+  virtual ~ReplayHWInfo() { }
+
+  virtual DisplayError GetHWResourceInfo(HWResourceInfo *hw_resource) {
+    hw_resource->num_vig_pipe = config_.num_vig_pipe;
+    hw_resource->num_rgb_pipe = config_.num_rgb_pipe;
+    hw_resource->num_dma_pipe = config_.num_dma_pipe;
+    hw_resource->num_blending_stages = config_.num_blending_stages;
+    hw_resource->max_scale_up = 20;
+    hw_resource->max_scale_down = 4;
+    hw_resource->max_mixer_width = 2560;
+    hw_resource->max_pipe_width = 2560;
+    hw_resource->is_src_split = true;
+    hw_resource->has_ubwc = true;
+    hw_resource->has_qseed3 = true;
+
+    // Pipe ids are assigned in the order VIG, RGB, DMA.
+    PipeType types[] = { kPipeTypeVIG, kPipeTypeRGB, kPipeTypeDMA };
+    uint32_t counts[] = { config_.num_vig_pipe, config_.num_rgb_pipe, config_.num_dma_pipe };
+    hw_resource->hw_pipes.clear();
+    for (uint32_t type = 0; type < 3; type++) {
+      for (uint32_t i = 0; i < counts[type]; i++) {
+        HWPipeCaps pipe_caps;
+        pipe_caps.type = types[type];
+        pipe_caps.id = UINT32(hw_resource->hw_pipes.size());
+        hw_resource->hw_pipes.push_back(pipe_caps);
+      }
+    }
+
+    return kErrorNone;
+  }
+
+  virtual DisplayError GetFirstDisplayInterfaceType(HWDisplayInterfaceInfo *hw_disp_info) {
+    hw_disp_info->type = kPrimary;
+    hw_disp_info->is_connected = true;
+    return kErrorNone;
+  }
+
+  virtual DisplayError GetDisplaysStatus(HWDisplaysInfo *hw_displays_info) {
+    return kErrorNotSupported;
+  }
+
+  virtual DisplayError GetMaxDisplaysSupported(DisplayType type, int32_t *max_displays) {
+    *max_displays = (type == kPrimary) ? 1 : 0;
+    return kErrorNone;
+  }
+
+ private:
+  const ReplayConfig &config_;
+};
+
+// Hardware interface which accepts every configuration and never produces fences. It counts the
+// number of validations so that the strategy attempts made per frame can be reported.
+class ReplayHWInterface : public HWInterface {
+ public:
+  ReplayHWInterface(const ReplayConfig &config, int32_t display_id)
+    : config_(config), display_id_(display_id) {
+    display_attributes_.x_pixels = config.width;
+    display_attributes_.y_pixels = config.height;
+    display_attributes_.fps = config.fps;
+    display_attributes_.vsync_period_ns = UINT32(1000000000L / config.fps);
+    display_attributes_.x_dpi = 400.0f;
+    display_attributes_.y_dpi = 400.0f;
+    display_attributes_.h_total = config.width;
+    display_attributes_.v_total = config.height;
+    mixer_attributes_.width = config.width;
+    mixer_attributes_.height = config.height;
+    mixer_attributes_.split_left = config.width;
+  }
+
+  uint32_t GetValidateCount() { return validate_count_; }
+  void ResetValidateCount() { validate_count_ = 0; }
+
+  virtual DisplayError Init() { return kErrorNone; }
+  virtual DisplayError Deinit() { return kErrorNone; }
+  virtual DisplayError GetDisplayId(int32_t *display_id) {
+    *display_id = display_id_;
+    return kErrorNone;
+  }
+  virtual DisplayError GetActiveConfig(uint32_t *active_config) {
+    *active_config = 0;
+    return kErrorNone;
+  }
+  virtual DisplayError GetNumDisplayAttributes(uint32_t *count) {
+    *count = 1;
+    return kErrorNone;
+  }
+  virtual DisplayError GetDisplayAttributes(uint32_t index,
+                                            HWDisplayAttributes *display_attributes) {
+    *display_attributes = display_attributes_;
+    return kErrorNone;
+  }
+  virtual DisplayError GetHWPanelInfo(HWPanelInfo *panel_info) {
+    panel_info->mode = kModeVideo;
+    panel_info->min_fps = config_.fps;
+    panel_info->max_fps = config_.fps;
+    panel_info->is_primary_panel = (display_id_ == 0);
+    panel_info->split_info.left_split = config_.width;
+    snprintf(panel_info->panel_name, sizeof(panel_info->panel_name), "replay");
+    return kErrorNone;
+  }
+  virtual DisplayError SetDisplayAttributes(uint32_t index) { return kErrorNone; }
+  virtual DisplayError SetDisplayAttributes(const HWDisplayAttributes &display_attributes) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError SetDisplayFormat(uint32_t index, DisplayInterfaceFormat pref_fmt) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetConfigIndex(char *mode, uint32_t *index) { return kErrorNotSupported; }
+  virtual DisplayError PowerOn(const HWQosData &qos_data, int *release_fence) {
+    *release_fence = -1;
+    return kErrorNone;
+  }
+  virtual DisplayError PowerOff() { return kErrorNone; }
+  virtual DisplayError Doze(const HWQosData &qos_data, int *release_fence) {
+    *release_fence = -1;
+    return kErrorNone;
+  }
+  virtual DisplayError DozeSuspend(const HWQosData &qos_data, int *release_fence) {
+    *release_fence = -1;
+    return kErrorNone;
+  }
+  virtual DisplayError Standby() { return kErrorNone; }
+  virtual DisplayError Validate(HWLayers *hw_layers) {
+    validate_count_++;
+    return kErrorNone;
+  }
+  virtual DisplayError Commit(HWLayers *hw_layers) {
+    for (Layer &hw_layer : hw_layers->info.hw_layers) {
+      hw_layer.input_buffer.release_fence_fd = -1;
+    }
+    hw_layers->info.sync_handle = -1;
+    return kErrorNone;
+  }
+  virtual DisplayError Flush(HWLayers *hw_layers) { return kErrorNone; }
+  virtual DisplayError GetPPFeaturesVersion(PPFeatureVersion *vers) { return kErrorNotSupported; }
+  virtual DisplayError SetPPFeatures(PPFeaturesConfig *feature_list) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError SetVSyncState(bool enable) { return kErrorNone; }
+  virtual void SetIdleTimeoutMs(uint32_t timeout_ms) { }
+  virtual DisplayError SetDisplayMode(const HWDisplayMode hw_display_mode) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError SetRefreshRate(uint32_t refresh_rate) { return kErrorNotSupported; }
+  virtual DisplayError SetPanelBrightness(int level) { return kErrorNotSupported; }
+  virtual DisplayError GetHWScanInfo(HWScanInfo *scan_info) { return kErrorNotSupported; }
+  virtual DisplayError GetVideoFormat(uint32_t config_index, uint32_t *video_format) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetMaxCEAFormat(uint32_t *max_cea_format) { return kErrorNotSupported; }
+  virtual DisplayError SetCursorPosition(HWLayers *hw_layers, int x, int y) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError OnMinHdcpEncryptionLevelChange(uint32_t min_enc_level) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetPanelBrightness(int *level) { return kErrorNotSupported; }
+  virtual DisplayError SetAutoRefresh(bool enable) { return kErrorNone; }
+  virtual DisplayError SetS3DMode(HWS3DMode s3d_mode) { return kErrorNotSupported; }
+  virtual DisplayError SetScaleLutConfig(HWScaleLutInfo *lut_info) { return kErrorNone; }
+  virtual DisplayError SetMixerAttributes(const HWMixerAttributes &mixer_attributes) {
+    mixer_attributes_ = mixer_attributes;
+    return kErrorNone;
+  }
+  virtual DisplayError GetMixerAttributes(HWMixerAttributes *mixer_attributes) {
+    *mixer_attributes = mixer_attributes_;
+    return kErrorNone;
+  }
+  virtual DisplayError DumpDebugData() { return kErrorNone; }
+  virtual void Dump(std::ostringstream *os) { }
+  virtual DisplayError SetDynamicDSIClock(uint64_t bit_clk_rate) { return kErrorNotSupported; }
+  virtual DisplayError GetDynamicDSIClock(uint64_t *bit_clk_rate) { return kErrorNotSupported; }
+  virtual DisplayError GetDisplayIdentificationData(uint8_t *out_port, uint32_t *out_data_size,
+                                                    uint8_t *out_data) {
+    return kErrorNotSupported;
+  }
+
+ private:
+  const ReplayConfig &config_;
+  int32_t display_id_ = 0;
+  HWDisplayAttributes display_attributes_;
+  HWMixerAttributes mixer_attributes_;
+  uint32_t validate_count_ = 0;
+};
+
+// Strategy extension which only spends the configured time selecting a strategy, standing in for
+// the cost of a real strategy library. It declines every frame so that Strategy falls back to GPU
+// composition.
+class ReplayStrategy : public StrategyInterface {
+ public:
+  explicit ReplayStrategy(uint32_t cost_us) : cost_ns_(UINT64(cost_us) * 1000) { }
+
+  virtual DisplayError Start(HWLayersInfo *hw_layers_info, uint32_t *max_attempts) {
+    uint64_t end = GetTimeNs() + cost_ns_;
+    while (GetTimeNs() < end) { }
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetNextStrategy(StrategyConstraints *constraints) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError Stop() { return kErrorNone; }
+  virtual DisplayError Reconfigure(const HWPanelInfo &hw_panel_info,
+                                   const HWResourceInfo &hw_res_info,
+                                   const HWMixerAttributes &mixer_attributes,
+                                   const DisplayConfigVariableInfo &fb_config) {
+    return kErrorNone;
+  }
+  virtual DisplayError SetCompositionState(LayerComposition composition_type, bool enable) {
+    return kErrorNone;
+  }
+  virtual DisplayError Purge() { return kErrorNone; }
+  virtual DisplayError SetIdleTimeoutMs(uint32_t active_ms) { return kErrorNone; }
+  virtual DisplayError GetCapabilities(HWDisplayCaps *caps) {
+    caps->hdr_supported = false;
+    return kErrorNotSupported;
+  }
+
+ private:
+  uint64_t cost_ns_ = 0;
+};
+
+// Extension which pairs ReplayStrategy with the default resource manager.
+class ReplayExtension : public ExtensionInterface {
+ public:
+  explicit ReplayExtension(const ReplayConfig &config) : config_(config) { }
+  virtual ~ReplayExtension() { }
+
+  virtual DisplayError CreatePartialUpdate(int32_t display_id, DisplayType type,
+                                           const HWResourceInfo &hw_resource_info,
+                                           const HWPanelInfo &hw_panel_info,
+                                           const HWMixerAttributes &mixer_attributes,
+                                           const HWDisplayAttributes &display_attributes,
+                                           const DisplayConfigVariableInfo &fb_config,
+                                           PartialUpdateInterface **interface) {
+    *interface = NULL;
+    return kErrorNotSupported;
+  }
+  virtual DisplayError DestroyPartialUpdate(PartialUpdateInterface *interface) {
+    return kErrorNone;
+  }
+  virtual DisplayError CreateStrategyExtn(int32_t display_id, DisplayType type,
+                                          BufferAllocator *buffer_allocator,
+                                          const HWResourceInfo &hw_resource_info,
+                                          const HWPanelInfo &hw_panel_info,
+                                          const HWMixerAttributes &mixer_attributes,
+                                          const DisplayConfigVariableInfo &fb_config,
+                                          StrategyInterface **interface) {
+    *interface = new ReplayStrategy(config_.strategy_cost_us);
+    return kErrorNone;
+  }
+  virtual DisplayError DestroyStrategyExtn(StrategyInterface *interface) {
+    delete interface;
+    return kErrorNone;
+  }
+  virtual DisplayError CreateResourceExtn(const HWResourceInfo &hw_resource_info,
+                                          BufferAllocator *buffer_allocator,
+                                          BufferSyncHandler *buffer_sync_handler,
+                                          ResourceInterface **interface) {
+    return ResourceDefault::CreateResourceDefault(hw_resource_info, interface);
+  }
+  virtual DisplayError DestroyResourceExtn(ResourceInterface *interface) {
+    return ResourceDefault::DestroyResourceDefault(interface);
+  }
+  virtual DisplayError CreateDppsControlExtn(DppsControlInterface **dpps_control_interface,
+                                             SocketHandler *socket_handler) {
+    *dpps_control_interface = NULL;
+    return kErrorNotSupported;
+  }
+  virtual DisplayError DestroyDppsControlExtn(DppsControlInterface *interface) {
+    return kErrorNone;
+  }
+
+ private:
+  const ReplayConfig &config_;
+};
+
+class ReplayBufferSyncHandler : public BufferSyncHandler {
+ public:
+  virtual DisplayError SyncWait(int fd) { return kErrorNone; }
+  virtual DisplayError SyncMerge(int fd1, int fd2, int *merged_fd) {
+    *merged_fd = -1;
+    return kErrorNone;
+  }
+  virtual bool IsSyncSignaled(int fd) { return true; }
+};
+
+class ReplayBufferAllocator : public BufferAllocator {
+ public:
+  virtual DisplayError AllocateBuffer(BufferInfo *buffer_info) { return kErrorNotSupported; }
+  virtual DisplayError FreeBuffer(BufferInfo *buffer_info) { return kErrorNotSupported; }
+  virtual uint32_t GetBufferSize(BufferInfo *buffer_info) { return 0; }
+  virtual DisplayError GetAllocatedBufferInfo(const BufferConfig &buffer_config,
+                                              AllocatedBufferInfo *allocated_buffer_info) {
+    return kErrorNotSupported;
+  }
+};
+
+class ReplayEventHandler : public DisplayEventHandler {
+ public:
+  virtual DisplayError VSync(const DisplayEventVSync &vsync) { return kErrorNone; }
+  virtual DisplayError Refresh() { return kErrorNone; }
+  virtual DisplayError CECMessage(char *message) { return kErrorNone; }
+  virtual DisplayError HandleEvent(DisplayEvent event) { return kErrorNone; }
+};
+
+// Display backed by ReplayHWInterface instead of a display driver. The hardware interface is
+// released by DisplayBase::Deinit.
+class ReplayDisplay : public DisplayBase {
+ public:
+  ReplayDisplay(int32_t display_id, DisplayType type, HWDeviceType device_type,
+                ReplayHWInterface *hw_intf, DisplayEventHandler *event_handler,
+                HWInfoInterface *hw_info_intf, BufferSyncHandler *buffer_sync_handler,
+                BufferAllocator *buffer_allocator, CompManager *comp_manager)
+    : DisplayBase(display_id, type, event_handler, device_type, buffer_sync_handler,
+                  buffer_allocator, comp_manager, hw_info_intf), replay_hw_intf_(hw_intf) { }
+
+  virtual DisplayError Init() {
+    lock_guard<recursive_mutex> obj(recursive_mutex_);
+    hw_intf_ = replay_hw_intf_;
+    return DisplayBase::Init();
+  }
+  virtual DisplayError Prepare(LayerStack *layer_stack) {
+    lock_guard<recursive_mutex> obj(recursive_mutex_);
+    hw_layers_ = HWLayers();
+    return DisplayBase::Prepare(layer_stack);
+  }
+  virtual DisplayError SetRefreshRate(uint32_t refresh_rate, bool final_rate) {
+    return kErrorNotSupported;
+  }
+
+ private:
+  ReplayHWInterface *replay_hw_intf_ = NULL;
+};
+
+// Layers of one recorded frame. Frames are kept in a std::list so that the layer pointers held
+// by each LayerStack stay valid.
+struct ReplayFrame {
+  std::vector<Layer> layers;
+  LayerStack layer_stack;
+};
+
+struct ReplayStats {
+  std::vector<uint64_t> prepare_ns;
+  std::vector<uint64_t> commit_ns;
+  std::vector<uint32_t> validate_count;
+  std::vector<uint64_t> allocations;
+  std::vector<uint32_t> sde_layers;
+  uint32_t num_errors = 0;
+};
+
+template <class T>
+static T Percentile(std::vector<T> values, uint32_t percent) {
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t index = (values.size() - 1) * percent / 100;
+
+  return values[index];
+}
+
+template <class T>
+static void PrintDistribution(const char *name, const std::vector<T> &values, uint64_t divisor) {
+  double total = 0.0;
+  for (T value : values) {
+    total += static_cast<double>(value);
+  }
+  double mean = values.empty() ? 0.0 : total / static_cast<double>(values.size());
+  double div = static_cast<double>(divisor);
+
+  printf("%-12s mean %10.2f  p50 %10.2f  p90 %10.2f  p99 %10.2f  max %10.2f\n", name,
+         mean / div, static_cast<double>(Percentile(values, 50)) / div,
+         static_cast<double>(Percentile(values, 90)) / div,
+         static_cast<double>(Percentile(values, 99)) / div,
+         static_cast<double>(Percentile(values, 100)) / div);
+}
+
+static DisplayError LoadTrace(const char *file_name, std::list<ReplayFrame> *frames) {
+  LayerStackTrace trace;
+  DisplayError error = trace.Open(file_name, false /* record */);
+  if (error != kErrorNone) {
+    return error;
+  }
+
+  while (true) {
+    frames->emplace_back();
+    ReplayFrame &frame = frames->back();
+    error = trace.Read(&frame.layer_stack, &frame.layers);
+    if (error != kErrorNone) {
+      frames->pop_back();
+      break;
+    }
+  }
+
+  return (error == kErrorUndefined) ? kErrorNone : error;
+}
+
+static void ReplayFrames(const ReplayConfig &config, const std::list<ReplayFrame> &frames,
+                         ReplayDisplay *display, ReplayHWInterface *hw_intf,
+                         ReplayStats *stats) {
+  // Prepare modifies the layers, so every frame is replayed from a scratch copy. The copy is made
+  // outside the measured region.
+  std::vector<Layer> layers;
+  LayerStack layer_stack;
+  size_t num_frames = frames.size() * config.iterations;
+
+  stats->prepare_ns.reserve(num_frames);
+  stats->commit_ns.reserve(num_frames);
+  stats->validate_count.reserve(num_frames);
+  stats->allocations.reserve(num_frames);
+  stats->sde_layers.reserve(num_frames);
+
+  for (uint32_t iteration = 0; iteration < config.iterations; iteration++) {
+    for (const ReplayFrame &frame : frames) {
+      layers = frame.layers;
+      layer_stack.flags = frame.layer_stack.flags;
+      layer_stack.layers.clear();
+      for (Layer &layer : layers) {
+        layer_stack.layers.push_back(&layer);
+      }
+      hw_intf->ResetValidateCount();
+
+      num_allocations = 0;
+      count_allocations = true;
+      uint64_t start = GetTimeNs();
+      DisplayError error = display->Prepare(&layer_stack);
+      uint64_t prepared = GetTimeNs();
+      count_allocations = false;
+
+      if (error == kErrorNone) {
+        error = display->Commit(&layer_stack);
+      }
+      uint64_t committed = GetTimeNs();
+
+      if (error != kErrorNone && error != kErrorNotValidated) {
+        stats->num_errors++;
+      }
+
+      stats->prepare_ns.push_back(prepared - start);
+      stats->commit_ns.push_back(committed - prepared);
+      stats->validate_count.push_back(hw_intf->GetValidateCount());
+      stats->allocations.push_back(num_allocations);
+
+      uint32_t sde_layers = 0;
+      for (Layer *layer : layer_stack.layers) {
+        sde_layers += (layer->composition == kCompositionSDE) ? 1 : 0;
+      }
+      stats->sde_layers.push_back(sde_layers);
+    }
+  }
+}
+
+// Drives the default resource manager directly. Every round each display reserves pipes for a
+// GPU target whose size and scaling vary, and one display is purged, so pipes keep moving between
+// hw blocks.
+static void BenchmarkPipes(const ReplayConfig &config, HWResourceInfo hw_resource) {
+  const DisplayType display_types[kMaxDisplays] = { kPrimary, kHDMI, kVirtual };
+  ResourceInterface *resource_intf = NULL;
+  Handle display_ctx[kMaxDisplays] = {};
+  HWDisplayAttributes display_attributes;
+  HWPanelInfo panel_info;
+  HWMixerAttributes mixer_attributes;
+
+  // Pipes are limited to the panel width, so full mixer width layers need two of them.
+  hw_resource.max_pipe_width = config.width;
+  if (ResourceDefault::CreateResourceDefault(hw_resource, &resource_intf) != kErrorNone ||
+      !resource_intf) {
+    printf("Failed to create resource manager\n");
+    return;
+  }
+
+  // Half width, full width and a downscaled layer which needs a scaling pipe.
+  float width = FLOAT(std::min(config.width * 2, hw_resource.max_mixer_width));
+  float height = FLOAT(config.height);
+  display_attributes.x_pixels = UINT32(width);
+  display_attributes.y_pixels = config.height;
+  display_attributes.fps = config.fps;
+  mixer_attributes.width = UINT32(width);
+  mixer_attributes.height = config.height;
+  mixer_attributes.split_left = UINT32(width);
+
+  for (uint32_t i = 0; i < config.num_displays; i++) {
+    resource_intf->RegisterDisplay(INT32(i), display_types[i], display_attributes, panel_info,
+                                   mixer_attributes, &display_ctx[i]);
+  }
+
+  Layer layer;
+  layer.composition = kCompositionGPUTarget;
+  layer.input_buffer.format = kFormatRGBA8888;
+  layer.input_buffer.width = UINT32(width);
+  layer.input_buffer.height = config.height;
+  layer.input_buffer.unaligned_width = UINT32(width);
+  layer.input_buffer.unaligned_height = config.height;
+  layer.plane_alpha = 255;
+  const LayerRect dst_rects[] = { LayerRect(0.0f, 0.0f, width / 2, height),
+                                  LayerRect(0.0f, 0.0f, width, height),
+                                  LayerRect(0.0f, 0.0f, width / 4, height / 2) };
+  uint32_t num_rects = sizeof(dst_rects) / sizeof(dst_rects[0]);
+
+  std::vector<uint64_t> prepare_ns;
+  uint32_t num_errors = 0;
+  prepare_ns.reserve(config.pipe_rounds * config.num_displays);
+
+  for (uint32_t round = 0; round < config.pipe_rounds; round++) {
+    for (uint32_t i = 0; i < config.num_displays; i++) {
+      HWLayers hw_layers;
+      layer.dst_rect = dst_rects[(round + i) % num_rects];
+      layer.src_rect = LayerRect(0.0f, 0.0f, layer.dst_rect.right, layer.dst_rect.bottom);
+      if ((round + i) % num_rects == 2) {
+        layer.src_rect = LayerRect(0.0f, 0.0f, width / 2, height);
+      }
+      hw_layers.info.hw_layers.push_back(layer);
+      hw_layers.info.sync_handle = -1;
+
+      uint64_t start = GetTimeNs();
+      resource_intf->Start(display_ctx[i]);
+      DisplayError error = resource_intf->Prepare(display_ctx[i], &hw_layers);
+      resource_intf->Stop(display_ctx[i], &hw_layers);
+      prepare_ns.push_back(GetTimeNs() - start);
+
+      if (error != kErrorNone) {
+        num_errors++;
+      } else {
+        resource_intf->PostCommit(display_ctx[i], &hw_layers);
+      }
+    }
+    resource_intf->Purge(display_ctx[round % config.num_displays]);
+  }
+
+  for (uint32_t i = 0; i < config.num_displays; i++) {
+    resource_intf->UnregisterDisplay(display_ctx[i]);
+  }
+  ResourceDefault::DestroyResourceDefault(resource_intf);
+
+  printf("Reserved pipes %zu times on %d displays, %d failed\n", prepare_ns.size(),
+         config.num_displays, num_errors);
+  PrintDistribution("reserve(ns)", prepare_ns, 1);
+}
+
+static void PrintUsage(const char *name) {
+  printf("Usage: %s [options] <trace file>\n", name);
+  printf("       %s [options] -p <rounds>\n", name);
+  printf("  -w <width>       Panel width, default 1080\n");
+  printf("  -h <height>      Panel height, default 1920\n");
+  printf("  -f <fps>         Panel refresh rate, default 60\n");
+  printf("  -v <count>       Number of VIG pipes, default 4\n");
+  printf("  -r <count>       Number of RGB pipes, default 4\n");
+  printf("  -d <count>       Number of DMA pipes, default 2\n");
+  printf("  -s <count>       Number of blending stages, default 7\n");
+  printf("  -n <iterations>  Number of times the trace is replayed, default 1\n");
+  printf("  -c <displays>    Number of displays replaying concurrently, 1 to 3, default 1\n");
+  printf("  -t <us>          Simulated strategy selection time per frame, default 0\n");
+  printf("  -p <rounds>      Benchmark pipe reservation churn across displays, no trace needed\n");
+  printf("  -j <file>        Write a Chrome trace JSON timeline of the replay to file\n");
+}
+
+static int Replay(int argc, char **argv) {
+  ReplayConfig config;
+  const char *json_file = NULL;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "w:h:f:v:r:d:s:n:c:t:p:j:")) != -1) {
+    uint32_t value = UINT32(strtoul(optarg, NULL, 0));
+    switch (opt) {
+    case 'j': json_file = optarg; break;
+    case 'w': config.width = value; break;
+    case 'h': config.height = value; break;
+    case 'f': config.fps = value; break;
+    case 'v': config.num_vig_pipe = value; break;
+    case 'r': config.num_rgb_pipe = value; break;
+    case 'd': config.num_dma_pipe = value; break;
+    case 's': config.num_blending_stages = value; break;
+    case 'n': config.iterations = value; break;
+    case 'c': config.num_displays = value; break;
+    case 't': config.strategy_cost_us = value; break;
+    case 'p': config.pipe_rounds = value; break;
+    default:
+      PrintUsage(argv[0]);
+      return -EINVAL;
+    }
+  }
+
+  if ((optind >= argc && !config.pipe_rounds) || !config.width || !config.height || !config.fps ||
+      config.num_rgb_pipe < 2 || !config.num_displays || config.num_displays > kMaxDisplays) {
+    PrintUsage(argv[0]);
+    return -EINVAL;
+  }
+
+  if (config.pipe_rounds) {
+    ReplayHWInfo hw_info(config);
+    HWResourceInfo hw_resource;
+    hw_info.GetHWResourceInfo(&hw_resource);
+    BenchmarkPipes(config, hw_resource);
+    return 0;
+  }
+
+  std::list<ReplayFrame> frames;
+  DisplayError error = LoadTrace(argv[optind], &frames);
+  if (error != kErrorNone || frames.empty()) {
+    printf("Failed to load trace %s, error = %d\n", argv[optind], error);
+    return -EINVAL;
+  }
+
+  static ReplayDebugHandler debug_handler;
+  if (json_file) {
+    debug_handler.trace_buffer_.Init(1 << 18);
+    DebugHandler::Set(&debug_handler);
+  }
+
+  ReplayHWInfo hw_info(config);
+  ReplayExtension extension(config);
+  ReplayBufferSyncHandler buffer_sync_handler;
+  ReplayBufferAllocator buffer_allocator;
+  ReplayEventHandler event_handler;
+  HWResourceInfo hw_resource;
+  CompManager comp_manager;
+
+  hw_info.GetHWResourceInfo(&hw_resource);
+  // The replay extension is only needed to simulate strategy cost, without it the default
+  // strategy and resource manager are measured.
+  error = comp_manager.Init(hw_resource, config.strategy_cost_us ? &extension : NULL,
+                            &buffer_allocator, &buffer_sync_handler, NULL /* socket_handler */);
+  if (error != kErrorNone) {
+    printf("CompManager init failed, error = %d\n", error);
+    return -EINVAL;
+  }
+
+  // One display of each type the default resource manager can drive.
+  const DisplayType display_types[kMaxDisplays] = { kPrimary, kHDMI, kVirtual };
+  const HWDeviceType device_types[kMaxDisplays] = { kDevicePrimary, kDeviceHDMI, kDeviceVirtual };
+  ReplayHWInterface *hw_intf[kMaxDisplays] = {};
+  ReplayDisplay *display[kMaxDisplays] = {};
+  uint32_t num_displays = 0;
+  int release_fence = -1;
+
+  for (; num_displays < config.num_displays; num_displays++) {
+    uint32_t i = num_displays;
+    hw_intf[i] = new ReplayHWInterface(config, INT32(i));
+    display[i] = new ReplayDisplay(INT32(i), display_types[i], device_types[i], hw_intf[i],
+                                   &event_handler, &hw_info, &buffer_sync_handler,
+                                   &buffer_allocator, &comp_manager);
+    error = display[i]->Init();
+    if (error != kErrorNone) {
+      printf("Display %d init failed, error = %d\n", i, error);
+      delete display[i];
+      delete hw_intf[i];
+      break;
+    }
+
+    display[i]->SetDisplayState(kStateOn, &release_fence);
+  }
+
+  ReplayStats stats[kMaxDisplays];
+  uint64_t start = GetTimeNs();
+  if (num_displays == config.num_displays) {
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < num_displays; i++) {
+      threads.emplace_back(ReplayFrames, std::cref(config), std::cref(frames), display[i],
+                           hw_intf[i], &stats[i]);
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+  uint64_t elapsed_ns = GetTimeNs() - start;
+
+  for (uint32_t i = 0; i < num_displays; i++) {
+    display[i]->SetDisplayState(kStateOff, &release_fence);
+    display[i]->Deinit();
+    delete display[i];
+  }
+  comp_manager.Deinit();
+
+  if (num_displays != config.num_displays) {
+    return -EINVAL;
+  }
+
+  for (uint32_t i = 1; i < num_displays; i++) {
+    ReplayStats &total = stats[0];
+    total.prepare_ns.insert(total.prepare_ns.end(), stats[i].prepare_ns.begin(),
+                            stats[i].prepare_ns.end());
+    total.commit_ns.insert(total.commit_ns.end(), stats[i].commit_ns.begin(),
+                           stats[i].commit_ns.end());
+    total.validate_count.insert(total.validate_count.end(), stats[i].validate_count.begin(),
+                                stats[i].validate_count.end());
+    total.allocations.insert(total.allocations.end(), stats[i].allocations.begin(),
+                             stats[i].allocations.end());
+    total.sde_layers.insert(total.sde_layers.end(), stats[i].sde_layers.begin(),
+                            stats[i].sde_layers.end());
+    total.num_errors += stats[i].num_errors;
+  }
+
+  printf("Replayed %zu frames (%zu recorded x %d x %d displays), %d errors\n",
+         stats[0].prepare_ns.size(), frames.size(), config.iterations, num_displays,
+         stats[0].num_errors);
+  printf("throughput   %.1f frames/s\n", static_cast<double>(stats[0].prepare_ns.size()) *
+         1000000000.0 / static_cast<double>(elapsed_ns ? elapsed_ns : 1));
+  PrintDistribution("prepare(us)", stats[0].prepare_ns, 1000);
+  PrintDistribution("commit(us)", stats[0].commit_ns, 1000);
+  PrintDistribution("validates", stats[0].validate_count, 1);
+  PrintDistribution("allocations", stats[0].allocations, 1);
+  PrintDistribution("sde layers", stats[0].sde_layers, 1);
+
+  if (json_file) {
+    std::vector<TraceEvent> events;
+    debug_handler.trace_buffer_.GetEvents(&events);
+    if (TraceBuffer::WriteChromeJson(json_file, events, getpid()) != kErrorNone) {
+      printf("Failed to write %s\n", json_file);
+      return -EINVAL;
+    }
+    printf("Wrote %zu trace events to %s\n", events.size(), json_file);
+  }
+
+  return 0;
+}
+
+}  // namespace sdm
+
+int main(int argc, char **argv) {
+  return sdm::Replay(argc, argv);
+}
@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+* Offline decoder for raw trace buffer dumps (QService DUMP_TRACE_BUFFER with raw set). Converts a
+* dump into a Chrome trace JSON file and prints the duration of each traced scope.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/trace_buffer.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdm {
+
+struct ScopeSummary {
+  uint64_t count = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+};
+
+static void PrintSummary(const std::vector<TraceEvent> &events) {
+  std::map<uint32_t, std::vector<const TraceEvent *>> open_scopes;  // Begin events per thread.
+  std::map<std::string, ScopeSummary> summaries;
+
+  for (const auto &event : events) {
+    std::vector<const TraceEvent *> &scopes = open_scopes[event.tid];
+    if (event.type == kTraceBegin) {
+      scopes.push_back(&event);
+      continue;
+    }
+
+    if (scopes.empty()) {
+      continue;  // Begin was overwritten in the ring.
+    }
+
+    const TraceEvent *begin = scopes.back();
+    scopes.pop_back();
+    uint64_t duration_ns = event.timestamp_ns - std::min(event.timestamp_ns, begin->timestamp_ns);
+    ScopeSummary &summary = summaries[begin->name];
+    summary.count++;
+    summary.total_ns += duration_ns;
+    summary.max_ns = std::max(summary.max_ns, duration_ns);
+  }
+
+  typedef std::pair<std::string, ScopeSummary> ScopeEntry;
+  std::vector<ScopeEntry> sorted(summaries.begin(), summaries.end());
+  std::sort(sorted.begin(), sorted.end(), [](const ScopeEntry &a, const ScopeEntry &b) {
+    return a.second.total_ns > b.second.total_ns;
+  });
+
+  printf("%-48s %8s %12s %10s %10s\n", "scope", "count", "total(us)", "mean(us)", "max(us)");
+  for (const auto &entry : sorted) {
+    const ScopeSummary &summary = entry.second;
+    printf("%-48s %8llu %12llu %10llu %10llu\n", entry.first.c_str(),
+           static_cast<unsigned long long>(summary.count),
+           static_cast<unsigned long long>(summary.total_ns / 1000),
+           static_cast<unsigned long long>(summary.total_ns / summary.count / 1000),
+           static_cast<unsigned long long>(summary.max_ns / 1000));
+  }
+}
+
+static void PrintUsage(const char *name) {
+  printf("Usage: %s [options] <raw dump> [json file]\n", name);
+  printf("  -p <pid>         Process id written to the JSON events, default 0\n");
+  printf("  -s               Print per scope durations\n");
+}
+
+static int Decode(int argc, char **argv) {
+  int pid = 0;
+  bool summary = false;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "p:s")) != -1) {
+    switch (opt) {
+    case 'p': pid = atoi(optarg); break;
+    case 's': summary = true; break;
+    default:
+      PrintUsage(argv[0]);
+      return -EINVAL;
+    }
+  }
+
+  if (optind >= argc || (optind + 1 >= argc && !summary)) {
+    PrintUsage(argv[0]);
+    return -EINVAL;
+  }
+
+  std::vector<TraceEvent> events;
+  if (TraceBuffer::ReadRaw(argv[optind], &events) != kErrorNone) {
+    printf("Failed to read %s\n", argv[optind]);
+    return -EINVAL;
+  }
+
+  if (optind + 1 < argc) {
+    if (TraceBuffer::WriteChromeJson(argv[optind + 1], events, pid) != kErrorNone) {
+      printf("Failed to write %s\n", argv[optind + 1]);
+      return -EINVAL;
+    }
+    printf("Wrote %zu trace events to %s\n", events.size(), argv[optind + 1]);
+  }
+
+  if (summary) {
+    PrintSummary(events);
+  }
+
+  return 0;
+}
+
+}  // namespace sdm
+
+int main(int argc, char **argv) {
+  return sdm::Decode(argc, argv);
+}